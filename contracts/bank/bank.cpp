@@ -12,6 +12,7 @@
 #include <cctype>
 // #include <cmath>
 #include <algorithm>
+#include <limits>
 
 
 using namespace eosio;
@@ -38,23 +39,41 @@ ACTION bank::transfer(name from, name to, asset quantity, string memo)
 	if((from != BANKACCOUNT && to != BANKACCOUNT) || memo == "deny") {
 		process_regular_transfer(from, to, quantity, memo);
 		if(memo == "deny") {
-			check_on_system_change();
+			check_on_system_change(false, from);
+		}
+		else {
+			accrue_metric("p2p"_n, from, quantity.symbol == DUSD ? quantity.amount : 0);
 		}
 	}
 
 	// if transfer from _self then do service transfer
 	else if(from == BANKACCOUNT) {
 		process_service_transfer(from, to, quantity, memo);
-		check_on_system_change();
+		check_on_system_change(false, to);
 		return;
 	}
 
 	// if to == _self and asset is DUSD
 	else if(quantity.symbol == DUSD) {
+		// redemption intent waits for settlement of batch epoch
+		bool batch_for_eos = match_memo(memo, "Batch redeem for EOS");
+		if(batch_for_eos || match_memo(memo, "Batch redeem for DBTC")) {
+			process_batch_intent(from, quantity, batch_for_eos ? EOS.code() : DBTC.code());
+			return;
+		}
+		// redemption, which cannot be filled now, waits in queue instead of failing; redemption paid out
+		// directly passed can_redeem_now(), so it does not take payments of batch intents
+		if(is_dusd_redeem(from, to, extended_asset(quantity, _self), memo) && must_queue_redeem(from, quantity, memo)) {
+			process_queue_redeem(from, to, quantity, memo);
+			return;
+		}
 		check_on_transfer(from, to, {quantity, BANKACCOUNT}, memo);
 		// if user transfers dusd to buy dps
 		if(match_memo(memo,"Buy DPS"))
 			process_exchange_DUSD_for_DPS(from, to, quantity, memo);
+		// if user deposits dusd to savings vault
+		else if(match_memo(memo, "Deposit to savings"))
+			process_savings_deposit(from, to, quantity, memo);
 		// if transfer is to redeem dusd for dbtc/btc/eos
 		else if(is_dusd_redeem(from, to, extended_asset(quantity, _self), memo)) {
 			bool valid_transfer = false;
@@ -84,7 +103,7 @@ ACTION bank::transfer(name from, name to, asset quantity, string memo)
 		// if dbond-connected transfer
 		else if(is_dbond_contract(from)) {
 			process_regular_transfer(from, to, quantity, memo);
-			check_on_system_change();
+			check_on_system_change(false, from);
 			SEND_INLINE_ACTION(*this, blncsppl, {{_self, "active"_n}}, {});
 		}
 		else
@@ -123,7 +142,7 @@ void bank::ontransfer(name from, name to, asset quantity, const string& memo) {
 
 	// if I recieve a dbond as collateral (payment was sent earlier)
 	else if(is_dbond_contract(token_contract)) {
-		check_on_system_change();
+		check_on_system_change(false, from);
 	}
 
 	else {
@@ -132,6 +151,11 @@ void bank::ontransfer(name from, name to, asset quantity, const string& memo) {
 		if(!is_approved_liquid_asset(ex_asset)) {
 			fail("transfer not allowed 6");
 		}
+		// mint intent waits for settlement of batch epoch, payment is not bank's till then
+		if(match_memo(memo, "Batch buy DUSD")) {
+			process_batch_intent(from, quantity, DUSD.code());
+			return;
+		}
 		// if DUSD mint request
 		if(is_dusd_mint(from, to, ex_asset, memo)) {
 			check_on_transfer(from, to, ex_asset, memo);
@@ -164,7 +188,9 @@ void bank::ontransfer(name from, name to, asset quantity, const string& memo) {
 		}
 		// if technical internal transaction (ex. rebalancing portfolio)
 		else if(is_technical_transfer(token_contract, from, quantity, memo)) {
-			// nothing to do, look at the bottom
+			// DBTC minted by custodian for 'balancehedge' order has the order id in memo
+			if(from == CUSTODIAN)
+				settle_hedge_withdrawal(memo);
 		}
 		else
 			fail("transfer not allowed 9");
@@ -180,7 +206,7 @@ ACTION bank::issue( name to, asset quantity, string memo ) {
 		SEND_INLINE_ACTION(*this, blncsppl, {{_self, "active"_n}}, {});
 	}
 	else
-		check_on_system_change(true);
+		check_on_system_change(true, to);
 }
 
 ACTION bank::retire( asset quantity, string memo ) {
@@ -196,7 +222,11 @@ ACTION bank::retire( asset quantity, string memo ) {
 }
 
 ACTION bank::setvar(name scope, name varname, int64_t value) {
+	bool bitmex_report = scope == PERIODIC_SCOPE && varname == "btc.bitmex"_n;
+	int64_t bitmex_before = bitmex_report ? get_variable("btc.bitmex"_n, PERIODIC_SCOPE, value) : 0;
 	token::setvar(scope, varname, value);
+	if(bitmex_report)
+		settle_bitmex_change(value - bitmex_before);
 
 	// balance DUSD supply:
 	// issue or retire tokens to keep supply equal to current USD value of BTC reserves
@@ -216,12 +246,30 @@ ACTION bank::setvar(name scope, name varname, int64_t value) {
 ACTION bank::authdbond(name dbond_contract, dbond_id_class dbond_id) {
 	require_auth(ADMINACCOUNT);
 	authorized_dbonds dblist(_self, _self.value);
+	dbond_dues dues(_self, _self.value);
 	auto existing = dblist.find(dbond_id.raw());
-	check(existing == dblist.end(), "dbond with this dbond_id is authorized already");
+	// dbonds other than fc_dbonds are never due for sweep
+	dbonds::fc_dbond_stats fc_info;
+	bool is_fc = dbonds::get_fc_dbond(dbond_contract, dbond_id, fc_info);
+	check(existing == dblist.end() || (is_fc && existing->contract == dbond_contract && dues.find(dbond_id.raw()) == dues.end()),
+		"dbond with this dbond_id is authorized already");
+	if(is_fc) {
+		dues.emplace(_self, [&](auto& d) {
+			d.dbond = dbond_id;
+			d.maturity_time = fc_info.dbond.maturity_time;
+			d.retire_time = fc_info.dbond.retire_time;
+			d.matured = false;
+		});
+	}
+	// dbond authorized before due times were kept is confirmed already
+	if(existing != dblist.end())
+		return;
 	dblist.emplace(_self, [&](auto& db) {
 		db.dbond = dbond_id;
 		db.contract = dbond_contract;
 	});
+	if(is_fc)
+		cache_fc_dbond_accrual(fc_info);
 	action(
 		permission_level{_self, "active"_n},
 		dbond_contract, "confirmfcdb"_n,
@@ -294,7 +342,7 @@ void bank::splitToDev(const asset& quantity, asset& toDev) {
 }
 
 ACTION bank::blncsppl() {
-	// TODO: consider in-flight redeem transactions to bitmex account
+	// DBTC in flight to bitmex account is counted by get_bank_assets_value()
 
 	int64_t targetSupplyCents = get_bank_assets_value();
 
@@ -323,6 +371,476 @@ ACTION bank::blncsppl() {
 	}
 }
 
+ACTION bank::checkinvars() {
+	// no ledger row and no ledger shards mean that token has never been moved, so its supply must be zero
+	auto held = [](name token_contract, const symbol& sym) {
+		ledger ldg(token_contract, token_contract.value);
+		auto itr = ldg.find(sym.code().raw());
+		int64_t issuer_held = itr == ldg.end() ? 0 : itr->issuer_held.amount;
+		return issuer_held + get_users_held(token_contract, sym);
+	};
+
+	// transfer fees not swept yet are held by nobody, but they are counted in supply
+	for(const auto& sym : {DUSD, DPS}) {
+		int64_t supply = get_supply(_self, sym.code()).amount;
+		int64_t fees = get_shards_total<fee_shards>(sym.code().raw());
+		print("\n", sym.code(), " supply: ", supply, " held: ", held(_self, sym), " fees to sweep: ", fees);
+		check(held(_self, sym) + fees == supply, "ledger totals do not match token supply");
+	}
+
+	// DBTC running totals are kept by custodian
+	check(held(CUSTODIAN, DBTC) == get_supply(CUSTODIAN, DBTC.code()).amount,
+		"DBTC ledger totals do not match token supply");
+
+	// liabilities against assets, dbonds are taken at value saved by last supply balancing,
+	// BTC in flight between bank and bitmex is counted as get_bank_assets_value() does, payments of batch intents are not
+	batch_epoch pending  = get_batch_epoch();
+	int64_t dbtc_value   = get_btc_value(get_balance(BITMEXACC, BTC) + get_balance(BANKACCOUNT, DBTC) - pending.dbtc
+			+ get_variable("hedge.topup"_n, STAT_SCOPE) + get_variable("hedge.xfer"_n, STAT_SCOPE));
+	int64_t eos_value    = get_eos_value(get_balance(BANKACCOUNT, EOS) - pending.eos);
+	int64_t dbonds_value = get_cached_dbonds_assets_value();
+	int64_t savings_value = get_savings_value();
+	int64_t assets_value = dbtc_value + eos_value + dbonds_value - savings_value;
+
+	int64_t dusd_users_held = get_users_held(_self, DUSD);
+	int64_t dusd_supply = get_supply(_self, DUSD.code()).amount;
+	int64_t max_supply_error = get_variable("maxsupplerr"_n, SYSTEM_SCOPE) / 1000000;
+
+	print("\nassets: BTC ", dbtc_value, " EOS ", eos_value, " dbonds ", dbonds_value, " savings ", -savings_value,
+		" total ", assets_value);
+	check(dusd_users_held <= assets_value + max_supply_error, "DUSD held by users exceeds bank assets value");
+	check(std::abs(assets_value - dusd_supply) <= max_supply_error, "DUSD supply differs from bank assets value more than maxsupplerr");
+}
+
+ACTION bank::commitpol(checksum256 root, asset total, time_point snapshot_time) {
+	require_auth(ADMINACCOUNT);
+
+	auto sym_code_raw = total.symbol.code().raw();
+	stats statstable(_self, sym_code_raw);
+	const auto& st = statstable.get(sym_code_raw, "symbol does not exist");
+	check(total.symbol == st.supply.symbol, "symbol precision mismatch");
+	check(total.amount >= 0, "total must not be negative");
+	check(total <= st.supply, "total liabilities exceed token supply");
+
+	polroots roots(_self, sym_code_raw);
+	auto itr = roots.find(sym_code_raw);
+	auto fill = [&](auto& r) {
+		r.total         = total;
+		r.supply        = st.supply;
+		r.root          = root;
+		r.snapshot_time = snapshot_time;
+		r.mtime         = current_time_point();
+	};
+	if(itr == roots.end())
+		roots.emplace(_self, fill);
+	else
+		roots.modify(itr, same_payer, fill);
+}
+
+ACTION bank::verifypol(name owner, asset balance, const vector<pol_proof_node>& path) {
+	auto sym_code_raw = balance.symbol.code().raw();
+	polroots roots(_self, sym_code_raw);
+	const auto& committed = roots.get(sym_code_raw, "no liabilities root committed for this token");
+	check(balance.symbol == committed.total.symbol, "symbol precision mismatch");
+	check(balance.amount >= 0, "balance must not be negative");
+
+	checksum256 hash = pol_leaf_hash(owner, balance.amount);
+	int64_t sum = balance.amount;
+	for(const auto& sibling : path) {
+		// non-negative sums bounded by total keep a prover from hiding liabilities
+		check(sibling.sum >= 0 && sibling.sum <= committed.total.amount, "bad sum in proof");
+		if(sibling.is_left)
+			hash = pol_node_hash(sibling.hash, sibling.sum, hash, sum);
+		else
+			hash = pol_node_hash(hash, sum, sibling.hash, sibling.sum);
+		sum += sibling.sum;
+		check(sum <= committed.total.amount, "sum in proof exceeds committed total");
+	}
+	check(hash == committed.root, "proof does not match committed root");
+	check(sum == committed.total.amount, "proof sum does not match committed total");
+
+	print("\n", owner, " ", balance, " is included in liabilities ", committed.total);
+}
+
+ACTION bank::rebalance() {
+	rebalance_hedge();
+}
+
+ACTION bank::sweepshards() {
+	for(const auto& sym : {DUSD, DPS}) {
+		int64_t fees = fold_shards<fee_shards>(sym.code().raw());
+		if(fees != 0)
+			add_balance(_self, asset(fees, sym), _self);
+		fold_ledger(sym);
+	}
+	fold_used_volume();
+	fold_metrics();
+}
+
+ACTION bank::snapshot() {
+	require_auth(ADMINACCOUNT);
+	int64_t id = get_variable("dps.snapshot"_n, STAT_SCOPE) + 1;
+	set_variable("dps.snapshot"_n, id, STAT_SCOPE);
+	print("\nsnapshot ", id);
+}
+
+ACTION bank::balanceat(name owner, uint64_t snapshot_id) {
+	check(snapshot_id > 0 && snapshot_id <= uint64_t(get_variable("dps.snapshot"_n, STAT_SCOPE)), "snapshot not found");
+	accounts acnts(_self, owner.value);
+	auto itr = acnts.find(DPS.code().raw());
+	asset current = itr == acnts.end() ? asset(0, DPS) : itr->balance;
+	print(get_checkpointed<balance_checkpoints>(_self, owner.value, snapshot_id, current));
+}
+
+ACTION bank::supplyat(uint64_t snapshot_id) {
+	check(snapshot_id > 0 && snapshot_id <= uint64_t(get_variable("dps.snapshot"_n, STAT_SCOPE)), "snapshot not found");
+	asset current = get_supply(_self, DPS.code());
+	print(get_checkpointed<supply_checkpoints>(_self, DPS.code().raw(), snapshot_id, current));
+}
+
+ACTION bank::distribute(asset profit) {
+	require_auth(ADMINACCOUNT);
+	check(profit.symbol == DUSD, "only DUSD profit allowed");
+	check(profit.amount > 0, "must distribute positive quantity");
+	check(profit.amount <= get_bank_capital_value(), "profit exceeds bank capital");
+
+	// transfer fees not swept yet are bank's DPS too
+	int64_t dps_in_circulation = get_supply(_self, DPS.code()).amount - get_balance(_self, DPS)
+		- get_shards_total<fee_shards>(DPS.code().raw());
+	check(dps_in_circulation > 0, "no DPS in circulation");
+	uint128_t delta = profit.amount * PROFIT_SCALE / dps_in_circulation;
+
+	profit_pools pools(_self, _self.value);
+	auto pool = pools.find(DUSD.code().raw());
+	if(pool == pools.end()) {
+		pools.emplace(_self, [&](auto& p) {
+			p.acc  = delta;
+			p.owed = profit;
+		});
+	}
+	else {
+		pools.modify(pool, same_payer, [&](auto& p) {
+			p.acc  += delta;
+			p.owed += profit;
+		});
+	}
+}
+
+ACTION bank::claim(name owner) {
+	accounts acnts(_self, owner.value);
+	auto balance = acnts.find(DPS.code().raw());
+	accrue_profit(owner, balance == acnts.end() ? asset(0, DPS) : balance->balance);
+
+	profit_shares shares(_self, _self.value);
+	auto share = shares.find(owner.value);
+	check(share != shares.end() && share->accrued.amount > 0, "no profit to claim");
+	asset payout = share->accrued;
+	shares.modify(share, same_payer, [&](auto& s) {
+		s.accrued.amount = 0;
+	});
+
+	profit_pools pools(_self, _self.value);
+	pools.modify(pools.get(DUSD.code().raw()), same_payer, [&](auto& p) {
+		p.owed -= payout;
+	});
+	sub_balance(_self, payout);
+	add_balance(owner, payout, _self);
+	print("\n", owner, " claimed ", payout);
+}
+
+ACTION bank::sweep(uint64_t max) {
+	authorized_dbonds dblist(_self, _self.value);
+	dbond_dues dues(_self, _self.value);
+	auto due = dues.get_index<"due"_n>();
+	uint64_t now = current_time_point().time_since_epoch().count();
+	uint64_t swept = 0;
+	// every step moves dbond to its retire time or removes it, so the first entry is the next due one
+	for(; swept < max; swept++) {
+		auto itr = due.begin();
+		if(itr == due.end() || itr->secondary_key_1() > now)
+			break;
+		const auto& dd = *itr;
+		const auto& db = dblist.get(dd.dbond.raw(), "due dbond is not authorized");
+
+		dbonds::fc_dbond_stats info;
+		bool found = dbonds::get_fc_dbond(db.contract, db.dbond, info);
+		dbonds::accounts held(db.contract, _self.value);
+		auto balance = held.find(db.dbond.raw());
+		bool holding = balance != held.end() && balance->balance.amount != 0;
+
+		if(!found || !holding || info.fc_state == dbonds::EXPIRED_PAID_OFF) {
+			print("\n", db.dbond, " paid off");
+			erase_fc_dbond_accrual(db.dbond);
+			dues.erase(dd);
+			dblist.erase(db);
+		}
+		else if(!dd.matured && info.fc_state != dbonds::EXPIRED_DEFAULTED) {
+			// held at maturity means unpaid, technical default included: no value till paid off or retired
+			print("\n", db.dbond, " matured unpaid");
+			set_fc_dbond_price(db.dbond, asset(0, DUSD));
+			dues.modify(dd, same_payer, [&](auto& d) {
+				d.matured = true;
+			});
+		}
+		else {
+			print("\n", db.dbond, " written down");
+			set_fc_dbond_price(db.dbond, asset(0, DUSD));
+			dues.erase(dd);
+			dblist.erase(db);
+		}
+	}
+	print("\nswept ", swept);
+	if(swept > 0)
+		SEND_INLINE_ACTION(*this, blncsppl, {{_self, "active"_n}}, {});
+}
+
+ACTION bank::fillredeems(uint64_t max) {
+	check_main_switch();
+
+	// volume of fills is accrued to shards, so they are read once
+	int64_t volume_delta = get_shards_total<volume_shards>(BANKACCOUNT.value), dbtc_spent = 0, eos_spent = 0;
+	asset filled(0, DUSD);
+	uint64_t queued = 0;
+	for(auto want : {DBTC.code(), EOS.code()}) {
+		redeem_queues queues(_self, want.raw());
+		auto queue = queues.find(DUSD.code().raw());
+		if(queue == queues.end() || queue->head == queue->tail)
+			continue;
+		queued += queue->tail - queue->fills - queue->cancels;
+
+		// gaps left by cancelled orders count against 'max' too, so a fill reads at most 'max' orders
+		redeem_orders orders(_self, want.raw());
+		uint64_t head = queue->head, count = 0;
+		asset queue_filled(0, DUSD);
+		for(uint64_t steps = 0; head < queue->tail && steps < max; head++, steps++) {
+			auto order = orders.find(head);
+			if(order == orders.end())
+				continue;
+			bool for_eos = want == EOS.code();
+			if(!can_redeem_now(order->quantity, order->memo, volume_delta, for_eos ? eos_spent : dbtc_spent))
+				break;
+
+			// volume is counted at fill, as update_statistics_on_trade() does for redemption
+			int64_t delta = order->quantity.amount * 1000000;
+			accrue_used_volume(order->owner, delta);
+			volume_delta += delta;
+
+			if(for_eos) {
+				asset eos_quantity = {coin2eos(order->quantity), EOS};
+				action(permission_level{_self, "active"_n}, EOSIOTOKEN, "transfer"_n,
+					std::make_tuple(BANKACCOUNT, order->owner, eos_quantity, order->memo)).send();
+				eos_spent += eos_quantity.amount;
+				accrue_metric("redeem.eos"_n, order->owner, order->quantity.amount);
+			}
+			else {
+				// DBTC goes to owner or, for BTC address in memo, to custodian redeem order
+				asset dbtc_quantity = {coin2satoshi(order->quantity), DBTC};
+				bool for_dbtc = match_memo(order->memo, "Redeem for DBTC");
+				action(permission_level{_self, "active"_n}, CUSTODIAN, "transfer"_n,
+					std::make_tuple(BANKACCOUNT, for_dbtc ? order->owner : CUSTODIAN, dbtc_quantity, order->memo)).send();
+				dbtc_spent += dbtc_quantity.amount;
+				accrue_metric(for_dbtc ? "redeem.dbtc"_n : "redeem.btc"_n, order->owner, order->quantity.amount);
+			}
+			queue_filled += order->quantity;
+			count++;
+			orders.erase(order);
+		}
+
+		print("\nfilled ", count, " redemptions for ", want, ", ", queue_filled);
+		if(head == queue->head)
+			continue;
+		queues.modify(queue, same_payer, [&](auto& q) {
+			q.head    = head;
+			q.queued -= queue_filled;
+			q.filled += queue_filled.amount;
+			q.fills  += count;
+		});
+		filled += queue_filled;
+	}
+
+	check(queued > 0, "redemption queue is empty");
+	if(filled.amount == 0)
+		return;
+	SEND_INLINE_ACTION(*this, retire, {{BANKACCOUNT, "active"_n}}, {filled, "queued redemptions"});
+}
+
+ACTION bank::rdmposition(symbol_code want, uint64_t order_id) {
+	redeem_queues queues(_self, want.raw());
+	const auto& queue = queues.get(DUSD.code().raw(), "redemption queue is empty");
+	redeem_orders orders(_self, want.raw());
+	const auto& order = orders.get(order_id, "redemption order not found");
+
+	uint64_t position;
+	int64_t ahead;
+	get_redeem_position(queue, order, position, ahead);
+	// order fits, when volume used after orders ahead passes can_redeem_now(); it decays
+	// by 'maxdayvol' / 20 per hour, see get_used_volume(); volume in shards is not read, it is
+	// folded by the next sweep
+	int64_t max_volume = get_variable("maxdayvol", SYSTEM_SCOPE) / 1000000;
+	int64_t hourly_decay = std::max<int64_t>(max_volume / 20, 1);
+	int64_t excess = get_used_volume() / 1000000 + ahead + 2 * order.quantity.amount - max_volume;
+	int64_t wait = excess <= 0 ? 0 : (excess + hourly_decay - 1) / hourly_decay * 3600;
+	print("position ", position, " ahead ", asset(ahead, DUSD), " wait ", wait);
+}
+
+ACTION bank::rdmcancel(name owner, symbol_code want, uint64_t order_id) {
+	require_auth(owner);
+
+	redeem_orders orders(_self, want.raw());
+	const auto& order = orders.get(order_id, "redemption order not found");
+	check(order.owner == owner, "redemption order of another account");
+	asset quantity = order.quantity;
+	orders.erase(order);
+
+	// escrow goes back as it came, with no fee and no limit checks
+	sub_balance(_self, quantity);
+	add_balance(owner, quantity, owner);
+
+	// head is not moved, fill skips the gap
+	redeem_queues queues(_self, want.raw());
+	auto queue = queues.find(DUSD.code().raw());
+	queues.modify(queue, same_payer, [&](auto& q) {
+		q.queued    -= quantity;
+		q.cancelled += quantity.amount;
+		q.cancels   += 1;
+	});
+	print("\nredemption cancelled ", want, " ", order_id);
+}
+
+ACTION bank::settleepoch() {
+	check_main_switch();
+
+	batch_epochs epochs(_self, _self.value);
+	auto epoch = epochs.find(DUSD.code().raw());
+	check(epoch != epochs.end() && epoch->intents > 0, "batch epoch is empty");
+	check(current_time_point() >= epoch->start + seconds(get_batch_epoch_seconds()), "batch epoch is not over");
+
+	// one snapshot of rates and daily volume prices the whole epoch
+	conversion_rates<> rates;
+	int64_t volume_used = get_pending_used_volume();
+	int64_t mint_dbtc = 0, mint_eos = 0, redeem_dbtc = 0, redeem_eos = 0, net_value = 0, refunds = 0;
+	// assets of the bank, which redemptions can take: intents refunded give their payment back
+	int64_t dbtc_left = get_balance(_self, DBTC), eos_left = get_balance(_self, EOS);
+	auto refund = [&](const batch_intent& intent) {
+		if(intent.quantity.symbol == DUSD) {
+			sub_balance( _self, intent.quantity );
+			add_balance( intent.owner, intent.quantity, _self );
+		}
+		else {
+			// payments of intents are held back from redemptions and hedge top-ups, see get_spendable_balance()
+			int64_t& left = intent.quantity.symbol == DBTC ? dbtc_left : eos_left;
+			check(intent.quantity.amount <= left, "bank does not hold payment of batch intent " + std::to_string(intent.id));
+			left -= intent.quantity.amount;
+			action(permission_level{_self, "active"_n}, intent.quantity.symbol == DBTC ? CUSTODIAN : EOSIOTOKEN, "transfer"_n,
+				std::make_tuple(BANKACCOUNT, intent.owner, intent.quantity, string("batch refund"))).send();
+		}
+		refunds++;
+	};
+
+	// mints go first, they make room in daily volume for redemptions; intent, which does not fit
+	// daily volume or bank assets at settlement, is refunded instead of failing the whole epoch
+	batch_intents intents(_self, _self.value);
+	std::vector<std::pair<name, asset>> minted;
+	for(auto itr = intents.begin(); itr != intents.end();) {
+		if(itr->want != DUSD.code()) {
+			itr++;
+			continue;
+		}
+		bool for_dbtc = itr->quantity.symbol == DBTC;
+		asset dusd_quantity = for_dbtc ? rates.satoshi2coin(itr->quantity.amount) : rates.eos2coin(itr->quantity.amount);
+		if(fits_net_volume(volume_used, net_value - dusd_quantity.amount)) {
+			minted.emplace_back(itr->owner, dusd_quantity);
+			(for_dbtc ? mint_dbtc : mint_eos) += dusd_quantity.amount;
+			net_value -= dusd_quantity.amount;
+		}
+		else
+			refund(*itr);
+		itr = intents.erase(itr);
+	}
+	// DUSD of minters is issued to bank first, so that payments do not take bank capital;
+	// supply balancing below retires escrow of redemptions for the net of the epoch
+	if(mint_dbtc + mint_eos > 0) {
+		stats statstable(_self, DUSD.code().raw());
+		add_supply(statstable, statstable.get(DUSD.code().raw()), asset(mint_dbtc + mint_eos, DUSD));
+	}
+	for(const auto& mint : minted) {
+		sub_balance( _self, mint.second );
+		add_balance( mint.first, mint.second, _self );
+	}
+	for(auto itr = intents.begin(); itr != intents.end(); itr = intents.erase(itr)) {
+		bool for_eos = itr->want == EOS.code();
+		int64_t payment = for_eos ? rates.coin2eos(itr->quantity) : rates.coin2satoshi(itr->quantity);
+		if(!fits_net_volume(volume_used, net_value + itr->quantity.amount) || payment > (for_eos ? eos_left : dbtc_left)) {
+			refund(*itr);
+			continue;
+		}
+		(for_eos ? eos_left : dbtc_left) -= payment;
+		action(permission_level{_self, "active"_n}, for_eos ? EOSIOTOKEN : CUSTODIAN, "transfer"_n,
+			std::make_tuple(BANKACCOUNT, itr->owner, asset(payment, for_eos ? EOS : DBTC), string("batch redemption"))).send();
+		(for_eos ? redeem_eos : redeem_dbtc) += itr->quantity.amount;
+		net_value += itr->quantity.amount;
+	}
+
+	if(net_value != 0)
+		accrue_used_volume(BANKACCOUNT, net_value * 1000000);
+	if(mint_dbtc != 0)
+		accrue_metric("mint.dbtc"_n, _self, mint_dbtc);
+	if(mint_eos != 0)
+		accrue_metric("mint.eos"_n, _self, mint_eos);
+	if(redeem_dbtc != 0)
+		accrue_metric("redeem.dbtc"_n, _self, redeem_dbtc);
+	if(redeem_eos != 0)
+		accrue_metric("redeem.eos"_n, _self, redeem_eos);
+
+	print("\nsettled epoch ", epoch->id, ", ", epoch->intents, " intents, ", refunds, " refunded");
+	epochs.modify(epoch, same_payer, [&](auto& e) {
+		e.dusd    = asset(0, DUSD);
+		e.dbtc    = 0;
+		e.eos     = 0;
+		e.id     += 1;
+		e.intents = 0;
+		e.start   = current_time_point();
+	});
+	// payments of the epoch are bank's now, one supply balancing issues or retires the net
+	SEND_INLINE_ACTION(*this, blncsppl, {{_self, "active"_n}}, {});
+}
+
+ACTION bank::withdraw(name owner, int64_t shares) {
+	require_auth(owner);
+	check_main_switch();
+	check(shares > 0, "must withdraw positive shares");
+
+	savers savings(_self, _self.value);
+	auto itr = savings.find(owner.value);
+	check(itr != savings.end() && itr->shares >= shares, "not enough shares");
+
+	vault current = accrue_savings();
+	asset payout{int64_t((int128_t)current.value.amount * shares / current.shares), DUSD};
+
+	if(itr->shares == shares)
+		savings.erase(itr);
+	else {
+		savings.modify(itr, same_payer, [&](auto& s) {
+			s.shares -= shares;
+		});
+	}
+	vaults vs(_self, _self.value);
+	vs.modify(vs.get(DUSD.code().raw()), same_payer, [&](auto& v) {
+		v.value  -= payout;
+		v.shares -= shares;
+	});
+
+	print("\n", owner, " withdrew ", payout, " for ", shares, " shares");
+	if(payout.amount > 0)
+		SEND_INLINE_ACTION(*this, issue, {{_self, "active"_n}}, {owner, payout, "savings withdrawal"});
+}
+
+ACTION bank::accrue() {
+	vault current = accrue_savings();
+	print("\nsavings ", current.value, " for ", current.shares, " shares");
+	SEND_INLINE_ACTION(*this, blncsppl, {{_self, "active"_n}}, {});
+}
+
 bool bank::is_authdbond_contract(name who) {
 	authorized_dbonds authdbonds(_self, _self.value);
 	auto authdbonds_contracts = authdbonds.get_index<"contracts"_n>();
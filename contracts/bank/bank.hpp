@@ -11,6 +11,7 @@
 #include <stable.coin.hpp>
 #include <depostoken.hpp>
 #include <limitations.hpp>
+#include <pol.hpp>
 
 #include <string>
 #include <vector>
@@ -48,12 +49,132 @@ public:
 		token::delvar(scope, varname);
 	}
 
+	ACTION seedledger(symbol_code sym) {
+		token::seedledger(sym);
+	}
+
+	/**
+	 * Authorize dbond of 'dbond_contract'. Accrual parameters of fc_dbond priced in DUSD are cached
+	 * in 'fcdbaccrual' table, see dbonds_accrual.hpp, its due times in 'dbonddue' table for 'sweep'.
+	 * fc_dbond authorized before 'dbonddue' table was added gets there by the same call.
+	 * Requires ADMINACCOUNT authentication.
+	 */
 	ACTION authdbond(name dbond_contract, dbond_id_class dbond_id);
 
 	ACTION listdpssale(asset target_total_supply, asset price);
 
 	ACTION blncsppl();
 
+	/**
+	 * Read-only solvency check. Compares running totals from 'ledger' table with token supplies
+	 * and DUSD held by users with bank assets. Cost does not depend on number of accounts.
+	 * Fails with the first broken invariant.
+	 */
+	ACTION checkinvars();
+
+	/**
+	 * Commit root and total of Merkle sum tree over balances held by users (see pol.hpp),
+	 * built off-chain from table snapshot by tools/pol. Requires ADMINACCOUNT authentication.
+	 */
+	ACTION commitpol(checksum256 root, asset total, time_point snapshot_time);
+
+	/**
+	 * Read-only check of inclusion proof: 'balance' of 'owner' is counted in committed total.
+	 * 'path' lists siblings from leaf level up to the root.
+	 */
+	ACTION verifypol(name owner, asset balance, const vector<pol_proof_node>& path);
+
+	/**
+	 * Keeper action: rebalances hedge between custody and bitmex by 'balancehedge' orders and
+	 * DBTC top-ups, see rebalance_hedge() in limit_handlers.hpp. Anyone may call it,
+	 * orders are limited by 'hedge.cool'.
+	 */
+	ACTION rebalance();
+
+	/**
+	 * Keeper action: adds transfer fees accrued in 'feeshards' to bank balance, folds
+	 * 'ledgshards' into 'ledger' and 'volshards' into 'volumeused' (see shards.hpp) and
+	 * records "p2p" metric accrued in 'mtrshards' (see metrics.hpp). Anyone may call it.
+	 */
+	ACTION sweepshards();
+
+	/**
+	 * Take snapshot of DPS balances: increments 'dps.snapshot' in 'stat' scope, balances are
+	 * checkpointed lazily by their next change (see 'balchkpts' in depostoken.hpp).
+	 * Requires ADMINACCOUNT authentication.
+	 */
+	ACTION snapshot();
+
+	/**
+	 * Read-only: prints DPS balance of 'owner' at snapshot 'snapshot_id'.
+	 */
+	ACTION balanceat(name owner, uint64_t snapshot_id);
+
+	/**
+	 * Read-only: prints DPS supply at snapshot 'snapshot_id'.
+	 */
+	ACTION supplyat(uint64_t snapshot_id);
+
+	/**
+	 * Distribute 'profit' in DUSD from bank capital to DPS holders pro rata, DPS of bank and DPS
+	 * transfer fees in 'feeshards' take no share (see 'profitpool' in depostoken.hpp).
+	 * Requires ADMINACCOUNT authentication.
+	 */
+	ACTION distribute(asset profit);
+
+	/**
+	 * Pay DUSD profit accrued to DPS held by 'owner'. Anyone may call it, profit goes to 'owner'.
+	 */
+	ACTION claim(name owner);
+
+	/**
+	 * Keeper action: looks at not more than 'max' authorized dbonds, which maturity or retire time
+	 * has come, in order of "due" index. fc_dbond still held by bank at maturity is unpaid, technical
+	 * default included, and is written down to zero; it is unauthorized by retire time or when it is
+	 * paid off. Anyone may call it.
+	 */
+	ACTION sweep(uint64_t max);
+
+	/**
+	 * Keeper action: fills not more than 'max' queued DUSD redemptions of each queue in order of queue,
+	 * while daily volume and bank balance of requested asset allow, at prices of fill time
+	 * (see redeem_queue.hpp); gaps of cancelled orders count against 'max'. Anyone may call it.
+	 */
+	ACTION fillredeems(uint64_t max);
+
+	/**
+	 * Read-only: prints position of queued redemption 'order_id' in queue of 'want' asset (DBTC or EOS),
+	 * DUSD ahead of it and estimated seconds till it fits into daily volume. Reads two rows, position
+	 * and DUSD ahead are upper bounds, see get_redeem_position().
+	 */
+	ACTION rdmposition(symbol_code want, uint64_t order_id);
+
+	/**
+	 * Cancel queued redemption 'order_id' in queue of 'want' asset (DBTC or EOS), escrowed DUSD goes
+	 * back to 'owner'. Requires 'owner' authentication.
+	 */
+	ACTION rdmcancel(name owner, symbol_code want, uint64_t order_id);
+
+	/**
+	 * Keeper action: settles batch epoch, when 'batch.epoch' seconds have passed since its start
+	 * (see batch.hpp). All intents are priced at one snapshot of rates, DUSD of minters is issued
+	 * and paid, redeemers get DBTC or EOS, supply is balanced once. Mints go before redemptions;
+	 * intent, which does not fit daily volume or bank assets, is refunded. Anyone may call it.
+	 */
+	ACTION settleepoch();
+
+	/**
+	 * Withdraw 'shares' of 'owner' from savings vault, DUSD is issued to 'owner' at the current
+	 * share price (see savings.hpp). Requires 'owner' authentication.
+	 */
+	ACTION withdraw(name owner, int64_t shares);
+
+	/**
+	 * Keeper action: saves value of savings vault grown by 'save.apr' and balances DUSD supply.
+	 * Anyone may call it.
+	 */
+	ACTION accrue();
+
 	/*
 	 * New token actions and methods
 	 */
@@ -84,9 +205,14 @@ public:
 		if(dbcontracts.find(dbond_contract.value) != dbcontracts.end()) {
 			authorized_dbonds dblist(_self, _self.value);
 			auto existing = dblist.find(dbond_id.raw());
-			if(existing != dblist.end()) {
+			if(existing != dblist.end())
 				dblist.erase(existing);
-			}
+			dbond_dues dues(_self, _self.value);
+			auto due = dues.find(dbond_id.raw());
+			if(due != dues.end())
+				dues.erase(due);
+			// written down dbonds are not authorized any more, but keep their price till erase
+			erase_fc_dbond_accrual(dbond_id);
 		}
 	}
 
@@ -100,6 +226,11 @@ public:
 		auto existing = authdblist.find(dbond_id.raw());
 		if(existing != authdblist.end())
 			authdblist.erase(existing);
+		dbond_dues dues(_self, _self.value);
+		auto due = dues.find(dbond_id.raw());
+		if(due != dues.end())
+			dues.erase(due);
+		erase_fc_dbond_accrual(dbond_id);
 	}
 
 	/*
@@ -137,11 +268,30 @@ public:
 						itr = statstable.erase(itr);
 					}
 				}
+				ledger ldg(_self, _self.value);
+				for(auto t : tokens) {
+					auto itr = ldg.find(t.raw());
+					if(itr != ldg.end())
+						ldg.erase(itr);
+				}
+				for(auto t : tokens) {
+					ledger_shards shards(_self, t.raw());
+					for(auto itr = shards.begin(); itr != shards.end();)
+						itr = shards.erase(itr);
+				}
 			}
 			authorized_dbonds db(_self, _self.value);
 			for(auto itr = db.begin(); itr != db.end();) {
 				itr = db.erase(itr);
 			}
+			dbond_dues dues(_self, _self.value);
+			for(auto itr = dues.begin(); itr != dues.end();) {
+				itr = dues.erase(itr);
+			}
+			fc_dbond_accruals accruals(_self, _self.value);
+			for(auto itr = accruals.begin(); itr != accruals.end();) {
+				itr = accruals.erase(itr);
+			}
 		}
 	}
 	#endif
@@ -175,12 +325,40 @@ private:
 		uint64_t secondary_key_1()const { return contract.value; }
 	};
 
+	// scope -- _self.value; row per authorized fc_dbond, kept apart from "authfcdbonds" to leave its layout as is
+	// "due" index orders dbonds by the next time 'sweep' has to look at them: maturity, then retire time
+	TABLE dbond_due_info {
+		dbond_id_class dbond;
+		time_point maturity_time;
+		time_point retire_time;
+		bool matured;
+
+		uint64_t primary_key()const { return dbond.raw(); }
+		uint64_t secondary_key_1()const { return (matured ? retire_time : maturity_time).time_since_epoch().count(); }
+	};
+
+	// scope -- token symbol code, same as for "stat" table
+	TABLE liabilities_root {
+		asset       total;
+		asset       supply;          // token supply at the moment of commit
+		checksum256 root;
+		time_point  snapshot_time;
+		time_point  mtime;
+
+		uint64_t primary_key()const { return total.symbol.code().raw(); }
+	};
+
 	typedef eosio::multi_index< "accounts"_n, account > accounts;
 	typedef eosio::multi_index< "stat"_n, currency_stats > stats;
+	typedef eosio::multi_index< "polroot"_n, liabilities_root > polroots;
 	typedef eosio::multi_index<
 		"authfcdbonds"_n,
 		authorized_dbonds_info,
 		indexed_by< "contracts"_n, const_mem_fun<authorized_dbonds_info, uint64_t, &authorized_dbonds_info::secondary_key_1> > > authorized_dbonds;
+	typedef eosio::multi_index<
+		"dbonddue"_n,
+		dbond_due_info,
+		indexed_by< "due"_n, const_mem_fun<dbond_due_info, uint64_t, &dbond_due_info::secondary_key_1> > > dbond_dues;
 
 	/**
 	 * arbitrary data store. scopes:
@@ -214,4 +392,7 @@ private:
 	bool is_authdbond_contract(name who);
 	void process_mint_DUSD_for_EOS(name buyer, asset eos_quantity);
 	void process_redeem_DUSD_for_EOS(name from, name to, asset quantity, string memo);
+	void process_savings_deposit(name from, name to, asset quantity, string memo);
+	void process_queue_redeem(name from, name to, asset quantity, string memo);
+	void process_batch_intent(name from, asset quantity, symbol_code want);
 };
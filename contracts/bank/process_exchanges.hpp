@@ -14,7 +14,7 @@ using namespace std;
 
 void bank::process_regular_transfer(name from, name to, asset quantity, string memo){
 	// regular transfer, get transfer fee
-	uint64_t fee = std::round(1e-10 * quantity.amount * get_variable("fee.transfer", SYSTEM_SCOPE));
+	uint64_t fee = get_transfer_fee(quantity);
 
 	#ifdef DEBUG
 			auto payer = BANKACCOUNT;
@@ -26,8 +26,9 @@ void bank::process_regular_transfer(name from, name to, asset quantity, string m
 
 	sub_balance( from, quantity + fee_tokens );
 	add_balance( to, quantity, payer );
+	// fee goes to bank balance by 'sweepshards', so that transfers do not write one bank row
 	if(fee != 0) {
-		add_balance( BANKACCOUNT, fee_tokens, payer );
+		accrue_transfer_fee( from, fee_tokens );
 	}
 }
 
@@ -45,13 +46,8 @@ void bank::process_exchange_DUSD_for_DPS(name from, name to, asset quantity, str
 	check(quantity.symbol == DUSD, "only DUSD as payment allowed");
 
 	asset dps_to_dev;
-	asset dps_quantity_requested = dusd2dps(quantity, false);
-	asset dps_quantity = dps_quantity_requested;
-	dps_quantity.amount = min(dps_quantity.amount, get_balance(_self, DPS));
-	// asset change = dps2dusd(dps_quantity_requested - dps_quantity, false); // this is wrong, dps2dusd substracts fee
-	int64_t change_amount = get_variable("dpssaleprice", SYSTEM_SCOPE) / dpsPrecision
-		* (dps_quantity_requested.amount - dps_quantity.amount);
-	asset change{int64_t(change_amount), DUSD};
+	asset change;
+	asset dps_quantity = get_dps_for_sale(quantity, change);
 
 	check(dps_quantity.amount > 0, "there is no DPS for sale at the moment");
 
@@ -61,6 +57,8 @@ void bank::process_exchange_DUSD_for_DPS(name from, name to, asset quantity, str
 	// transfer DUSD
 	sub_balance(from, quantity);
 	add_balance(BANKACCOUNT, quantity, payer);
+
+	accrue_metric("dps.buy"_n, from, quantity.amount - change.amount);
 	
 	// transfer DPS
 	SEND_INLINE_ACTION(*this, transfer, {{BANKACCOUNT, "active"_n}}, {BANKACCOUNT, from, dps_quantity, "DPS for DUSD"});
@@ -78,7 +76,7 @@ void bank::process_redeem_DUSD_for_DBTC(name from, name to, asset quantity, stri
 	sub_balance( from, quantity );
 	add_balance( to, quantity, payer );
 
-	asset dbtcQuantity = {dusd2satoshi(quantity), DBTC};
+	asset dbtcQuantity = {coin2satoshi(quantity), DBTC};
 
 	// exchange DUSD => DBTC
 	action(
@@ -87,6 +85,8 @@ void bank::process_redeem_DUSD_for_DBTC(name from, name to, asset quantity, stri
 		std::make_tuple(BANKACCOUNT, from, dbtcQuantity, memo)
 	).send();
 
+	accrue_metric("redeem.dbtc"_n, from, quantity.amount);
+
 	SEND_INLINE_ACTION(*this, retire, {{BANKACCOUNT, "active"_n}}, {quantity, memo});
 }
 
@@ -95,7 +95,7 @@ void bank::process_redeem_DUSD_for_BTC(name from, name to, asset quantity, strin
 	sub_balance( from, quantity );
 	add_balance( to, quantity, payer );
 
-	asset dbtcQuantity = {dusd2satoshi(quantity), DBTC};
+	asset dbtcQuantity = {coin2satoshi(quantity), DBTC};
 	// exchange DUSD => BTC
 	action(
 		permission_level{_self, "active"_n},
@@ -103,6 +103,8 @@ void bank::process_redeem_DUSD_for_BTC(name from, name to, asset quantity, strin
 		std::make_tuple(BANKACCOUNT, CUSTODIAN, dbtcQuantity, btc_address)
 	).send();
 
+	accrue_metric("redeem.btc"_n, from, quantity.amount);
+
 	SEND_INLINE_ACTION(*this, retire, {{BANKACCOUNT, "active"_n}}, {quantity, btc_address});
 }
 
@@ -115,6 +117,8 @@ void bank::process_redeem_DPS_for_DUSD(name from, name to, asset quantity, strin
 	// transfer DPS to issuer.
 	sub_balance(from, quantity);
 	add_balance(BANKACCOUNT, quantity, payer);
+
+	accrue_metric("dps.redeem"_n, from, dusdQuantity.amount);
 	
 	SEND_INLINE_ACTION(*this, transfer, {{BANKACCOUNT, "active"_n}}, {BANKACCOUNT, from, dusdQuantity, "DPS for DUSD sell"});
 }
@@ -128,8 +132,6 @@ void bank::process_redeem_DPS_for_DBTC(name from, name to, asset quantity, strin
 	sub_balance(from, quantity);
 	add_balance(BANKACCOUNT, quantity, payer);
 
-	asset dbtcQuantity = {dusd2satoshi(dusdQuantity), DBTC};
-
 	// redeem for DBTC or BTC
 	SEND_INLINE_ACTION(*this, retire, {{BANKACCOUNT, "active"_n}}, {dusdQuantity, memo});
 
@@ -147,13 +149,11 @@ void bank::process_redeem_DPS_for_BTC(name from, name to, asset quantity, string
 	// redeem for DBTC or BTC
 	SEND_INLINE_ACTION(*this, retire, {{BANKACCOUNT, "active"_n}}, {dusdQuantity, memo});
 
-	asset dbtcQuantity = {dusd2satoshi(dusdQuantity), DBTC};
-
 	fail("not implemented");
 }
 
 void bank::process_mint_DPS_for_DBTC(name buyer, asset dbtc_quantity) {
-	asset dusd_quantity = satoshi2dusd(dbtc_quantity.amount);
+	asset dusd_quantity = satoshi2coin(dbtc_quantity.amount);
 	asset dps_to_dev_fund;
 	asset dps_quantity = dusd2dps(dusd_quantity, false);
 	splitToDev(dps_quantity, dps_to_dev_fund);
@@ -164,12 +164,14 @@ void bank::process_mint_DPS_for_DBTC(name buyer, asset dbtc_quantity) {
 }
 
 void bank::process_mint_DUSD_for_DBTC(name buyer, asset dbtc_quantity) {
-	asset dusd_quantity = satoshi2dusd(dbtc_quantity.amount);
+	asset dusd_quantity = satoshi2coin(dbtc_quantity.amount);
+	accrue_metric("mint.dbtc"_n, buyer, dusd_quantity.amount);
 	SEND_INLINE_ACTION(*this, issue, {{BANKACCOUNT, "active"_n}}, {buyer, dusd_quantity, "DUSD for DBTC"});
 }
 
 void bank::process_mint_DUSD_for_EOS(name buyer, asset eos_quantity) {
-	asset dusd_quantity = eos2dusd(eos_quantity.amount);
+	asset dusd_quantity = eos2coin(eos_quantity.amount);
+	accrue_metric("mint.eos"_n, buyer, dusd_quantity.amount);
 	SEND_INLINE_ACTION(*this, issue, {{BANKACCOUNT, "active"_n}}, {buyer, dusd_quantity, "DUSD for EOS"});
 }
 
@@ -178,7 +180,7 @@ void bank::process_redeem_DUSD_for_EOS(name from, name to, asset quantity, strin
 	sub_balance( from, quantity );
 	add_balance( to, quantity, payer );
 
-	asset eos_quantity = {dusd2eos(quantity), EOS};
+	asset eos_quantity = {coin2eos(quantity), EOS};
 
 	// exchange DUSD => EOS
 	action(
@@ -187,5 +189,95 @@ void bank::process_redeem_DUSD_for_EOS(name from, name to, asset quantity, strin
 		std::make_tuple(BANKACCOUNT, from, eos_quantity, memo)
 	).send();
 
+	accrue_metric("redeem.eos"_n, from, quantity.amount);
+
 	SEND_INLINE_ACTION(*this, retire, {{BANKACCOUNT, "active"_n}}, {quantity, memo});
 }
+
+void bank::process_savings_deposit(name from, name to, asset quantity, string memo){
+	// shares at the current share price, the first deposit sets price to one cent per share
+	vault current = accrue_savings();
+	int64_t shares = current.shares == 0 || current.value.amount == 0
+		? quantity.amount
+		: int64_t((int128_t)quantity.amount * current.shares / current.value.amount);
+	check(shares > 0, "deposit is too small");
+
+	vaults vs(_self, _self.value);
+	vs.modify(vs.get(DUSD.code().raw()), same_payer, [&](auto& v) {
+		v.value  += quantity;
+		v.shares += shares;
+	});
+
+	savers savings(_self, _self.value);
+	auto itr = savings.find(from.value);
+	if(itr == savings.end()) {
+		savings.emplace(from, [&](auto& s) {
+			s.owner  = from;
+			s.shares = shares;
+		});
+	}
+	else {
+		savings.modify(itr, same_payer, [&](auto& s) {
+			s.shares += shares;
+		});
+	}
+
+	sub_balance( from, quantity );
+	add_balance( to, quantity, from );
+	print("\n", from, " deposited ", quantity, " for ", shares, " shares");
+
+	// deposited DUSD is owed by vault now, so it is retired
+	SEND_INLINE_ACTION(*this, retire, {{BANKACCOUNT, "active"_n}}, {quantity, "savings deposit"});
+}
+
+void bank::process_queue_redeem(name from, name to, asset quantity, string memo){
+	// DUSD is escrowed in bank balance till 'fillredeems' fills the order
+	sub_balance( from, quantity );
+	add_balance( to, quantity, from );
+
+	symbol_code want = get_redeem_want(memo);
+	redeem_queues queues(_self, want.raw());
+	auto queue = queues.find(DUSD.code().raw());
+	if(queue == queues.end()) {
+		queue = queues.emplace(_self, [&](auto& q) {
+			q.queued    = asset(0, DUSD);
+			q.head      = 0;
+			q.tail      = 0;
+			q.enqueued  = 0;
+			q.filled    = 0;
+			q.fills     = 0;
+			q.cancelled = 0;
+			q.cancels   = 0;
+		});
+	}
+
+	redeem_orders orders(_self, want.raw());
+	uint64_t id = queue->tail;
+	orders.emplace(from, [&](auto& o) {
+		o.id        = id;
+		o.owner     = from;
+		o.quantity  = quantity;
+		o.memo      = memo;
+		o.ctime     = current_time_point();
+		o.enqueued  = queue->enqueued;
+		o.cancelled = queue->cancelled;
+		o.cancels   = queue->cancels;
+	});
+	queues.modify(queue, same_payer, [&](auto& q) {
+		q.queued   += quantity;
+		q.tail     += 1;
+		q.enqueued += quantity.amount;
+	});
+	print("\nredemption queued ", want, " ", id);
+}
+
+void bank::process_batch_intent(name from, asset quantity, symbol_code want){
+	add_batch_intent(from, quantity, want);
+	name token_contract = quantity.symbol == DUSD ? BANKACCOUNT : quantity.symbol == DBTC ? CUSTODIAN : EOSIOTOKEN;
+	check_batch_intent(extended_asset(quantity, token_contract), want);
+	// DUSD of redemption is escrowed in bank balance, DBTC and EOS of mint are there already
+	if(quantity.symbol == DUSD) {
+		sub_balance( from, quantity );
+		add_balance( BANKACCOUNT, quantity, from );
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+using namespace eosio;
+using namespace std;
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/system.hpp>
+
+#include <stable.coin.hpp>
+
+/**
+ * Epoch-batched mint and redemption, on while 'batch.epoch' system variable (epoch length in seconds)
+ * is positive. Users submit intents by transfer to bank: DBTC or EOS with memo "Batch buy DUSD",
+ * DUSD with memo "Batch redeem for DBTC" or "Batch redeem for EOS". Submission checks order size and
+ * records the intent, payment waits in bank balance. 'settleepoch' action prices all intents of the
+ * epoch at one reading of rate and fee variables, refunds intents, which daily volume or bank assets
+ * cannot take, and balances DUSD supply once, so mints and redemptions of the epoch net to one issue
+ * or retire. Payments of intents are not bank's till then:
+ * get_bank_assets_value() and get_hedge_assets_value() skip pending DBTC and EOS,
+ * get_bank_capital_value() skips escrowed DUSD.
+ * Scope is BANKACCOUNT; "epoch" row per stablecoin, "intents" row per intent of the current epoch.
+ */
+const uint64_t MAX_EPOCH_INTENTS = 100;
+
+TABLE batch_epoch {
+	asset      dusd;      // DUSD escrowed by redemption intents
+	int64_t    dbtc;      // DBTC paid by mint intents
+	int64_t    eos;       // EOS paid by mint intents
+	uint64_t   id;
+	uint64_t   intents;   // intents of the epoch, id of the next intent
+	time_point start;
+
+	uint64_t primary_key()const { return dusd.symbol.code().raw(); }
+};
+
+TABLE batch_intent {
+	uint64_t    id;
+	name        owner;
+	asset       quantity;  // payment: DBTC or EOS for mint, DUSD for redemption
+	symbol_code want;      // DUSD for mint, DBTC or EOS for redemption
+
+	uint64_t primary_key()const { return id; }
+};
+
+typedef eosio::multi_index< "epoch"_n, batch_epoch > batch_epochs;
+typedef eosio::multi_index< "intents"_n, batch_intent > batch_intents;
+
+int64_t get_batch_epoch_seconds() {
+	variables sys_vars(BANKACCOUNT, SYSTEM_SCOPE.value);
+	auto itr = sys_vars.find(("batch.epoch"_n).value);
+	return itr == sys_vars.end() ? 0 : itr->value;
+}
+
+// payments of the current epoch, zero if batch mode was never used
+batch_epoch get_batch_epoch() {
+	batch_epochs epochs(BANKACCOUNT, BANKACCOUNT.value);
+	auto itr = epochs.find(DUSD.code().raw());
+	return itr == epochs.end() ? batch_epoch{asset(0, DUSD)} : *itr;
+}
+
+void add_batch_intent(name owner, asset quantity, symbol_code want) {
+	check(get_batch_epoch_seconds() > 0, "batch mode is off");
+
+	batch_epochs epochs(BANKACCOUNT, BANKACCOUNT.value);
+	auto epoch = epochs.find(DUSD.code().raw());
+	if(epoch == epochs.end()) {
+		epoch = epochs.emplace(BANKACCOUNT, [&](auto& e) {
+			e.dusd    = asset(0, DUSD);
+			e.dbtc    = 0;
+			e.eos     = 0;
+			e.id      = 0;
+			e.intents = 0;
+			e.start   = current_time_point();
+		});
+	}
+	check(epoch->intents < MAX_EPOCH_INTENTS, "batch epoch is full, wait for settlement");
+
+	batch_intents intents(BANKACCOUNT, BANKACCOUNT.value);
+	uint64_t id = epoch->intents;
+	intents.emplace(BANKACCOUNT, [&](auto& i) {
+		i.id       = id;
+		i.owner    = owner;
+		i.quantity = quantity;
+		i.want     = want;
+	});
+	epochs.modify(epoch, same_payer, [&](auto& e) {
+		if(quantity.symbol == DUSD)
+			e.dusd += quantity;
+		else if(quantity.symbol == DBTC)
+			e.dbtc += quantity.amount;
+		else
+			e.eos += quantity.amount;
+		e.intents += 1;
+	});
+	print("\nbatch intent ", id, " of epoch ", epoch->id);
+}
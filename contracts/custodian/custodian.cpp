@@ -24,39 +24,19 @@ ACTION custodian::transfer( name    from,
 	check_transfer(from, to, quantity, memo);
 
 	if(to == CUSTODIAN && quantity.symbol.code() == DBTC.code()) {
-		asset order_quantity = quantity;
 		validate_btc_address(memo, BITCOIN_TESTNET);
 		redeemOrders ord(_self, quantity.symbol.code().raw());
 
-		if(from == BANKACCOUNT) {
-			// it's hedge balancing order, let's correct order_quantity considering
-			// previous hedge balancing orders in state "new"
-			auto status_index = ord.get_index<"status"_n>();
-			int64_t orders_amount = 0;
-			auto lower = status_index.lower_bound("new"_n.value);
-			auto upper = status_index.upper_bound("new"_n.value);
-			if(lower != status_index.end()) {
-				do {
-					if(lower->user == BANKACCOUNT)
-						orders_amount += lower->btc_amount;
-				} while(lower++ != upper);
-			}
-			if(orders_amount > order_quantity.amount)
-				order_quantity.amount = 0;
-			else
-				order_quantity.amount -= orders_amount;
-		}
-
-		if(order_quantity.amount > 0)
-			ord.emplace(_self, [&](auto& o) {
-				o.id         = ord.available_primary_key();
-				o.user       = from;
-				o.status     = "new"_n;
-				o.btc_amount = order_quantity.amount;
-				o.btc_txid   = uint256_t();
-				o.mtime      = current_time_point().time_since_epoch().count();
-				o.btc_address = memo;
-			});
+		// hedge orders of bank are netted against ones in flight by bank, see rebalance_hedge()
+		ord.emplace(_self, [&](auto& o) {
+			o.id         = ord.available_primary_key();
+			o.user       = from;
+			o.status     = "new"_n;
+			o.btc_amount = quantity.amount;
+			o.btc_txid   = uint256_t();
+			o.mtime      = current_time_point().time_since_epoch().count();
+			o.btc_address = memo;
+		});
 	}
 
 	auto payer = has_auth( to ) ? to : from;
@@ -87,7 +67,6 @@ ACTION custodian::mint(name user, symbol_code sym, int64_t satoshi_amount, const
 
 	auto stat_it = statstable.find(DBTC.code().raw());
 	check( stat_it != statstable.end(), "token with symbol does not exist, create token before issue" );
-	const auto& st = *stat_it;
 	require_auth(CUSTODIAN);
 
 	mintOrders ord(_self, sym.raw());
@@ -157,27 +136,41 @@ ACTION custodian::redeem(symbol_code sym, uint64_t order_id, const string& btc_t
 
 ACTION custodian::balancehedge(int64_t amount) {
 	require_auth(BANKACCOUNT);
+	check(amount > 0, "hedge order amount must be positive");
 
+	// netted against orders in flight by bank, see rebalance_hedge()
 	mintOrders ord(_self, DBTC.code().raw());
-	auto status_index = ord.get_index<"status"_n>();
-	int64_t orders_amount = 0;
-	auto lower = status_index.lower_bound("new"_n.value);
-	auto upper = status_index.upper_bound("new"_n.value);
-	if(lower != status_index.end()) {
-		do {
-			if(lower->user == BANKACCOUNT)
-				orders_amount += lower->btc_amount;
-		} while(lower++ != upper);
-	}
+	ord.emplace(CUSTODIAN, [&](auto& o) {
+		o.id         = ord.available_primary_key();
+		o.user       = BANKACCOUNT;
+		o.status     = "new"_n;
+		o.btc_amount = amount;
+		o.btc_txid   = uint256_t();
+		o.mtime      = current_time_point().time_since_epoch().count();
+	});
+}
 
-	if(amount > orders_amount) {
-		ord.emplace(CUSTODIAN, [&](auto& o) {
-			o.id         = ord.available_primary_key();
-			o.user       = BANKACCOUNT;
-			o.status     = "new"_n;
-			o.btc_amount = amount - orders_amount;
-			o.btc_txid   = uint256_t();
-			o.mtime      = current_time_point().time_since_epoch().count();
-		});
-	}
+ACTION custodian::fillhedge(uint64_t order_id, const string& btc_txid) {
+	require_auth(CUSTODIAN);
+
+	check_main_switch();
+
+	uint256_t txid_bin = hex2bin(btc_txid);
+
+	mintOrders ord(_self, DBTC.code().raw());
+	auto txid_index = ord.get_index<"btctxid"_n>();
+	check(txid_index.find(txid_bin) == txid_index.end(), "duplicate mint!");
+
+	auto& order = *(ord.require_find(order_id, "order not found"));
+	check(order.user == BANKACCOUNT, "not a hedge order");
+	check(order.status == "new"_n, "hedge order is not new");
+
+	ord.modify(order, same_payer, [&](auto& o) {
+		o.status   = "processing"_n;
+		o.btc_txid = txid_bin;
+	});
+
+	// bank settles "hedge.xfer" by the order id in memo, see settle_hedge_withdrawal()
+	string memo = "hedge " + std::to_string(order_id);
+	SEND_INLINE_ACTION(*this, issue, {{CUSTODIAN, "active"_n}}, {BANKACCOUNT, asset(order.btc_amount, DBTC), memo});
 }
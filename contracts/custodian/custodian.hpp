@@ -54,6 +54,10 @@ public:
 		token::delvar(scope, varname);
 	}
 
+	ACTION seedledger(symbol_code sym) {
+		token::seedledger(sym);
+	}
+
 	/*
 	 * New token actions and methods
 	 */
@@ -64,6 +68,14 @@ public:
 	// initiate withdrawal from hedge account to custody. amount in satoshis
 	ACTION balancehedge(int64_t amount);
 
+	// withdrawal of 'balancehedge' order has come to custody: mints DBTC of the order to bank
+	ACTION fillhedge(uint64_t order_id, const string& btc_txid);
+
+	// keeper action: folds 'ledgshards' into 'ledger', see shards.hpp. Anyone may call it.
+	ACTION sweepshards() {
+		fold_ledger(DBTC);
+	}
+
 	#ifdef DEBUG
 	/*
 	 * Erase accounts listed in 'names' for given token symbols.
@@ -86,6 +98,17 @@ public:
 					itr = statstable.erase(itr);
 				}
 			}
+			ledger ldg(_self, _self.value);
+			for(auto t : tokens) {
+				auto itr = ldg.find(t.raw());
+				if(itr != ldg.end())
+					ldg.erase(itr);
+			}
+			for(auto t : tokens) {
+				ledger_shards shards(_self, t.raw());
+				for(auto itr = shards.begin(); itr != shards.end();)
+					itr = shards.erase(itr);
+			}
 		}
 		{
 			mintOrders mo(_self, DBTC.code().raw());
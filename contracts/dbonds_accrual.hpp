@@ -0,0 +1,79 @@
+#pragma once
+
+using namespace eosio;
+using namespace std;
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/system.hpp>
+
+#include <stable.coin.hpp>
+#include <dbonds_tables.hpp>
+
+/**
+ * Accrual parameters of fc_dbonds priced in DUSD, copied from "fcdbond" row of dbonds contract by
+ * 'authdbond' action (see cache_fc_dbond_accrual()). Price of such dbond is computed on read:
+ * initial_price with simple interest at 'apr' from 'initial_time' till now, not later than
+ * 'maturity_time', so valuation reads neither the full dbond row nor 'current_price' pushed by
+ * dbonds contract. 'sweep' action of bank fixes price of due dbonds by set_fc_dbond_price().
+ * Scope is BANKACCOUNT, row per dbond.
+ */
+TABLE fc_dbond_accrual {
+	dbond_id_class dbond;
+	asset          initial_price;
+	time_point     initial_time;
+	time_point     maturity_time;
+	int64_t        apr;
+
+	uint64_t primary_key()const { return dbond.raw(); }
+};
+
+typedef eosio::multi_index< "fcdbaccrual"_n, fc_dbond_accrual > fc_dbond_accruals;
+
+void cache_fc_dbond_accrual(const dbonds::fc_dbond_stats& info) {
+	// fc_dbonds priced in other tokens are valued as before
+	if(info.initial_price.contract != BANKACCOUNT || info.initial_price.quantity.symbol != DUSD)
+		return;
+
+	fc_dbond_accruals accruals(BANKACCOUNT, BANKACCOUNT.value);
+	auto existing = accruals.find(info.dbond.dbond_id.raw());
+	if(existing != accruals.end())
+		accruals.erase(existing);
+	accruals.emplace(BANKACCOUNT, [&](auto& a) {
+		a.dbond         = info.dbond.dbond_id;
+		a.initial_price = info.initial_price.quantity;
+		a.initial_time  = info.initial_time;
+		a.maturity_time = info.dbond.maturity_time;
+		a.apr           = info.dbond.apr;
+	});
+}
+
+// fixes price of dbond, no accrual: zero for unpaid and defaulted dbonds
+void set_fc_dbond_price(dbond_id_class dbond_id, asset price) {
+	fc_dbond_accruals accruals(BANKACCOUNT, BANKACCOUNT.value);
+	auto existing = accruals.find(dbond_id.raw());
+	auto setter = [&](auto& a) {
+		a.dbond         = dbond_id;
+		a.initial_price = price;
+		a.initial_time  = current_time_point();
+		a.maturity_time = a.initial_time;
+		a.apr           = 0;
+	};
+	if(existing == accruals.end())
+		accruals.emplace(BANKACCOUNT, setter);
+	else
+		accruals.modify(existing, same_payer, setter);
+}
+
+void erase_fc_dbond_accrual(dbond_id_class dbond_id) {
+	fc_dbond_accruals accruals(BANKACCOUNT, BANKACCOUNT.value);
+	auto existing = accruals.find(dbond_id.raw());
+	if(existing != accruals.end())
+		accruals.erase(existing);
+}
+
+int64_t get_accrued_price(const fc_dbond_accrual& a, time_point now) {
+	time_point until = std::min(now, a.maturity_time);
+	int64_t seconds = std::max<int64_t>((until - a.initial_time).to_seconds(), 0);
+	return a.initial_price.amount + get_apr_interest(a.initial_price.amount, a.apr, seconds);
+}
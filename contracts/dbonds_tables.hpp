@@ -31,6 +31,16 @@ namespace dbonds {
 		uint64_t primary_key() const { return balance.symbol.code().raw(); }
 	};
 
+	// fc_state of fc_dbond_stats, as dbonds contract sets it
+	enum fc_dbond_state : int {
+		CREATED                = 0,
+		AGREEMENT_SIGNED       = 1,
+		CIRCULATING            = 2,
+		EXPIRED_PAID_OFF       = 3,
+		EXPIRED_TECH_DEFAULTED = 4,
+		EXPIRED_DEFAULTED      = 5
+	};
+
 	// scope: dbond.emitent
 	struct fc_dbond_stats {
 		fc_dbond             dbond;
@@ -43,11 +53,8 @@ namespace dbonds {
 		uint64_t primary_key() const { return dbond.dbond_id.raw(); }
 	};
 
-	// TABLE cc_dbond_stats {
-	//   dbond_id_class  dbond_id;
-
-	//   uint64_t primary_key() const { return dbond_id.raw(); }
-	// };
+	// 'ccdbond' table of cc_dbonds is not declared: its layout is not published by the dbonds contract,
+	// bank does not read it and takes cc_dbonds at no value, see get_dbonds_assets_value()
 
 	// TABLE nc_dbond_stats {
 	//   dbond_id_class  dbond_id;
@@ -71,7 +78,6 @@ namespace dbonds {
 	using stats             = multi_index< "stat"_n, currency_stats >;
 	using accounts          = multi_index< "accounts"_n, account >;
 	using fc_dbond_index    = multi_index< "fcdbond"_n, fc_dbond_stats >;
-	// using cc_dbond_index = multi_index< "ccdbond"_n, cc_dbond_stats >;
 	// using nc_dbond_index = multi_index< "ncdbond"_n, nc_dbond_stats >;
 	// using fc_dbond_orders   = multi_index< "fcdborders"_n, fc_dbond_order_struct >;
 	using fc_dbond_orders   = multi_index<
@@ -90,6 +96,20 @@ namespace dbonds {
 		return fcdb_info.current_price;
 	}
 
+	// returns false, if dbond is not found or is not fiat-collateralized
+	bool get_fc_dbond(name dbonds_contract, dbond_id_class dbond_id, fc_dbond_stats& result) {
+		stats statstable(dbonds_contract, dbond_id.raw());
+		auto st = statstable.find(dbond_id.raw());
+		if(st == statstable.end())
+			return false;
+		fc_dbond_index fcdb_stat(dbonds_contract, st->issuer.value);
+		auto itr = fcdb_stat.find(dbond_id.raw());
+		if(itr == fcdb_stat.end())
+			return false;
+		result = *itr;
+		return true;
+	}
+
 	void get_holder_dbonds(name dbonds_contract, name holder, vector<asset>& result) {
 		result.clear();
 		accounts acnts(dbonds_contract, holder.value);
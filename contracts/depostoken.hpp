@@ -10,6 +10,7 @@
 #include <eosio/print.hpp>
 
 #include <stable.coin.hpp>
+#include <shards.hpp>
 #include <utility>
 
 #include <string>
@@ -42,9 +43,75 @@ struct currency_stats {
 	uint64_t primary_key()const { return supply.symbol.code().raw(); }
 };
 
+/**
+ * Running totals of balances, one row per token symbol. Scope is _self.
+ * Kept by delta in sub_balance and add_balance (and so in issue, retire and transfer).
+ * Deltas of users wait in 'ledgshards' (see shards.hpp) till fold_ledger(), so that transfers
+ * between users do not all write this row; users_held + issuer_held + sum of the shards must always
+ * be equal to supply in stat table, see get_users_held().
+ * Totals count from the first balance change made by a contract with this table.
+ */
+TABLE ledger_totals {
+	asset    users_held;
+	asset    issuer_held;
+
+	uint64_t primary_key()const { return users_held.symbol.code().raw(); }
+};
+
+/**
+ * DPS balance checkpoints, so that balances at a snapshot are known without dumping 'accounts'.
+ * Current snapshot id is 'dps.snapshot' variable in 'stat' scope, 'snapshot' action of bank increments it.
+ * The first change of a balance after snapshot N records the balance before the change with id N,
+ * so balance at snapshot S is the one of the first checkpoint with id >= S, or the current balance,
+ * if there is none (see get_checkpointed()). A balance pays at most one row per snapshot.
+ * Scope is owner for "balchkpts" and token symbol code for "supchkpts" of total supply.
+ */
+TABLE checkpoint {
+	uint64_t id;
+	asset    balance;
+
+	uint64_t primary_key()const { return id; }
+};
+
+/**
+ * DPS profit distribution. 'distribute' action of bank adds profit per DPS held by accounts other than
+ * bank to 'acc' of "profitpool" row of the profit token, in scale PROFIT_SCALE; 'owed' is profit not
+ * claimed yet. Every change of a DPS balance first accrues balance * (acc - holder's acc) to holder's
+ * "profitshare" row and moves holder's acc to the current one (see accrue_profit()), so distribution
+ * and 'claim' cost the same for any number of holders. Scope is _self for both tables.
+ */
+const uint128_t PROFIT_SCALE = 1000000000000000000ull;
+
+TABLE profit_pool {
+	uint128_t acc;
+	asset     owed;
+
+	uint64_t primary_key()const { return owed.symbol.code().raw(); }
+};
+
+TABLE profit_share {
+	name      owner;
+	uint128_t acc;
+	asset     accrued;
+
+	uint64_t primary_key()const { return owner.value; }
+};
+
 typedef eosio::multi_index< "accounts"_n, account > accounts;
 typedef eosio::multi_index< "stat"_n, currency_stats > stats;
 typedef eosio::multi_index< "variables"_n, variable > variables;
+typedef eosio::multi_index< "ledger"_n, ledger_totals > ledger;
+typedef eosio::multi_index< "balchkpts"_n, checkpoint > balance_checkpoints;
+typedef eosio::multi_index< "supchkpts"_n, checkpoint > supply_checkpoints;
+typedef eosio::multi_index< "profitpool"_n, profit_pool > profit_pools;
+typedef eosio::multi_index< "profitshare"_n, profit_share > profit_shares;
+
+template<typename Checkpoints>
+asset get_checkpointed(name contract, uint64_t scope, uint64_t snapshot_id, asset current) {
+	Checkpoints checkpoints(contract, scope);
+	auto itr = checkpoints.lower_bound(snapshot_id);
+	return itr == checkpoints.end() ? current : itr->balance;
+}
 
 /**
  * Mint orders table. Scope is constant, DBTC.
@@ -133,6 +200,14 @@ public:
 	 */
 	void delvar(name scope, name varname);
 
+	/**
+	 * Seed 'ledger' row of token 'sym' for totals which were not kept from its first balance change.
+	 * issuer_held is set to balance of the issuer, users_held to the rest of supply less transfer
+	 * fees not swept yet, ledger shards are dropped. Requires ADMINACCOUNT authentication.
+	 * @param {symbol_code} sym - Token to seed totals of.
+	 */
+	void seedledger(symbol_code sym);
+
 	static asset get_supply( name token_contract_account, symbol_code sym_code )
 	{
 		stats statstable( token_contract_account, sym_code.raw() );
@@ -140,6 +215,15 @@ public:
 		return st.supply;
 	}
 
+	// users_held of 'ledger' row with deltas not folded yet
+	static int64_t get_users_held( name token_contract_account, symbol sym )
+	{
+		ledger ldg( token_contract_account, token_contract_account.value );
+		auto itr = ldg.find( sym.code().raw() );
+		int64_t folded = itr == ldg.end() ? 0 : itr->users_held.amount;
+		return folded + get_shards_total<ledger_shards>( sym.code().raw(), token_contract_account );
+	}
+
 	// static asset get_balance( name token_contract_account, name owner, symbol_code sym_code )
 	// {
 	// 	accounts accountstable( token_contract_account, owner.value );
@@ -151,6 +235,13 @@ protected:
 
 	void sub_balance( name owner, asset value );
 	void add_balance( name owner, asset value, name ram_payer );
+	template<typename Stats>
+	void add_supply( Stats& statstable, const typename Stats::const_iterator::value_type& st, asset quantity );
+	void update_ledger( name owner, asset delta );
+	void fold_ledger( symbol sym );
+	template<typename Checkpoints>
+	void save_checkpoint( uint64_t scope, asset before );
+	void accrue_profit( name owner, asset before );
 	void check_transfer(name from, name to, asset quantity, string memo);
 
 	/**
@@ -220,17 +311,25 @@ void token::issue(name to, asset quantity, string memo)
 	check( quantity.amount > 0, "must issue positive quantity" );
 
 	check( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
+	add_supply( statstable, st, quantity );
+
+	if( to != st.issuer ) {
+		SEND_INLINE_ACTION( *this, transfer, { {st.issuer, "active"_n} }, { st.issuer, to, quantity, memo } );
+	}
+}
+
+// supply of 'st' grows by 'quantity' held by the issuer; authority is checked by callers
+template<typename Stats>
+void token::add_supply( Stats& statstable, const typename Stats::const_iterator::value_type& st, asset quantity )
+{
 	check( quantity.amount <= st.max_supply.amount - st.supply.amount, "quantity exceeds available supply");
 
+	save_checkpoint<supply_checkpoints>( quantity.symbol.code().raw(), st.supply );
 	statstable.modify( st, same_payer, [&]( auto& s ) {
 		s.supply += quantity;
 	});
 
 	add_balance( st.issuer, quantity, st.issuer );
-
-	if( to != st.issuer ) {
-		SEND_INLINE_ACTION( *this, transfer, { {st.issuer, "active"_n} }, { st.issuer, to, quantity, memo } );
-	}
 }
 
 void token::retire(asset quantity, string memo)
@@ -251,6 +350,7 @@ void token::retire(asset quantity, string memo)
 
 	check( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
 
+	save_checkpoint<supply_checkpoints>( sym.code().raw(), st.supply );
 	statstable.modify( st, same_payer, [&]( auto& s ) {
 		s.supply -= quantity;
 	});
@@ -275,9 +375,13 @@ void token::sub_balance( name owner, asset value )
 
 	name ram_payer = owner;
 #endif
+	save_checkpoint<balance_checkpoints>( owner.value, from.balance );
+	accrue_profit( owner, from.balance );
 	from_acnts.modify( from, ram_payer, [&]( auto& a ) {
 		a.balance -= value;
 	});
+
+	update_ledger( owner, -value );
 }
 
 void token::add_balance( name owner, asset value, name ram_payer )
@@ -285,14 +389,109 @@ void token::add_balance( name owner, asset value, name ram_payer )
 	accounts to_acnts( _self, owner.value );
 	auto to = to_acnts.find( value.symbol.code().raw() );
 	if( to == to_acnts.end() ) {
+		save_checkpoint<balance_checkpoints>( owner.value, asset{0, value.symbol} );
+		accrue_profit( owner, asset{0, value.symbol} );
 		to_acnts.emplace( ram_payer, [&]( auto& a ){
 			a.balance = value;
 		});
 	} else {
+		save_checkpoint<balance_checkpoints>( owner.value, to->balance );
+		accrue_profit( owner, to->balance );
 		to_acnts.modify( to, same_payer, [&]( auto& a ) {
 			a.balance += value;
 		});
 	}
+
+	update_ledger( owner, value );
+}
+
+void token::update_ledger( name owner, asset delta )
+{
+	// issuer of all tokens is the contract itself
+	if( owner != _self ) {
+		add_to_shard<ledger_shards>( delta.symbol.code().raw(), owner, delta.amount, _self );
+		return;
+	}
+
+	ledger ldg( _self, _self.value );
+	auto itr = ldg.find( delta.symbol.code().raw() );
+	if( itr == ldg.end() ) {
+		ldg.emplace( _self, [&]( auto& l ) {
+			l.users_held  = asset{0, delta.symbol};
+			l.issuer_held = delta;
+		});
+	} else {
+		ldg.modify( itr, same_payer, [&]( auto& l ) {
+			l.issuer_held += delta;
+		});
+	}
+}
+
+void token::fold_ledger( symbol sym )
+{
+	int64_t users_delta = fold_shards<ledger_shards>( sym.code().raw(), _self );
+	if( users_delta == 0 )
+		return;
+
+	ledger ldg( _self, _self.value );
+	auto itr = ldg.find( sym.code().raw() );
+	if( itr == ldg.end() ) {
+		ldg.emplace( _self, [&]( auto& l ) {
+			l.users_held  = asset{users_delta, sym};
+			l.issuer_held = asset{0, sym};
+		});
+	} else {
+		ldg.modify( itr, same_payer, [&]( auto& l ) {
+			l.users_held.amount += users_delta;
+		});
+	}
+}
+
+template<typename Checkpoints>
+void token::save_checkpoint( uint64_t scope, asset before )
+{
+	if( before.symbol != DPS )
+		return;
+	variables stat_vars( _self, STAT_SCOPE.value );
+	auto snapshot = stat_vars.find( "dps.snapshot"_n.value );
+	if( snapshot == stat_vars.end() )
+		return;
+
+	Checkpoints checkpoints( _self, scope );
+	uint64_t id = snapshot->value;
+	if( checkpoints.find( id ) != checkpoints.end() )
+		return;
+	checkpoints.emplace( _self, [&]( auto& c ) {
+		c.id      = id;
+		c.balance = before;
+	});
+}
+
+void token::accrue_profit( name owner, asset before )
+{
+	// bank DPS is not in circulation and takes no profit
+	if( before.symbol != DPS || owner == _self )
+		return;
+	profit_pools pools( _self, _self.value );
+	auto pool = pools.find( DUSD.code().raw() );
+	if( pool == pools.end() )
+		return;
+
+	profit_shares shares( _self, _self.value );
+	auto share = shares.find( owner.value );
+	if( share == shares.end() ) {
+		// holder without a row has not been accrued since the pool was created with zero acc
+		shares.emplace( _self, [&]( auto& s ) {
+			s.owner   = owner;
+			s.acc     = pool->acc;
+			s.accrued = asset{int64_t(before.amount * pool->acc / PROFIT_SCALE), DUSD};
+		});
+	} else if( share->acc != pool->acc ) {
+		shares.modify( share, same_payer, [&]( auto& s ) {
+			s.accrued.amount += int64_t(before.amount * (pool->acc - s.acc) / PROFIT_SCALE);
+			s.acc = pool->acc;
+		});
+	}
 }
 
 void token::open( name owner, const symbol& symbol, name ram_payer )
@@ -324,6 +523,35 @@ void token::close( name owner, const symbol& symbol )
 	acnts.erase( it );
 }
 
+void token::seedledger(symbol_code sym) {
+	require_auth(ADMINACCOUNT);
+
+	asset supply = get_supply( _self, sym );
+	accounts acnts( _self, _self.value );
+	auto issuer_acnt = acnts.find( sym.raw() );
+	asset issuer_held = issuer_acnt == acnts.end() ? asset{0, supply.symbol} : issuer_acnt->balance;
+	int64_t fees = get_shards_total<fee_shards>( sym.raw(), _self );
+	asset users_held = supply - issuer_held - asset{fees, supply.symbol};
+
+	// deltas in shards are counted in balances already
+	fold_shards<ledger_shards>( sym.raw(), _self );
+
+	ledger ldg( _self, _self.value );
+	auto itr = ldg.find( sym.raw() );
+	if( itr == ldg.end() ) {
+		ldg.emplace( _self, [&]( auto& l ) {
+			l.users_held  = users_held;
+			l.issuer_held = issuer_held;
+		});
+	} else {
+		ldg.modify( itr, same_payer, [&]( auto& l ) {
+			l.users_held  = users_held;
+			l.issuer_held = issuer_held;
+		});
+	}
+	print("\n", sym, " seeded: users ", users_held, " issuer ", issuer_held);
+}
+
 void token::setvar(name scope, name varname, int64_t value) {
 	switch(scope) {
 		case SYSTEM_SCOPE:
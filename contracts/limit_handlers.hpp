@@ -24,45 +24,152 @@ void on_switcher_check_fail(){
 }
 
 void on_lack_of_liquidity(){
+	print("\n====== handle on_lack_of_liquidity, hedge is rebalanced by 'rebalance' action");
 	return;
-	print("\n====== handle on_lack_of_liquidity");
-	double bitmex_target = get_variable("bitmex.trg", SYSTEM_SCOPE) * 1e-10;
-	double hedge_assets_btc_value = 1e8 * get_hedge_assets_value() / get_btc_price();
-	int64_t amount_in_process = bitmex_in_process_mint_order_btc_amount(BANKACCOUNT);
-	int64_t bitmex_target_btc_value = int64_t(bitmex_target * hedge_assets_btc_value);
-	int64_t bitmex_balance_btc_value = get_balance(BITMEXACC, BTC) - amount_in_process;
-	int64_t order_amount = bitmex_balance_btc_value - bitmex_target_btc_value;
-	if(order_amount > 0) {
-		action(
-			permission_level{BANKACCOUNT, "active"_n},
-			CUSTODIAN, "balancehedge"_n,
-			make_tuple(order_amount)
-		).send();
-	}
+}
 
+void on_high_leverage(){
+	print("\n====== handle on_high_leverage, hedge is rebalanced by 'rebalance' action");
 	return;
 }
 
-void on_high_leverage(){
+void on_too_much_liquidity() {
+	print("\n====== handle on_too_much_liquidity, hedge is rebalanced by 'rebalance' action");
 	return;
-	print("\n====== handle on_high_leverage");
-	double bitmex_target = get_variable("bitmex.trg", SYSTEM_SCOPE) * 1e-10;
-	double hedge_assets_btc_value = 1e8 * get_hedge_assets_value() / get_btc_price();
-	int64_t amount_in_process = bitmex_in_process_redeem_order_btc_amount(BANKACCOUNT);
-	int64_t bitmex_target_btc_value = int64_t(bitmex_target * hedge_assets_btc_value);
-	int64_t bitmex_balance_btc_value = get_balance(BITMEXACC, BTC) + amount_in_process;
-	int64_t order_amount = bitmex_target_btc_value - bitmex_balance_btc_value;
-	if(order_amount > 0) {
-		action(
-			permission_level{BANKACCOUNT, "active"_n},
-			BANKACCOUNT, "transfer"_n,
-			make_tuple(BANKACCOUNT, CUSTODIAN, asset{order_amount, DBTC}, bitmex_address)
-		).send();
+}
+
+/**
+ * Hedge orders in flight, in satoshi, are kept in 'stat' scope:
+ *   "hedge.topup" -- DBTC sent to custodian for bitmex, 'btc.bitmex' has not shown it yet
+ *   "hedge.wdraw" -- 'balancehedge' orders, 'btc.bitmex' has not shown them paid out yet
+ *   "hedge.xfer"  -- withdrawals paid out by bitmex less DBTC minted for them by custodian,
+ *                    negative while custodian mints before oracle reports the payout
+ * Custodian may pay out or mint before or after bitmex balance reported by oracle changes, so
+ * in-flight amounts are settled by the change of 'btc.bitmex' they cause, see settle_bitmex_change(),
+ * and bank counts BTC once all the way: effective bitmex balance is btc.bitmex + hedge.topup
+ * - hedge.wdraw, hedge assets and bank assets add hedge.topup + hedge.xfer.
+ */
+void settle_hedge_order(name in_flight_var, int64_t amount) {
+	int64_t in_flight = get_variable(in_flight_var, STAT_SCOPE);
+	if(in_flight > 0)
+		set_variable(in_flight_var, in_flight > amount ? in_flight - amount : 0, STAT_SCOPE);
+}
+
+/**
+ * Change of 'btc.bitmex' reported by oracle: a rise is taken as top-up credited by bitmex, a drop
+ * as withdrawal paid out by it, which is in "hedge.xfer" till custodian mints it. Change beyond
+ * orders in flight is bitmex profit or loss.
+ */
+void settle_bitmex_change(int64_t delta) {
+	if(delta > 0) {
+		settle_hedge_order("hedge.topup"_n, delta);
+		return;
 	}
+	int64_t wdraw = get_variable("hedge.wdraw"_n, STAT_SCOPE);
+	int64_t paid = min(wdraw, -delta);
+	if(paid <= 0)
+		return;
+	set_variable("hedge.wdraw"_n, wdraw - paid, STAT_SCOPE);
+	set_variable("hedge.xfer"_n, get_variable("hedge.xfer"_n, STAT_SCOPE) + paid, STAT_SCOPE);
+}
 
-	return;
+/**
+ * DBTC minted to bank by custodian 'fillhedge' action has memo "hedge <id>", id of the filled
+ * 'balancehedge' order in 'mintorders'. Settles "hedge.xfer" by amount of that order, other
+ * DBTC mints to bank, as plain BTC deposits, are not hedge withdrawals.
+ */
+void settle_hedge_withdrawal(const string& memo) {
+	string word, id;
+	split_memo(memo, word, id);
+	if(!match_memo(word, "hedge") || id.empty() || id.size() > 19 || id.find_first_not_of("0123456789") != string::npos)
+		return;
+	uint64_t order_id = 0;
+	for(char c : id)
+		order_id = order_id * 10 + (c - '0');
+
+	mintOrders ord(CUSTODIAN, DBTC.code().raw());
+	auto itr = ord.find(order_id);
+	if(itr != ord.end() && itr->user == BANKACCOUNT && itr->status == "processing"_n)
+		set_variable("hedge.xfer"_n, get_variable("hedge.xfer"_n, STAT_SCOPE) - itr->btc_amount, STAT_SCOPE);
 }
 
-void on_too_much_liquidity() {
-	return;
+/**
+ * Moves share of hedge assets held at bitmex back to 'bitmex.trg' when effective bitmex balance
+ * leaves the band 'hedge.band' around it, or when bitmex margin or liquidity pool leave soft ranges
+ * of check_leverage() and check_liquidity(). If target share leaves liquidity pool out of its soft
+ * range, target is moved towards liquidity target, but not out of ['bitmex.min', 'bitmex.max'].
+ * Orders less than 'hedge.minord' satoshi are not placed, and no order is placed within
+ * 'hedge.cool' seconds after the previous one, which is 'hedge.last' of 'stat' scope.
+ * Shares are in 1e-10 units. Does nothing in settlement mode.
+ */
+void rebalance_hedge() {
+	print("\n====== rebalance hedge");
+	if(get_variable("settlement"_n, SYSTEM_SCOPE)) {
+		print("\nsettlement mode, nothing to do");
+		return;
+	}
+
+	variables stat_vars(BANKACCOUNT, STAT_SCOPE.value);
+	auto last = stat_vars.find("hedge.last"_n.value);
+	int64_t cooldown = get_variable("hedge.cool"_n, SYSTEM_SCOPE, 3600);
+	if(last != stat_vars.end() && (current_time_point() - last->mtime).to_seconds() < cooldown) {
+		print("\ncooldown after order ", last->value);
+		return;
+	}
+
+	int64_t topup = get_variable("hedge.topup"_n, STAT_SCOPE);
+	int64_t wdraw = get_variable("hedge.wdraw"_n, STAT_SCOPE);
+	int64_t xfer = get_variable("hedge.xfer"_n, STAT_SCOPE);
+	double btc_price = get_btc_price();
+	double hedge = 1e8 * get_hedge_assets_value() / btc_price + topup + xfer;
+	double bitmex = get_balance(BITMEXACC, BTC) + topup - wdraw;
+	double liquidity = hedge - bitmex;
+	double liq_trg = 1e8 * get_bank_capital_value() / btc_price / 2;
+	double liq_low = liq_trg / 2;
+	double liq_high = liq_trg * 1.5;
+	double low = get_variable("bitmex.min", SYSTEM_SCOPE) * 1e-10 * hedge;
+	double high = get_variable("bitmex.max", SYSTEM_SCOPE) * 1e-10 * hedge;
+	double band = get_variable("hedge.band"_n, SYSTEM_SCOPE, 1000000000) * 1e-10 * hedge;
+
+	double target = get_variable("bitmex.trg", SYSTEM_SCOPE) * 1e-10 * hedge;
+	if(lt(hedge - target, liq_low))
+		target = max(hedge - liq_trg, low);
+	else if(gt(hedge - target, liq_high))
+		target = min(hedge - liq_trg, high);
+
+	print("\nhedge assets ", hedge, ", bitmex ", bitmex, ", in flight +", topup, " -", wdraw, ", paid out ", xfer);
+	print("\nliquidity ", liquidity, " in [", liq_low, ", ", liq_high, "], bitmex target ", target, " in [", low, ", ", high, "]");
+
+	bool out_of_soft_ranges = lt(bitmex, low) || gt(bitmex, high) || lt(liquidity, liq_low) || gt(liquidity, liq_high);
+	if(!out_of_soft_ranges && !gt(std::abs(target - bitmex), band)) {
+		print("\nwithin band");
+		return;
+	}
+
+	int64_t order = int64_t(target - bitmex);
+	if(order > 0)
+		order = min(order, get_spendable_balance(DBTC));
+	if(std::abs(order) < get_variable("hedge.minord"_n, SYSTEM_SCOPE, 1000000)) {
+		print("\norder ", order, " is too small");
+		return;
+	}
+
+	print("\nhedge order ", order);
+	if(order > 0) {
+		set_variable("hedge.topup"_n, topup + order, STAT_SCOPE);
+		action(
+			permission_level{BANKACCOUNT, "active"_n},
+			CUSTODIAN, "transfer"_n,
+			make_tuple(BANKACCOUNT, CUSTODIAN, asset{order, DBTC}, bitmex_address)
+		).send();
+	}
+	else {
+		set_variable("hedge.wdraw"_n, wdraw - order, STAT_SCOPE);
+		action(
+			permission_level{BANKACCOUNT, "active"_n},
+			CUSTODIAN, "balancehedge"_n,
+			make_tuple(-order)
+		).send();
+	}
+	set_variable("hedge.last"_n, order, STAT_SCOPE);
 }
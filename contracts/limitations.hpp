@@ -12,18 +12,21 @@ using namespace std;
 
 #include <utility.hpp>
 #include <limit_handlers.hpp>
+#include <metrics.hpp>
+#include <shards.hpp>
 
+template<typename Coin = bank_coin>
 void check_main_switch() {
 
-	auto data_timestamp = get_var_upd_time("btcusd", PERIODIC_SCOPE);
+	auto data_timestamp = get_var_upd_time(Coin::btc_rate.to_string(), PERIODIC_SCOPE);
 	int64_t data_age = (current_time_point() - data_timestamp).to_seconds();
 	int64_t max_data_age = get_variable("maxdataage", SYSTEM_SCOPE);
 
-	auto btcusd = get_btc_price();
-	auto btcusd_low = get_variable("btcusd.low", PERIODIC_SCOPE) / 1000000;
-	auto btcusd_high = get_variable("btcusd.high", PERIODIC_SCOPE) / 1000000;
+	auto btc_price = get_btc_price<Coin>();
+	int64_t btc_price_low = get_variable(Coin::btc_low.to_string(), PERIODIC_SCOPE) / coin_scale<Coin>::rate;
+	int64_t btc_price_high = get_variable(Coin::btc_high.to_string(), PERIODIC_SCOPE) / coin_scale<Coin>::rate;
 
-	auto sw_onchain = (data_age <= max_data_age) && (btcusd >= btcusd_low) && (btcusd <= btcusd_high);
+	auto sw_onchain = (data_age <= max_data_age) && (btc_price >= btc_price_low) && (btc_price <= btc_price_high);
 
 	auto sw_service = get_variable("sw.service", SYSTEM_SCOPE);
 	auto sw_manual  = get_variable("sw.manual", SYSTEM_SCOPE);
@@ -35,13 +38,59 @@ void check_main_switch() {
 	}
 }
 
+// 'volumeused' decayed by hours passed since it was written
+int64_t get_used_volume(){
+	int64_t msec_in_hour = 3600000000;
+	auto last_update_time = get_var_upd_time("volumeused", STAT_SCOPE).time_since_epoch().count();
+	int64_t l_hour = last_update_time / msec_in_hour;
+	int64_t r_hour = current_time_point().time_since_epoch().count() / msec_in_hour;
+	int64_t n_hours = r_hour - l_hour;
+	int64_t volume_used = get_variable("volumeused", STAT_SCOPE);
+	if(n_hours == 0)
+		return volume_used;
+
+	int64_t max_abs_vol = get_variable("maxdayvol", SYSTEM_SCOPE);
+	int64_t hourly_decay = int64_t((1.0 * max_abs_vol / 20) + 0.5); //20 is close to 24 but without 3 as a divisor
+
+	int64_t sign = volume_used > 0 ? 1 : -1;
+	int64_t delta = n_hours * hourly_decay;
+	int64_t updated = volume_used * sign > delta ? volume_used - delta * sign : 0;
+
+	print("\n=========decay volumeused");
+	print("\nvolume used", volume_used);
+	print("\nl_h, r_h, n_h ", l_hour, " ", r_hour, " ", n_hours);
+	print("\nupdated volume used ", updated);
+	return updated;
+}
+
+// get_used_volume() with changes accrued to 'volshards' and not folded yet, see shards.hpp;
+// it reads all shards, so it is for keeper actions only
+int64_t get_pending_used_volume(){
+	return get_used_volume() + get_shards_total<volume_shards>(BANKACCOUNT.value);
+}
+
+/**
+ * Orders of users check daily volume against get_used_volume() and the shard of their account
+ * only, so that exchanges of accounts of different shards do not read rows the others write.
+ * Volume of other shards is unseen till 'sweepshards', so a shard takes orders in the direction
+ * of 'delta' only while its volume before the order is within 'maxdayvol' / SHARDS_COUNT:
+ * unseen volume is bounded by SHARDS_COUNT - 1 allowances and orders, which took the last ones.
+ */
+bool fits_shard_allowance(int64_t shard_before, int64_t delta) {
+	int64_t allowance = get_variable("maxdayvol", SYSTEM_SCOPE) / int64_t(SHARDS_COUNT);
+	return delta > 0 ? shard_before <= allowance : shard_before >= -allowance;
+}
+
+template<typename Coin = bank_coin>
 void check_limits(name from, name to, extended_asset quantity, const string& memo){
 
 	if(is_user_exchange(from, to, quantity, memo)){
-		int64_t usd_value = get_usd_value(quantity);
+		int64_t usd_value = get_usd_value<Coin>(quantity);
 		
-		int64_t btc_price = get_btc_price();
-		int64_t usd_volume_used = get_variable("volumeused", STAT_SCOPE) / 1000000;
+		int64_t btc_price = get_btc_price<Coin>();
+		// this order is counted already by update_statistics_on_trade() in shard of 'from'
+		int64_t shard = get_shard_value<volume_shards>(BANKACCOUNT.value, from);
+		int64_t usd_volume_used = (get_used_volume() + shard) / 1000000;
 
 		int64_t usd_order_maxlimit = get_variable("maxordersize", SYSTEM_SCOPE) / 1000000;
 		int64_t abs_usage_max = get_variable("maxdayvol", SYSTEM_SCOPE) / 1000000;
@@ -55,21 +104,80 @@ void check_limits(name from, name to, extended_asset quantity, const string& mem
 		print("\nusd quantity:", usd_value);
 
 		if(quantity.quantity.symbol == DBTC && quantity.contract == CUSTODIAN)
-			check(usd_value <= available_to_sell_dbtc, "total daily volume exceeded, try later");
-		if(quantity.quantity.symbol == DUSD && quantity.contract == BANKACCOUNT)
-			check(usd_value <= available_to_buy_dbtc, "total daily volume exceeded, try later");
+			check(usd_value <= available_to_sell_dbtc && fits_shard_allowance(shard + usd_value * 1000000, -1),
+				"total daily volume exceeded, try later");
+		if(quantity.quantity.symbol == Coin::sym && quantity.contract == BANKACCOUNT)
+			check(usd_value <= available_to_buy_dbtc && fits_shard_allowance(shard - usd_value * 1000000, 1),
+				"total daily volume exceeded, try later");
 
 		print("\n", quantity.quantity, "@", quantity.contract, " ", btc_price, " ", usd_value, " ", usd_order_maxlimit);
 		check(usd_value <= usd_order_maxlimit, "order maximum value exceeded, check \'maxordersize\' in \'variables\' table with scope \'system\'");
 	}
 }
 
+// true, if DUSD redemption passes daily volume check of check_limits() and bank holds requested asset
+// apart from payments of batch intents; 'volume_delta' is change of 'volumeused' not folded yet,
+// 'spent' is requested asset already sent
+bool can_redeem_now(asset quantity, const string& memo, int64_t volume_delta, int64_t spent) {
+	int64_t usd_volume_used = (get_used_volume() + volume_delta + quantity.amount * 1000000) / 1000000;
+	int64_t available_to_buy_dbtc = get_variable("maxdayvol", SYSTEM_SCOPE) / 1000000 - usd_volume_used;
+	if(quantity.amount > available_to_buy_dbtc)
+		return false;
+	if(match_memo(memo, "Redeem for EOS"))
+		return coin2eos(quantity) + spent <= get_spendable_balance(EOS);
+	return coin2satoshi(quantity) + spent <= get_spendable_balance(DBTC);
+}
+
+// asset requested by redemption memo, it is the scope of its queue, see redeem_queue.hpp
+symbol_code get_redeem_want(const string& memo) {
+	return match_memo(memo, "Redeem for EOS") ? EOS.code() : DBTC.code();
+}
+
+// redemption of 'owner' waits in queue, if it cannot be filled now or other redemptions for the same
+// asset wait already; orders above 'maxordersize' are not queued, check_limits() rejects them, orders
+// for assets not approved are not queued, bank::transfer rejects them
+bool must_queue_redeem(name owner, asset quantity, const string& memo) {
+	if(quantity.amount > get_variable("maxordersize", SYSTEM_SCOPE) / 1000000)
+		return false;
+	symbol_code want = get_redeem_want(memo);
+	extended_asset payment = want == EOS.code() ? extended_asset(asset(0, EOS), EOSIOTOKEN) : extended_asset(asset(0, DBTC), CUSTODIAN);
+	if(!is_approved_liquid_asset(payment))
+		return false;
+	int64_t shard = get_shard_value<volume_shards>(BANKACCOUNT.value, owner);
+	return get_redeem_queue_length(want) > 0 || !fits_shard_allowance(shard, 1)
+		|| !can_redeem_now(quantity, memo, shard, 0);
+}
+
+// checks of check_limits() and bank::transfer, which batch intent can take at submission: size of order
+// and approval of requested asset; 'batch.minord' keeps dust intents out of the epoch, daily volume is
+// checked at settlement by fits_net_volume()
+template<typename Coin = bank_coin>
+void check_batch_intent(extended_asset quantity, symbol_code want) {
+	if(want != Coin::sym.code()) {
+		extended_asset payment = want == EOS.code() ? extended_asset(asset(0, EOS), EOSIOTOKEN) : extended_asset(asset(0, DBTC), CUSTODIAN);
+		check(is_approved_liquid_asset(payment), "transfer not allowed 8");
+	}
+	int64_t usd_value = get_usd_value<Coin>(quantity);
+	check(usd_value <= get_variable("maxordersize", SYSTEM_SCOPE) / 1000000, "order maximum value exceeded, check \'maxordersize\' in \'variables\' table with scope \'system\'");
+	check(usd_value >= get_variable("batch.minord"_n, SYSTEM_SCOPE, 100000000) / 1000000, "order minimum value not reached, check \'batch.minord\' in \'variables\' table with scope \'system\'");
+}
+
+// true, if net value of batch epoch, positive for net redemption, passes daily volume check of check_limits();
+// 'volume_used' is get_pending_used_volume() read once for the epoch
+bool fits_net_volume(int64_t volume_used, int64_t net_value) {
+	int64_t usd_volume_used = (volume_used + net_value * 1000000) / 1000000;
+	int64_t abs_usage_max = get_variable("maxdayvol", SYSTEM_SCOPE) / 1000000;
+	if(net_value > 0)
+		return net_value <= abs_usage_max - usd_volume_used;
+	return -net_value <= usd_volume_used + abs_usage_max;
+}
+
 double check_bitmex_balance_ratio() {
 	// returns share (of hedge assets) in format 0.*
 	// if positive => exceeds maximum value
 	// if negatime => below minimum value
 	int64_t value_to_hedge = get_hedge_assets_value();
-	int64_t btm_balance = get_usd_value(asset(get_balance(BITMEXACC, BTC), BTC));
+	int64_t btm_balance = get_btc_value(get_balance(BITMEXACC, BTC));
 	double maintainance_share = 1.0 * btm_balance / value_to_hedge;
 	double btm_min = 1.0 * get_variable("bitmex.min", SYSTEM_SCOPE) * 1e-10;
 	double btm_max = 1.0 * get_variable("bitmex.max", SYSTEM_SCOPE) * 1e-10;
@@ -81,7 +189,7 @@ double check_bitmex_balance_ratio() {
 	return 0.;
 }
 
-void check_liquidity(bool internal_trigger) {
+void check_liquidity(bool internal_trigger, name caller) {
 	// checks that liquidity pool is not far from target
 	// we allow the liquidity pool to be 0
 
@@ -94,23 +202,25 @@ void check_liquidity(bool internal_trigger) {
 	double current_liq_pool = 1.0 * get_liquidity_pool_value();
 
 	if(lt(current_liq_pool, soft_value_low)) {
+		accrue_metric("lim.liq"_n, caller);
 		on_lack_of_liquidity();
 		if(!internal_trigger && lt(current_liq_pool, hard_value_low))
 			fail("there is not enough liquidity for your order, reduce or try later");
 	}
 	if(gt(current_liq_pool, soft_value_high)) {
+		accrue_metric("lim.liq"_n, caller);
 		on_too_much_liquidity();
 		if(!internal_trigger && gt(current_liq_pool, hard_value_high))
 			fail("thedeposbank needs to rebalance assets, reduce or try later");	
 	}
 }
 
-void check_leverage(bool internal_trigger){
+void check_leverage(bool internal_trigger, name caller){
 
 	double soft_margin = get_variable("bitmex.min", SYSTEM_SCOPE) * 1e-10;
 	double hard_margin = get_hard_margin(soft_margin);
 	int64_t hedge_assets_value = get_hedge_assets_value();
-	int64_t bitmex_balance_value = get_usd_value(asset(get_balance(BITMEXACC, BTC), BTC));
+	int64_t bitmex_balance_value = get_btc_value(get_balance(BITMEXACC, BTC));
 	int64_t soft_value = int64_t(soft_margin * hedge_assets_value);
 	int64_t hard_value = int64_t(hard_margin * hedge_assets_value);
 
@@ -125,13 +235,14 @@ void check_leverage(bool internal_trigger){
 	print("\nBITMEX BTC balance ", get_balance(BITMEXACC, BTC));
 	if(lt(1.0 * bitmex_balance_value, soft_value))
 	{
+		accrue_metric("lim.lev"_n, caller);
 		on_high_leverage();
 		if(!internal_trigger && lt(1.0 * bitmex_balance_value, hard_value))	
 			fail("at the moment minting is not available due to high demand, please, try later");
 	}
 }
 
-void check_capital(bool internal_trigger){
+void check_capital(bool internal_trigger, name caller){
 
 	int64_t bank_capital = get_bank_capital_value();
 	int64_t dusd_supply = get_supply(DUSD);
@@ -150,6 +261,7 @@ void check_capital(bool internal_trigger){
 	print("\ninternal_trigger ", internal_trigger);
 	if(lt(1.0 * bank_capital, soft_margin))
 	{
+		accrue_metric("lim.cap"_n, caller);
 		on_lack_of_capital();
 		if(!internal_trigger && lt(1.0 * bank_capital, hard_margin))
 			fail("System needs to increase bank capital. Please, try later.");
@@ -161,52 +273,37 @@ void check_capital(bool internal_trigger){
 	}
 }
 
+// returns change of 'volumeused', accrued to shard of the account, see shards.hpp
 void update_statistics_on_trade(name from, name to, extended_asset quantity, const string & memo){
-	int64_t cur_volume_used = get_variable("volumeused", STAT_SCOPE);
 	int64_t transaction_value = get_usd_value(quantity);
+	int64_t delta = 0;
 	
 	if(is_dusd_mint(from, to, quantity, memo))
-		set_variable("volumeused"_n, cur_volume_used - transaction_value * 1000000, STAT_SCOPE);
+		delta = -transaction_value * 1000000;
 	if(is_dusd_redeem(from, to, quantity, memo))
-		set_variable("volumeused"_n, cur_volume_used + transaction_value * 1000000, STAT_SCOPE);
+		delta = transaction_value * 1000000;
+	if(delta != 0)
+		accrue_used_volume(from, delta);
 }
 
-void decay_used_volume(){
-	int64_t msec_in_hour = 3600000000;
-	auto last_update_time = get_var_upd_time("volumeused", STAT_SCOPE).time_since_epoch().count();
-	int64_t l_hour = last_update_time / msec_in_hour;
-	int64_t r_hour = current_time_point().time_since_epoch().count() / msec_in_hour;
-	int64_t n_hours = r_hour - l_hour;
-	if(n_hours == 0)
-		return;
-
-	int64_t max_abs_vol = get_variable("maxdayvol", SYSTEM_SCOPE);
-	int64_t hourly_decay = int64_t((1.0 * max_abs_vol / 20) + 0.5); //20 is close to 24 but without 3 as a divisor
-
-	int64_t volume_used = get_variable("volumeused", STAT_SCOPE);
-	int64_t sign = volume_used > 0 ? 1 : -1;
-	int64_t delta = n_hours * hourly_decay;
-	int64_t updated = volume_used * sign > delta ? volume_used - delta * sign : 0;
-
-	print("\n=========decay volumeused");
-	print("\nvolume used", volume_used);
-	print("\nl_h, r_h, n_h ", l_hour, " ", r_hour, " ", n_hours);
-	print("\nupdated volume used ", updated);
-
-	set_variable("volumeused"_n, updated, STAT_SCOPE);
+// folds shards of 'volumeused' into it, called by 'sweepshards' action only
+void fold_used_volume(){
+	int64_t volume_used = get_used_volume();
+	int64_t pending = fold_shards<volume_shards>(BANKACCOUNT.value);
+	if(pending != 0 || volume_used != get_variable("volumeused", STAT_SCOPE))
+		set_variable("volumeused"_n, volume_used + pending, STAT_SCOPE);
 }
 
 void check_on_transfer(name from, name to, extended_asset quantity, const string & memo) {
-	decay_used_volume();
 	update_statistics_on_trade(from, to, quantity, memo);
 	check_limits(from, to, quantity, memo);
 }
 
-void check_on_system_change(bool internal_trigger=false) {
+// 'caller' is account of the user, whose order changed the system, it chooses shard of limit metrics
+void check_on_system_change(bool internal_trigger=false, name caller=BANKACCOUNT) {
 	if(get_variable("settlement"_n, SYSTEM_SCOPE))
 		return;
-	decay_used_volume();
-	check_liquidity(internal_trigger);
-	check_leverage(internal_trigger);
-	check_capital(internal_trigger);
+	check_liquidity(internal_trigger, caller);
+	check_leverage(internal_trigger, caller);
+	check_capital(internal_trigger, caller);
 }
\ No newline at end of file
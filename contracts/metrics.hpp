@@ -0,0 +1,128 @@
+#pragma once
+
+using namespace eosio;
+using namespace std;
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/system.hpp>
+#include <string>
+#include <vector>
+
+#include <stable.coin.hpp>
+#include <shards.hpp>
+
+/**
+ * Per-action counters for ops dashboards. Scope is metric name:
+ *   "mint.dbtc", "mint.eos", "redeem.btc", "redeem.dbtc", "redeem.eos",
+ *   "dps.buy", "dps.redeem", "p2p" -- user actions, volume in USD cents;
+ *   "lim.liq", "lim.lev", "lim.cap" -- soft limit breaches, no volume.
+ * Each scope is a ring of METRICS_RING_SIZE hourly buckets, primary key is
+ * hour % METRICS_RING_SIZE, so a scope never holds more than that many rows.
+ * A bucket left from a previous round of the ring is reset on first write.
+ * Transactions rejected by check() leave no trace here, because all their
+ * writes are reverted.
+ * Actions accrue their metrics to "mtrshards" rows chosen by shard_of() of the
+ * user (see accrue_metric()), so orders of different users do not write one
+ * bucket row; 'sweepshards' action of bank records them into the bucket of the
+ * sweep hour (see fold_metrics()). Keeper actions accrue to the shard of bank.
+ */
+const int64_t METRICS_RING_SIZE = 24;
+
+const name METRIC_NAMES[] = {
+	"mint.dbtc"_n, "mint.eos"_n, "redeem.btc"_n, "redeem.dbtc"_n, "redeem.eos"_n,
+	"dps.buy"_n, "dps.redeem"_n, "p2p"_n, "lim.liq"_n, "lim.lev"_n, "lim.cap"_n
+};
+
+TABLE metric {
+	uint64_t slot;
+	int64_t  hour;      // hours since epoch
+	uint64_t calls;
+	int64_t  volume;    // in USD cents
+
+	uint64_t primary_key()const { return slot; }
+};
+
+TABLE metric_shard {
+	uint64_t id;
+	uint64_t calls;
+	int64_t  volume;    // in USD cents
+
+	uint64_t primary_key()const { return id; }
+};
+
+typedef eosio::multi_index< "metrics"_n, metric > metrics;
+typedef eosio::multi_index< "mtrshards"_n, metric_shard > metric_shards;
+
+void record_metric(name metric_name, int64_t usd_value = 0, uint64_t calls = 1) {
+	int64_t hour = current_time_point().sec_since_epoch() / 3600;
+	uint64_t slot = hour % METRICS_RING_SIZE;
+
+	metrics mtr(BANKACCOUNT, metric_name.value);
+	auto itr = mtr.find(slot);
+	if(itr == mtr.end()) {
+		mtr.emplace(BANKACCOUNT, [&](auto& m) {
+			m.slot   = slot;
+			m.hour   = hour;
+			m.calls  = calls;
+			m.volume = usd_value;
+		});
+	}
+	else if(itr->hour != hour) {
+		mtr.modify(itr, same_payer, [&](auto& m) {
+			m.hour   = hour;
+			m.calls  = calls;
+			m.volume = usd_value;
+		});
+	}
+	else {
+		mtr.modify(itr, same_payer, [&](auto& m) {
+			m.calls  += calls;
+			m.volume += usd_value;
+		});
+	}
+}
+
+// the only writer of metrics in actions, see fold_metrics()
+void accrue_metric(name metric_name, name caller, int64_t usd_value = 0) {
+	metric_shards shards(BANKACCOUNT, metric_name.value);
+	uint64_t id = shard_of(caller);
+	auto itr = shards.find(id);
+	if(itr == shards.end()) {
+		shards.emplace(BANKACCOUNT, [&](auto& s) {
+			s.id     = id;
+			s.calls  = 1;
+			s.volume = usd_value;
+		});
+	}
+	else {
+		shards.modify(itr, same_payer, [&](auto& s) {
+			s.calls  += 1;
+			s.volume += usd_value;
+		});
+	}
+}
+
+// records calls accrued in shards and sets them to zero
+void fold_metric(name metric_name) {
+	metric_shards shards(BANKACCOUNT, metric_name.value);
+	uint64_t calls = 0;
+	int64_t volume = 0;
+	for(auto itr = shards.begin(); itr != shards.end(); itr++) {
+		if(itr->calls == 0)
+			continue;
+		calls  += itr->calls;
+		volume += itr->volume;
+		shards.modify(itr, same_payer, [&](auto& s) {
+			s.calls  = 0;
+			s.volume = 0;
+		});
+	}
+	if(calls > 0)
+		record_metric(metric_name, volume, calls);
+}
+
+void fold_metrics() {
+	for(name metric_name : METRIC_NAMES)
+		fold_metric(metric_name);
+}
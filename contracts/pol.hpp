@@ -0,0 +1,55 @@
+#pragma once
+
+using namespace eosio;
+using namespace std;
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/crypto.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * Merkle sum tree for proof of liabilities. Every node carries a hash and a sum of balances below it.
+ * Byte layout (integers are little-endian), must be kept in sync with tools/pol:
+ *   leaf = sha256( 0x00 | owner.value (8 bytes) | balance amount (8 bytes) )
+ *   node = sha256( 0x01 | left hash (32 bytes) | left sum (8 bytes) | right hash (32 bytes) | right sum (8 bytes) )
+ *   node sum = left sum + right sum
+ * A node without a pair on its level is moved to the next level unchanged.
+ */
+struct pol_proof_node {
+	checksum256 hash;
+	int64_t     sum;
+	bool        is_left;      // true, if this sibling is the left child
+};
+
+void pol_put_int64(char*& pos, uint64_t value) {
+	for(int i = 0; i < 8; i++)
+		*pos++ = char((value >> (8 * i)) & 0xff);
+}
+
+void pol_put_hash(char*& pos, const checksum256& hash) {
+	auto bytes = hash.extract_as_byte_array();
+	for(auto b : bytes)
+		*pos++ = char(b);
+}
+
+checksum256 pol_leaf_hash(name owner, int64_t amount) {
+	char buf[17];
+	char* pos = buf;
+	*pos++ = 0;
+	pol_put_int64(pos, owner.value);
+	pol_put_int64(pos, uint64_t(amount));
+	return sha256(buf, sizeof(buf));
+}
+
+checksum256 pol_node_hash(const checksum256& left, int64_t left_sum, const checksum256& right, int64_t right_sum) {
+	char buf[81];
+	char* pos = buf;
+	*pos++ = 1;
+	pol_put_hash(pos, left);
+	pol_put_int64(pos, uint64_t(left_sum));
+	pol_put_hash(pos, right);
+	pol_put_int64(pos, uint64_t(right_sum));
+	return sha256(buf, sizeof(buf));
+}
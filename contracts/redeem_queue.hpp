@@ -0,0 +1,78 @@
+#pragma once
+
+using namespace eosio;
+using namespace std;
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/system.hpp>
+#include <string>
+
+#include <stable.coin.hpp>
+
+/**
+ * FIFO queues of DUSD redemptions, which daily volume or bank balance of requested asset cannot take
+ * at the moment (see must_queue_redeem() in limitations.hpp), one queue per requested asset: DBTC
+ * (for "Redeem for DBTC" and BTC address) and EOS, so that lack of one asset does not hold redemptions
+ * for the other. DUSD of queued order is escrowed in bank balance and counted in 'queued' of "rdmqueue"
+ * row, so it is not bank capital. 'fillredeems' action fills orders of each queue from 'head' in order
+ * of id at prices of fill time, while they fit. 'rdmcancel' action refunds escrow of an order to its
+ * owner, cancelled order leaves a gap in ids, which fill skips.
+ * Queue row keeps running totals of orders queued, filled and cancelled, order row keeps the totals
+ * of its queue at insert, so position of an order is a difference of them, see get_redeem_position().
+ * Scope is requested asset symbol code, see get_redeem_want() in limitations.hpp; "rdmqueue" row per
+ * stablecoin, "rdmorders" row per order.
+ */
+TABLE redeem_queue {
+	asset    queued;      // DUSD of orders not filled yet
+	uint64_t head;        // id of the first order not filled or cancelled gap before it
+	uint64_t tail;        // id of the next order, it is the number of orders queued
+	int64_t  enqueued;    // DUSD of all orders queued
+	int64_t  filled;      // DUSD of all orders filled
+	uint64_t fills;       // number of orders filled
+	int64_t  cancelled;   // DUSD of all orders cancelled
+	uint64_t cancels;     // number of orders cancelled
+
+	uint64_t primary_key()const { return queued.symbol.code().raw(); }
+};
+
+TABLE redeem_order {
+	uint64_t   id;
+	name       owner;
+	asset      quantity;
+	string     memo;      // memo of redemption transfer: requested asset or BTC address
+	time_point ctime;
+	int64_t    enqueued;  // 'enqueued', 'cancelled' and 'cancels' of queue before this order
+	int64_t    cancelled;
+	uint64_t   cancels;
+
+	uint64_t primary_key()const { return id; }
+};
+
+typedef eosio::multi_index< "rdmqueue"_n, redeem_queue > redeem_queues;
+typedef eosio::multi_index< "rdmorders"_n, redeem_order > redeem_orders;
+
+int64_t get_redeem_queued() {
+	int64_t queued = 0;
+	for(auto want : {DBTC.code(), EOS.code()}) {
+		redeem_queues queues(BANKACCOUNT, want.raw());
+		auto itr = queues.find(DUSD.code().raw());
+		queued += itr == queues.end() ? 0 : itr->queued.amount;
+	}
+	return queued;
+}
+
+// orders waiting in queue, cancelled ones are not counted
+uint64_t get_redeem_queue_length(symbol_code want) {
+	redeem_queues queues(BANKACCOUNT, want.raw());
+	auto itr = queues.find(DUSD.code().raw());
+	return itr == queues.end() ? 0 : itr->tail - itr->fills - itr->cancels;
+}
+
+// orders and DUSD ahead of 'order': orders filled are all ahead of it, and so are the ones cancelled
+// before it was queued; orders ahead cancelled after it was queued are still counted, so both
+// are upper bounds till the fill passes them
+void get_redeem_position(const redeem_queue& queue, const redeem_order& order, uint64_t& position, int64_t& ahead) {
+	position = order.id - queue.fills - order.cancels;
+	ahead = order.enqueued - queue.filled - order.cancelled;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+using namespace eosio;
+using namespace std;
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/system.hpp>
+
+#include <stable.coin.hpp>
+#include <depostoken.hpp>
+
+/**
+ * Stablecoin savings vault. DUSD deposited by transfer to bank with memo "Deposit to savings" is retired
+ * and owed back to savers by "vault" row: 'value' at 'mtime' for 'shares' in total. Value grows by
+ * 'save.apr' system variable (format of fc_dbond apr, 1000 means 10%), but not faster than fc_dbonds
+ * held by bank earn (see get_savings_apr()), and the grown value is saved at every deposit, withdrawal
+ * and 'accrue' action (see accrue_savings()), so accrual writes one row for any number of savers. 'withdraw' action issues value of shares at the current share price.
+ * Value of vault is liability of the bank, get_bank_assets_value() takes it off bank assets.
+ * Scope is BANKACCOUNT for both tables, "vault" row per stablecoin, "savings" row per saver.
+ */
+TABLE vault {
+	asset      value;
+	int64_t    shares;
+	time_point mtime;
+
+	uint64_t primary_key()const { return value.symbol.code().raw(); }
+};
+
+TABLE saver {
+	name    owner;
+	int64_t shares;
+
+	uint64_t primary_key()const { return owner.value; }
+};
+
+typedef eosio::multi_index< "vault"_n, vault > vaults;
+typedef eosio::multi_index< "savings"_n, saver > savers;
+
+// 'save.apr' capped by 'dbonds.apr' stat variable: value-weighted apr of fc_dbonds held by bank,
+// saved by get_dbonds_assets_value(); without dbonds savings do not grow
+int64_t get_savings_apr() {
+	variables sys_vars(BANKACCOUNT, SYSTEM_SCOPE.value);
+	auto itr = sys_vars.find(("save.apr"_n).value);
+	if(itr == sys_vars.end())
+		return 0;
+	variables stat_vars(BANKACCOUNT, STAT_SCOPE.value);
+	auto cap = stat_vars.find(("dbonds.apr"_n).value);
+	return cap == stat_vars.end() ? 0 : std::min(itr->value, cap->value);
+}
+
+// value of vault grown since 'mtime' till 'now', simple interest between accruals
+int64_t get_accrued_value(const vault& v, time_point now, int64_t apr) {
+	int64_t seconds = std::max<int64_t>((now - v.mtime).to_seconds(), 0);
+	return v.value.amount + get_apr_interest(v.value.amount, apr, seconds);
+}
+
+int64_t get_savings_value() {
+	vaults vs(BANKACCOUNT, BANKACCOUNT.value);
+	auto itr = vs.find(DUSD.code().raw());
+	if(itr == vs.end())
+		return 0;
+	return get_accrued_value(*itr, current_time_point(), get_savings_apr());
+}
+
+// saves grown value of vault, returns vault row
+vault accrue_savings() {
+	vaults vs(BANKACCOUNT, BANKACCOUNT.value);
+	auto itr = vs.find(DUSD.code().raw());
+	if(itr == vs.end()) {
+		itr = vs.emplace(BANKACCOUNT, [&](auto& v) {
+			v.value  = asset(0, DUSD);
+			v.shares = 0;
+			v.mtime  = current_time_point();
+		});
+	}
+	else {
+		int64_t value = get_accrued_value(*itr, current_time_point(), get_savings_apr());
+		vs.modify(itr, same_payer, [&](auto& v) {
+			v.value.amount = value;
+			v.mtime        = current_time_point();
+		});
+	}
+	return *itr;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+using namespace eosio;
+using namespace std;
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <string>
+#include <vector>
+
+#include <stable.coin.hpp>
+
+/**
+ * Counters, which every transaction would write, split into SHARDS_COUNT rows,
+ * so that transactions of different accounts write different rows:
+ *   "feeshards", scope is token symbol code -- transfer fees not added to bank balance yet;
+ *   "volshards", scope is BANKACCOUNT -- change of 'volumeused' not folded into it yet;
+ *   "ledgshards", scope is token symbol code -- change of 'users_held' not folded into 'ledger' yet,
+ *   kept by every token contract in its own tables, see token::update_ledger().
+ * Row is chosen by account, see shard_of(). Rows are folded back by 'sweepshards' action of bank
+ * (and of custodian for its ledger) and kept with zero value, so the tables never hold more than
+ * SHARDS_COUNT rows per scope. 'code' of helpers is the contract owning the table.
+ * Transactions of users read their own shard only, see get_shard_value(); sums of all shards are
+ * read by keeper actions and invariant checks.
+ */
+const uint64_t SHARDS_COUNT = 16;
+
+TABLE shard {
+	uint64_t id;
+	int64_t  value;
+
+	uint64_t primary_key()const { return id; }
+};
+
+typedef eosio::multi_index< "feeshards"_n, shard > fee_shards;
+typedef eosio::multi_index< "volshards"_n, shard > volume_shards;
+typedef eosio::multi_index< "ledgshards"_n, shard > ledger_shards;
+
+uint64_t shard_of(name account) {
+	// characters of a name are in its high bits, multiplicative hashing mixes them into high bits
+	// of the product, which are taken by multiplying it to SHARDS_COUNT
+	uint64_t hash = account.value * 0x9e3779b97f4a7c15ull;
+	return uint64_t(((uint128_t)hash * SHARDS_COUNT) >> 64);
+}
+
+template<typename Shards>
+void add_to_shard(uint64_t scope, name account, int64_t delta, name code = BANKACCOUNT) {
+	Shards shards(code, scope);
+	uint64_t id = shard_of(account);
+	auto itr = shards.find(id);
+	if(itr == shards.end()) {
+		shards.emplace(code, [&](auto& s) {
+			s.id    = id;
+			s.value = delta;
+		});
+	}
+	else {
+		shards.modify(itr, same_payer, [&](auto& s) {
+			s.value += delta;
+		});
+	}
+}
+
+template<typename Shards>
+int64_t get_shard_value(uint64_t scope, name account, name code = BANKACCOUNT) {
+	Shards shards(code, scope);
+	auto itr = shards.find(shard_of(account));
+	return itr == shards.end() ? 0 : itr->value;
+}
+
+template<typename Shards>
+int64_t get_shards_total(uint64_t scope, name code = BANKACCOUNT) {
+	Shards shards(code, scope);
+	int64_t total = 0;
+	for(const auto& s : shards)
+		total += s.value;
+	return total;
+}
+
+// returns sum of shards and sets them to zero
+template<typename Shards>
+int64_t fold_shards(uint64_t scope, name code = BANKACCOUNT) {
+	Shards shards(code, scope);
+	int64_t total = 0;
+	for(auto itr = shards.begin(); itr != shards.end(); itr++) {
+		if(itr->value == 0)
+			continue;
+		total += itr->value;
+		shards.modify(itr, same_payer, [&](auto& s) {
+			s.value = 0;
+		});
+	}
+	return total;
+}
+
+void accrue_transfer_fee(name payer, asset fee) {
+	add_to_shard<fee_shards>(fee.symbol.code().raw(), payer, fee.amount);
+}
+
+void accrue_used_volume(name account, int64_t delta) {
+	add_to_shard<volume_shards>(BANKACCOUNT.value, account, delta);
+}
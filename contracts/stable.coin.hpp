@@ -9,13 +9,16 @@ using namespace eosio;
 #include <string>
 #include <vector>
 
-const symbol DUSD("DUSD", 2);
+#include <stablecoin.hpp>
+
+// stablecoin of this build, "DUSD" unless other policy is chosen, see stablecoin.hpp
+const symbol DUSD = bank_coin::sym;
 const symbol DPS("DPS", 8);
 const symbol DBTC("DBTC", 8);
 const symbol BTC("BTC", 8);
 const symbol EOS("EOS", 4);
 
-const double dusdPrecision = 1e2;
+const double dusdPrecision = coin_scale<bank_coin>::unit;
 const double dpsPrecision  = 1e8;
 const double dbtcPrecision = 1e8;
 
@@ -40,6 +43,8 @@ constexpr name SYSTEM_SCOPE   = name{"system"};
 constexpr name STAT_SCOPE     = name{"stat"};
 constexpr name DBONDS_SCOPE   = name{"dbonds"};
 
+const int64_t SECONDS_IN_YEAR = 365 * 24 * 3600;
+
 #ifdef DEBUG
 const std::string bitmex_address("2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxM");
 #else
@@ -54,6 +59,11 @@ bool fail(const char* message) {
 	return false;
 }
 
+// simple interest on 'amount' for 'seconds' at 'apr' in format of fc_dbond apr (1000 means 10%)
+int64_t get_apr_interest(int64_t amount, int64_t apr, int64_t seconds) {
+	return int64_t((int128_t)amount * apr * seconds / (10000 * SECONDS_IN_YEAR));
+}
+
 bool is_approved_liquid_asset(extended_asset quantity) {
 	return approved_liquid_assets.find(quantity.get_extended_symbol()) != approved_liquid_assets.end();
 }
@@ -74,10 +84,10 @@ bool validate_btc_address(const std::string& address, bool is_testnet) {
 	std::vector<uint8_t> addr_bin(25);
 
 	for(int i = 0; address[i]; i++) {
-		if(address[i] & 0x80 || b58digits_map[address[i]] == -1)
+		if(address[i] & 0x80 || b58digits_map[uint8_t(address[i])] == -1)
 			return false; // fail("Invalid bitcoin address: bad char");
  
-		int c = b58digits_map[address[i]];
+		int c = b58digits_map[uint8_t(address[i])];
 		for(int j = 25; j--; ) {
 			c += 58 * addr_bin[j];
 			addr_bin[j] = c & 0xff;
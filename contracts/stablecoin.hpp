@@ -0,0 +1,60 @@
+#pragma once
+
+using namespace eosio;
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+
+/**
+ * Stablecoin policies. Bank contract is built for one stablecoin, its policy is 'bank_coin'
+ * (DUSD by default, -DSTABLECOIN_EUR builds DEUR). Conversions and limits of utility.hpp and
+ * limitations.hpp are templates on policy, so symbol, scale factors and names of oracle
+ * variables are constants of each instance and nothing branches on the stablecoin at runtime.
+ *
+ * Policy members:
+ *   sym      -- stablecoin symbol, its precision gives scale factors, see coin_scale;
+ *   btc_rate -- periodic variable, price of 1 BTC in stablecoin, stored in scale 1e8;
+ *   btc_low  -- periodic variable, lowest allowed btc_rate;
+ *   btc_high -- periodic variable, highest allowed btc_rate;
+ *   eos_rate -- periodic variable, price of 1 EOS in stablecoin, stored in scale 1e8.
+ */
+struct usd_coin {
+	static constexpr symbol sym{"DUSD", 2};
+	static constexpr name   btc_rate{"btcusd"};
+	static constexpr name   btc_low{"btcusd.low"};
+	static constexpr name   btc_high{"btcusd.high"};
+	static constexpr name   eos_rate{"eosusd"};
+};
+
+struct eur_coin {
+	static constexpr symbol sym{"DEUR", 2};
+	static constexpr name   btc_rate{"btceur"};
+	static constexpr name   btc_low{"btceur.low"};
+	static constexpr name   btc_high{"btceur.high"};
+	static constexpr name   eos_rate{"eoseur"};
+};
+
+#ifdef STABLECOIN_EUR
+using bank_coin = eur_coin;
+#else
+using bank_coin = usd_coin;
+#endif
+
+constexpr double decimal_scale(uint8_t precision) {
+	return precision == 0 ? 1.0 : 10.0 * decimal_scale(precision - 1);
+}
+
+template<typename Coin>
+struct coin_scale {
+	// minimal units of stablecoin in one stablecoin (100 cents for DUSD)
+	static constexpr double unit = decimal_scale(Coin::sym.precision());
+	// rate variable (scale 1e8) to price in minimal units: divide by 'rate', or multiply by 'rate_factor'
+	static constexpr double rate = 1e8 / unit;
+	static constexpr double rate_factor = unit / 1e8;
+	// satoshi (eoshi) per minimal unit of stablecoin at price of 1 stablecoin per BTC (EOS)
+	static constexpr double satoshi = 1e8 / unit;
+	static constexpr double eoshi = 1e4 / unit;
+};
+
+static_assert(coin_scale<usd_coin>::rate == 1e6 && coin_scale<usd_coin>::rate_factor == 1e-6, "DUSD scale");
+static_assert(coin_scale<usd_coin>::satoshi == 1e6 && coin_scale<usd_coin>::eoshi == 1e2, "DUSD scale");
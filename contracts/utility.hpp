@@ -8,11 +8,16 @@ using namespace std;
 #include <eosio/system.hpp>
 #include <eosio/crypto.hpp>
 #include <cmath>
+#include <map>
 #include <string>
 #include <vector>
 #include <cctype>
 #include <stable.coin.hpp>
 #include <dbonds_tables.hpp>
+#include <dbonds_accrual.hpp>
+#include <savings.hpp>
+#include <redeem_queue.hpp>
+#include <batch.hpp>
 
 #define err 1e-7
 
@@ -78,6 +83,11 @@ int64_t get_variable(name varname, name scope, int64_t default_value = 0) {
 	return itr->value;
 }
 
+// fee of p2p transfer of bank tokens, charged above 'quantity'
+int64_t get_transfer_fee(asset quantity) {
+	return std::round(1e-10 * quantity.amount * get_variable("fee.transfer", SYSTEM_SCOPE));
+}
+
 void set_variable(name var_name, int64_t value, name SCOPE) {
 	check(SCOPE == STAT_SCOPE || SCOPE == SYSTEM_SCOPE || SCOPE == PERIODIC_SCOPE,
 		"only stat, system or periodic scope allowed");
@@ -111,6 +121,13 @@ asset dusd2dps(asset dusd, bool nominal) {
 	return {static_cast<int64_t>(std::round(dusd.amount * rate_)), DPS};
 }
 
+// DUSD distributed to DPS holders and not claimed yet, it is not bank capital
+int64_t get_profit_owed() {
+	profit_pools pools(BANKACCOUNT, BANKACCOUNT.value);
+	auto pool = pools.find(DUSD.code().raw());
+	return pool == pools.end() ? 0 : pool->owed.amount;
+}
+
 asset dps2dusd(asset dps, bool nominal) {
 	check(dps.symbol == DPS, "wrong symbol in dps2dusd()");
 
@@ -125,7 +142,8 @@ asset dps2dusd(asset dps, bool nominal) {
 		stats dps_stats(BANKACCOUNT, DPS.code().raw());
 		accounts issuer_balances(BANKACCOUNT, BANKACCOUNT.value);
 		
-		asset reserveFund = issuer_balances.get(DUSD.code().raw()).balance;
+		asset reserveFund = issuer_balances.get(DUSD.code().raw()).balance
+			- asset(get_profit_owed() + get_redeem_queued() + get_batch_epoch().dusd.amount, DUSD);
 		asset dpsInCirculation = 
 			dps_stats.get(DPS.code().raw()).supply -
 			issuer_balances.get(DPS.code().raw()).balance;
@@ -175,57 +193,68 @@ bool is_user_exchange(name from, name to, extended_asset quantity, const string
 	return is_dusd_mint(from, to, quantity, memo) || is_dusd_redeem(from, to, quantity, memo);
 }
 
+// price of 1 BTC in minimal units of stablecoin (cents for DUSD)
+template<typename Coin = bank_coin>
 int64_t get_btc_price() {
-	// returns price in cents
-	int64_t value = get_variable("btcusd", PERIODIC_SCOPE) / 1e6;
+	int64_t value = get_variable(Coin::btc_rate.to_string(), PERIODIC_SCOPE) / coin_scale<Coin>::rate;
 	return value;
 }
 
+// price of 1 EOS in minimal units of stablecoin
+template<typename Coin = bank_coin>
 int64_t get_eos_price() {
-	// returns price in cents
-	int64_t value = get_variable("eosusd", PERIODIC_SCOPE) / 1e6;
+	int64_t value = get_variable(Coin::eos_rate.to_string(), PERIODIC_SCOPE) / coin_scale<Coin>::rate;
 	return value;
 }
 
+template<typename Coin = bank_coin>
+int64_t get_btc_value(int64_t satoshi_amount) {
+	double btc_price = 1.0 * get_btc_price<Coin>();
+	double btc_amount = 1.0 * satoshi_amount / 100000000;
+	return int64_t(round(btc_amount * btc_price));
+}
+
+template<typename Coin = bank_coin>
+int64_t get_eos_value(int64_t eoshi_amount) {
+	double eos_price = get_variable(Coin::eos_rate.to_string(), PERIODIC_SCOPE) * coin_scale<Coin>::rate_factor;
+	double eos_amount = eoshi_amount * 1e-4;
+	return int64_t(round(eos_amount * eos_price));
+}
+
+template<typename Coin = bank_coin>
 int64_t get_usd_value(asset quantity) {
-	// returns value in cents
+	// returns value in minimal units of stablecoin
 	if(quantity.symbol == DBTC || quantity.symbol == BTC)
-	{
-		double btc_price = 1.0 * get_btc_price();
-		double btc_amount = 1.0 * quantity.amount / 100000000;
-		return int64_t(round(btc_amount * btc_price));
-	}
-	if(quantity.symbol == DUSD)
+		return get_btc_value<Coin>(quantity.amount);
+	if(quantity.symbol == Coin::sym)
 		return quantity.amount;
-	if(quantity.symbol == EOS) {
-		double eos_price = get_variable("eosusd", PERIODIC_SCOPE) * 1e-6;
-		double eos_amount = quantity.amount * 1e-4;
-		return int64_t(round(eos_amount * eos_price));
-	}
+	if(quantity.symbol == EOS)
+		return get_eos_value<Coin>(quantity.amount);
 	fail("get_usd_value not supported with this asset");
 }
 
+template<typename Coin = bank_coin>
 int64_t get_usd_value(extended_asset quantity) {
-	// returns value in cents
+	// returns value in minimal units of stablecoin
 	if((quantity.quantity.symbol == DBTC || quantity.quantity.symbol == BTC) && quantity.contract == CUSTODIAN)
-	{
-		double btc_price = 1.0 * get_btc_price();
-		double btc_amount = 1.0 * quantity.quantity.amount / 100000000;
-		return int64_t(round(btc_amount * btc_price));
-	}
-	if(quantity.quantity.symbol == DUSD && quantity.contract == BANKACCOUNT)
+		return get_btc_value<Coin>(quantity.quantity.amount);
+	if(quantity.quantity.symbol == Coin::sym && quantity.contract == BANKACCOUNT)
 		return quantity.quantity.amount;
-	if(quantity.quantity.symbol == EOS && quantity.contract == EOSIOTOKEN){
-		double eos_price = get_variable("eosusd", PERIODIC_SCOPE) * 1e-6;
-		double eos_amount = quantity.quantity.amount * 1e-4;
-		return int64_t(round(eos_amount * eos_price));
-	}
+	if(quantity.quantity.symbol == EOS && quantity.contract == EOSIOTOKEN)
+		return get_eos_value<Coin>(quantity.quantity.amount);
 	if(quantity.quantity.symbol == DPS && quantity.contract == BANKACCOUNT) {
 		return dps2dusd(quantity.quantity, true).amount; // TODO: should account at nominal, right?
 	}
 	// "quantity" is dbond:
-	extended_asset dbond_price = dbonds::get_price(quantity.contract, quantity.quantity.symbol.code());
-	check(dbond_price.contract == BANKACCOUNT && dbond_price.quantity.symbol == DUSD, "get_usd_value not supported with this asset");
+	fc_dbond_accruals accruals(BANKACCOUNT, BANKACCOUNT.value);
+	auto accrual = accruals.find(quantity.quantity.symbol.code().raw());
+	if(accrual != accruals.end() && accrual->initial_price.symbol == Coin::sym)
+		return quantity.quantity.amount * get_accrued_price(*accrual, current_time_point()) / pow(10, quantity.quantity.symbol.precision());
+	// fc_dbonds only, see get_dbonds_assets_value()
+	dbonds::fc_dbond_stats fc_info;
+	check(dbonds::get_fc_dbond(quantity.contract, quantity.quantity.symbol.code(), fc_info), "get_usd_value not supported with this asset");
+	const extended_asset& dbond_price = fc_info.current_price;
+	check(dbond_price.contract == BANKACCOUNT && dbond_price.quantity.symbol == Coin::sym, "get_usd_value not supported with this asset");
 	return quantity.quantity.amount * dbond_price.quantity.amount / pow(10, quantity.quantity.symbol.precision());
 }
 
@@ -259,16 +288,35 @@ int64_t get_balance(name user, const symbol token) {
 	return it->balance.amount;
 }
 
+// DBTC or EOS balance of bank, which it may pay out: payments of batch mint intents are not bank's
+// till settlement, 'settleepoch' refunds them from bank balance
+int64_t get_spendable_balance(const symbol token) {
+	batch_epoch pending = get_batch_epoch();
+	return get_balance(BANKACCOUNT, token) - (token == DBTC ? pending.dbtc : token == EOS ? pending.eos : 0);
+}
+
+// DPS sold for 'dusd' at sale price, no more than bank holds; 'change' is DUSD returned for DPS it lacks
+asset get_dps_for_sale(asset dusd, asset& change) {
+	asset requested = dusd2dps(dusd, false);
+	asset dps = requested;
+	dps.amount = min(dps.amount, get_balance(BANKACCOUNT, DPS));
+	// dps2dusd() is not used here, it substracts redemption fee
+	int64_t change_amount = get_variable("dpssaleprice", SYSTEM_SCOPE) / dpsPrecision * (requested.amount - dps.amount);
+	change = {change_amount, DUSD};
+	return dps;
+}
+
 int64_t get_hedge_assets_value() {
-	int64_t dbtc_balance = get_balance(BANKACCOUNT, DBTC);
+	// DBTC and EOS paid by batch mint intents are not bank's till settlement
+	batch_epoch pending = get_batch_epoch();
+	int64_t dbtc_balance = get_balance(BANKACCOUNT, DBTC) - pending.dbtc;
 	int64_t bitmex_balance = get_balance(BITMEXACC, BTC);
-	int64_t eos_balance = get_balance(BANKACCOUNT, EOS);
-	return get_usd_value(asset(dbtc_balance, DBTC)) + get_usd_value(asset(bitmex_balance, BTC)) + 
-			get_usd_value(asset(eos_balance, EOS));
+	int64_t eos_balance = get_balance(BANKACCOUNT, EOS) - pending.eos;
+	return get_btc_value(dbtc_balance) + get_btc_value(bitmex_balance) + get_eos_value(eos_balance);
 }
 
 int64_t get_liquidity_pool_value() {
-	return get_hedge_assets_value() - get_usd_value(asset(get_balance(BITMEXACC, BTC), BTC));
+	return get_hedge_assets_value() - get_btc_value(get_balance(BITMEXACC, BTC));
 }
 
 double get_hard_margin(double soft_margin) {
@@ -283,6 +331,8 @@ bool is_dbond_contract(name contract) {
 
 int64_t get_dbonds_assets_value() {
 	int64_t result = 0;
+	int128_t apr_value = 0;     // sum of apr * value of dbonds
+	fc_dbond_accruals accruals(BANKACCOUNT, BANKACCOUNT.value);
 	variables dbonds_contracts(BANKACCOUNT, DBONDS_SCOPE.value);
 	// iterate over dbonds contracts
 	for(const auto& dbonds_contract : dbonds_contracts) {
@@ -291,9 +341,32 @@ int64_t get_dbonds_assets_value() {
 		int64_t one_contract_dbonds_value = 0;
 		// iterate over dbonds owned by bank
 		for(const auto& db : dbond_assets) {
-			extended_asset price = dbonds::get_price(dbonds_contract.var_name, db.symbol.code());
-			if(price.contract == BANKACCOUNT && price.quantity.symbol == DUSD)
-				one_contract_dbonds_value += db.amount * price.quantity.amount / pow(10, db.symbol.precision());
+			// fc_dbonds authorized with DUSD price accrue interest from cached parameters; paid off dbonds
+			// leave bank, so dbonds held past maturity are unpaid and have no value, see bank::sweep()
+			auto accrual = accruals.find(db.symbol.code().raw());
+			if(accrual != accruals.end()) {
+				if(current_time_point() >= accrual->maturity_time)
+					continue;
+				int64_t value = db.amount * get_accrued_price(*accrual, current_time_point()) / pow(10, db.symbol.precision());
+				apr_value += (int128_t)value * accrual->apr;
+				one_contract_dbonds_value += value;
+				continue;
+			}
+			// other fc_dbonds are taken at price pushed by dbonds contract; layout of 'ccdbond' rows of
+			// the dbonds contract is not published, so cc_dbonds and other dbonds get no value till it is
+			dbonds::fc_dbond_stats fc_info;
+			if(!dbonds::get_fc_dbond(dbonds_contract.var_name, db.symbol.code(), fc_info))
+				continue;
+			// nor defaulted ones, fiat collateral is not priced by bank
+			if(current_time_point() >= fc_info.dbond.maturity_time || fc_info.fc_state == dbonds::EXPIRED_TECH_DEFAULTED
+					|| fc_info.fc_state == dbonds::EXPIRED_DEFAULTED)
+				continue;
+			const extended_asset& price = fc_info.current_price;
+			if(price.contract == BANKACCOUNT && price.quantity.symbol == DUSD) {
+				int64_t value = db.amount * price.quantity.amount / pow(10, db.symbol.precision());
+				apr_value += (int128_t)value * fc_info.dbond.apr;
+				one_contract_dbonds_value += value;
+			}
 		}
 		// save value of all dbonds for each dbonds contract
 		dbonds_contracts.modify(dbonds_contract, BANKACCOUNT, [&](auto& v) {
@@ -302,19 +375,40 @@ int64_t get_dbonds_assets_value() {
 		});
 		result += one_contract_dbonds_value;
 	}
+	// cap of savings apr, see get_savings_apr(); vault grows at the old cap till now
+	int64_t apr = result > 0 ? int64_t(apr_value / result) : 0;
+	if(apr != get_variable("dbonds.apr"_n, STAT_SCOPE)) {
+		accrue_savings();
+		set_variable("dbonds.apr"_n, apr, STAT_SCOPE);
+	}
+	return result;
+}
+
+int64_t get_cached_dbonds_assets_value() {
+	// sum of dbonds values saved by the last get_dbonds_assets_value() call
+	int64_t result = 0;
+	variables dbonds_contracts(BANKACCOUNT, DBONDS_SCOPE.value);
+	for(const auto& dbonds_contract : dbonds_contracts)
+		result += dbonds_contract.value;
 	return result;
 }
 
 int64_t get_bank_assets_value() {
-	// calculate BTC value
-	int64_t btc_balance = get_balance(BITMEXACC, BTC) + get_balance(BANKACCOUNT, DBTC);
+	// calculate BTC value, BTC in flight between bank and bitmex is still bank's, see settle_hedge_order(),
+	// DBTC and EOS paid by batch mint intents are not bank's till settlement
+	batch_epoch pending = get_batch_epoch();
+	int64_t btc_balance = get_balance(BITMEXACC, BTC) + get_balance(BANKACCOUNT, DBTC) - pending.dbtc
+			+ get_variable("hedge.topup"_n, STAT_SCOPE) + get_variable("hedge.xfer"_n, STAT_SCOPE);
+	int64_t eos_balance = get_balance(BANKACCOUNT, EOS) - pending.eos;
 
-	return get_usd_value(asset(btc_balance, DBTC)) + get_usd_value(asset(get_balance(BANKACCOUNT, EOS), EOS)) 
-			+ get_dbonds_assets_value();
+	// DUSD deposited to savings vault is retired, vault value is owed to savers at apr capped by dbonds
+	int64_t dbonds_value = get_dbonds_assets_value();
+	return get_btc_value(btc_balance) + get_eos_value(eos_balance) + dbonds_value - get_savings_value();
 }
 
 int64_t get_bank_capital_value() {
-	return get_balance(BANKACCOUNT, DUSD);
+	// profit owed to DPS holders and DUSD of queued and batch redemptions are held by bank, but not its own
+	return get_balance(BANKACCOUNT, DUSD) - get_profit_owed() - get_redeem_queued() - get_batch_epoch().dusd.amount;
 }
 
 int64_t get_supply(const symbol & token) {
@@ -332,81 +426,87 @@ int64_t get_supply(const symbol & token) {
 	return 0;
 }
 
-asset satoshi2dusd(int64_t satoshi_amount) {
+// conversions at mint and redemption rates, fees are taken in favour of bank
+// "fee.mint", "fee.redeem" and rate variables are stored in scale 1e8
+template<typename Coin = bank_coin>
+asset satoshi2coin(int64_t satoshi_amount) {
 	variables sys_vars(BANKACCOUNT, SYSTEM_SCOPE.value);
 	variables periodic_vars(BANKACCOUNT, PERIODIC_SCOPE.value);
-	// "btcusd", "fee.mint" variables are stored in scale 1e8
 	double mintFee = 1e-8 * sys_vars.require_find(("fee.mint"_n).value, "fee.mint (mint fee in percent) variable not found")->value;
-	double rate = (100.0 - mintFee) * 1e-10 * periodic_vars.require_find(("btcusd"_n).value, "btcusd (exchange rate) variable not found")->value;
-	int64_t amount = std::round(rate * satoshi_amount / 1e6); // hardcode: DUSD precision is 2
-	return {amount, DUSD};
+	double rate = (100.0 - mintFee) * 1e-10 * periodic_vars.require_find(Coin::btc_rate.value, "BTC exchange rate variable not found")->value;
+	int64_t amount = std::round(rate * satoshi_amount / coin_scale<Coin>::satoshi);
+	return {amount, Coin::sym};
 }
 
-int64_t dusd2satoshi(asset dusd) {
-	check(dusd.symbol == DUSD, "wrong symbol in dusd2satoshi()");
+template<typename Coin = bank_coin>
+int64_t coin2satoshi(asset coin) {
+	check(coin.symbol == Coin::sym, "wrong symbol in coin2satoshi()");
 	variables sys_vars(BANKACCOUNT, SYSTEM_SCOPE.value);
 	variables periodic_vars(BANKACCOUNT, PERIODIC_SCOPE.value);
-	// "btcusd", "fee.redeem" variables are stored in scale 1e8
 	double redeemFee = 1e-8 * sys_vars.require_find(("fee.redeem"_n).value, "fee.redeem (redemption fee) variable not found")->value;
-	double rate = (100 + redeemFee) * 1e-10 * periodic_vars.require_find(("btcusd"_n).value, "btcusd (exchange rate) variable not found")->value;
-	int64_t satoshi_amount = std::round(1e6 * dusd.amount / rate); // hardcode: DUSD precision is 2
+	double rate = (100 + redeemFee) * 1e-10 * periodic_vars.require_find(Coin::btc_rate.value, "BTC exchange rate variable not found")->value;
+	int64_t satoshi_amount = std::round(coin_scale<Coin>::satoshi * coin.amount / rate);
 	return satoshi_amount;
 }
 
-asset eos2dusd(int64_t eoshi_amount) {
+template<typename Coin = bank_coin>
+asset eos2coin(int64_t eoshi_amount) {
 	variables sys_vars(BANKACCOUNT, SYSTEM_SCOPE.value);
 	variables periodic_vars(BANKACCOUNT, PERIODIC_SCOPE.value);
-	// "btcusd", "fee.mint" variables are stored in scale 1e8
 	double mintFee = 1e-8 * sys_vars.require_find(("fee.mint"_n).value, "fee.mint (mint fee in percent) variable not found")->value;
-	double rate = (100.0 - mintFee) * 1e-10 * periodic_vars.require_find(("eosusd"_n).value, "eosusd (exchange rate) variable not found")->value;
-	int64_t amount = std::round(rate * eoshi_amount / 1e2); // hardcode: DUSD precision is 2
-	return {amount, DUSD};
+	double rate = (100.0 - mintFee) * 1e-10 * periodic_vars.require_find(Coin::eos_rate.value, "EOS exchange rate variable not found")->value;
+	int64_t amount = std::round(rate * eoshi_amount / coin_scale<Coin>::eoshi);
+	return {amount, Coin::sym};
 }
 
-int64_t dusd2eos(asset dusd) {
-	check(dusd.symbol == DUSD, "wrong symbol in dusd2satoshi()");
+template<typename Coin = bank_coin>
+int64_t coin2eos(asset coin) {
+	check(coin.symbol == Coin::sym, "wrong symbol in coin2eos()");
 	variables sys_vars(BANKACCOUNT, SYSTEM_SCOPE.value);
 	variables periodic_vars(BANKACCOUNT, PERIODIC_SCOPE.value);
-	// "btcusd", "fee.redeem" variables are stored in scale 1e8
 	double redeemFee = 1e-8 * sys_vars.require_find(("fee.redeem"_n).value, "fee.redeem (redemption fee) variable not found")->value;
-	double rate = (100 + redeemFee) * 1e-10 * periodic_vars.require_find(("eosusd"_n).value, "eosusd (exchange rate) variable not found")->value;
-	int64_t eoshi_amount = std::round(1e2 * dusd.amount / rate); // hardcode: DUSD precision is 2
+	double rate = (100 + redeemFee) * 1e-10 * periodic_vars.require_find(Coin::eos_rate.value, "EOS exchange rate variable not found")->value;
+	int64_t eoshi_amount = std::round(coin_scale<Coin>::eoshi * coin.amount / rate);
 	return eoshi_amount;
 }
 
-int64_t bitmex_in_process_redeem_order_btc_amount(name user) {
-	redeemOrders ord(CUSTODIAN, DBTC.code().raw());
-	auto status_index = ord.get_index<"status"_n>();
-
-	int64_t amount = 0;
-	auto lower = status_index.lower_bound("processing"_n.value);
-	auto upper = status_index.upper_bound("processing"_n.value);
-	if(lower != status_index.end()) {
-		do {
-			if(lower->user == user)
-				amount += lower->btc_amount;
-		} while(lower++ != upper);
+// rates of the conversions above, read once to price many orders at one snapshot of variables;
+// computed by the same operations, so results are those of satoshi2coin() and others
+template<typename Coin = bank_coin>
+struct conversion_rates {
+	double btc_mint, btc_redeem, eos_mint, eos_redeem;
+
+	conversion_rates() {
+		variables sys_vars(BANKACCOUNT, SYSTEM_SCOPE.value);
+		variables periodic_vars(BANKACCOUNT, PERIODIC_SCOPE.value);
+		double mintFee = 1e-8 * sys_vars.require_find(("fee.mint"_n).value, "fee.mint (mint fee in percent) variable not found")->value;
+		double redeemFee = 1e-8 * sys_vars.require_find(("fee.redeem"_n).value, "fee.redeem (redemption fee) variable not found")->value;
+		int64_t btc_rate = periodic_vars.require_find(Coin::btc_rate.value, "BTC exchange rate variable not found")->value;
+		int64_t eos_rate = periodic_vars.require_find(Coin::eos_rate.value, "EOS exchange rate variable not found")->value;
+		btc_mint   = (100.0 - mintFee) * 1e-10 * btc_rate;
+		btc_redeem = (100 + redeemFee) * 1e-10 * btc_rate;
+		eos_mint   = (100.0 - mintFee) * 1e-10 * eos_rate;
+		eos_redeem = (100 + redeemFee) * 1e-10 * eos_rate;
 	}
 
-	return amount;
-}
+	asset satoshi2coin(int64_t satoshi_amount) const {
+		int64_t amount = std::round(btc_mint * satoshi_amount / coin_scale<Coin>::satoshi);
+		return {amount, Coin::sym};
+	}
 
-int64_t bitmex_in_process_mint_order_btc_amount(name user) {
-	mintOrders ord(CUSTODIAN, DBTC.code().raw());
-	auto status_index = ord.get_index<"status"_n>();
+	int64_t coin2satoshi(asset coin) const {
+		return std::round(coin_scale<Coin>::satoshi * coin.amount / btc_redeem);
+	}
 
-	int64_t amount = 0;
-	auto lower = status_index.lower_bound("processing"_n.value);
-	auto upper = status_index.upper_bound("processing"_n.value);
-	if(lower != status_index.end()) {
-		do {
-			if(lower->user == user)
-				amount += lower->btc_amount;
-		} while(lower++ != upper);
+	asset eos2coin(int64_t eoshi_amount) const {
+		int64_t amount = std::round(eos_mint * eoshi_amount / coin_scale<Coin>::eoshi);
+		return {amount, Coin::sym};
 	}
 
-	return amount;
-}
+	int64_t coin2eos(asset coin) const {
+		return std::round(coin_scale<Coin>::eoshi * coin.amount / eos_redeem);
+	}
+};
 
 uint64_t pow(uint64_t x, uint64_t p) {
 	if(p == 0)
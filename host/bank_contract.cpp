@@ -0,0 +1,117 @@
+/**
+ *  bank_contract.cpp -- host build of contracts/bank, see contracts.hpp
+ */
+
+#include "prelude.hpp"
+#include "chain.hpp"
+#include "contracts.hpp"
+
+namespace host_bank {
+
+using std::pow;
+
+#include <bank.cpp>
+
+#include "dbond_serialization.hpp"
+
+} // namespace host_bank
+
+void host::bank_apply(eosio::name receiver, eosio::name code, eosio::name action, const std::vector<char>& data) {
+	using host_bank::bank;
+
+	if(code == receiver) {
+		switch(action.value) {
+			HOST_DISPATCH_ACTION(bank, create)
+			HOST_DISPATCH_ACTION(bank, issue)
+			HOST_DISPATCH_ACTION(bank, retire)
+			HOST_DISPATCH_ACTION(bank, transfer)
+			HOST_DISPATCH_ACTION(bank, open)
+			HOST_DISPATCH_ACTION(bank, close)
+			HOST_DISPATCH_ACTION(bank, setvar)
+			HOST_DISPATCH_ACTION(bank, delvar)
+			HOST_DISPATCH_ACTION(bank, seedledger)
+			HOST_DISPATCH_ACTION(bank, authdbond)
+			HOST_DISPATCH_ACTION(bank, listdpssale)
+			HOST_DISPATCH_ACTION(bank, blncsppl)
+			HOST_DISPATCH_ACTION(bank, checkinvars)
+			HOST_DISPATCH_ACTION(bank, commitpol)
+			HOST_DISPATCH_ACTION(bank, verifypol)
+			HOST_DISPATCH_ACTION(bank, rebalance)
+			HOST_DISPATCH_ACTION(bank, sweepshards)
+			HOST_DISPATCH_ACTION(bank, snapshot)
+			HOST_DISPATCH_ACTION(bank, balanceat)
+			HOST_DISPATCH_ACTION(bank, supplyat)
+			HOST_DISPATCH_ACTION(bank, distribute)
+			HOST_DISPATCH_ACTION(bank, claim)
+			HOST_DISPATCH_ACTION(bank, sweep)
+			HOST_DISPATCH_ACTION(bank, fillredeems)
+			HOST_DISPATCH_ACTION(bank, rdmposition)
+			HOST_DISPATCH_ACTION(bank, rdmcancel)
+			HOST_DISPATCH_ACTION(bank, settleepoch)
+			HOST_DISPATCH_ACTION(bank, withdraw)
+			HOST_DISPATCH_ACTION(bank, accrue)
+#ifdef DEBUG
+			HOST_DISPATCH_ACTION(bank, unauthdbond)
+			HOST_DISPATCH_ACTION(bank, erase)
+#endif
+		}
+		eosio::check(false, "unknown action");
+	}
+
+	// notifications, see [[eosio::on_notify]] attributes in bank.hpp
+	switch(action.value) {
+		case eosio::name("transfer").value:
+			execute_action<bank, &bank::ontransfer>(receiver, code, data);
+			return;
+		case eosio::name("listprivord").value:
+			execute_action<bank, &bank::on_fcdb_trade_request>(receiver, code, data);
+			return;
+		case eosio::name("erase").value:
+			execute_action<bank, &bank::ondbonderase>(receiver, code, data);
+			return;
+	}
+}
+
+host::bank_state host::read_bank_state() {
+	using namespace host_bank;
+
+	// valuation saves dbonds values and savings cap, so it runs as an action, which is reverted
+	bank_state result;
+	auto run = host::push_code(BANKACCOUNT, [&] {
+		result.assets         = get_bank_assets_value();
+		result.capital        = get_bank_capital_value();
+		result.liquidity_pool = get_liquidity_pool_value();
+		result.hedge_assets   = get_hedge_assets_value();
+		result.bitmex         = get_btc_value(get_balance(BITMEXACC, BTC));
+		result.dusd_supply    = get_supply(DUSD);
+		result.volume_used    = get_variable("volumeused", STAT_SCOPE) / 1000000;
+	}, false);
+	eosio::check(!run.failed, run.error);
+	return result;
+}
+
+namespace {
+
+template<typename Coin>
+host::coin_quote quote(int64_t satoshi, int64_t eoshi) {
+	using namespace host_bank;
+
+	host::coin_quote result;
+	result.btc_price  = get_btc_price<Coin>();
+	result.btc_value  = get_btc_value<Coin>(satoshi);
+	result.eos_value  = get_eos_value<Coin>(eoshi);
+	result.mint_btc   = satoshi2coin<Coin>(satoshi).amount;
+	result.mint_eos   = eos2coin<Coin>(eoshi).amount;
+	result.redeem_btc = coin2satoshi<Coin>(asset(result.mint_btc, Coin::sym));
+	result.redeem_eos = coin2eos<Coin>(asset(result.mint_eos, Coin::sym));
+	return result;
+}
+
+} // namespace
+
+host::coin_quote host::read_coin_quote(eosio::symbol_code coin, int64_t satoshi, int64_t eoshi) {
+	if(coin == host_bank::eur_coin::sym.code())
+		return quote<host_bank::eur_coin>(satoshi, eoshi);
+	eosio::check(coin == host_bank::usd_coin::sym.code(), "no stablecoin policy for symbol");
+	return quote<host_bank::usd_coin>(satoshi, eoshi);
+}
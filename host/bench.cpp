@@ -0,0 +1,93 @@
+/**
+ *  bench.cpp -- Google Benchmark suite for exchange paths of host builds of contracts
+ *  Every iteration executes one user transaction with all its inline actions and notifications,
+ *  then reverts it, so all iterations start from the same state prepared by exchange_state().
+ */
+
+#include "scenarios.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace scenarios;
+
+namespace {
+
+void run(benchmark::State& state, const host::packed_action& act) {
+	auto first = host::push_transaction({act}, false);
+	if(first.failed) {
+		state.SkipWithError(first.error.c_str());
+		return;
+	}
+	for(auto _ : state)
+		benchmark::DoNotOptimize(host::push_transaction({act}, false));
+}
+
+host::packed_action bank_transfer(asset quantity, const std::string& memo) {
+	return host::make_action(BANK_ACC, name("transfer"), TEST_ACC, TEST_ACC, BANK_ACC, quantity, memo);
+}
+
+void BM_mint_DUSD_for_DBTC(benchmark::State& state) {
+	run(state, host::make_action(CUSTODIAN_ACC, name("transfer"), TEST_ACC, TEST_ACC, BANK_ACC, asset(100000, DBTC), std::string("Buy DUSD")));
+}
+
+void BM_mint_DUSD_for_EOS(benchmark::State& state) {
+	run(state, host::make_action(EOSIO_TOKEN, name("transfer"), TEST_ACC, TEST_ACC, BANK_ACC, asset(10000, EOS), std::string("Buy DUSD")));
+}
+
+void BM_redeem_DUSD_for_DBTC(benchmark::State& state) {
+	run(state, bank_transfer(asset(1000, DUSD), "Redeem for DBTC"));
+}
+
+void BM_redeem_DUSD_for_BTC(benchmark::State& state) {
+	run(state, bank_transfer(asset(1000, DUSD), "2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxM"));
+}
+
+void BM_redeem_DUSD_for_EOS(benchmark::State& state) {
+	run(state, bank_transfer(asset(1000, DUSD), "Redeem for EOS"));
+}
+
+void BM_exchange_DUSD_for_DPS(benchmark::State& state) {
+	run(state, bank_transfer(asset(1000, DUSD), "Buy DPS"));
+}
+
+void BM_redeem_DPS_for_DUSD(benchmark::State& state) {
+	run(state, bank_transfer(asset(10000000, DPS), "Redeem for DUSD"));
+}
+
+void BM_p2p_transfer(benchmark::State& state) {
+	run(state, host::make_action(BANK_ACC, name("transfer"), TEST_ACC, TEST_ACC, BUYER, asset(100, DUSD), std::string("p2p")));
+}
+
+void BM_checkinvars(benchmark::State& state) {
+	run(state, host::make_action(BANK_ACC, name("checkinvars"), TEST_ACC));
+}
+
+} // namespace
+
+BENCHMARK(BM_mint_DUSD_for_DBTC);
+BENCHMARK(BM_mint_DUSD_for_EOS);
+BENCHMARK(BM_redeem_DUSD_for_DBTC);
+BENCHMARK(BM_redeem_DUSD_for_BTC);
+BENCHMARK(BM_redeem_DUSD_for_EOS);
+BENCHMARK(BM_exchange_DUSD_for_DPS);
+BENCHMARK(BM_redeem_DPS_for_DUSD);
+BENCHMARK(BM_p2p_transfer);
+BENCHMARK(BM_checkinvars);
+
+int main(int argc, char** argv) {
+	benchmark::Initialize(&argc, argv);
+	try {
+		exchange_state();
+	}
+	catch(const std::exception& e) {
+		std::cerr << "setup: " << e.what() << std::endl;
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
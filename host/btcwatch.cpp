@@ -0,0 +1,120 @@
+/**
+ *  btcwatch.cpp -- BTC deposit watcher over host chain
+ *  usage: btcwatch -a addresses.txt (-f blocks.txt | -c "bitcoin-cli -regtest") [-k confirmations] [-s start_height]
+ *                  [-j threads] [-b batch] [-i interval_ms] [-n polls]
+ *
+ *  Boots the chain as test/boot.sh does, then every 'interval_ms' (default 1000) scans new blocks
+ *  of recorded fixture (-f, lines "height hex") or of bitcoind reached by bitcoin-cli command (-c),
+ *  and mints deposits with 'confirmations' (default 6) by custodian::mint in transactions of
+ *  'batch' (default 50) actions, see deposits.hpp. Blocks are fetched and decoded by -j threads.
+ *  Addresses file has lines "address account [symbol]", symbol is DBTC (default), DUSD or DPS.
+ *  Stops after 'polls' scans (default 0, runs forever).
+ */
+
+#include "deposits.hpp"
+#include "scenarios.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace scenarios;
+
+namespace {
+
+map<string, deposits::account> read_addresses(const string& file) {
+	ifstream in(file);
+	if(!in)
+		throw runtime_error("cannot read " + file);
+	map<string, deposits::account> result;
+	string line;
+	while(getline(in, line)) {
+		istringstream fields(line);
+		string address, user, sym = "DBTC";
+		if(!(fields >> address >> user) || address[0] == '#')
+			continue;
+		fields >> sym;
+		result[address] = {name(user), eosio::symbol_code(sym.c_str())};
+	}
+	return result;
+}
+
+void usage() {
+	cerr << "usage: btcwatch -a addresses.txt (-f blocks.txt | -c \"bitcoin-cli -regtest\") [-k confirmations] [-s start_height]" << endl
+	     << "                [-j threads] [-b batch] [-i interval_ms] [-n polls]" << endl;
+	exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	string addresses_file, fixture, cli;
+	deposits::config cfg;
+	int interval_ms = 1000;
+	long polls = 0;
+
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(i + 1 >= argc)
+			usage();
+		const char* value = argv[++i];
+		if(arg == "-a")
+			addresses_file = value;
+		else if(arg == "-f")
+			fixture = value;
+		else if(arg == "-c")
+			cli = value;
+		else if(arg == "-k")
+			cfg.confirmations = max(1, atoi(value));
+		else if(arg == "-s")
+			cfg.start_height = atoll(value);
+		else if(arg == "-j")
+			cfg.threads = max(1, atoi(value));
+		else if(arg == "-b")
+			cfg.batch = max(1, atoi(value));
+		else if(arg == "-i")
+			interval_ms = max(1, atoi(value));
+		else if(arg == "-n")
+			polls = atol(value);
+		else
+			usage();
+	}
+	if(addresses_file.empty() || fixture.empty() == cli.empty())
+		usage();
+
+	try {
+		auto source = fixture.empty() ? deposits::cli_source(cli) : deposits::fixture_source(fixture);
+		boot();
+		deposits::watcher watcher(*source, read_addresses(addresses_file), cfg, CUSTODIAN_ACC);
+
+		for(long p = 0; polls == 0 || p < polls; p++) {
+			if(p)
+				this_thread::sleep_for(chrono::milliseconds(interval_ms));
+			auto start = chrono::steady_clock::now();
+			auto report = watcher.poll();
+			auto us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+			printf("tip %lld: %zu blocks scanned, %zu reorged, %zu deposits found, %zu minted in %zu transactions, %zu duplicates, %zu pending, %lld us\n",
+				(long long)report.tip, report.blocks, report.reorged, report.found, report.minted, report.transactions,
+				report.duplicates, watcher.pending().size(), (long long)us);
+			for(const auto& txid : report.conflicts)
+				printf("conflict: %s pays several accounts, not minted\n", txid.c_str());
+			for(const auto& txid : report.deep_reorgs)
+				printf("reorg deeper than confirmations: %s was minted\n", txid.c_str());
+			for(const auto& error : report.errors)
+				printf("rejected: %s\n", error.c_str());
+			fflush(stdout);
+		}
+	}
+	catch(const exception& e) {
+		cerr << "btcwatch: " << e.what() << endl;
+		return 2;
+	}
+	return 0;
+}
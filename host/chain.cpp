@@ -0,0 +1,386 @@
+/**
+ *  chain.cpp -- in-memory chain for host builds of contracts, see chain.hpp
+ */
+
+#include "chain.hpp"
+
+#include <eosio/check.hpp>
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace host {
+
+namespace {
+
+	// same as max_inline_action_depth of nodeos default configuration
+	const int max_inline_action_depth = 4;
+
+	using table_id = std::tuple<uint64_t, uint64_t, uint64_t>;
+
+	struct undo_entry {
+		table_id              table;
+		uint64_t              pk;
+		std::optional<db_row> old;
+	};
+
+	struct apply_context {
+		uint64_t                    receiver;
+		const packed_action*        act;
+		std::vector<uint64_t>*      recipients;
+		std::vector<packed_action>* inlines;
+	};
+
+	struct chain_state {
+		std::set<uint64_t>                 accounts;
+		std::map<uint64_t, apply_handler>  code;
+		std::map<table_id, db_table>       tables;
+		uint64_t                           time = 0;
+		bool                               print = false;
+		bool                               deltas = false;
+		std::vector<std::vector<table_delta>> deltas_log;
+
+		std::vector<undo_entry>            undo;
+		std::vector<apply_context>         contexts;
+		std::string                        console;
+		transaction_costs                  costs;
+	};
+
+	// every thread has its own chain, so independent simulations can run in parallel
+	thread_local chain_state state;
+
+	const apply_context& context() {
+		eosio::check(!state.contexts.empty(), "no action is being executed");
+		return state.contexts.back();
+	}
+
+	// calls made by scenarios and benchmarks outside of actions are not counted
+	transaction_costs* costs() {
+		return state.contexts.empty() ? nullptr : &state.costs;
+	}
+
+	void count_call() {
+		if(auto* c = costs())
+			c->host_calls++;
+	}
+
+	std::string name_str(uint64_t n) {
+		return eosio::name(n).to_string();
+	}
+
+	void index_row(db_table& t, uint64_t pk, const db_row& row) {
+		if(t.indices.size() < row.secondary.size())
+			t.indices.resize(row.secondary.size());
+		for(size_t i = 0; i < row.secondary.size(); i++)
+			t.indices[i].insert({row.secondary[i], pk});
+	}
+
+	void unindex_row(db_table& t, uint64_t pk, const db_row& row) {
+		for(size_t i = 0; i < row.secondary.size() && i < t.indices.size(); i++)
+			t.indices[i].erase({row.secondary[i], pk});
+	}
+
+	// put row to the table, replacing existing one, or remove row if 'row' is empty
+	void put_row(const table_id& id, uint64_t pk, std::optional<db_row> row) {
+		db_table& t = state.tables[id];
+		auto existing = t.rows.find(pk);
+		if(existing != t.rows.end()) {
+			unindex_row(t, pk, existing->second);
+			t.rows.erase(existing);
+		}
+		if(row) {
+			index_row(t, pk, *row);
+			t.rows.emplace(pk, std::move(*row));
+		}
+	}
+
+	void write_row(uint64_t scope, uint64_t table, uint64_t pk, std::optional<db_row> row) {
+		table_id id{context().receiver, scope, table};
+		state.costs.db_writes++;
+		if(row)
+			state.costs.bytes_written += row->data.size();
+		auto& rows = state.tables[id].rows;
+		auto existing = rows.find(pk);
+		undo_entry entry{id, pk, {}};
+		if(existing != rows.end())
+			entry.old = existing->second;
+		state.undo.push_back(std::move(entry));
+		put_row(id, pk, std::move(row));
+	}
+
+	void rollback(size_t undo_size) {
+		while(state.undo.size() > undo_size) {
+			auto& entry = state.undo.back();
+			put_row(entry.table, entry.pk, std::move(entry.old));
+			state.undo.pop_back();
+		}
+	}
+
+	// undo log keeps the state of rows before transaction, rows unchanged by it give no delta
+	std::vector<table_delta> collect_deltas() {
+		std::vector<table_delta> result;
+		std::set<std::pair<table_id, uint64_t>> seen;
+		for(const auto& entry : state.undo) {
+			if(!seen.insert({entry.table, entry.pk}).second)
+				continue;
+			const auto& rows = state.tables[entry.table].rows;
+			auto row = rows.find(entry.pk);
+			bool present = row != rows.end();
+			if(!present && !entry.old)
+				continue;
+			if(present && entry.old && entry.old->data == row->second.data && entry.old->payer == row->second.payer)
+				continue;
+			auto [code, scope, table] = entry.table;
+			table_delta delta{code, scope, table, entry.pk, 0, present, {}};
+			if(present) {
+				delta.payer = row->second.payer;
+				delta.value = row->second.data;
+			}
+			result.push_back(std::move(delta));
+		}
+		return result;
+	}
+
+	void execute_action(const packed_action& act, int depth) {
+		eosio::check(depth <= max_inline_action_depth, "max inline action depth per transaction reached");
+		eosio::check(state.accounts.count(act.account), "action's receiving contract account does not exist: " + name_str(act.account));
+
+		std::vector<uint64_t> recipients{act.account};
+		std::vector<packed_action> inlines;
+		for(size_t i = 0; i < recipients.size(); i++) {
+			auto code = state.code.find(recipients[i]);
+			if(code == state.code.end())
+				continue;
+			state.costs.actions++;
+			if(i > 0)
+				state.costs.notifications++;
+			state.contexts.push_back({recipients[i], &act, &recipients, &inlines});
+			try {
+				code->second(eosio::name(recipients[i]), eosio::name(act.account), eosio::name(act.name), act.data);
+			}
+			catch(...) {
+				state.contexts.pop_back();
+				throw;
+			}
+			state.contexts.pop_back();
+		}
+		for(const auto& a : inlines)
+			execute_action(a, depth + 1);
+	}
+
+} // namespace
+
+/*
+ * intrinsics.hpp
+ */
+uint64_t current_time() {
+	count_call();
+	return state.time;
+}
+
+bool has_auth(uint64_t account) {
+	count_call();
+	const auto& auth = context().act->authorization;
+	return std::any_of(auth.begin(), auth.end(), [&](const auto& p) { return p.first == account; });
+}
+
+void require_auth(uint64_t account) {
+	eosio::check(has_auth(account), "missing authority of " + name_str(account));
+}
+
+bool is_account(uint64_t account) {
+	count_call();
+	return state.accounts.count(account) != 0;
+}
+
+void require_recipient(uint64_t account) {
+	count_call();
+	auto& recipients = *context().recipients;
+	if(std::find(recipients.begin(), recipients.end(), account) == recipients.end())
+		recipients.push_back(account);
+}
+
+uint64_t current_receiver() {
+	count_call();
+	return context().receiver;
+}
+
+void send_inline(packed_action act) {
+	const auto& ctx = context();
+	count_call();
+	state.costs.inline_actions++;
+	eosio::check(state.accounts.count(act.account), "inline action's code account does not exist: " + name_str(act.account));
+	for(const auto& p : act.authorization)
+		eosio::check(p.first == ctx.receiver, "inline action authorized by " + name_str(p.first) +
+			" can not be sent by contract " + name_str(ctx.receiver));
+	ctx.inlines->push_back(std::move(act));
+}
+
+bool print_enabled() {
+	return state.print;
+}
+
+void prints(std::string_view str) {
+	state.console += str;
+}
+
+const db_table* db_find_table(uint64_t code, uint64_t scope, uint64_t table) {
+	count_call();
+	auto itr = state.tables.find({code, scope, table});
+	return itr == state.tables.end() ? nullptr : &itr->second;
+}
+
+const db_row* db_get(uint64_t code, uint64_t scope, uint64_t table, uint64_t pk) {
+	auto* c = costs();
+	if(c)
+		c->host_calls++;
+	auto t = state.tables.find({code, scope, table});
+	if(t == state.tables.end())
+		return nullptr;
+	auto row = t->second.rows.find(pk);
+	if(row == t->second.rows.end())
+		return nullptr;
+	if(c) {
+		c->db_reads++;
+		c->bytes_read += row->second.data.size();
+	}
+	return &row->second;
+}
+
+void db_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t pk, std::vector<char> data, std::vector<std::string> secondary) {
+	count_call();
+	write_row(scope, table, pk, db_row{std::move(data), payer, std::move(secondary)});
+}
+
+void db_update(uint64_t scope, uint64_t table, uint64_t payer, uint64_t pk, std::vector<char> data, std::vector<std::string> secondary) {
+	count_call();
+	const auto& rows = state.tables[{context().receiver, scope, table}].rows;
+	auto existing = rows.find(pk);
+	if(payer == 0)
+		payer = existing->second.payer;
+	write_row(scope, table, pk, db_row{std::move(data), payer, std::move(secondary)});
+}
+
+void db_remove(uint64_t scope, uint64_t table, uint64_t pk) {
+	count_call();
+	write_row(scope, table, pk, std::nullopt);
+}
+
+/*
+ * chain.hpp
+ */
+void reset() {
+	bool print = state.print, deltas = state.deltas;
+	state = chain_state();
+	state.print = print;
+	state.deltas = deltas;
+}
+
+void create_account(eosio::name account) {
+	state.accounts.insert(account.value);
+}
+
+void set_code(eosio::name account, apply_handler handler) {
+	create_account(account);
+	state.code[account.value] = handler;
+}
+
+void set_time(uint64_t us) {
+	state.time = us;
+}
+
+void advance_time(uint64_t us) {
+	state.time += us;
+}
+
+void set_print(bool enabled) {
+	state.print = enabled;
+}
+
+void set_deltas(bool enabled) {
+	state.deltas = enabled;
+}
+
+std::vector<std::vector<table_delta>> take_deltas() {
+	return std::exchange(state.deltas_log, {});
+}
+
+namespace {
+
+	// runs 'execute' as one transaction, its writes are reverted if it throws or 'commit' is false
+	template<typename F>
+	transaction_result run_transaction(F execute, bool commit) {
+		transaction_result result;
+		state.undo.clear();
+		state.console.clear();
+		state.costs = transaction_costs();
+		try {
+			execute();
+		}
+		catch(const std::exception& e) {
+			result.failed = true;
+			result.error = e.what();
+		}
+		if(result.failed || !commit)
+			rollback(0);
+		else if(state.deltas)
+			state.deltas_log.push_back(collect_deltas());
+		state.undo.clear();
+		result.console = std::move(state.console);
+		result.costs = state.costs;
+		state.console.clear();
+		return result;
+	}
+
+} // namespace
+
+transaction_result push_transaction(const std::vector<packed_action>& actions, bool commit) {
+	return run_transaction([&] {
+		for(const auto& act : actions)
+			execute_action(act, 0);
+	}, commit);
+}
+
+transaction_result push_code(eosio::name receiver, const std::function<void()>& body, bool commit) {
+	return run_transaction([&] {
+		packed_action act{receiver.value, 0, {}, {}};
+		std::vector<uint64_t> recipients{receiver.value};
+		std::vector<packed_action> inlines;
+		state.costs.actions++;
+		state.contexts.push_back({receiver.value, &act, &recipients, &inlines});
+		try {
+			body();
+		}
+		catch(...) {
+			state.contexts.pop_back();
+			throw;
+		}
+		state.contexts.pop_back();
+		for(const auto& a : inlines)
+			execute_action(a, 1);
+	}, commit);
+}
+
+void load_row(eosio::name code, uint64_t scope, eosio::name table, uint64_t pk, std::vector<char> data) {
+	put_row({code.value, scope, table.value}, pk, db_row{std::move(data), code.value, {}});
+}
+
+struct private_chain::state {
+	chain_state chain;
+};
+
+private_chain::private_chain() : own(new state) {
+}
+
+private_chain::~private_chain() = default;
+
+void private_chain::swap() {
+	std::swap(host::state, own->chain);
+}
+
+} // namespace host
@@ -0,0 +1,155 @@
+/**
+ *  chain.hpp -- in-memory chain for host builds of contracts
+ *
+ *  Executes transactions like nodeos does: an action is applied to its account, then to every
+ *  account added by require_recipient(), then inline actions are executed depth first.
+ *  Any failed check() reverts all table writes of the transaction.
+ *  There is no RAM or CPU accounting, accounts have no keys and authorization is checked by
+ *  actor names only: actor of inline action must be the contract sending it.
+ *  Chain state is per thread: all functions below act on the chain of calling thread.
+ */
+#pragma once
+
+#include <eosio/datastream.hpp>
+#include <eosio/intrinsics.hpp>
+#include <eosio/name.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace host {
+
+/**
+ * Contract entry point, same as 'apply' generated by eosio.cdt.
+ * 'code' is the first receiver of the action, it differs from 'receiver' for notifications.
+ */
+using apply_handler = void (*)(eosio::name receiver, eosio::name code, eosio::name action, const std::vector<char>& data);
+
+/**
+ * Deterministic costs of one transaction, these do not depend on machine load, so builds of
+ * contracts can be compared by them. Every chain API call made by contract code is a host call,
+ * reads are rows fetched and deserialized, writes are rows stored, updated or removed.
+ */
+struct transaction_costs {
+	uint64_t actions = 0;           // applied actions, notifications included
+	uint64_t notifications = 0;
+	uint64_t inline_actions = 0;
+	uint64_t host_calls = 0;
+	uint64_t db_reads = 0;
+	uint64_t db_writes = 0;
+	uint64_t bytes_read = 0;
+	uint64_t bytes_written = 0;
+};
+
+/**
+ * Final state of a row changed by committed transaction, as state history plugin sends it:
+ * one delta per row, however many times it was written, 'present' is false for removed rows.
+ */
+struct table_delta {
+	uint64_t          code;
+	uint64_t          scope;
+	uint64_t          table;
+	uint64_t          primary_key;
+	uint64_t          payer;
+	bool              present;
+	std::vector<char> value;
+};
+
+struct transaction_result {
+	bool              failed = false;
+	std::string       error;
+	std::string       console;
+	transaction_costs costs;
+
+	explicit operator bool() const { return !failed; }
+};
+
+// drop all accounts, contracts, tables and deltas log, print and deltas settings are kept
+void reset();
+
+void create_account(eosio::name account);
+void set_code(eosio::name account, apply_handler handler);
+
+// chain time in microseconds since epoch, as returned by current_time_point()
+void set_time(uint64_t us);
+void advance_time(uint64_t us);
+
+// collect print() output of contracts into transaction_result::console
+void set_print(bool enabled);
+
+/**
+ * With deltas enabled every committed transaction appends its table deltas, in order of first
+ * write, to the log of chain. take_deltas() returns the log, one vector per transaction, and clears it.
+ */
+void set_deltas(bool enabled);
+std::vector<std::vector<table_delta>> take_deltas();
+
+/**
+ * Execute actions as one transaction. With 'commit' == false all changes are reverted
+ * after execution, this keeps the state unchanged between benchmark iterations.
+ */
+transaction_result push_transaction(const std::vector<packed_action>& actions, bool commit = true);
+
+/**
+ * Action authorized by 'actor'. Arguments are serialized in given order and types,
+ * so they must have exactly the types of action parameters.
+ */
+template<typename... Args>
+packed_action make_action(eosio::name account, eosio::name act, eosio::name actor, const Args&... args) {
+	return {account.value, act.value, {{actor.value, eosio::name("active").value}}, eosio::pack(std::make_tuple(args...))};
+}
+
+template<typename... Args>
+transaction_result push_action(eosio::name account, eosio::name act, eosio::name actor, const Args&... args) {
+	return push_transaction({make_action(account, act, actor, args...)});
+}
+
+/**
+ * Execute 'body' as the only action of a transaction, applied to 'receiver': it may write tables
+ * of 'receiver' and send inline actions, notifications are not sent. This runs contract functions,
+ * which are not actions, with the same rollback as actions, see push_transaction().
+ */
+transaction_result push_code(eosio::name receiver, const std::function<void()>& body, bool commit = true);
+
+/**
+ * Put a row read from another chain, outside of transactions: nothing is counted or logged.
+ * Secondary keys are not known from row data, so rows loaded this way are found by primary key only.
+ */
+void load_row(eosio::name code, uint64_t scope, eosio::name table, uint64_t pk, std::vector<char> data);
+
+/**
+ * Chain apart from the chain of the thread. While use() runs, every function above and every
+ * intrinsic called by the thread act on this chain, the chain of the thread is back when use()
+ * returns or throws. sdk/bank_client.cpp runs contract code over rows of a snapshot this way.
+ */
+class private_chain {
+public:
+	private_chain();
+	~private_chain();
+	private_chain(const private_chain&) = delete;
+	private_chain& operator=(const private_chain&) = delete;
+
+	template<typename F>
+	auto use(F&& f) {
+		guard g(*this);
+		return f();
+	}
+
+private:
+	struct state;
+
+	struct guard {
+		private_chain& chain;
+		explicit guard(private_chain& c) : chain(c) { chain.swap(); }
+		~guard() { chain.swap(); }
+	};
+
+	void swap();
+
+	std::unique_ptr<state> own;
+};
+
+} // namespace host
@@ -0,0 +1,355 @@
+/**
+ *  columnar.cpp -- typed columnar files of contract table rows, see columnar.hpp
+ */
+
+#include "columnar.hpp"
+
+#include <eosio/datastream.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+
+namespace columnar {
+
+namespace {
+
+	const char     magic[8] = {'D', 'E', 'P', 'O', 'S', 'C', 'O', 'L'};
+	const uint32_t version = 1;
+
+	template<typename T>
+	void put(std::string& buf, T v) {
+		buf.append(reinterpret_cast<const char*>(&v), sizeof(v));
+	}
+
+	void put_string(std::string& buf, const std::string& s) {
+		uint32_t v = s.size();
+		do {
+			uint8_t b = uint8_t(v & 0x7f);
+			v >>= 7;
+			buf += char(b | ((v > 0) << 7));
+		} while(v);
+		buf += s;
+	}
+
+	class reader_stream {
+	public:
+		reader_stream(const char* data, size_t size) : pos(data), end(data + size) {}
+
+		template<typename T>
+		T get() {
+			T v;
+			take(&v, sizeof(v));
+			return v;
+		}
+
+		std::string get_string() {
+			uint32_t size = 0;
+			for(int by = 0; ; by += 7) {
+				if(by >= 35)
+					throw std::runtime_error("varuint32 is too long");
+				uint8_t b = get<uint8_t>();
+				size |= uint32_t(b & 0x7f) << by;
+				if(!(b & 0x80))
+					break;
+			}
+			std::string s(size, '\0');
+			take(s.data(), size);
+			return s;
+		}
+
+		void take(void* to, size_t size) {
+			if(size > size_t(end - pos))
+				throw std::runtime_error("columnar data is truncated");
+			memcpy(to, pos, size);
+			pos += size;
+		}
+
+		bool done() const { return pos == end; }
+
+	private:
+		const char* pos;
+		const char* end;
+	};
+
+	bool is_string(column_type t) {
+		return t == column_type::string;
+	}
+
+	std::string encode_group(const std::vector<column>& columns, const std::vector<std::vector<value>>& rows) {
+		std::string result;
+		put<uint32_t>(result, rows.size());
+		for(size_t c = 0; c < columns.size(); c++) {
+			std::string raw;
+			raw.reserve(rows.size() * 8);
+			for(const auto& r : rows) {
+				const auto& v = r[c];
+				if(is_string(columns[c].type))
+					put_string(raw, std::get<std::string>(v));
+				else if(std::holds_alternative<int64_t>(v))
+					put<int64_t>(raw, std::get<int64_t>(v));
+				else
+					put<uint64_t>(raw, std::get<uint64_t>(v));
+			}
+			uLongf size = compressBound(raw.size());
+			std::string compressed(size, '\0');
+			if(compress2(reinterpret_cast<Bytef*>(compressed.data()), &size, reinterpret_cast<const Bytef*>(raw.data()), raw.size(), 6) != Z_OK)
+				throw std::runtime_error("zlib compression failed");
+			put<uint32_t>(result, size);
+			put<uint32_t>(result, raw.size());
+			result.append(compressed.data(), size);
+		}
+		return result;
+	}
+
+	void decode_group(reader_stream& in, const std::vector<column>& columns, std::vector<std::vector<value>>& rows) {
+		uint32_t count = in.get<uint32_t>();
+		size_t first = rows.size();
+		rows.resize(first + count, std::vector<value>(columns.size()));
+		for(size_t c = 0; c < columns.size(); c++) {
+			uint32_t compressed_size = in.get<uint32_t>();
+			uint32_t raw_size = in.get<uint32_t>();
+			std::string compressed(compressed_size, '\0');
+			in.take(compressed.data(), compressed_size);
+			std::string raw(raw_size, '\0');
+			uLongf size = raw_size;
+			if(uncompress(reinterpret_cast<Bytef*>(raw.data()), &size, reinterpret_cast<const Bytef*>(compressed.data()), compressed_size) != Z_OK || size != raw_size)
+				throw std::runtime_error("damaged column " + columns[c].name);
+			reader_stream column_data(raw.data(), raw.size());
+			for(size_t r = first; r < rows.size(); r++) {
+				if(is_string(columns[c].type))
+					rows[r][c] = column_data.get_string();
+				else if(columns[c].type == column_type::int64)
+					rows[r][c] = column_data.get<int64_t>();
+				else
+					rows[r][c] = column_data.get<uint64_t>();
+			}
+			if(!column_data.done())
+				throw std::runtime_error("column " + columns[c].name + " is longer than row group");
+		}
+	}
+
+	// columns of ABI field type
+	void add_field_columns(std::vector<column>& result, const indexer::abi_field& f) {
+		if(f.type == "asset") {
+			result.push_back({f.name + ".amount", column_type::int64});
+			result.push_back({f.name + ".symbol", column_type::symbol});
+		}
+		else if(f.type == "name")
+			result.push_back({f.name, column_type::name});
+		else if(f.type == "int64" || f.type == "time_point")
+			result.push_back({f.name, column_type::int64});
+		else if(f.type == "uint64" || f.type == "symbol_code")
+			result.push_back({f.name, column_type::uint64});
+		else if(f.type == "string" || f.type == "checksum256")
+			result.push_back({f.name, column_type::string});
+		else
+			throw std::runtime_error("no column type for ABI type " + f.type);
+	}
+
+	void add_field_values(std::vector<value>& result, const indexer::abi_field& f, const indexer::row& r) {
+		if(!r.present) {
+			// removed row has no fields, columns are filled with zero values
+			if(f.type == "asset") {
+				result.push_back(int64_t(0));
+				result.push_back(uint64_t(0));
+			}
+			else if(f.type == "int64" || f.type == "time_point")
+				result.push_back(int64_t(0));
+			else if(f.type == "string" || f.type == "checksum256")
+				result.push_back(std::string());
+			else
+				result.push_back(uint64_t(0));
+			return;
+		}
+		const auto& v = r[f.name];
+		if(auto a = std::get_if<eosio::asset>(&v)) {
+			result.push_back(a->amount);
+			result.push_back(a->symbol.raw());
+		}
+		else if(auto n = std::get_if<name>(&v))
+			result.push_back(n->value);
+		else if(auto i = std::get_if<int64_t>(&v))
+			result.push_back(*i);
+		else if(auto u = std::get_if<uint64_t>(&v))
+			result.push_back(*u);
+		else
+			result.push_back(std::get<std::string>(v));
+	}
+
+} // namespace
+
+std::vector<column> table_columns(const std::vector<indexer::abi_field>& fields) {
+	std::vector<column> result = {
+		{"transaction", column_type::uint64},
+		{"scope",       column_type::name},
+		{"primary_key", column_type::uint64},
+		{"payer",       column_type::name},
+		{"present",     column_type::boolean},
+	};
+	for(const auto& f : fields)
+		add_field_columns(result, f);
+	return result;
+}
+
+std::vector<value> row_values(const indexer::row_version& v, const std::vector<indexer::abi_field>& fields) {
+	const auto& r = v.state;
+	std::vector<value> result = {v.transaction, r.scope.value, r.primary_key, r.payer.value, uint64_t(r.present)};
+	for(const auto& f : fields)
+		add_field_values(result, f, r);
+	return result;
+}
+
+/*
+ * writer
+ */
+writer::writer(const std::string& path, name code, name table, std::vector<column> cols, unsigned t, size_t rows)
+	: out(path, std::ios::binary | std::ios::trunc), columns(std::move(cols)), threads(std::max(1u, t)), group_rows(std::max<size_t>(1, rows)) {
+	if(!out)
+		throw std::runtime_error("cannot write " + path);
+	std::string header(magic, sizeof(magic));
+	put<uint32_t>(header, version);
+	put<uint64_t>(header, code.value);
+	put<uint64_t>(header, table.value);
+	put<uint32_t>(header, columns.size());
+	for(const auto& c : columns) {
+		put_string(header, c.name);
+		put<uint8_t>(header, uint8_t(c.type));
+	}
+	out.write(header.data(), header.size());
+}
+
+writer::~writer() {
+	try {
+		close();
+	}
+	catch(...) {
+	}
+}
+
+void writer::add(std::vector<value> row) {
+	if(row.size() != columns.size())
+		throw std::logic_error("row does not match columns of columnar file");
+	group.push_back(std::move(row));
+	if(group.size() >= group_rows)
+		flush_group();
+}
+
+void writer::flush_group() {
+	if(group.empty())
+		return;
+	// at most 'threads' groups are encoded at once, the oldest is written first
+	if(encoding.size() >= threads)
+		write_encoded();
+	encoding.push_back(std::async(std::launch::async, [cols = columns, rows = std::move(group)] {
+		return encode_group(cols, rows);
+	}));
+	group.clear();
+}
+
+void writer::write_encoded() {
+	std::string data = encoding.front().get();
+	encoding.pop_front();
+	uint32_t rows;
+	memcpy(&rows, data.data(), sizeof(rows));
+	groups.emplace_back(uint64_t(out.tellp()), rows);
+	out.write(data.data(), data.size());
+}
+
+void writer::close() {
+	if(closed)
+		return;
+	closed = true;
+	flush_group();
+	while(!encoding.empty())
+		write_encoded();
+	uint64_t footer_offset = out.tellp();
+	std::string footer;
+	put<uint32_t>(footer, groups.size());
+	for(const auto& [offset, rows] : groups) {
+		put<uint64_t>(footer, offset);
+		put<uint32_t>(footer, rows);
+	}
+	put<uint64_t>(footer, footer_offset);
+	footer.append(magic, sizeof(magic));
+	out.write(footer.data(), footer.size());
+	out.close();
+	if(!out)
+		throw std::runtime_error("columnar file write failed");
+}
+
+/*
+ * reader
+ */
+table_file read_file(const std::string& path) {
+	std::ifstream in(path, std::ios::binary);
+	if(!in)
+		throw std::runtime_error("cannot read " + path);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if(data.size() < 2 * sizeof(magic) + 12 || memcmp(data.data(), magic, sizeof(magic)) || memcmp(data.data() + data.size() - sizeof(magic), magic, sizeof(magic)))
+		throw std::runtime_error(path + " is not a columnar file");
+
+	reader_stream header(data.data() + sizeof(magic), data.size() - sizeof(magic));
+	if(header.get<uint32_t>() != version)
+		throw std::runtime_error(path + ": unknown version");
+	table_file result;
+	result.code = name(header.get<uint64_t>());
+	result.table = name(header.get<uint64_t>());
+	uint32_t count = header.get<uint32_t>();
+	for(uint32_t i = 0; i < count; i++) {
+		column c;
+		c.name = header.get_string();
+		c.type = column_type(header.get<uint8_t>());
+		result.columns.push_back(c);
+	}
+
+	uint64_t footer_offset;
+	memcpy(&footer_offset, data.data() + data.size() - sizeof(magic) - sizeof(footer_offset), sizeof(footer_offset));
+	if(footer_offset > data.size())
+		throw std::runtime_error(path + ": damaged footer");
+	reader_stream footer(data.data() + footer_offset, data.size() - footer_offset);
+	uint32_t groups = footer.get<uint32_t>();
+	for(uint32_t g = 0; g < groups; g++) {
+		uint64_t offset = footer.get<uint64_t>();
+		uint32_t rows = footer.get<uint32_t>();
+		if(offset >= footer_offset)
+			throw std::runtime_error(path + ": damaged footer");
+		reader_stream group(data.data() + offset, footer_offset - offset);
+		size_t before = result.rows.size();
+		decode_group(group, result.columns, result.rows);
+		if(result.rows.size() - before != rows)
+			throw std::runtime_error(path + ": row group size differs from footer");
+	}
+	return result;
+}
+
+size_t export_segment(const indexer::store& store, const std::map<name, const indexer::abi*>& abis, const std::string& dir,
+	uint64_t segment, uint64_t after, uint64_t upto, unsigned threads, size_t group_rows) {
+	std::map<std::pair<name, name>, std::vector<indexer::row_version>> tables;
+	for(auto& v : store.changes(after, upto))
+		tables[{v.state.code, v.state.table}].push_back(std::move(v));
+
+	size_t total = 0;
+	for(const auto& [id, versions] : tables) {
+		auto [code, table] = id;
+		auto contract = abis.find(code);
+		if(contract == abis.end() || !contract->second->count(table))
+			continue;
+		const auto& fields = contract->second->at(table);
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), ".%06llu.dcol", (unsigned long long)segment);
+		writer w(dir + "/" + code.to_string() + "." + table.to_string() + suffix, code, table, table_columns(fields), threads, group_rows);
+		for(const auto& v : versions)
+			w.add(row_values(v, fields));
+		w.close();
+		total += versions.size();
+	}
+	return total;
+}
+
+} // namespace columnar
@@ -0,0 +1,92 @@
+/**
+ *  columnar.hpp -- typed columnar files of contract table rows, written by host/export
+ *
+ *  A file holds rows of one table: header with table name and typed columns, row groups and
+ *  footer with offsets of row groups. Every column of a row group is stored separately and
+ *  compressed by zlib: integers as 8-byte little-endian values, strings with varuint32 length.
+ *  Row groups are encoded on worker threads and written in order.
+ *
+ *    file       "DEPOSCOL" version:u32 code:u64 table:u64 columns:u32 (name:string type:u8)...
+ *               row group... footer
+ *    row group  rows:u32 (compressed_size:u32 raw_size:u32 zlib_data) for every column
+ *    footer     groups:u32 (offset:u64 rows:u32)... footer_offset:u64 "DEPOSCOL"
+ *
+ *  Export of a table is a sequence of segments: the first one has all rows, next ones have rows
+ *  changed after the previous segment, in their last state. Rows removed since the previous
+ *  segment have present == 0. Applying segments in order by (scope, primary_key) gives the table.
+ */
+#pragma once
+
+#include "indexer.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace columnar {
+
+using eosio::name;
+
+enum class column_type : uint8_t { uint64, int64, name, symbol, string, boolean };
+
+struct column {
+	std::string name;
+	column_type type;
+};
+
+// name, symbol and boolean columns are read as uint64_t
+using value = std::variant<uint64_t, int64_t, std::string>;
+
+/**
+ * Columns of exported table: transaction, scope, primary_key, payer, present and fields of ABI
+ * struct. Asset field is split into <field>.amount and <field>.symbol, checksum256 is hex string.
+ */
+std::vector<column> table_columns(const std::vector<indexer::abi_field>& fields);
+std::vector<value> row_values(const indexer::row_version& v, const std::vector<indexer::abi_field>& fields);
+
+class writer {
+public:
+	writer(const std::string& path, name code, name table, std::vector<column> columns, unsigned threads, size_t group_rows);
+	~writer();
+
+	void add(std::vector<value> row);
+
+	// encode the last row group and write footer
+	void close();
+
+private:
+	void flush_group();
+	void write_encoded();
+
+	std::ofstream                            out;
+	std::vector<column>                      columns;
+	unsigned                                 threads;
+	size_t                                   group_rows;
+	std::vector<std::vector<value>>          group;
+	std::deque<std::future<std::string>>     encoding;
+	std::vector<std::pair<uint64_t, uint32_t>> groups;     // offset and rows of written groups
+	bool                                     closed = false;
+};
+
+struct table_file {
+	name                             code;
+	name                             table;
+	std::vector<column>              columns;
+	std::vector<std::vector<value>>  rows;
+};
+
+table_file read_file(const std::string& path);
+
+/**
+ * Write segment of every table described by 'abis' with rows changed in (after, upto] to
+ * files <dir>/<code>.<table>.<segment>.dcol, returns number of rows written.
+ */
+size_t export_segment(const indexer::store& store, const std::map<name, const indexer::abi*>& abis, const std::string& dir,
+	uint64_t segment, uint64_t after, uint64_t upto, unsigned threads, size_t group_rows);
+
+} // namespace columnar
@@ -0,0 +1,55 @@
+/**
+ *  contracts.hpp -- host builds of contracts
+ *  Each contract is compiled in its own translation unit and namespace, like eosio.cdt builds
+ *  one wasm module per contract: shared headers define non-inline functions and tables.
+ */
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+
+#include <vector>
+
+namespace host {
+
+void bank_apply(eosio::name receiver, eosio::name code, eosio::name action, const std::vector<char>& data);
+void custodian_apply(eosio::name receiver, eosio::name code, eosio::name action, const std::vector<char>& data);
+
+/**
+ * eosio.token stand-in, built from depostoken.hpp: create, issue and transfer with notifications
+ */
+void eosio_token_apply(eosio::name receiver, eosio::name code, eosio::name action, const std::vector<char>& data);
+
+/**
+ * Bank balance sheet as check_on_system_change() sees it, computed by formulas of utility.hpp
+ * from current tables, values are in cents.
+ */
+struct bank_state {
+	int64_t assets;             // get_bank_assets_value()
+	int64_t capital;            // get_bank_capital_value()
+	int64_t liquidity_pool;     // get_liquidity_pool_value()
+	int64_t hedge_assets;       // get_hedge_assets_value()
+	int64_t bitmex;             // BTC at bitmex
+	int64_t dusd_supply;
+	int64_t volume_used;        // 'volumeused' in 'stat' scope
+};
+
+bank_state read_bank_state();
+
+/**
+ * Conversions of utility.hpp specialized for stablecoin policy of 'coin' ("DUSD" or "DEUR", see
+ * contracts/stablecoin.hpp) from current bank variables, values are in minimal units of the stablecoin.
+ */
+struct coin_quote {
+	int64_t btc_price;          // get_btc_price()
+	int64_t btc_value;          // get_btc_value(satoshi)
+	int64_t eos_value;          // get_eos_value(eoshi)
+	int64_t mint_btc;           // satoshi2coin(satoshi)
+	int64_t mint_eos;           // eos2coin(eoshi)
+	int64_t redeem_btc;         // coin2satoshi(mint_btc), in satoshi
+	int64_t redeem_eos;         // coin2eos(mint_eos), in eoshi
+};
+
+coin_quote read_coin_quote(eosio::symbol_code coin, int64_t satoshi, int64_t eoshi);
+
+} // namespace host
@@ -0,0 +1,199 @@
+/**
+ *  costs.cpp -- deterministic per-action costs of host builds of contracts
+ *  usage: costs [-w baseline] [-c baseline] [-t percent]
+ *
+ *  Every path is one user transaction executed from exchange_state() and reverted afterwards.
+ *  Costs are counted by the in-memory chain (see transaction_costs in chain.hpp), so they are the
+ *  same on every run and machine: a change of numbers is a change of contracts code.
+ *  -w writes costs to baseline file, -c compares them with baseline file and exits with 1,
+ *  if any cost of any path exceeds baseline by more than -t percent (default 5).
+ */
+
+#include "scenarios.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace scenarios;
+
+namespace {
+
+struct path {
+	const char*         name;
+	host::packed_action act;
+};
+
+struct cost_field {
+	const char*                                 name;
+	uint64_t host::transaction_costs::*         member;
+};
+
+const cost_field fields[] = {
+	{"actions",   &host::transaction_costs::actions},
+	{"notifs",    &host::transaction_costs::notifications},
+	{"inlines",   &host::transaction_costs::inline_actions},
+	{"hostcalls", &host::transaction_costs::host_calls},
+	{"dbreads",   &host::transaction_costs::db_reads},
+	{"dbwrites",  &host::transaction_costs::db_writes},
+	{"bytesread", &host::transaction_costs::bytes_read},
+	{"byteswrit", &host::transaction_costs::bytes_written},
+};
+
+host::packed_action bank_transfer(asset quantity, const string& memo) {
+	return host::make_action(BANK_ACC, name("transfer"), TEST_ACC, TEST_ACC, BANK_ACC, quantity, memo);
+}
+
+vector<path> paths() {
+	return {
+		{"mint_DBTC",           host::make_action(CUSTODIAN_ACC, name("mint"), CUSTODIAN_ACC, TEST_ACC, DBTC.code(), int64_t(100000), string(64, 'f'))},
+		{"mint_DUSD_for_DBTC",  host::make_action(CUSTODIAN_ACC, name("transfer"), TEST_ACC, TEST_ACC, BANK_ACC, asset(100000, DBTC), string("Buy DUSD"))},
+		{"mint_DUSD_for_EOS",   host::make_action(EOSIO_TOKEN, name("transfer"), TEST_ACC, TEST_ACC, BANK_ACC, asset(10000, EOS), string("Buy DUSD"))},
+		{"redeem_DUSD_for_DBTC", bank_transfer(asset(1000, DUSD), "Redeem for DBTC")},
+		{"redeem_DUSD_for_BTC", bank_transfer(asset(1000, DUSD), "2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxM")},
+		{"redeem_DUSD_for_EOS", bank_transfer(asset(1000, DUSD), "Redeem for EOS")},
+		{"batch_mint_intent",   host::make_action(CUSTODIAN_ACC, name("transfer"), TEST_ACC, TEST_ACC, BANK_ACC, asset(100000, DBTC), string("Batch buy DUSD"))},
+		{"batch_redeem_intent", bank_transfer(asset(1000, DUSD), "Batch redeem for DBTC")},
+		{"buy_DPS",             bank_transfer(asset(1000, DUSD), "Buy DPS")},
+		{"redeem_DPS",          bank_transfer(asset(10000000, DPS), "Redeem for DUSD")},
+		{"p2p_transfer",        host::make_action(BANK_ACC, name("transfer"), TEST_ACC, TEST_ACC, BUYER, asset(100, DUSD), string("p2p"))},
+		{"oracle_setvar",       host::make_action(BANK_ACC, name("setvar"), ORACLE_ACC, name("periodic"), name("btcusd"), int64_t(1001000000000))},
+		{"blncsppl",            host::make_action(BANK_ACC, name("blncsppl"), BANK_ACC)},
+		{"checkinvars",         host::make_action(BANK_ACC, name("checkinvars"), TEST_ACC)},
+		{"rebalance",           host::make_action(BANK_ACC, name("rebalance"), TEST_ACC)},
+		{"sweepshards",         host::make_action(BANK_ACC, name("sweepshards"), TEST_ACC)},
+	};
+}
+
+using cost_table = map<string, vector<uint64_t>>;
+
+cost_table read_baseline(const string& file) {
+	ifstream in(file);
+	if(!in)
+		throw runtime_error("cannot read " + file);
+	cost_table result;
+	string line;
+	while(getline(in, line)) {
+		if(line.empty() || line[0] == '#')
+			continue;
+		istringstream row(line);
+		string name;
+		row >> name;
+		auto& values = result[name];
+		uint64_t v;
+		while(row >> v)
+			values.push_back(v);
+	}
+	return result;
+}
+
+void write_baseline(const string& file, const cost_table& costs) {
+	ofstream out(file);
+	if(!out)
+		throw runtime_error("cannot write " + file);
+	out << "# path";
+	for(const auto& f : fields)
+		out << " " << f.name;
+	out << "\n# written by host/costs -w, compared by 'make costcheck'\n";
+	for(const auto& [name, values] : costs) {
+		out << name;
+		for(auto v : values)
+			out << " " << v;
+		out << "\n";
+	}
+}
+
+void usage() {
+	cerr << "usage: costs [-w baseline] [-c baseline] [-t percent]" << endl;
+	exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	string write_to, compare_with;
+	double threshold = 5;
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(i + 1 >= argc)
+			usage();
+		if(arg == "-w")
+			write_to = argv[++i];
+		else if(arg == "-c")
+			compare_with = argv[++i];
+		else if(arg == "-t")
+			threshold = atof(argv[++i]);
+		else
+			usage();
+	}
+
+	try {
+		exchange_state();
+		// batch mode is on, so that intents can be measured
+		if(setvar(name("batch.epoch"), 3600).failed)
+			throw runtime_error("cannot set batch.epoch");
+
+		cost_table costs;
+		printf("%-22s", "path");
+		for(const auto& f : fields)
+			printf(" %9s", f.name);
+		printf("\n");
+		int failed = 0;
+		for(const auto& p : paths()) {
+			auto result = host::push_transaction({p.act}, false);
+			if(result.failed) {
+				printf("%-22s FAILED: %s\n", p.name, result.error.c_str());
+				failed++;
+				continue;
+			}
+			auto& values = costs[p.name];
+			printf("%-22s", p.name);
+			for(const auto& f : fields) {
+				values.push_back(result.costs.*f.member);
+				printf(" %9llu", (unsigned long long)values.back());
+			}
+			printf("\n");
+		}
+		if(failed)
+			return 1;
+
+		if(!write_to.empty())
+			write_baseline(write_to, costs);
+
+		if(!compare_with.empty()) {
+			auto baseline = read_baseline(compare_with);
+			int regressions = 0;
+			for(const auto& [name, values] : costs) {
+				auto base = baseline.find(name);
+				if(base == baseline.end() || base->second.size() != values.size()) {
+					printf("%s: no baseline\n", name.c_str());
+					continue;
+				}
+				for(size_t i = 0; i < values.size(); i++) {
+					double limit = base->second[i] * (1 + threshold / 100);
+					if(values[i] > limit) {
+						printf("\e[31m%s: %s %llu, baseline %llu\e[0m\n", name.c_str(), fields[i].name,
+							(unsigned long long)values[i], (unsigned long long)base->second[i]);
+						regressions++;
+					}
+				}
+			}
+			if(regressions) {
+				printf("%d costs regressed by more than %g%%\n", regressions, threshold);
+				return 1;
+			}
+			printf("no costs regressed by more than %g%%\n", threshold);
+		}
+	}
+	catch(const exception& e) {
+		cerr << "costs: " << e.what() << endl;
+		return 2;
+	}
+	return 0;
+}
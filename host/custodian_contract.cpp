@@ -0,0 +1,47 @@
+/**
+ *  custodian_contract.cpp -- host build of contracts/custodian, see contracts.hpp
+ */
+
+#include "prelude.hpp"
+#include "contracts.hpp"
+
+namespace host_custodian {
+
+using std::pow;
+
+#include <custodian.cpp>
+
+#include "dbond_serialization.hpp"
+
+} // namespace host_custodian
+
+void host::custodian_apply(eosio::name receiver, eosio::name code, eosio::name action, const std::vector<char>& data) {
+	using host_custodian::custodian;
+
+	if(code == receiver) {
+		switch(action.value) {
+			HOST_DISPATCH_ACTION(custodian, create)
+			HOST_DISPATCH_ACTION(custodian, issue)
+			HOST_DISPATCH_ACTION(custodian, retire)
+			HOST_DISPATCH_ACTION(custodian, transfer)
+			HOST_DISPATCH_ACTION(custodian, open)
+			HOST_DISPATCH_ACTION(custodian, close)
+			HOST_DISPATCH_ACTION(custodian, setvar)
+			HOST_DISPATCH_ACTION(custodian, delvar)
+			HOST_DISPATCH_ACTION(custodian, seedledger)
+			HOST_DISPATCH_ACTION(custodian, mint)
+			HOST_DISPATCH_ACTION(custodian, redeem)
+			HOST_DISPATCH_ACTION(custodian, balancehedge)
+			HOST_DISPATCH_ACTION(custodian, fillhedge)
+			HOST_DISPATCH_ACTION(custodian, sweepshards)
+#ifdef DEBUG
+			HOST_DISPATCH_ACTION(custodian, erase)
+#endif
+		}
+		eosio::check(false, "unknown action");
+	}
+
+	// notifications, see [[eosio::on_notify]] attributes in custodian.hpp
+	if(code == host_custodian::BANKACCOUNT && action == eosio::name("transfer"))
+		execute_action<custodian, &custodian::ontransfer>(receiver, code, data);
+}
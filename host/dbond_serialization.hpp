@@ -0,0 +1,24 @@
+/**
+ *  dbond_serialization.hpp -- serialization of dbonds structs with base classes, see datastream.hpp
+ *  Included inside contract namespace right after contract sources, found by argument-dependent lookup.
+ */
+
+template<typename Stream>
+eosio::datastream<Stream>& operator<<(eosio::datastream<Stream>& ds, const fc_dbond& v) {
+	return ds << static_cast<const dbond&>(v) << v.collateral_bond << v.verifier << v.counterparty
+		<< v.liquidation_agent << v.escrow_contract_link << v.apr << v.holders_list;
+}
+
+inline eosio::datastream<const char*>& operator>>(eosio::datastream<const char*>& ds, fc_dbond& v) {
+	return ds >> static_cast<dbond&>(v) >> v.collateral_bond >> v.verifier >> v.counterparty
+		>> v.liquidation_agent >> v.escrow_contract_link >> v.apr >> v.holders_list;
+}
+
+template<typename Stream>
+eosio::datastream<Stream>& operator<<(eosio::datastream<Stream>& ds, const cc_dbond& v) {
+	return ds << static_cast<const dbond&>(v) << v.crypto_collateral << v.early_payoff_policy << v.max_supply << v.issue_price;
+}
+
+inline eosio::datastream<const char*>& operator>>(eosio::datastream<const char*>& ds, cc_dbond& v) {
+	return ds >> static_cast<dbond&>(v) >> v.crypto_collateral >> v.early_payoff_policy >> v.max_supply >> v.issue_price;
+}
@@ -0,0 +1,537 @@
+/**
+ *  deposits.cpp -- BTC deposit watcher, see deposits.hpp
+ */
+
+#include "deposits.hpp"
+
+#include <eosio/crypto.hpp>
+#include <eosio/multi_index.hpp>
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+
+namespace deposits {
+
+namespace {
+
+	// blocks kept below confirmation depth to detect reorgs deeper than it
+	const int64_t kept_blocks = 144;
+
+	const char b58digits[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+	struct mint_order_row {
+		uint64_t           id;
+		name               user;
+		name               status;
+		int64_t            btc_amount;
+		eosio::checksum256 btc_txid;
+		uint64_t           mtime;
+
+		uint64_t           primary_key() const { return id; }
+		uint64_t           get_secondary_1() const { return status.value; }
+		eosio::checksum256 get_secondary_2() const { return btc_txid; }
+	};
+
+	// the same indices as mintOrders of depostoken.hpp
+	using mint_orders = eosio::multi_index<name("mintorders"), mint_order_row,
+		eosio::indexed_by<name("status"), eosio::const_mem_fun<mint_order_row, uint64_t, &mint_order_row::get_secondary_1>>,
+		eosio::indexed_by<name("btctxid"), eosio::const_mem_fun<mint_order_row, eosio::checksum256, &mint_order_row::get_secondary_2>>>;
+
+	class block_reader {
+	public:
+		explicit block_reader(const std::vector<uint8_t>& data) : data(data) {}
+
+		const uint8_t* skip(size_t size) {
+			if(size > data.size() - pos)
+				throw std::runtime_error("block is truncated");
+			const uint8_t* result = data.data() + pos;
+			pos += size;
+			return result;
+		}
+
+		template<typename T>
+		T get() {
+			T v = 0;
+			const uint8_t* p = skip(sizeof(T));
+			for(size_t i = 0; i < sizeof(T); i++)
+				v |= T(p[i]) << (8 * i);
+			return v;
+		}
+
+		uint64_t varint() {
+			uint8_t first = get<uint8_t>();
+			if(first < 0xfd)
+				return first;
+			if(first == 0xfd)
+				return get<uint16_t>();
+			if(first == 0xfe)
+				return get<uint32_t>();
+			return get<uint64_t>();
+		}
+
+		// count of items, every one taking at least 'min_size' bytes
+		uint64_t count(size_t min_size) {
+			uint64_t n = varint();
+			if(n > (data.size() - pos) / min_size)
+				throw std::runtime_error("block is truncated");
+			return n;
+		}
+
+		size_t position() const { return pos; }
+		const uint8_t* at(size_t p) const { return data.data() + p; }
+		bool peek_witness_marker() const { return pos + 1 < data.size() && data[pos] == 0 && data[pos + 1] == 1; }
+
+	private:
+		const std::vector<uint8_t>& data;
+		size_t                      pos = 0;
+	};
+
+	transaction parse_transaction(block_reader& in) {
+		transaction tx;
+		size_t start = in.position();
+		in.skip(4);
+		bool segwit = in.peek_witness_marker();
+		if(segwit)
+			in.skip(2);
+
+		// txid covers version, inputs, outputs and lock time, but not witness data
+		size_t body = in.position();
+		uint64_t inputs = in.count(41);
+		for(uint64_t i = 0; i < inputs; i++) {
+			in.skip(36);
+			in.skip(in.varint());
+			in.skip(4);
+		}
+		uint64_t outputs = in.count(9);
+		for(uint64_t i = 0; i < outputs; i++) {
+			output o;
+			o.index = uint32_t(i);
+			o.satoshi = int64_t(in.get<uint64_t>());
+			size_t size = in.varint();
+			const uint8_t* script = in.skip(size);
+			o.script.assign(script, script + size);
+			tx.outputs.push_back(std::move(o));
+		}
+		size_t body_end = in.position();
+		if(segwit)
+			for(uint64_t i = 0; i < inputs; i++)
+				for(uint64_t items = in.count(1); items; items--)
+					in.skip(in.varint());
+		const uint8_t* lock_time = in.skip(4);
+
+		tx.txid = display_hex(sha256d({{in.at(start), 4}, {in.at(body), body_end - body}, {lock_time, 4}}));
+		return tx;
+	}
+
+	class fixture_file : public block_source {
+	public:
+		explicit fixture_file(std::string path) : path(std::move(path)) {}
+
+		int64_t tip() override {
+			auto time = std::filesystem::last_write_time(path);
+			if(!chain || time != loaded) {
+				auto fresh = std::make_unique<recorded_chain>();
+				std::ifstream in(path);
+				if(!in)
+					throw std::runtime_error("cannot read " + path);
+				int64_t height;
+				std::string hex;
+				while(in >> height >> hex)
+					fresh->set(height, from_hex(hex));
+				chain = std::move(fresh);
+				loaded = time;
+			}
+			return chain->tip();
+		}
+
+		std::string hash(int64_t height) override { return chain->hash(height); }
+		std::vector<uint8_t> raw(const std::string& hash) override { return chain->raw(hash); }
+
+	private:
+		std::string                      path;
+		std::filesystem::file_time_type  loaded;
+		std::unique_ptr<recorded_chain>  chain;
+	};
+
+	class bitcoin_cli : public block_source {
+	public:
+		explicit bitcoin_cli(std::string command) : command(std::move(command)) {}
+
+		int64_t tip() override {
+			std::string out;
+			if(!run("getblockcount", out))
+				throw std::runtime_error(command + " getblockcount failed");
+			return std::stoll(out);
+		}
+
+		std::string hash(int64_t height) override {
+			std::string out;
+			return run("getblockhash " + std::to_string(height), out) ? out : std::string();
+		}
+
+		std::vector<uint8_t> raw(const std::string& hash) override {
+			std::string out;
+			if(!run("getblock " + hash + " 0", out))
+				throw std::runtime_error(command + " getblock " + hash + " failed");
+			return from_hex(out);
+		}
+
+	private:
+		// stdout without trailing whitespace, false if command failed
+		bool run(const std::string& args, std::string& out) {
+			FILE* p = popen((command + " " + args + " 2>/dev/null").c_str(), "r");
+			if(!p)
+				throw std::runtime_error("cannot run " + command);
+			char buf[65536];
+			size_t n;
+			while((n = fread(buf, 1, sizeof(buf), p)) > 0)
+				out.append(buf, n);
+			int status = pclose(p);
+			while(!out.empty() && isspace((unsigned char)out.back()))
+				out.pop_back();
+			return status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		}
+
+		std::string command;
+	};
+
+} // namespace
+
+hash256 sha256d(const std::vector<std::pair<const uint8_t*, size_t>>& parts) {
+	sha256_ctx first;
+	for(const auto& [data, size] : parts)
+		first.update(data, size);
+	hash256 h = first.final();
+	sha256_ctx second;
+	second.update(h.data(), h.size());
+	return second.final();
+}
+
+std::string to_hex(const uint8_t* data, size_t size) {
+	static const char digits[] = "0123456789abcdef";
+	std::string result;
+	for(size_t i = 0; i < size; i++) {
+		result += digits[data[i] >> 4];
+		result += digits[data[i] & 0xf];
+	}
+	return result;
+}
+
+std::vector<uint8_t> from_hex(const std::string& hex) {
+	auto digit = [&](char c) -> int {
+		if(c >= '0' && c <= '9')
+			return c - '0';
+		if(c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if(c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		throw std::runtime_error("bad hex string");
+	};
+	if(hex.size() % 2)
+		throw std::runtime_error("bad hex string");
+	std::vector<uint8_t> result(hex.size() / 2);
+	for(size_t i = 0; i < result.size(); i++)
+		result[i] = uint8_t(digit(hex[2 * i]) << 4 | digit(hex[2 * i + 1]));
+	return result;
+}
+
+std::optional<std::vector<uint8_t>> address_script(const std::string& address) {
+	// decoding of validate_btc_address() in stable.coin.hpp
+	std::array<uint8_t, 25> bin{};
+	for(char ch : address) {
+		const char* digit = ch ? strchr(b58digits, ch) : nullptr;
+		if(!digit)
+			return std::nullopt;
+		int c = int(digit - b58digits);
+		for(int j = 25; j--; ) {
+			c += 58 * bin[j];
+			bin[j] = c & 0xff;
+			c >>= 8;
+		}
+		if(c)
+			return std::nullopt;
+	}
+	hash256 check = sha256d({{bin.data(), 21}});
+	if(!std::equal(check.begin(), check.begin() + 4, bin.begin() + 21))
+		return std::nullopt;
+
+	const uint8_t* hash = bin.data() + 1;
+	switch(bin[0]) {
+	case 0x00:
+	case 0x6f:
+		// OP_DUP OP_HASH160 <20> OP_EQUALVERIFY OP_CHECKSIG
+		{
+			std::vector<uint8_t> script = {0x76, 0xa9, 0x14};
+			script.insert(script.end(), hash, hash + 20);
+			script.insert(script.end(), {0x88, 0xac});
+			return script;
+		}
+	case 0x05:
+	case 0xc4:
+		// OP_HASH160 <20> OP_EQUAL
+		{
+			std::vector<uint8_t> script = {0xa9, 0x14};
+			script.insert(script.end(), hash, hash + 20);
+			script.push_back(0x87);
+			return script;
+		}
+	default:
+		return std::nullopt;
+	}
+}
+
+std::string encode_address(uint8_t version, const std::array<uint8_t, 20>& hash) {
+	std::vector<uint8_t> bin = {version};
+	bin.insert(bin.end(), hash.begin(), hash.end());
+	hash256 check = sha256d({{bin.data(), bin.size()}});
+	bin.insert(bin.end(), check.begin(), check.begin() + 4);
+
+	std::string digits;
+	std::vector<uint8_t> number = bin;
+	while(std::any_of(number.begin(), number.end(), [](uint8_t b) { return b != 0; })) {
+		int remainder = 0;
+		for(auto& b : number) {
+			int v = remainder * 256 + b;
+			b = uint8_t(v / 58);
+			remainder = v % 58;
+		}
+		digits += b58digits[remainder];
+	}
+	for(size_t i = 0; i < bin.size() && bin[i] == 0; i++)
+		digits += '1';
+	return std::string(digits.rbegin(), digits.rend());
+}
+
+std::string display_hex(const hash256& hash) {
+	hash256 reversed;
+	std::reverse_copy(hash.begin(), hash.end(), reversed.begin());
+	return to_hex(reversed.data(), reversed.size());
+}
+
+block parse_block(const std::vector<uint8_t>& raw) {
+	block_reader in(raw);
+	block result;
+	const uint8_t* header = in.skip(80);
+	result.hash = display_hex(sha256d({{header, 80}}));
+	hash256 prev;
+	std::copy(header + 4, header + 36, prev.begin());
+	result.prev = display_hex(prev);
+	for(uint64_t n = in.count(60); n; n--)
+		result.transactions.push_back(parse_transaction(in));
+	if(in.position() != raw.size())
+		throw std::runtime_error("block " + result.hash + " has extra data");
+	return result;
+}
+
+/*
+ * recorded_chain
+ */
+void recorded_chain::set(int64_t height, std::vector<uint8_t> raw) {
+	std::string h = parse_block(raw).hash;
+	std::lock_guard<std::mutex> lock(m);
+	if(best.empty())
+		base = height;
+	if(height < base || height > base + int64_t(best.size()))
+		throw std::runtime_error("recorded block " + std::to_string(height) + " does not continue the chain");
+	best.resize(height - base);
+	best.push_back(h);
+	blocks[h] = std::move(raw);
+}
+
+int64_t recorded_chain::tip() {
+	std::lock_guard<std::mutex> lock(m);
+	return best.empty() ? -1 : base + int64_t(best.size()) - 1;
+}
+
+std::string recorded_chain::hash(int64_t height) {
+	std::lock_guard<std::mutex> lock(m);
+	if(height < base || height >= base + int64_t(best.size()))
+		return {};
+	return best[height - base];
+}
+
+std::vector<uint8_t> recorded_chain::raw(const std::string& hash) {
+	std::lock_guard<std::mutex> lock(m);
+	auto itr = blocks.find(hash);
+	if(itr == blocks.end())
+		throw std::runtime_error("no recorded block " + hash);
+	return itr->second;
+}
+
+std::unique_ptr<block_source> fixture_source(const std::string& path) {
+	return std::make_unique<fixture_file>(path);
+}
+
+std::unique_ptr<block_source> cli_source(const std::string& command) {
+	return std::make_unique<bitcoin_cli>(command);
+}
+
+/*
+ * watcher
+ */
+watcher::watcher(block_source& s, std::map<std::string, account> addresses, config c, name cust)
+	: source(s), cfg(c), custodian(cust), first_height(c.start_height) {
+	for(const auto& [address, acc] : addresses) {
+		auto script = address_script(address);
+		if(!script)
+			throw std::runtime_error("invalid deposit address " + address);
+		scripts[*script] = acc;
+	}
+	cfg.threads = std::max(1u, cfg.threads);
+	cfg.batch = std::max<size_t>(1, cfg.batch);
+}
+
+std::vector<deposit> watcher::match(const block& b, int64_t height, std::vector<std::string>& conflicts) const {
+	std::vector<deposit> result;
+	for(const auto& tx : b.transactions) {
+		std::map<std::pair<name, symbol_code>, int64_t> paid;
+		for(const auto& o : tx.outputs) {
+			auto itr = scripts.find(o.script);
+			if(itr != scripts.end())
+				paid[{itr->second.user, itr->second.sym}] += o.satoshi;
+		}
+		if(paid.size() > 1)
+			conflicts.push_back(tx.txid);
+		else if(paid.size() == 1)
+			result.push_back({tx.txid, {paid.begin()->first.first, paid.begin()->first.second}, paid.begin()->second, height});
+	}
+	return result;
+}
+
+bool watcher::already_minted(const deposit& d) const {
+	mint_orders orders(custodian, d.to.sym.raw());
+	auto bytes = from_hex(d.txid);
+	std::array<uint8_t, 32> txid;
+	std::copy(bytes.begin(), bytes.end(), txid.begin());
+	auto index = orders.get_index<name("btctxid")>();
+	return index.find(eosio::checksum256(txid)) != index.end();
+}
+
+std::set<std::string> watcher::mint(const std::vector<deposit>& confirmed, scan_report& report) {
+	std::vector<deposit> todo;
+	for(const auto& d : confirmed) {
+		if(already_minted(d))
+			report.duplicates++;
+		else
+			todo.push_back(d);
+	}
+
+	auto action = [&](const deposit& d) {
+		return host::make_action(custodian, name("mint"), custodian, d.to.user, d.to.sym, d.satoshi, d.txid);
+	};
+	std::set<std::string> failed;
+	for(size_t first = 0; first < todo.size(); first += cfg.batch) {
+		size_t last = std::min(todo.size(), first + cfg.batch);
+		std::vector<host::packed_action> actions;
+		for(size_t i = first; i < last; i++)
+			actions.push_back(action(todo[i]));
+		report.transactions++;
+		if(host::push_transaction(actions)) {
+			report.minted += last - first;
+			continue;
+		}
+		// one rejected mint reverts the whole batch, the rest are minted one by one
+		for(size_t i = first; i < last; i++) {
+			report.transactions++;
+			auto result = host::push_transaction({action(todo[i])});
+			if(result)
+				report.minted++;
+			else {
+				report.errors.push_back(todo[i].txid + ": " + result.error);
+				failed.insert(todo[i].txid);
+			}
+		}
+	}
+	return failed;
+}
+
+scan_report watcher::poll() {
+	scan_report report;
+	report.tip = source.tip();
+
+	// drop blocks which are not in the best chain anymore
+	while(!scanned.empty()) {
+		auto last = std::prev(scanned.end());
+		if(last->first <= report.tip && source.hash(last->first) == last->second.hash)
+			break;
+		if(last->second.minted)
+			for(const auto& d : last->second.deposits)
+				report.deep_reorgs.push_back(d.txid);
+		report.reorged++;
+		scanned.erase(last);
+	}
+
+	// blocks are fetched and decoded ahead by up to 'threads' tasks, and applied in order
+	struct fetched {
+		scanned_block            b;
+		std::string              prev;
+		std::vector<std::string> conflicts;
+	};
+	auto fetch = [this](int64_t height) {
+		fetched f;
+		f.b.hash = source.hash(height);
+		if(f.b.hash.empty())
+			return f;
+		block b = parse_block(source.raw(f.b.hash));
+		if(b.hash != f.b.hash)
+			throw std::runtime_error("block at height " + std::to_string(height) + " has hash " + b.hash + " instead of " + f.b.hash);
+		f.prev = b.prev;
+		f.b.deposits = match(b, height, f.conflicts);
+		return f;
+	};
+	int64_t next = scanned.empty() ? first_height : scanned.rbegin()->first + 1;
+	std::deque<std::future<fetched>> ahead;
+	int64_t queued = next;
+	while(next <= report.tip) {
+		while(queued <= report.tip && ahead.size() < cfg.threads)
+			ahead.push_back(std::async(std::launch::async, fetch, queued++));
+		fetched f = ahead.front().get();
+		ahead.pop_front();
+		// best chain changed while scanning, the next poll finds the fork
+		auto parent = scanned.find(next - 1);
+		if(f.b.hash.empty() || (parent != scanned.end() && parent->second.hash != f.prev))
+			break;
+		report.blocks++;
+		report.found += f.b.deposits.size();
+		report.conflicts.insert(report.conflicts.end(), f.conflicts.begin(), f.conflicts.end());
+		scanned[next++] = std::move(f.b);
+	}
+	for(auto& f : ahead)
+		f.wait();
+
+	std::vector<deposit> confirmed;
+	int64_t depth = report.tip - cfg.confirmations + 1;
+	for(auto& [height, b] : scanned)
+		if(height <= depth && !b.minted)
+			confirmed.insert(confirmed.end(), b.deposits.begin(), b.deposits.end());
+	auto failed = mint(confirmed, report);
+	for(auto& [height, b] : scanned)
+		if(height <= depth && !b.minted)
+			b.minted = std::none_of(b.deposits.begin(), b.deposits.end(), [&](const deposit& d) { return failed.count(d.txid); });
+
+	while(!scanned.empty() && scanned.begin()->second.minted && scanned.begin()->first < depth - kept_blocks) {
+		first_height = scanned.begin()->first + 1;
+		scanned.erase(scanned.begin());
+	}
+	return report;
+}
+
+std::vector<deposit> watcher::pending() const {
+	std::vector<deposit> result;
+	for(const auto& [height, b] : scanned)
+		if(!b.minted)
+			result.insert(result.end(), b.deposits.begin(), b.deposits.end());
+	return result;
+}
+
+} // namespace deposits
@@ -0,0 +1,183 @@
+/**
+ *  deposits.hpp -- BTC deposit watcher: scans bitcoin blocks and mints tokens of custodian
+ *
+ *  Blocks are read in raw serialization, as 'getblock <hash> 0' of bitcoind returns them, from
+ *  a block source: bitcoin-cli of local regtest node or recorded blocks. Outputs paying to
+ *  deposit addresses (base58 P2PKH and P2SH, the types validate_btc_address() accepts) become
+ *  deposits of mapped accounts. Deposits of a block are minted once the block has given number
+ *  of confirmations; blocks replaced by reorg are dropped with their unminted deposits.
+ *  custodian::mint keeps one order per txid and token, so outputs of a transaction to the same
+ *  account are minted as one order, and a transaction paying several accounts is reported as
+ *  a conflict and left to manual processing. Txids already in 'btctxid' index of 'mintorders'
+ *  are skipped, so restarted watcher may rescan from any height.
+ *  Blocks are fetched and decoded by worker threads, and applied in order of heights.
+ */
+#pragma once
+
+#include "chain.hpp"
+#include "sha256.hpp"
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace deposits {
+
+using eosio::name;
+using eosio::symbol_code;
+
+// double SHA-256 of concatenated parts, as bitcoin hashes blocks and transactions
+hash256 sha256d(const std::vector<std::pair<const uint8_t*, size_t>>& parts);
+
+std::string to_hex(const uint8_t* data, size_t size);
+
+// throws runtime_error on odd length or non-hex digits
+std::vector<uint8_t> from_hex(const std::string& hex);
+
+// output script of base58 address, nullopt if address is invalid
+std::optional<std::vector<uint8_t>> address_script(const std::string& address);
+
+// base58check address of 'version' byte (0x6f P2PKH or 0xc4 P2SH on testnet) and 20-byte hash
+std::string encode_address(uint8_t version, const std::array<uint8_t, 20>& hash);
+
+// hex of hash in bitcoin display order, reversed
+std::string display_hex(const hash256& hash);
+
+struct output {
+	uint32_t             index;
+	int64_t              satoshi;
+	std::vector<uint8_t> script;
+};
+
+struct transaction {
+	std::string         txid;        // display hex, as custodian::mint takes it
+	std::vector<output> outputs;
+};
+
+struct block {
+	std::string              hash;
+	std::string              prev;
+	std::vector<transaction> transactions;
+};
+
+// parses serialized block, segwit transactions included, throws runtime_error if it is malformed
+block parse_block(const std::vector<uint8_t>& raw);
+
+/**
+ * Best chain of bitcoin node. Functions are called by several threads at once.
+ */
+class block_source {
+public:
+	virtual ~block_source() = default;
+
+	// height of the best block, -1 for empty chain
+	virtual int64_t tip() = 0;
+
+	// hash of best chain block at height, empty if there is no block
+	virtual std::string hash(int64_t height) = 0;
+
+	// serialized block
+	virtual std::vector<uint8_t> raw(const std::string& hash) = 0;
+};
+
+/**
+ * Recorded blocks from the height of the first set() block. set() replaces block at height
+ * and drops all blocks above it, like a reorg.
+ */
+class recorded_chain : public block_source {
+public:
+	void set(int64_t height, std::vector<uint8_t> raw);
+
+	int64_t tip() override;
+	std::string hash(int64_t height) override;
+	std::vector<uint8_t> raw(const std::string& hash) override;
+
+private:
+	std::mutex                                   m;
+	int64_t                                      base = 0;
+	std::vector<std::string>                     best;        // hashes from 'base' height
+	std::map<std::string, std::vector<uint8_t>>  blocks;
+};
+
+/**
+ * Recorded blocks in file, a line "height hex" for every block in order of heights.
+ * File is read again, when it is changed.
+ */
+std::unique_ptr<block_source> fixture_source(const std::string& path);
+
+// bitcoind through given bitcoin-cli command line, e.g. "bitcoin-cli -regtest"
+std::unique_ptr<block_source> cli_source(const std::string& command);
+
+struct account {
+	name        user;
+	symbol_code sym;             // token minted for deposit: DBTC, DUSD or DPS
+};
+
+struct config {
+	int64_t  confirmations = 6;   // block with tip height has one confirmation
+	int64_t  start_height = 0;
+	unsigned threads = 4;
+	size_t   batch = 50;          // mint actions per transaction
+};
+
+struct deposit {
+	std::string txid;
+	account     to;
+	int64_t     satoshi;
+	int64_t     height;
+};
+
+struct scan_report {
+	int64_t                  tip = -1;
+	size_t                   blocks = 0;             // scanned blocks
+	size_t                   reorged = 0;            // dropped blocks
+	size_t                   found = 0;              // deposits found in scanned blocks
+	size_t                   minted = 0;
+	size_t                   duplicates = 0;         // already in mint orders
+	size_t                   transactions = 0;       // pushed mint transactions
+	std::vector<std::string> conflicts;              // txids paying several accounts
+	std::vector<std::string> errors;                 // "txid: message" of rejected mints
+	std::vector<std::string> deep_reorgs;            // minted txids of blocks dropped by reorg
+};
+
+class watcher {
+public:
+	watcher(block_source& source, std::map<std::string, account> addresses, config cfg, name custodian);
+
+	// scans new blocks and mints confirmed deposits
+	scan_report poll();
+
+	// deposits of scanned blocks waiting for confirmations
+	std::vector<deposit> pending() const;
+
+private:
+	struct scanned_block {
+		std::string          hash;
+		std::vector<deposit> deposits;
+		bool                 minted = false;
+	};
+
+	std::vector<deposit> match(const block& b, int64_t height, std::vector<std::string>& conflicts) const;
+	bool already_minted(const deposit& d) const;
+	// returns txids of rejected mints, these are retried by the next poll
+	std::set<std::string> mint(const std::vector<deposit>& confirmed, scan_report& report);
+
+	block_source&                          source;
+	std::map<std::vector<uint8_t>, account> scripts;
+	config                                 cfg;
+	name                                   custodian;
+	std::map<int64_t, scanned_block>       scanned;      // by height
+	int64_t                                first_height; // the next height to scan, when no blocks are kept
+};
+
+} // namespace deposits
@@ -0,0 +1,47 @@
+/**
+ *  dispatcher.hpp -- host counterpart of eosio::execute_action, used by contract 'apply' handlers
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace host {
+
+// argument types of contract method, as they are deserialized
+template<typename Method>
+struct action_args;
+
+template<typename Base, typename... Args>
+struct action_args<void (Base::*)(Args...)> {
+	using type = std::tuple<std::decay_t<Args>...>;
+};
+
+/**
+ * Deserialize action arguments and call contract method on a new contract object,
+ * as eosio.cdt does for every action and notification. The method is a template argument,
+ * so the call is direct and the compiler sees, that it does not go through a vtable of 'obj'.
+ */
+template<typename Contract, auto Method>
+void execute_action(eosio::name self, eosio::name code, const std::vector<char>& data) {
+	typename action_args<decltype(Method)>::type args;
+	eosio::datastream<const char*> ds(data.data(), data.size());
+	ds >> args;
+	Contract obj(self, code, eosio::datastream<const char*>(data.data(), data.size()));
+	std::apply([&](auto&... a) { (obj.*Method)(a...); }, args);
+}
+
+} // namespace host
+
+/**
+ * Dispatch 'action' to method of the same name, like EOSIO_DISPATCH does.
+ */
+#define HOST_DISPATCH_ACTION(CONTRACT, NAME) \
+	case eosio::name(#NAME).value: \
+		::host::execute_action<CONTRACT, &CONTRACT::NAME>(receiver, code, data); \
+		return;
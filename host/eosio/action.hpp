@@ -0,0 +1,72 @@
+/**
+ *  action.hpp -- host stand-in for eosio actions, authorization and notifications
+ */
+#pragma once
+
+#include <eosio/datastream.hpp>
+#include <eosio/intrinsics.hpp>
+#include <eosio/name.hpp>
+
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio {
+
+inline void require_auth(name n) { host::require_auth(n.value); }
+inline bool has_auth(name n) { return host::has_auth(n.value); }
+inline bool is_account(name n) { return host::is_account(n.value); }
+
+template<typename... Accounts>
+void require_recipient(name n, Accounts... more) {
+	host::require_recipient(n.value);
+	(host::require_recipient(name(more).value), ...);
+}
+
+struct permission_level {
+	permission_level() = default;
+	permission_level(name a, name p) : actor(a), permission(p) {}
+
+	name actor;
+	name permission;
+};
+
+struct action {
+	eosio::name                   account;
+	eosio::name                   name;
+	std::vector<permission_level> authorization;
+	std::vector<char>             data;
+
+	action() = default;
+
+	template<typename T>
+	action(const permission_level& auth, eosio::name a, eosio::name n, T&& value)
+		: account(a), name(n), authorization{auth}, data(pack(std::forward<T>(value))) {}
+
+	template<typename T>
+	action(std::vector<permission_level> auths, eosio::name a, eosio::name n, T&& value)
+		: account(a), name(n), authorization(std::move(auths)), data(pack(std::forward<T>(value))) {}
+
+	void send() const {
+		host::packed_action act{account.value, name.value, {}, data};
+		for(const auto& p : authorization)
+			act.authorization.emplace_back(p.actor.value, p.permission.value);
+		host::send_inline(std::move(act));
+	}
+};
+
+template<typename Method>
+struct inline_dispatcher;
+
+template<typename T, typename... Args>
+struct inline_dispatcher<void(T::*)(Args...)> {
+	static void call(name code, name act, std::vector<permission_level> perms, std::tuple<std::decay_t<Args>...> args) {
+		action(std::move(perms), code, act, std::move(args)).send();
+	}
+};
+
+} // namespace eosio
+
+#define SEND_INLINE_ACTION(CONTRACT, NAME, ...) \
+	::eosio::inline_dispatcher<decltype(&std::decay_t<decltype(CONTRACT)>::NAME)>::call( \
+		(CONTRACT).get_self(), ::eosio::name(#NAME), __VA_ARGS__)
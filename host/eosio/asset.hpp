@@ -0,0 +1,289 @@
+/**
+ *  asset.hpp -- host stand-in for eosio symbol and asset types
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace eosio {
+
+class symbol_code {
+public:
+	constexpr symbol_code() = default;
+	constexpr explicit symbol_code(uint64_t raw) : value(raw) {}
+
+	constexpr explicit symbol_code(std::string_view str) {
+		if(str.size() > 7)
+			check(false, "string is too long to be a valid symbol_code");
+		for(auto itr = str.rbegin(); itr != str.rend(); ++itr) {
+			if(*itr < 'A' || *itr > 'Z')
+				check(false, "only uppercase letters allowed in symbol_code string");
+			value <<= 8;
+			value |= *itr;
+		}
+	}
+
+	constexpr bool is_valid() const {
+		auto sym = value;
+		for(int i = 0; i < 7; i++) {
+			char c = (char)(sym & 0xFF);
+			if(!('A' <= c && c <= 'Z'))
+				return false;
+			sym >>= 8;
+			if(!(sym & 0xFF)) {
+				do {
+					sym >>= 8;
+					if((sym & 0xFF))
+						return false;
+					i++;
+				} while(i < 7);
+			}
+		}
+		return true;
+	}
+
+	constexpr uint32_t length() const {
+		auto sym = value;
+		uint32_t len = 0;
+		while(sym & 0xFF && len <= 7) {
+			len++;
+			sym >>= 8;
+		}
+		return len;
+	}
+
+	constexpr uint64_t raw() const { return value; }
+	constexpr explicit operator bool() const { return value != 0; }
+
+	std::string to_string() const {
+		std::string result;
+		auto v = value;
+		for(auto i = 0; i < 7; ++i, v >>= 8) {
+			if(v == 0)
+				break;
+			result += char(v & 0xFF);
+		}
+		return result;
+	}
+
+	friend constexpr bool operator==(const symbol_code& a, const symbol_code& b) { return a.value == b.value; }
+	friend constexpr bool operator!=(const symbol_code& a, const symbol_code& b) { return a.value != b.value; }
+	friend constexpr bool operator<(const symbol_code& a, const symbol_code& b) { return a.value < b.value; }
+
+private:
+	uint64_t value = 0;
+};
+
+class symbol {
+public:
+	constexpr symbol() = default;
+	constexpr explicit symbol(uint64_t s) : value(s) {}
+	constexpr symbol(symbol_code sc, uint8_t precision) : value((sc.raw() << 8) | (uint64_t)precision) {}
+	constexpr symbol(std::string_view ss, uint8_t precision) : value((symbol_code(ss).raw() << 8) | (uint64_t)precision) {}
+
+	constexpr bool is_valid() const { return code().is_valid(); }
+	constexpr uint8_t precision() const { return value & 0xFFull; }
+	constexpr symbol_code code() const { return symbol_code{value >> 8}; }
+	constexpr uint64_t raw() const { return value; }
+	constexpr explicit operator bool() const { return value != 0; }
+
+	std::string to_string() const { return std::to_string(precision()) + "," + code().to_string(); }
+
+	friend constexpr bool operator==(const symbol& a, const symbol& b) { return a.value == b.value; }
+	friend constexpr bool operator!=(const symbol& a, const symbol& b) { return a.value != b.value; }
+	friend constexpr bool operator<(const symbol& a, const symbol& b) { return a.value < b.value; }
+
+private:
+	uint64_t value = 0;
+};
+
+class extended_symbol {
+public:
+	constexpr extended_symbol() = default;
+	constexpr extended_symbol(symbol s, name con) : sym(s), contract(con) {}
+
+	constexpr symbol get_symbol() const { return sym; }
+	constexpr name get_contract() const { return contract; }
+
+	friend constexpr bool operator==(const extended_symbol& a, const extended_symbol& b) {
+		return a.sym == b.sym && a.contract == b.contract;
+	}
+	friend constexpr bool operator!=(const extended_symbol& a, const extended_symbol& b) { return !(a == b); }
+	friend constexpr bool operator<(const extended_symbol& a, const extended_symbol& b) {
+		return a.contract < b.contract || (a.contract == b.contract && a.sym < b.sym);
+	}
+
+	symbol sym;
+	name   contract;
+};
+
+struct asset {
+	int64_t       amount = 0;
+	eosio::symbol symbol;
+
+	static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+	asset() {}
+	asset(int64_t a, eosio::symbol s) : amount(a), symbol{s} {
+		check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+		check(symbol.is_valid(), "invalid symbol name");
+	}
+
+	bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+	bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+	void set_amount(int64_t a) {
+		amount = a;
+		check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+	}
+
+	asset operator-() const {
+		asset r = *this;
+		r.amount = -r.amount;
+		return r;
+	}
+
+	asset& operator-=(const asset& a) {
+		check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+		amount -= a.amount;
+		check(-max_amount <= amount, "subtraction underflow");
+		check(amount <= max_amount, "subtraction overflow");
+		return *this;
+	}
+
+	asset& operator+=(const asset& a) {
+		check(a.symbol == symbol, "attempt to add asset with different symbol");
+		amount += a.amount;
+		check(-max_amount <= amount, "addition underflow");
+		check(amount <= max_amount, "addition overflow");
+		return *this;
+	}
+
+	friend asset operator+(const asset& a, const asset& b) {
+		asset result = a;
+		result += b;
+		return result;
+	}
+
+	friend asset operator-(const asset& a, const asset& b) {
+		asset result = a;
+		result -= b;
+		return result;
+	}
+
+	asset& operator*=(int64_t a) {
+		int128_t tmp = (int128_t)amount * (int128_t)a;
+		check(tmp <= max_amount, "multiplication overflow");
+		check(tmp >= -max_amount, "multiplication underflow");
+		amount = (int64_t)tmp;
+		return *this;
+	}
+
+	friend asset operator*(const asset& a, int64_t b) {
+		asset result = a;
+		result *= b;
+		return result;
+	}
+
+	asset& operator/=(int64_t a) {
+		check(a != 0, "divide by zero");
+		check(!(amount == std::numeric_limits<int64_t>::min() && a == -1), "signed division overflow");
+		amount /= a;
+		return *this;
+	}
+
+	friend asset operator/(const asset& a, int64_t b) {
+		asset result = a;
+		result /= b;
+		return result;
+	}
+
+	friend bool operator==(const asset& a, const asset& b) {
+		check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+		return a.amount == b.amount;
+	}
+	friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+	friend bool operator<(const asset& a, const asset& b) {
+		check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+		return a.amount < b.amount;
+	}
+	friend bool operator<=(const asset& a, const asset& b) { return !(b < a); }
+	friend bool operator>(const asset& a, const asset& b) { return b < a; }
+	friend bool operator>=(const asset& a, const asset& b) { return !(a < b); }
+
+	std::string to_string() const {
+		int64_t p = (int64_t)symbol.precision();
+		int64_t p10 = 1;
+		for(int64_t i = 0; i < p; i++)
+			p10 *= 10;
+		bool negative = amount < 0;
+		uint64_t invert = negative ? uint64_t(-amount) : uint64_t(amount);
+		std::string result = std::to_string(invert / p10);
+		if(p > 0) {
+			std::string fraction = std::to_string(invert % p10);
+			result += "." + std::string(p - fraction.size(), '0') + fraction;
+		}
+		return (negative ? "-" : "") + result + " " + symbol.code().to_string();
+	}
+
+private:
+	using int128_t = __int128;
+};
+
+struct extended_asset {
+	asset quantity;
+	name  contract;
+
+	extended_asset() = default;
+	extended_asset(int64_t v, extended_symbol s) : quantity(v, s.get_symbol()), contract(s.get_contract()) {}
+	extended_asset(asset a, name c) : quantity(a), contract(c) {}
+
+	extended_symbol get_extended_symbol() const { return extended_symbol{quantity.symbol, contract}; }
+
+	extended_asset operator-() const { return {-quantity, contract}; }
+
+	friend extended_asset operator-(const extended_asset& a, const extended_asset& b) {
+		check(a.contract == b.contract, "type mismatch");
+		return {a.quantity - b.quantity, a.contract};
+	}
+	friend extended_asset operator+(const extended_asset& a, const extended_asset& b) {
+		check(a.contract == b.contract, "type mismatch");
+		return {a.quantity + b.quantity, a.contract};
+	}
+	extended_asset& operator+=(const extended_asset& b) {
+		check(contract == b.contract, "type mismatch");
+		quantity += b.quantity;
+		return *this;
+	}
+	extended_asset& operator-=(const extended_asset& b) {
+		check(contract == b.contract, "type mismatch");
+		quantity -= b.quantity;
+		return *this;
+	}
+
+	friend bool operator<(const extended_asset& a, const extended_asset& b) {
+		check(a.contract == b.contract, "type mismatch");
+		return a.quantity < b.quantity;
+	}
+	friend bool operator==(const extended_asset& a, const extended_asset& b) {
+		return std::tie(a.quantity, a.contract) == std::tie(b.quantity, b.contract);
+	}
+	friend bool operator!=(const extended_asset& a, const extended_asset& b) { return !(a == b); }
+	friend bool operator<=(const extended_asset& a, const extended_asset& b) {
+		check(a.contract == b.contract, "type mismatch");
+		return a.quantity <= b.quantity;
+	}
+	friend bool operator>=(const extended_asset& a, const extended_asset& b) {
+		check(a.contract == b.contract, "type mismatch");
+		return a.quantity >= b.quantity;
+	}
+};
+
+} // namespace eosio
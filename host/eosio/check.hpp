@@ -0,0 +1,26 @@
+/**
+ *  check.hpp -- host stand-in for eosio::check
+ *  A failed check throws, the host chain catches it and reverts the transaction.
+ */
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+namespace eosio {
+
+struct eosio_assert_exception : std::runtime_error {
+	using std::runtime_error::runtime_error;
+};
+
+inline void check(bool pred, const char* msg) {
+	if(!pred)
+		throw eosio_assert_exception(msg);
+}
+
+inline void check(bool pred, const std::string& msg) {
+	if(!pred)
+		throw eosio_assert_exception(msg);
+}
+
+} // namespace eosio
@@ -0,0 +1,56 @@
+/**
+ *  crypto.hpp -- host stand-in for eosio::checksum256 and eosio::sha256
+ */
+#pragma once
+
+#include "../sha256.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace eosio {
+
+/**
+ * Same layout as eosio::fixed_bytes<32>: two 128-bit words, bytes are packed into words big-endian.
+ */
+class checksum256 {
+public:
+	using word_t = unsigned __int128;
+
+	checksum256() : _data() {}
+	checksum256(const std::array<word_t, 2>& words) : _data(words) {}
+	checksum256(const std::array<uint8_t, 32>& bytes) : _data() {
+		for(size_t i = 0; i < 32; i++) {
+			_data[i / 16] <<= 8;
+			_data[i / 16] |= bytes[i];
+		}
+	}
+
+	static constexpr size_t size() { return 2; }
+	word_t* data() { return _data.data(); }
+	const word_t* data() const { return _data.data(); }
+	const std::array<word_t, 2>& get_array() const { return _data; }
+
+	std::array<uint8_t, 32> extract_as_byte_array() const {
+		std::array<uint8_t, 32> bytes;
+		for(size_t i = 0; i < 32; i++)
+			bytes[i] = uint8_t(_data[i / 16] >> (8 * (15 - i % 16)));
+		return bytes;
+	}
+
+	friend bool operator==(const checksum256& a, const checksum256& b) { return a._data == b._data; }
+	friend bool operator!=(const checksum256& a, const checksum256& b) { return a._data != b._data; }
+	friend bool operator<(const checksum256& a, const checksum256& b) { return a._data < b._data; }
+	friend bool operator>(const checksum256& a, const checksum256& b) { return b._data < a._data; }
+	friend bool operator<=(const checksum256& a, const checksum256& b) { return !(b._data < a._data); }
+	friend bool operator>=(const checksum256& a, const checksum256& b) { return !(a._data < b._data); }
+
+private:
+	std::array<word_t, 2> _data;
+};
+
+inline checksum256 sha256(const char* data, uint32_t length) {
+	return checksum256(::sha256(reinterpret_cast<const uint8_t*>(data), length));
+}
+
+} // namespace eosio
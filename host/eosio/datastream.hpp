@@ -0,0 +1,302 @@
+/**
+ *  datastream.hpp -- host stand-in for eosio::datastream, pack() and unpack()
+ *  Binary format follows eosio: little-endian integers, varuint32 sizes of strings and vectors.
+ *  Aggregates (tables and action structs) are serialized field by field, like eosio.cdt does it
+ *  with its reflection. Aggregates with base classes need their own operator<< and operator>>.
+ */
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/name.hpp>
+#include <eosio/system.hpp>
+
+#include <array>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+template<typename Stream>
+class datastream;
+
+template<>
+class datastream<const char*> {
+public:
+	datastream(const char* start, size_t size) : _pos(start), _end(start + size) {}
+
+	void read(char* d, size_t s) {
+		check(size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+		memcpy(d, _pos, s);
+		_pos += s;
+	}
+
+	size_t remaining() const { return _end - _pos; }
+
+private:
+	const char* _pos;
+	const char* _end;
+};
+
+template<>
+class datastream<std::vector<char>> {
+public:
+	void write(const char* d, size_t s) { _buf.insert(_buf.end(), d, d + s); }
+
+	std::vector<char>& buffer() { return _buf; }
+
+private:
+	std::vector<char> _buf;
+};
+
+namespace reflect {
+
+	struct any_field {
+		template<typename T>
+		operator T&() const;
+	};
+
+	template<typename T, typename Seq, typename = void>
+	struct brace_constructible : std::false_type {};
+
+	template<typename T, size_t... I>
+	struct brace_constructible<T, std::index_sequence<I...>,
+		std::void_t<decltype(T{ (void(I), any_field{})... })>> : std::true_type {};
+
+	template<typename T, size_t N = 16>
+	constexpr size_t field_count() {
+		if constexpr(N == 0)
+			return 0;
+		else if constexpr(brace_constructible<T, std::make_index_sequence<N>>::value)
+			return N;
+		else
+			return field_count<T, N - 1>();
+	}
+
+	template<typename T, typename F>
+	void for_each_field(T& t, F&& f) {
+		constexpr size_t n = field_count<std::remove_const_t<T>>();
+		static_assert(n > 0 && n <= 12, "unsupported number of fields");
+		if constexpr(n == 1) { auto& [a] = t; f(a); }
+		else if constexpr(n == 2) { auto& [a, b] = t; f(a); f(b); }
+		else if constexpr(n == 3) { auto& [a, b, c] = t; f(a); f(b); f(c); }
+		else if constexpr(n == 4) { auto& [a, b, c, d] = t; f(a); f(b); f(c); f(d); }
+		else if constexpr(n == 5) { auto& [a, b, c, d, e] = t; f(a); f(b); f(c); f(d); f(e); }
+		else if constexpr(n == 6) { auto& [a, b, c, d, e, g] = t; f(a); f(b); f(c); f(d); f(e); f(g); }
+		else if constexpr(n == 7) { auto& [a, b, c, d, e, g, h] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); }
+		else if constexpr(n == 8) { auto& [a, b, c, d, e, g, h, i] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); }
+		else if constexpr(n == 9) { auto& [a, b, c, d, e, g, h, i, j] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); }
+		else if constexpr(n == 10) { auto& [a, b, c, d, e, g, h, i, j, k] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); }
+		else if constexpr(n == 11) { auto& [a, b, c, d, e, g, h, i, j, k, l] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); }
+		else { auto& [a, b, c, d, e, g, h, i, j, k, l, m] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); }
+	}
+
+	template<typename T>
+	constexpr bool is_reflected = std::is_aggregate_v<T> && std::is_class_v<T>;
+
+	template<typename T>
+	constexpr bool is_raw = std::is_arithmetic_v<T> || std::is_same_v<T, __int128> || std::is_same_v<T, unsigned __int128>;
+
+} // namespace reflect
+
+/*
+ * integers, floating point and bool
+ */
+template<typename Stream, typename T, std::enable_if_t<reflect::is_raw<T>, int> = 0>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const T& v) {
+	ds.write(reinterpret_cast<const char*>(&v), sizeof(v));
+	return ds;
+}
+
+template<typename T, std::enable_if_t<reflect::is_raw<T>, int> = 0>
+datastream<const char*>& operator>>(datastream<const char*>& ds, T& v) {
+	ds.read(reinterpret_cast<char*>(&v), sizeof(v));
+	return ds;
+}
+
+template<typename Stream>
+void write_varuint32(datastream<Stream>& ds, uint32_t v) {
+	do {
+		uint8_t b = uint8_t(v & 0x7f);
+		v >>= 7;
+		b |= ((v > 0) << 7);
+		ds.write(reinterpret_cast<const char*>(&b), 1);
+	} while(v);
+}
+
+inline uint32_t read_varuint32(datastream<const char*>& ds) {
+	uint32_t v = 0;
+	uint8_t b = 0;
+	int by = 0;
+	do {
+		check(by < 35, "varuint32 is too long");
+		ds.read(reinterpret_cast<char*>(&b), 1);
+		v |= uint32_t(b & 0x7f) << by;
+		by += 7;
+	} while(b & 0x80);
+	return v;
+}
+
+/*
+ * eosio types
+ */
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const name& v) { return ds << v.value; }
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, name& v) { return ds >> v.value; }
+
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const symbol_code& v) { return ds << v.raw(); }
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, symbol_code& v) {
+	uint64_t raw;
+	ds >> raw;
+	v = symbol_code(raw);
+	return ds;
+}
+
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const symbol& v) { return ds << v.raw(); }
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, symbol& v) {
+	uint64_t raw;
+	ds >> raw;
+	v = symbol(raw);
+	return ds;
+}
+
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const extended_symbol& v) { return ds << v.sym << v.contract; }
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, extended_symbol& v) { return ds >> v.sym >> v.contract; }
+
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const asset& v) { return ds << v.amount << v.symbol; }
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, asset& v) { return ds >> v.amount >> v.symbol; }
+
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const extended_asset& v) { return ds << v.quantity << v.contract; }
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, extended_asset& v) { return ds >> v.quantity >> v.contract; }
+
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const microseconds& v) { return ds << v._count; }
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, microseconds& v) { return ds >> v._count; }
+
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const time_point& v) { return ds << v.elapsed; }
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, time_point& v) { return ds >> v.elapsed; }
+
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const time_point_sec& v) { return ds << v.utc_seconds; }
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, time_point_sec& v) { return ds >> v.utc_seconds; }
+
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const checksum256& v) {
+	auto bytes = v.extract_as_byte_array();
+	ds.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	return ds;
+}
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, checksum256& v) {
+	std::array<uint8_t, 32> bytes;
+	ds.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+	v = checksum256(bytes);
+	return ds;
+}
+
+/*
+ * standard containers
+ */
+template<typename Stream>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const std::string& v) {
+	write_varuint32(ds, uint32_t(v.size()));
+	ds.write(v.data(), v.size());
+	return ds;
+}
+inline datastream<const char*>& operator>>(datastream<const char*>& ds, std::string& v) {
+	v.resize(read_varuint32(ds));
+	ds.read(v.data(), v.size());
+	return ds;
+}
+
+template<typename Stream, typename T>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const std::vector<T>& v) {
+	write_varuint32(ds, uint32_t(v.size()));
+	for(const auto& i : v)
+		ds << i;
+	return ds;
+}
+template<typename T>
+datastream<const char*>& operator>>(datastream<const char*>& ds, std::vector<T>& v) {
+	uint32_t size = read_varuint32(ds);
+	check(size <= ds.remaining(), "vector size is out of range");
+	v.resize(size);
+	for(auto& i : v)
+		ds >> i;
+	return ds;
+}
+
+template<typename Stream, typename T, size_t N>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const std::array<T, N>& v) {
+	for(const auto& i : v)
+		ds << i;
+	return ds;
+}
+template<typename T, size_t N>
+datastream<const char*>& operator>>(datastream<const char*>& ds, std::array<T, N>& v) {
+	for(auto& i : v)
+		ds >> i;
+	return ds;
+}
+
+template<typename Stream, typename A, typename B>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const std::pair<A, B>& v) { return ds << v.first << v.second; }
+template<typename A, typename B>
+datastream<const char*>& operator>>(datastream<const char*>& ds, std::pair<A, B>& v) { return ds >> v.first >> v.second; }
+
+template<typename Stream, typename... Args>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const std::tuple<Args...>& v) {
+	std::apply([&](const auto&... i) { (void)(ds << ... << i); }, v);
+	return ds;
+}
+template<typename... Args>
+datastream<const char*>& operator>>(datastream<const char*>& ds, std::tuple<Args...>& v) {
+	std::apply([&](auto&... i) { (void)(ds >> ... >> i); }, v);
+	return ds;
+}
+
+/*
+ * aggregates: table rows and action structs
+ */
+template<typename Stream, typename T, std::enable_if_t<reflect::is_reflected<T>, int> = 0>
+datastream<Stream>& operator<<(datastream<Stream>& ds, const T& v) {
+	reflect::for_each_field(v, [&](const auto& f) { ds << f; });
+	return ds;
+}
+template<typename T, std::enable_if_t<reflect::is_reflected<T>, int> = 0>
+datastream<const char*>& operator>>(datastream<const char*>& ds, T& v) {
+	reflect::for_each_field(v, [&](auto& f) { ds >> f; });
+	return ds;
+}
+
+template<typename T>
+std::vector<char> pack(const T& v) {
+	datastream<std::vector<char>> ds;
+	ds << v;
+	return std::move(ds.buffer());
+}
+
+template<typename T>
+T unpack(const char* buffer, size_t len) {
+	T result{};
+	datastream<const char*> ds(buffer, len);
+	ds >> result;
+	return result;
+}
+
+template<typename T>
+T unpack(const std::vector<char>& bytes) {
+	return unpack<T>(bytes.data(), bytes.size());
+}
+
+} // namespace eosio
@@ -0,0 +1,24 @@
+/**
+ *  eosio.hpp -- host stand-in for eosio.cdt umbrella header
+ *  ACTION, TABLE and CONTRACT drop eosio.cdt attributes, host has no ABI to generate. Notification
+ *  handlers keep [[eosio::on_notify]], host compiler is told to ignore it (see Makefile).
+ */
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+#include <eosio/contract.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+#include <eosio/print.hpp>
+#include <eosio/system.hpp>
+
+using int128_t  = __int128;
+using uint128_t = unsigned __int128;
+
+#define ACTION   void
+#define TABLE    struct
+#define CONTRACT class
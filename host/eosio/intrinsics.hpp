@@ -0,0 +1,66 @@
+/**
+ *  intrinsics.hpp -- host side of chain API, implemented by host/chain.cpp
+ *  All names are passed as raw uint64_t values, so this header does not depend on eosio types.
+ */
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace host {
+
+// microseconds since epoch
+uint64_t current_time();
+
+void require_auth(uint64_t account);
+bool has_auth(uint64_t account);
+bool is_account(uint64_t account);
+void require_recipient(uint64_t account);
+uint64_t current_receiver();
+
+struct packed_action {
+	uint64_t                                    account;
+	uint64_t                                    name;
+	std::vector<std::pair<uint64_t, uint64_t>>  authorization;
+	std::vector<char>                           data;
+};
+
+void send_inline(packed_action act);
+
+bool print_enabled();
+void prints(std::string_view str);
+
+/**
+ * Rows of one table, stored serialized like on chain. Secondary keys are encoded so that
+ * byte order is the same as key order, each index keeps (key, primary key) pairs.
+ */
+struct db_row {
+	std::vector<char>         data;
+	uint64_t                  payer;
+	std::vector<std::string>  secondary;
+};
+
+using db_index = std::set<std::pair<std::string, uint64_t>>;
+
+struct db_table {
+	std::map<uint64_t, db_row> rows;
+	std::vector<db_index>      indices;
+};
+
+// returns nullptr, if table has never been written
+const db_table* db_find_table(uint64_t code, uint64_t scope, uint64_t table);
+
+// row of the table in current transaction, returns nullptr, if there is no such row
+const db_row* db_get(uint64_t code, uint64_t scope, uint64_t table, uint64_t pk);
+
+// writes are allowed to current receiver only, every write is recorded for transaction rollback
+void db_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t pk, std::vector<char> data, std::vector<std::string> secondary);
+void db_update(uint64_t scope, uint64_t table, uint64_t payer, uint64_t pk, std::vector<char> data, std::vector<std::string> secondary);
+void db_remove(uint64_t scope, uint64_t table, uint64_t pk);
+
+} // namespace host
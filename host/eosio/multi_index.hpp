@@ -0,0 +1,404 @@
+/**
+ *  multi_index.hpp -- host stand-in for eosio::multi_index over in-memory tables of host/chain.cpp
+ *  Rows are kept serialized, so contracts reading each other's tables with their own row types
+ *  see the same bytes as on chain. Like in eosio.cdt, each multi_index object caches rows it
+ *  has read, and references returned by get() or iterators stay valid until the row is erased.
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/intrinsics.hpp>
+#include <eosio/name.hpp>
+
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio {
+
+constexpr name same_payer{};
+
+template<name::raw IndexName, typename Extractor>
+struct indexed_by {
+	static constexpr name index_name = name(IndexName);
+	using extractor = Extractor;
+};
+
+template<class Class, typename Type, Type (Class::*PtrToMemberFunction)() const>
+struct const_mem_fun {
+	using result_type = std::decay_t<Type>;
+
+	template<typename T>
+	result_type operator()(const T& obj) const { return (obj.*PtrToMemberFunction)(); }
+};
+
+namespace detail {
+
+	// secondary keys are encoded big-endian, so byte order of encoded keys is the same as key order
+	inline std::string secondary_key(uint64_t v) {
+		std::string key(8, '\0');
+		for(int i = 7; i >= 0; i--, v >>= 8)
+			key[i] = char(v & 0xff);
+		return key;
+	}
+
+	inline std::string secondary_key(unsigned __int128 v) {
+		std::string key(16, '\0');
+		for(int i = 15; i >= 0; i--, v >>= 8)
+			key[i] = char(v & 0xff);
+		return key;
+	}
+
+	inline std::string secondary_key(const checksum256& v) {
+		auto bytes = v.extract_as_byte_array();
+		return std::string(bytes.begin(), bytes.end());
+	}
+
+} // namespace detail
+
+template<name::raw TableName, typename T, typename... Indices>
+class multi_index {
+public:
+	class const_iterator {
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type        = const T;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const T*;
+		using reference         = const T&;
+
+		const_iterator() = default;
+
+		const T& operator*() const {
+			check(_mi && !_end, "cannot dereference end iterator");
+			return _mi->load(_pk);
+		}
+		const T* operator->() const { return &**this; }
+
+		const_iterator& operator++() {
+			check(_mi && !_end, "cannot increment end iterator");
+			const auto& rows = _mi->rows();
+			auto itr = rows.upper_bound(_pk);
+			_end = itr == rows.end();
+			if(!_end)
+				_pk = itr->first;
+			return *this;
+		}
+		const_iterator operator++(int) {
+			const_iterator result = *this;
+			++*this;
+			return result;
+		}
+
+		const_iterator& operator--() {
+			check(_mi != nullptr, "cannot decrement iterator at beginning of table");
+			const auto& rows = _mi->rows();
+			auto itr = _end ? rows.end() : rows.lower_bound(_pk);
+			check(itr != rows.begin(), "cannot decrement iterator at beginning of table");
+			--itr;
+			_pk = itr->first;
+			_end = false;
+			return *this;
+		}
+		const_iterator operator--(int) {
+			const_iterator result = *this;
+			--*this;
+			return result;
+		}
+
+		friend bool operator==(const const_iterator& a, const const_iterator& b) {
+			return a._mi == b._mi && a._end == b._end && (a._end || a._pk == b._pk);
+		}
+		friend bool operator!=(const const_iterator& a, const const_iterator& b) { return !(a == b); }
+
+	private:
+		friend class multi_index;
+
+		const_iterator(const multi_index* mi, uint64_t pk, bool end) : _mi(mi), _pk(pk), _end(end) {}
+
+		const multi_index* _mi = nullptr;
+		uint64_t           _pk = 0;
+		bool               _end = true;
+	};
+
+	template<name::raw IndexName, typename Extractor, size_t Number>
+	class index {
+	public:
+		using secondary_key_type = typename Extractor::result_type;
+
+		class const_iterator {
+		public:
+			using iterator_category = std::bidirectional_iterator_tag;
+			using value_type        = const T;
+			using difference_type   = std::ptrdiff_t;
+			using pointer           = const T*;
+			using reference         = const T&;
+
+			const_iterator() = default;
+
+			const T& operator*() const {
+				check(_idx && !_end, "cannot dereference end iterator");
+				return _idx->_mi->load(_pk);
+			}
+			const T* operator->() const { return &**this; }
+
+			const_iterator& operator++() {
+				check(_idx && !_end, "cannot increment end iterator");
+				const auto* idx = _idx->entries();
+				auto itr = idx->upper_bound({_key, _pk});
+				set(idx, itr);
+				return *this;
+			}
+			const_iterator operator++(int) {
+				const_iterator result = *this;
+				++*this;
+				return result;
+			}
+
+			const_iterator& operator--() {
+				const auto* idx = _idx ? _idx->entries() : nullptr;
+				check(idx != nullptr, "cannot decrement iterator at beginning of index");
+				auto itr = _end ? idx->end() : idx->lower_bound({_key, _pk});
+				check(itr != idx->begin(), "cannot decrement iterator at beginning of index");
+				set(idx, --itr);
+				return *this;
+			}
+			const_iterator operator--(int) {
+				const_iterator result = *this;
+				--*this;
+				return result;
+			}
+
+			friend bool operator==(const const_iterator& a, const const_iterator& b) {
+				return a._idx == b._idx && a._end == b._end && (a._end || (a._pk == b._pk && a._key == b._key));
+			}
+			friend bool operator!=(const const_iterator& a, const const_iterator& b) { return !(a == b); }
+
+		private:
+			friend class index;
+
+			const_iterator(const index* idx) : _idx(idx) {}
+
+			void set(const host::db_index* idx, host::db_index::const_iterator itr) {
+				_end = itr == idx->end();
+				if(!_end) {
+					_key = itr->first;
+					_pk  = itr->second;
+				}
+			}
+
+			const index* _idx = nullptr;
+			std::string  _key;
+			uint64_t     _pk = 0;
+			bool         _end = true;
+		};
+
+		const_iterator begin() const { return make(entries() ? entries()->begin() : host::db_index::const_iterator()); }
+		const_iterator end() const { return const_iterator(this); }
+		const_iterator cbegin() const { return begin(); }
+		const_iterator cend() const { return end(); }
+
+		const_iterator lower_bound(const secondary_key_type& key) const {
+			const auto* idx = entries();
+			if(!idx)
+				return end();
+			return make(idx->lower_bound({detail::secondary_key(key), 0}));
+		}
+
+		const_iterator upper_bound(const secondary_key_type& key) const {
+			const auto* idx = entries();
+			if(!idx)
+				return end();
+			return make(idx->upper_bound({detail::secondary_key(key), std::numeric_limits<uint64_t>::max()}));
+		}
+
+		const_iterator find(const secondary_key_type& key) const {
+			auto itr = lower_bound(key);
+			if(itr != end() && itr._key != detail::secondary_key(key))
+				return end();
+			return itr;
+		}
+
+		const T& get(const secondary_key_type& key, const char* error_msg = "unable to find secondary key") const {
+			auto itr = find(key);
+			check(itr != end(), error_msg);
+			return *itr;
+		}
+
+	private:
+		friend class multi_index;
+
+		index(const multi_index* mi) : _mi(mi) {}
+
+		const host::db_index* entries() const {
+			const auto* table = _mi->table();
+			if(!table || table->indices.size() <= Number)
+				return nullptr;
+			return &table->indices[Number];
+		}
+
+		const_iterator make(host::db_index::const_iterator itr) const {
+			const_iterator result(this);
+			if(entries())
+				result.set(entries(), itr);
+			return result;
+		}
+
+		const multi_index* _mi;
+	};
+
+	multi_index(name code, uint64_t scope) : _code(code), _scope(scope) {}
+
+	multi_index(const multi_index&) = delete;
+	multi_index& operator=(const multi_index&) = delete;
+
+	name get_code() const { return _code; }
+	uint64_t get_scope() const { return _scope; }
+
+	const_iterator begin() const {
+		const auto& r = rows();
+		return r.empty() ? end() : const_iterator(this, r.begin()->first, false);
+	}
+	const_iterator end() const { return const_iterator(this, 0, true); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+
+	const_iterator lower_bound(uint64_t pk) const { return make(rows().lower_bound(pk)); }
+	const_iterator upper_bound(uint64_t pk) const { return make(rows().upper_bound(pk)); }
+
+	const_iterator find(uint64_t pk) const {
+		const auto& r = rows();
+		return r.count(pk) ? const_iterator(this, pk, false) : end();
+	}
+
+	const_iterator require_find(uint64_t pk, const char* error_msg = "unable to find key") const {
+		auto itr = find(pk);
+		check(itr != end(), error_msg);
+		return itr;
+	}
+
+	const T& get(uint64_t pk, const char* error_msg = "unable to find key") const {
+		auto itr = find(pk);
+		check(itr != end(), error_msg);
+		return *itr;
+	}
+
+	uint64_t available_primary_key() const {
+		const auto& r = rows();
+		if(r.empty())
+			return 0;
+		uint64_t last = r.rbegin()->first;
+		check(last < std::numeric_limits<uint64_t>::max() - 1, "next primary key in table is at autoincrement limit");
+		return last + 1;
+	}
+
+	template<typename Lambda>
+	const_iterator emplace(name payer, Lambda&& constructor) {
+		check_write();
+		auto obj = std::make_unique<T>();
+		constructor(*obj);
+		uint64_t pk = obj->primary_key();
+		check(!rows().count(pk), "could not insert object, most likely a uniqueness constraint was violated");
+		host::db_store(_scope, uint64_t(TableName), payer.value, pk, pack(*obj), secondary_keys(*obj));
+		_cache[pk] = std::move(obj);
+		return const_iterator(this, pk, false);
+	}
+
+	template<typename Lambda>
+	void modify(const_iterator itr, name payer, Lambda&& updater) {
+		check(itr != end(), "cannot pass end iterator to modify");
+		modify(*itr, payer, std::forward<Lambda>(updater));
+	}
+
+	template<typename Lambda>
+	void modify(const T& obj, name payer, Lambda&& updater) {
+		check_write();
+		uint64_t pk = obj.primary_key();
+		auto cached = _cache.find(pk);
+		check(cached != _cache.end() && cached->second.get() == &obj, "object passed to modify is not in multi_index");
+		T& mutable_obj = *cached->second;
+		updater(mutable_obj);
+		check(mutable_obj.primary_key() == pk, "updater cannot change primary key when modifying an object");
+		host::db_update(_scope, uint64_t(TableName), payer.value, pk, pack(mutable_obj), secondary_keys(mutable_obj));
+	}
+
+	const_iterator erase(const_iterator itr) {
+		check(itr != end(), "cannot pass end iterator to erase");
+		auto next = itr;
+		++next;
+		erase(*itr);
+		return next;
+	}
+
+	void erase(const T& obj) {
+		check_write();
+		uint64_t pk = obj.primary_key();
+		check(rows().count(pk), "attempt to remove object that was not in multi_index");
+		host::db_remove(_scope, uint64_t(TableName), pk);
+		_cache.erase(pk);
+	}
+
+	template<name::raw IndexName>
+	auto get_index() const {
+		constexpr size_t number = index_number<IndexName>();
+		static_assert(number < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index");
+		using indexed = std::tuple_element_t<number, std::tuple<Indices...>>;
+		return index<IndexName, typename indexed::extractor, number>(this);
+	}
+
+private:
+	template<name::raw IndexName>
+	static constexpr size_t index_number() {
+		constexpr uint64_t names[] = {Indices::index_name.value..., 0};
+		for(size_t i = 0; i < sizeof...(Indices); i++)
+			if(names[i] == uint64_t(IndexName))
+				return i;
+		return sizeof...(Indices);
+	}
+
+	const host::db_table* table() const {
+		return host::db_find_table(_code.value, _scope, uint64_t(TableName));
+	}
+
+	const std::map<uint64_t, host::db_row>& rows() const {
+		static const std::map<uint64_t, host::db_row> empty;
+		const auto* t = table();
+		return t ? t->rows : empty;
+	}
+
+	const_iterator make(std::map<uint64_t, host::db_row>::const_iterator itr) const {
+		return itr == rows().end() ? end() : const_iterator(this, itr->first, false);
+	}
+
+	const T& load(uint64_t pk) const {
+		auto cached = _cache.find(pk);
+		if(cached != _cache.end())
+			return *cached->second;
+		const auto* row = host::db_get(_code.value, _scope, uint64_t(TableName), pk);
+		check(row != nullptr, "unable to find key");
+		auto obj = std::make_unique<T>(unpack<T>(row->data));
+		return *(_cache[pk] = std::move(obj));
+	}
+
+	void check_write() const {
+		check(_code.value == host::current_receiver(), "db access violation");
+	}
+
+	static std::vector<std::string> secondary_keys(const T& obj) {
+		return {detail::secondary_key(typename Indices::extractor()(obj))...};
+	}
+
+	name     _code;
+	uint64_t _scope;
+	mutable std::map<uint64_t, std::unique_ptr<T>> _cache;
+};
+
+} // namespace eosio
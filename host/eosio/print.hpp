@@ -0,0 +1,64 @@
+/**
+ *  print.hpp -- host stand-in for eosio::print
+ *  Output goes to transaction console, nothing is formatted while printing is disabled.
+ */
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/intrinsics.hpp>
+#include <eosio/name.hpp>
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace eosio {
+
+namespace detail {
+
+	inline void print_to(std::string& out, const char* v) { out += v; }
+	inline void print_to(std::string& out, std::string_view v) { out += v; }
+	inline void print_to(std::string& out, const std::string& v) { out += v; }
+	inline void print_to(std::string& out, char v) { out += v; }
+	inline void print_to(std::string& out, bool v) { out += v ? "true" : "false"; }
+	inline void print_to(std::string& out, name v) { out += v.to_string(); }
+	inline void print_to(std::string& out, symbol_code v) { out += v.to_string(); }
+	inline void print_to(std::string& out, symbol v) { out += v.to_string(); }
+	inline void print_to(std::string& out, const asset& v) { out += v.to_string(); }
+	inline void print_to(std::string& out, const extended_asset& v) {
+		out += v.quantity.to_string() + "@" + v.contract.to_string();
+	}
+
+	inline void print_to(std::string& out, const checksum256& v) {
+		static const char digits[] = "0123456789abcdef";
+		for(auto b : v.extract_as_byte_array()) {
+			out += digits[b >> 4];
+			out += digits[b & 0xf];
+		}
+	}
+
+	inline void print_to(std::string& out, double v) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%.15e", v);
+		out += buf;
+	}
+
+	inline void print_to(std::string& out, float v) { print_to(out, double(v)); }
+
+	template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+	void print_to(std::string& out, T v) { out += std::to_string(v); }
+
+} // namespace detail
+
+template<typename... Args>
+void print(Args&&... args) {
+	if(!host::print_enabled())
+		return;
+	std::string out;
+	(detail::print_to(out, args), ...);
+	host::prints(out);
+}
+
+} // namespace eosio
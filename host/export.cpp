@@ -0,0 +1,159 @@
+/**
+ *  export.cpp -- columnar export of contract tables from history log
+ *  usage: export -f history.log -o dir [-t transaction] [-j threads] [-g group_rows]
+ *         export -p file.dcol
+ *
+ *  Replays history log (written by loadgen -d, see append_log() in indexer.hpp) into indexer
+ *  store and writes the next segment of every table of bank, custodian and eosio.token ABIs
+ *  to 'dir', see columnar.hpp. The first segment has all rows, every next run exports rows
+ *  changed after the last exported transaction, recorded in <dir>/MANIFEST, so an interrupted
+ *  or daily export resumes where the previous one stopped. -t limits export to transactions up
+ *  to given one. Row groups of 'group_rows' rows (default 65536) are encoded by -j threads.
+ *  -p prints columnar file as CSV.
+ */
+
+#include "columnar.hpp"
+#include "scenarios.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace scenarios;
+
+namespace {
+
+struct manifest_entry {
+	uint64_t segment;
+	uint64_t transaction;
+};
+
+// MANIFEST has a line "segment transaction" for every exported segment
+manifest_entry last_segment(const string& dir) {
+	manifest_entry last{0, 0};
+	ifstream in(dir + "/MANIFEST");
+	manifest_entry e;
+	while(in >> e.segment >> e.transaction)
+		last = e;
+	return last;
+}
+
+void print_file(const string& path) {
+	auto file = columnar::read_file(path);
+	printf("# %s::%s\n", file.code.to_string().c_str(), file.table.to_string().c_str());
+	for(size_t c = 0; c < file.columns.size(); c++)
+		printf("%s%s", c ? "," : "", file.columns[c].name.c_str());
+	printf("\n");
+	for(const auto& row : file.rows) {
+		for(size_t c = 0; c < row.size(); c++) {
+			string text;
+			switch(file.columns[c].type) {
+			case columnar::column_type::name:
+				text = name(get<uint64_t>(row[c])).to_string();
+				break;
+			case columnar::column_type::symbol:
+				text = "\"" + eosio::symbol(get<uint64_t>(row[c])).to_string() + "\"";
+				break;
+			case columnar::column_type::int64:
+				text = to_string(get<int64_t>(row[c]));
+				break;
+			case columnar::column_type::string:
+				text = "\"" + get<string>(row[c]) + "\"";
+				break;
+			default:
+				text = to_string(get<uint64_t>(row[c]));
+			}
+			printf("%s%s", c ? "," : "", text.c_str());
+		}
+		printf("\n");
+	}
+}
+
+void usage() {
+	cerr << "usage: export -f history.log -o dir [-t transaction] [-j threads] [-g group_rows]" << endl
+	     << "       export -p file.dcol" << endl;
+	exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	string log_file, dir, print;
+	uint64_t upto = UINT64_MAX;
+	unsigned threads = max(1u, thread::hardware_concurrency());
+	size_t group_rows = 65536;
+
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(i + 1 >= argc)
+			usage();
+		const char* value = argv[++i];
+		if(arg == "-f")
+			log_file = value;
+		else if(arg == "-o")
+			dir = value;
+		else if(arg == "-t")
+			upto = strtoull(value, nullptr, 10);
+		else if(arg == "-j")
+			threads = max(1, atoi(value));
+		else if(arg == "-g")
+			group_rows = max(1, atoi(value));
+		else if(arg == "-p")
+			print = value;
+		else
+			usage();
+	}
+
+	try {
+		if(!print.empty()) {
+			print_file(print);
+			return 0;
+		}
+		if(log_file.empty() || dir.empty())
+			usage();
+
+		map<name, const indexer::abi*> abis = {
+			{BANK_ACC, &indexer::bank_abi()},
+			{CUSTODIAN_ACC, &indexer::custodian_abi()},
+			{EOSIO_TOKEN, &indexer::token_abi()},
+		};
+		indexer::store store;
+		{
+			ifstream in(log_file, ios::binary);
+			if(!in)
+				throw runtime_error("cannot read " + log_file);
+			indexer::pipeline feed(store, abis, threads);
+			uint64_t transaction;
+			vector<host::table_delta> deltas;
+			while(indexer::read_log(in, transaction, deltas) && transaction <= upto)
+				feed.push(transaction, move(deltas));
+			feed.finish();
+		}
+
+		auto last = last_segment(dir);
+		upto = min(upto, store.last_transaction());
+		if(upto <= last.transaction) {
+			printf("nothing to export after transaction %llu\n", (unsigned long long)last.transaction);
+			return 0;
+		}
+		uint64_t segment = last.segment + 1;
+		size_t rows = columnar::export_segment(store, abis, dir, segment, last.transaction, upto, threads, group_rows);
+
+		ofstream manifest(dir + "/MANIFEST", ios::app);
+		manifest << segment << " " << upto << "\n";
+		if(!manifest.flush())
+			throw runtime_error("cannot write " + dir + "/MANIFEST");
+		printf("segment %llu: %zu rows changed in transactions %llu..%llu\n", (unsigned long long)segment, rows,
+			(unsigned long long)last.transaction + 1, (unsigned long long)upto);
+	}
+	catch(const exception& e) {
+		cerr << "export: " << e.what() << endl;
+		return 2;
+	}
+	return 0;
+}
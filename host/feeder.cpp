@@ -0,0 +1,121 @@
+/**
+ *  feeder.cpp -- oracle feeder over host chain
+ *  usage: feeder -s source [-s source ...] [-n ticks] [-t tick_ms] [-w width_pct] [-b deadband_pct]
+ *
+ *  Boots the chain as test/boot.sh does, then every 'tick_ms' (default 1000) of wall and chain
+ *  time reads all sources, "file:path" or "tcp:port" (see oracle.hpp), and pushes their median
+ *  with planned moves of btcusd.low and btcusd.high as one transaction of oracle account.
+ *  Band is median -+ width_pct (default 50), limits stay while within deadband_pct (default 10)
+ *  of their targets. Host chain executes a transaction as soon as it is pushed, so latency is
+ *  measured from tick start, reading of sources included, to execution of its transaction.
+ *  After 'ticks' (default 60, 0 runs forever) reports latency and rejection counts by check() message.
+ */
+
+#include "oracle.hpp"
+#include "scenarios.hpp"
+
+#include <eosio/system.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace scenarios;
+
+namespace {
+
+string price(int64_t value) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.2f", value * 1e-8);
+	return buf;
+}
+
+void usage() {
+	cerr << "usage: feeder -s source [-s source ...] [-n ticks] [-t tick_ms] [-w width_pct] [-b deadband_pct]" << endl
+	     << "       source is file:path or tcp:port" << endl;
+	exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	vector<string> specs;
+	long ticks = 60;
+	int tick_ms = 1000;
+	oracle::band_policy policy;
+
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(i + 1 >= argc)
+			usage();
+		const char* value = argv[++i];
+		if(arg == "-s")
+			specs.push_back(value);
+		else if(arg == "-n")
+			ticks = atol(value);
+		else if(arg == "-t")
+			tick_ms = max(1, atoi(value));
+		else if(arg == "-w")
+			policy.width = atof(value) / 100;
+		else if(arg == "-b")
+			policy.deadband = atof(value) / 100;
+		else
+			usage();
+	}
+	if(specs.empty() || policy.width <= 0 || policy.width >= 1)
+		usage();
+
+	try {
+		vector<unique_ptr<oracle::source>> sources;
+		for(const auto& s : specs)
+			sources.push_back(oracle::make_source(s));
+		boot();
+		oracle::feeder feeder(move(sources), policy, BANK_ACC, ORACLE_ACC);
+
+		vector<double> latencies;
+		map<string, size_t> rejections;
+		size_t transactions = 0, held = 0, no_data = 0;
+		auto next_tick = chrono::steady_clock::now();
+		for(long t = 0; ticks == 0 || t < ticks; t++) {
+			next_tick += chrono::milliseconds(tick_ms);
+			this_thread::sleep_until(next_tick);
+			host::advance_time(uint64_t(tick_ms) * 1000);
+
+			auto report = feeder.tick();
+			latencies.push_back(report.latency.count());
+			if(!report.sources_read)
+				no_data++;
+			if(report.plan.held)
+				held++;
+			if(report.pushed) {
+				transactions++;
+				if(report.result.failed)
+					rejections[report.result.error]++;
+			}
+			auto chain = oracle::read_chain(BANK_ACC);
+			string status = report.result.failed ? " rejected: " + report.result.error : "";
+			printf("tick %ld: %zu/%zu sources, btcusd %s%s, band %s..%s, %lld us%s\n", t + 1, report.sources_read, specs.size(),
+				price(report.median.btcusd).c_str(), report.plan.held ? " held" : "",
+				price(chain.low.value).c_str(), price(chain.high.value).c_str(), (long long)report.latency.count(), status.c_str());
+		}
+
+		sort(latencies.begin(), latencies.end());
+		auto pct = [&](double p) { return latencies.empty() ? 0.0 : latencies[min(latencies.size() - 1, size_t(p * latencies.size()))]; };
+		printf("ticks %zu, transactions %zu, held %zu, without data %zu\n", latencies.size(), transactions, held, no_data);
+		printf("tick to inclusion latency, us: p50 %.0f, p99 %.0f, max %.0f\n", pct(0.5), pct(0.99), latencies.empty() ? 0.0 : latencies.back());
+		for(const auto& [error, count] : rejections)
+			printf("rejected %zu: %s\n", count, error.c_str());
+	}
+	catch(const exception& e) {
+		cerr << "feeder: " << e.what() << endl;
+		return 2;
+	}
+	return 0;
+}
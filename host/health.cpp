@@ -0,0 +1,231 @@
+/**
+ *  health.cpp -- bank health metrics computed from table deltas, see health.hpp
+ */
+
+#include "health.hpp"
+
+#include <eosio/asset.hpp>
+#include <eosio/datastream.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <tuple>
+
+namespace health {
+
+namespace {
+
+	const name SYSTEM_SCOPE("system");
+	const name PERIODIC_SCOPE("periodic");
+	const name STAT_SCOPE("stat");
+	const name DBONDS_SCOPE("dbonds");
+	const name VARIABLES("variables");
+	const name ACCOUNTS("accounts");
+	const name STAT("stat");
+	const name PROFITPOOL("profitpool");
+	const name VAULT("vault");
+	const name RDMQUEUE("rdmqueue");
+	const name EPOCH("epoch");
+
+	const uint64_t DUSD = eosio::symbol_code("DUSD").raw();
+	const uint64_t DBTC = eosio::symbol_code("DBTC").raw();
+	const uint64_t EOS = eosio::symbol_code("EOS").raw();
+
+	using variable_row = std::tuple<name, int64_t, int64_t>;      // var_name, value, mtime
+	using vault_row = std::tuple<eosio::asset, int64_t, int64_t>; // value, shares, mtime
+	using epoch_row = std::tuple<eosio::asset, int64_t, int64_t>; // dusd, dbtc, eos
+
+	std::string format(double v) {
+		if(std::isnan(v))
+			return "NaN";
+		if(std::isinf(v))
+			return v > 0 ? "+Inf" : "-Inf";
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%.17g", v);
+		return buf;
+	}
+
+} // namespace
+
+monitor::monitor(name b, name c, name t) : bank(b), custodian(c), eosio_token(t) {}
+
+void monitor::apply(const std::vector<host::table_delta>& deltas) {
+	for(const auto& d : deltas) {
+		name code(d.code), scope(d.scope), table(d.table);
+		deltas_count++;
+
+		if(code == bank && table == VARIABLES) {
+			variable v;
+			if(d.present) {
+				auto [varname, value, mtime] = eosio::unpack<variable_row>(d.value);
+				v = {value, mtime};
+				latest_mtime = std::max(latest_mtime, mtime);
+			}
+			if(scope == DBONDS_SCOPE) {
+				// running sum, so dbonds value costs the same for any number of dbonds contracts
+				auto& cached = dbonds[name(d.primary_key)];
+				dbonds_value += v.value - cached.value;
+				cached = v;
+				if(!d.present)
+					dbonds.erase(name(d.primary_key));
+			}
+			else if(scope == SYSTEM_SCOPE || scope == PERIODIC_SCOPE || scope == STAT_SCOPE) {
+				if(d.present)
+					variables[{scope, name(d.primary_key)}] = v;
+				else
+					variables.erase({scope, name(d.primary_key)});
+			}
+			continue;
+		}
+
+		int64_t* balance = nullptr;
+		if(table == ACCOUNTS && scope == bank) {
+			if(code == bank && d.primary_key == DUSD)
+				balance = &bank_dusd;
+			else if(code == custodian && d.primary_key == DBTC)
+				balance = &bank_dbtc;
+			else if(code == eosio_token && d.primary_key == EOS)
+				balance = &bank_eos;
+		}
+		else if(code == bank && table == STAT && d.scope == DUSD && d.primary_key == DUSD)
+			balance = &dusd_supply;
+		if(balance)
+			*balance = d.present ? eosio::unpack<eosio::asset>(d.value).amount : 0;
+		if(code == bank && table == PROFITPOOL && d.primary_key == DUSD)
+			profit_owed = d.present ? eosio::unpack<std::pair<unsigned __int128, eosio::asset>>(d.value).second.amount : 0;
+		if(code == bank && table == VAULT && d.primary_key == DUSD) {
+			auto [value, shares, mtime] = d.present ? eosio::unpack<vault_row>(d.value) : vault_row{};
+			savings_value = value.amount;
+			savings_mtime = mtime;
+		}
+		// 'queued' is the first field of "rdmqueue" row, scope is requested asset
+		if(code == bank && table == RDMQUEUE && d.primary_key == DUSD)
+			redeem_queued[d.scope] = d.present ? eosio::unpack<eosio::asset>(d.value).amount : 0;
+		if(code == bank && table == EPOCH && d.primary_key == DUSD) {
+			auto [dusd, dbtc, eos] = d.present ? eosio::unpack<epoch_row>(d.value) : epoch_row{};
+			batch_dusd = dusd.amount;
+			batch_dbtc = dbtc;
+			batch_eos = eos;
+		}
+	}
+}
+
+int64_t monitor::get(name scope, const char* varname) const {
+	auto itr = variables.find({scope, name(varname)});
+	return itr == variables.end() ? 0 : itr->second.value;
+}
+
+int64_t monitor::mtime(name scope, const char* varname) const {
+	auto itr = variables.find({scope, name(varname)});
+	return itr == variables.end() ? 0 : itr->second.mtime;
+}
+
+std::vector<metric> monitor::compute(int64_t now_us) const {
+	// get_btc_price() and get_usd_value() of utility.hpp
+	int64_t btc_price = get(PERIODIC_SCOPE, "btcusd") / 1e6;
+	auto btc_usd = [&](int64_t satoshi) {
+		double btc_amount = 1.0 * satoshi / 100000000;
+		return int64_t(round(btc_amount * (1.0 * btc_price)));
+	};
+	auto eos_usd = [&](int64_t eoshi) {
+		double eos_price = get(PERIODIC_SCOPE, "eosusd") * 1e-6;
+		double eos_amount = eoshi * 1e-4;
+		return int64_t(round(eos_amount * eos_price));
+	};
+
+	int64_t bitmex_satoshi = get(PERIODIC_SCOPE, "btc.bitmex");
+	int64_t bitmex = btc_usd(bitmex_satoshi);
+	// payments of batch intents are not bank's till settlement
+	int64_t dbtc = bank_dbtc - batch_dbtc;
+	int64_t eos = bank_eos - batch_eos;
+	int64_t hedge_assets = btc_usd(dbtc) + bitmex + eos_usd(eos);
+	int64_t liquidity_pool = hedge_assets - bitmex;
+	int64_t queued = 0;
+	for(const auto& [scope, amount] : redeem_queued)
+		queued += amount;
+	int64_t capital = bank_dusd - profit_owed - queued - batch_dusd;
+	int64_t topup = get(STAT_SCOPE, "hedge.topup");
+	int64_t xfer = get(STAT_SCOPE, "hedge.xfer");
+	// get_savings_value() of savings.hpp
+	int64_t savings_seconds = std::max<int64_t>((now_us - savings_mtime) / 1000000, 0);
+	int64_t savings_apr = std::min(get(SYSTEM_SCOPE, "save.apr"), get(STAT_SCOPE, "dbonds.apr"));
+	int64_t savings = savings_value + int64_t((__int128)savings_value * savings_apr * savings_seconds / (10000ll * 31536000));
+	int64_t assets = btc_usd(bitmex_satoshi + dbtc + topup + xfer) + eos_usd(eos) + dbonds_value - savings;
+
+	// check_liquidity()
+	double liq_trg = capital / 2;
+
+	// check_leverage() and check_bitmex_balance_ratio()
+	double btm_min = get(SYSTEM_SCOPE, "bitmex.min") * 1e-10;
+
+	// check_capital()
+	double cap_min = get(SYSTEM_SCOPE, "mincapshare") * 1e-10;
+
+	// check_main_switch()
+	int64_t data_age = (now_us - mtime(PERIODIC_SCOPE, "btcusd")) / 1000000;
+	int64_t max_data_age = get(SYSTEM_SCOPE, "maxdataage");
+	bool main_switch = data_age <= max_data_age
+		&& btc_price >= get(PERIODIC_SCOPE, "btcusd.low") / 1000000
+		&& btc_price <= get(PERIODIC_SCOPE, "btcusd.high") / 1000000
+		&& get(SYSTEM_SCOPE, "sw.service") && get(SYSTEM_SCOPE, "sw.manual");
+
+	// decay_used_volume() as it would run now
+	int64_t volume_used = get(STAT_SCOPE, "volumeused");
+	int64_t n_hours = now_us / 3600000000 - mtime(STAT_SCOPE, "volumeused") / 3600000000;
+	int64_t max_abs_vol = get(SYSTEM_SCOPE, "maxdayvol");
+	if(n_hours != 0) {
+		int64_t hourly_decay = int64_t((1.0 * max_abs_vol / 20) + 0.5);
+		int64_t sign = volume_used > 0 ? 1 : -1;
+		int64_t delta = n_hours * hourly_decay;
+		volume_used = volume_used * sign > delta ? volume_used - delta * sign : 0;
+	}
+
+	return {
+		{"deposbank_liquidity_pool_cents",       "Liquidity pool value, get_liquidity_pool_value()", double(liquidity_pool)},
+		{"deposbank_liquidity_target_cents",     "Liquidity pool target, half of bank capital", liq_trg},
+		{"deposbank_liquidity_soft_low_cents",   "Liquidity pool below this triggers on_lack_of_liquidity()", liq_trg / 2},
+		{"deposbank_liquidity_soft_high_cents",  "Liquidity pool above this triggers on_too_much_liquidity()", liq_trg * 1.5},
+		{"deposbank_liquidity_hard_high_cents",  "Liquidity pool above this rejects orders", double(capital)},
+		{"deposbank_hedge_assets_cents",         "Hedge assets value, get_hedge_assets_value()", double(hedge_assets)},
+		{"deposbank_bitmex_balance_cents",       "BTC at bitmex in USD", double(bitmex)},
+		{"deposbank_bitmex_margin_share",        "BTC at bitmex to hedge assets", 1.0 * bitmex / hedge_assets},
+		{"deposbank_bitmex_min_share",           "Soft minimum of bitmex margin share, bitmex.min", btm_min},
+		{"deposbank_bitmex_hard_min_share",      "Hard minimum of bitmex margin share", 0.5 * btm_min},
+		{"deposbank_bitmex_max_share",           "Maximum of bitmex margin share, bitmex.max", get(SYSTEM_SCOPE, "bitmex.max") * 1e-10},
+		{"deposbank_bitmex_target_share",        "Target of bitmex margin share, bitmex.trg", get(SYSTEM_SCOPE, "bitmex.trg") * 1e-10},
+		{"deposbank_hedge_topup_satoshi",        "DBTC sent for bitmex top-up, not shown by btc.bitmex yet, hedge.topup", double(topup)},
+		{"deposbank_hedge_withdrawal_satoshi",   "Withdrawal from bitmex, not shown paid out by btc.bitmex yet, hedge.wdraw", double(get(STAT_SCOPE, "hedge.wdraw"))},
+		{"deposbank_hedge_transfer_satoshi",     "Withdrawal paid out by bitmex, not minted to bank yet, hedge.xfer", double(xfer)},
+		{"deposbank_capital_cents",              "Bank capital, DUSD held by the bank", double(capital)},
+		{"deposbank_dusd_supply_cents",          "DUSD supply", double(dusd_supply)},
+		{"deposbank_capital_ratio",              "Bank capital to DUSD supply", 1.0 * capital / dusd_supply},
+		{"deposbank_capital_min_share",          "Soft minimum of capital ratio, mincapshare", cap_min},
+		{"deposbank_capital_hard_min_share",     "Hard minimum of capital ratio", 0.5 * cap_min},
+		{"deposbank_assets_cents",               "Bank assets value, dbonds at cached value", double(assets)},
+		{"deposbank_savings_cents",              "Value of savings vault, owed to savers", double(savings)},
+		{"deposbank_redeem_queued_cents",        "DUSD of queued redemptions, escrowed by the bank", double(queued)},
+		{"deposbank_dbonds_value_cents",         "Cached value of dbonds held by the bank", double(dbonds_value)},
+		{"deposbank_supply_error_cents",         "Bank assets value minus DUSD supply", double(assets - dusd_supply)},
+		{"deposbank_supply_error_max_cents",     "Allowed supply error, maxsupplerr", double(get(SYSTEM_SCOPE, "maxsupplerr") / 1000000)},
+		{"deposbank_btc_price_cents",            "Oracle BTC price", double(btc_price)},
+		{"deposbank_oracle_data_age_seconds",    "Age of oracle btcusd", double(data_age)},
+		{"deposbank_oracle_data_age_max_seconds", "Maximum age of oracle data, maxdataage", double(max_data_age)},
+		{"deposbank_volume_used_cents",          "Daily volume used, decayed as decay_used_volume() would do now", volume_used / 1e6},
+		{"deposbank_volume_max_cents",           "Maximum daily volume, maxdayvol", max_abs_vol / 1e6},
+		{"deposbank_main_switch",                "1 if check_main_switch() passes", double(main_switch)},
+		{"deposbank_deltas_total",               "Table deltas processed", double(deltas_count)},
+	};
+}
+
+std::string monitor::render(int64_t now_us) const {
+	std::string result;
+	for(const auto& m : compute(now_us)) {
+		result += "# HELP " + m.name + " " + m.help + "\n";
+		result += "# TYPE " + m.name + (m.name.size() > 6 && m.name.compare(m.name.size() - 6, 6, "_total") == 0 ? " counter\n" : " gauge\n");
+		result += m.name + " " + format(m.value) + "\n";
+	}
+	return result;
+}
+
+} // namespace health
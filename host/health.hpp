@@ -0,0 +1,80 @@
+/**
+ *  health.hpp -- bank health metrics computed from table deltas, served by host/metricsd
+ *
+ *  Keeps only rows that check_on_system_change() reads: bank variables of 'system', 'periodic' and
+ *  'stat' scopes, balances of the bank, DUSD supply and sum of cached dbonds values of 'dbonds'
+ *  scope. Every delta updates them in constant time, so the cost of metrics does not depend on
+ *  number of users or dbonds. Derived values use formulas of limitations.hpp and utility.hpp
+ *  with the same rounding.
+ */
+#pragma once
+
+#include "chain.hpp"
+
+#include <eosio/name.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace health {
+
+using eosio::name;
+
+struct metric {
+	std::string name;
+	std::string help;
+	double      value;
+};
+
+class monitor {
+public:
+	monitor(name bank, name custodian, name eosio_token);
+
+	void apply(const std::vector<host::table_delta>& deltas);
+
+	/**
+	 * Metrics at time 'now_us' (microseconds since epoch) as contracts would see them:
+	 * data age and decay of 'volumeused' depend on time.
+	 */
+	std::vector<metric> compute(int64_t now_us) const;
+
+	// Prometheus text exposition format
+	std::string render(int64_t now_us) const;
+
+	// the latest mtime of bank variables, the best guess of head block time from deltas
+	int64_t head_time() const { return latest_mtime; }
+
+	uint64_t deltas() const { return deltas_count; }
+
+private:
+	struct variable {
+		int64_t value = 0;
+		int64_t mtime = 0;
+	};
+
+	int64_t get(name scope, const char* varname) const;
+	int64_t mtime(name scope, const char* varname) const;
+
+	name                                   bank, custodian, eosio_token;
+	std::map<std::pair<name, name>, variable> variables;      // (scope, name)
+	std::map<name, variable>               dbonds;            // cached values of dbonds contracts
+	int64_t                                dbonds_value = 0;
+	int64_t                                bank_dusd = 0;
+	int64_t                                bank_dbtc = 0;
+	int64_t                                bank_eos = 0;
+	int64_t                                dusd_supply = 0;
+	int64_t                                profit_owed = 0;   // DUSD distributed to DPS holders, not claimed
+	int64_t                                savings_value = 0; // value of savings vault at savings_mtime
+	int64_t                                savings_mtime = 0;
+	std::map<uint64_t, int64_t>            redeem_queued;     // DUSD escrowed by redemption queue, by requested asset
+	int64_t                                batch_dusd = 0;    // payments of batch intents of the current epoch
+	int64_t                                batch_dbtc = 0;
+	int64_t                                batch_eos = 0;
+	int64_t                                latest_mtime = 0;
+	uint64_t                               deltas_count = 0;
+};
+
+} // namespace health
@@ -0,0 +1,431 @@
+/**
+ *  indexer.cpp -- index of contract tables built from table deltas, see indexer.hpp
+ */
+
+#include "indexer.hpp"
+
+#include <eosio/datastream.hpp>
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace indexer {
+
+namespace {
+
+	const name ACCOUNTS("accounts");
+	const name MINTORDERS("mintorders");
+	const name REDEEMORDERS("redeemorders");
+	const name AUTHFCDBONDS("authfcdbonds");
+	const name VARIABLES("variables");
+
+	const std::vector<abi_field> account_fields = {{"balance", "asset"}};
+	const std::vector<abi_field> stat_fields = {{"supply", "asset"}, {"max_supply", "asset"}, {"issuer", "name"}};
+	const std::vector<abi_field> ledger_fields = {{"users_held", "asset"}, {"issuer_held", "asset"}};
+
+	field_value read_field(eosio::datastream<const char*>& ds, const std::string& type) {
+		if(type == "name") {
+			name v;
+			ds >> v;
+			return v;
+		}
+		if(type == "asset") {
+			asset v;
+			ds >> v;
+			return v;
+		}
+		if(type == "int64" || type == "time_point") {
+			int64_t v;
+			ds >> v;
+			return v;
+		}
+		if(type == "bool") {
+			bool v;
+			ds >> v;
+			return uint64_t(v);
+		}
+		if(type == "uint64" || type == "symbol_code") {
+			uint64_t v;
+			ds >> v;
+			return v;
+		}
+		if(type == "uint128") {
+			unsigned __int128 v;
+			ds >> v;
+			std::string digits;
+			do {
+				digits.insert(digits.begin(), char('0' + int(v % 10)));
+				v /= 10;
+			} while(v);
+			return digits;
+		}
+		if(type == "checksum256") {
+			static const char digits[] = "0123456789abcdef";
+			char bytes[32];
+			ds.read(bytes, sizeof(bytes));
+			std::string hex;
+			for(unsigned char b : bytes) {
+				hex += digits[b >> 4];
+				hex += digits[b & 0xf];
+			}
+			return hex;
+		}
+		if(type == "string") {
+			std::string v;
+			ds >> v;
+			return v;
+		}
+		throw std::runtime_error("unknown ABI type " + type);
+	}
+
+	bool is_order(name table) {
+		return table == MINTORDERS || table == REDEEMORDERS;
+	}
+
+	name name_field(const row& r, const char* field) {
+		return std::get<name>(r[field]);
+	}
+
+} // namespace
+
+const abi& bank_abi() {
+	static const abi result = {
+		{ACCOUNTS, account_fields},
+		{name("stat"), stat_fields},
+		{name("ledger"), ledger_fields},
+		{AUTHFCDBONDS, {{"dbond", "symbol_code"}, {"contract", "name"}}},
+		{name("dbonddue"), {{"dbond", "symbol_code"}, {"maturity_time", "time_point"}, {"retire_time", "time_point"},
+			{"matured", "bool"}}},
+		{name("polroot"), {{"total", "asset"}, {"supply", "asset"}, {"root", "checksum256"},
+			{"snapshot_time", "time_point"}, {"mtime", "time_point"}}},
+		{VARIABLES, {{"var_name", "name"}, {"value", "int64"}, {"mtime", "time_point"}}},
+		{name("metrics"), {{"slot", "uint64"}, {"hour", "int64"}, {"calls", "uint64"}, {"volume", "int64"}}},
+		{name("feeshards"), {{"id", "uint64"}, {"value", "int64"}}},
+		{name("volshards"), {{"id", "uint64"}, {"value", "int64"}}},
+		{name("ledgshards"), {{"id", "uint64"}, {"value", "int64"}}},
+		{name("mtrshards"), {{"id", "uint64"}, {"calls", "uint64"}, {"volume", "int64"}}},
+		{name("balchkpts"), {{"id", "uint64"}, {"balance", "asset"}}},
+		{name("supchkpts"), {{"id", "uint64"}, {"balance", "asset"}}},
+		{name("profitpool"), {{"acc", "uint128"}, {"owed", "asset"}}},
+		{name("profitshare"), {{"owner", "name"}, {"acc", "uint128"}, {"accrued", "asset"}}},
+		{name("vault"), {{"value", "asset"}, {"shares", "int64"}, {"mtime", "time_point"}}},
+		{name("savings"), {{"owner", "name"}, {"shares", "int64"}}},
+		{name("rdmqueue"), {{"queued", "asset"}, {"head", "uint64"}, {"tail", "uint64"}, {"enqueued", "int64"},
+			{"filled", "int64"}, {"fills", "uint64"}, {"cancelled", "int64"}, {"cancels", "uint64"}}},
+		{name("rdmorders"), {{"id", "uint64"}, {"owner", "name"}, {"quantity", "asset"}, {"memo", "string"},
+			{"ctime", "time_point"}, {"enqueued", "int64"}, {"cancelled", "int64"}, {"cancels", "uint64"}}},
+		{name("epoch"), {{"dusd", "asset"}, {"dbtc", "int64"}, {"eos", "int64"}, {"id", "uint64"}, {"intents", "uint64"},
+			{"start", "time_point"}}},
+		{name("intents"), {{"id", "uint64"}, {"owner", "name"}, {"quantity", "asset"}, {"want", "symbol_code"}}},
+		{name("fcdbaccrual"), {{"dbond", "symbol_code"}, {"initial_price", "asset"}, {"initial_time", "time_point"},
+			{"maturity_time", "time_point"}, {"apr", "int64"}}},
+	};
+	return result;
+}
+
+const abi& custodian_abi() {
+	static const abi result = {
+		{ACCOUNTS, account_fields},
+		{name("stat"), stat_fields},
+		{name("ledger"), ledger_fields},
+		{name("ledgshards"), {{"id", "uint64"}, {"value", "int64"}}},
+		{VARIABLES, {{"var_name", "name"}, {"value", "uint64"}, {"mtime", "time_point"}}},
+		{MINTORDERS, {{"id", "uint64"}, {"user", "name"}, {"status", "name"}, {"btc_amount", "int64"},
+			{"btc_txid", "checksum256"}, {"mtime", "uint64"}}},
+		{REDEEMORDERS, {{"id", "uint64"}, {"user", "name"}, {"status", "name"}, {"btc_amount", "int64"},
+			{"btc_txid", "checksum256"}, {"mtime", "uint64"}, {"btc_address", "string"}}},
+	};
+	return result;
+}
+
+const abi& token_abi() {
+	static const abi result = {
+		{ACCOUNTS, account_fields},
+		{name("stat"), stat_fields},
+		{name("ledger"), ledger_fields},
+		{name("ledgshards"), {{"id", "uint64"}, {"value", "int64"}}},
+	};
+	return result;
+}
+
+const field_value& row::operator[](const std::string& field) const {
+	for(const auto& [n, v] : fields)
+		if(n == field)
+			return v;
+	throw std::out_of_range("no field " + field + " in " + table.to_string() + " row");
+}
+
+std::optional<row> decode(const std::map<name, const abi*>& abis, const host::table_delta& delta) {
+	auto contract = abis.find(name(delta.code));
+	if(contract == abis.end())
+		return std::nullopt;
+	auto table = contract->second->find(name(delta.table));
+	if(table == contract->second->end())
+		return std::nullopt;
+
+	row r{name(delta.code), name(delta.scope), name(delta.table), delta.primary_key, name(delta.payer), delta.present, {}};
+	if(!delta.present)
+		return r;
+	eosio::datastream<const char*> ds(delta.value.data(), delta.value.size());
+	for(const auto& f : table->second)
+		r.fields.emplace_back(f.name, read_field(ds, f.type));
+	if(ds.remaining() != 0)
+		throw std::runtime_error("row of " + r.code.to_string() + "::" + r.table.to_string() + " is longer than ABI struct");
+	return r;
+}
+
+void append_log(std::ostream& out, uint64_t transaction, const std::vector<host::table_delta>& deltas) {
+	auto record = eosio::pack(std::make_tuple(transaction, deltas));
+	uint32_t size = record.size();
+	out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	out.write(record.data(), record.size());
+}
+
+bool read_log(std::istream& in, uint64_t& transaction, std::vector<host::table_delta>& deltas) {
+	uint32_t size;
+	if(!in.read(reinterpret_cast<char*>(&size), sizeof(size)))
+		return false;
+	std::vector<char> record(size);
+	if(!in.read(record.data(), size))
+		throw std::runtime_error("truncated history log record");
+	std::tie(transaction, deltas) = eosio::unpack<std::tuple<uint64_t, std::vector<host::table_delta>>>(record);
+	return true;
+}
+
+/*
+ * store
+ */
+void store::index(const row_key& key, const row& r) {
+	if(key.table == ACCOUNTS)
+		by_user[key.scope].insert(key);
+	else if(is_order(key.table)) {
+		by_user[name_field(r, "user")].insert(key);
+		by_status[{key.code, key.table, name_field(r, "status")}].insert(key);
+	}
+	else if(key.table == AUTHFCDBONDS)
+		by_contract[{key.code, name_field(r, "contract")}].insert(key);
+}
+
+void store::unindex(const row_key& key, const row& r) {
+	if(key.table == ACCOUNTS)
+		by_user[key.scope].erase(key);
+	else if(is_order(key.table)) {
+		by_user[name_field(r, "user")].erase(key);
+		by_status[{key.code, key.table, name_field(r, "status")}].erase(key);
+	}
+	else if(key.table == AUTHFCDBONDS)
+		by_contract[{key.code, name_field(r, "contract")}].erase(key);
+}
+
+void store::apply(uint64_t transaction, const std::vector<row>& changed) {
+	std::unique_lock lock(m);
+	for(const auto& r : changed) {
+		row_key key{r.code, r.scope, r.table, r.primary_key};
+		auto& history = rows[key];
+		if(!history.empty() && history.back().state.present)
+			unindex(key, history.back().state);
+		history.push_back({transaction, r});
+		versions++;
+		if(r.present)
+			index(key, r);
+	}
+	last = transaction;
+}
+
+std::optional<row> store::get(const row_key& key) const {
+	std::shared_lock lock(m);
+	auto itr = rows.find(key);
+	if(itr == rows.end() || !itr->second.back().state.present)
+		return std::nullopt;
+	return itr->second.back().state;
+}
+
+std::vector<row> store::current(const std::set<row_key>& keys) const {
+	std::vector<row> result;
+	for(const auto& key : keys)
+		result.push_back(rows.at(key).back().state);
+	return result;
+}
+
+std::vector<asset> store::balances(name code, name owner) const {
+	std::shared_lock lock(m);
+	std::vector<asset> result;
+	auto user = by_user.find(owner);
+	if(user == by_user.end())
+		return result;
+	for(const auto& key : user->second)
+		if(key.code == code && key.table == ACCOUNTS)
+			result.push_back(std::get<asset>(rows.at(key).back().state["balance"]));
+	return result;
+}
+
+std::optional<int64_t> store::variable(name code, name scope, name varname) const {
+	auto r = get({code, scope, VARIABLES, varname.value});
+	if(!r)
+		return std::nullopt;
+	const auto& value = (*r)["value"];
+	return std::holds_alternative<int64_t>(value) ? std::get<int64_t>(value) : int64_t(std::get<uint64_t>(value));
+}
+
+std::vector<row> store::orders(name user) const {
+	std::shared_lock lock(m);
+	std::set<row_key> keys;
+	auto itr = by_user.find(user);
+	if(itr != by_user.end())
+		for(const auto& key : itr->second)
+			if(is_order(key.table))
+				keys.insert(key);
+	return current(keys);
+}
+
+std::vector<row> store::orders_by_status(name code, name table, name status) const {
+	std::shared_lock lock(m);
+	auto itr = by_status.find({code, table, status});
+	return itr == by_status.end() ? std::vector<row>() : current(itr->second);
+}
+
+std::vector<row> store::dbonds(name code, name contract) const {
+	std::shared_lock lock(m);
+	auto itr = by_contract.find({code, contract});
+	return itr == by_contract.end() ? std::vector<row>() : current(itr->second);
+}
+
+std::vector<row_version> store::history(const row_key& key) const {
+	std::shared_lock lock(m);
+	auto itr = rows.find(key);
+	return itr == rows.end() ? std::vector<row_version>() : itr->second;
+}
+
+std::vector<row_version> store::changes(uint64_t after, uint64_t upto) const {
+	std::shared_lock lock(m);
+	std::vector<row_version> result;
+	for(const auto& [key, history] : rows) {
+		auto end = std::upper_bound(history.begin(), history.end(), upto,
+			[](uint64_t t, const row_version& v) { return t < v.transaction; });
+		if(end == history.begin() || std::prev(end)->transaction <= after)
+			continue;
+		// row created and removed within the range is not known to anyone who has read up to 'after'
+		if(!std::prev(end)->state.present) {
+			auto first = std::upper_bound(history.begin(), end, after,
+				[](uint64_t t, const row_version& v) { return t < v.transaction; });
+			if(first == history.begin() || !std::prev(first)->state.present)
+				continue;
+		}
+		result.push_back(*std::prev(end));
+	}
+	return result;
+}
+
+uint64_t store::last_transaction() const {
+	std::shared_lock lock(m);
+	return last;
+}
+
+size_t store::rows_count() const {
+	std::shared_lock lock(m);
+	return rows.size();
+}
+
+size_t store::versions_count() const {
+	std::shared_lock lock(m);
+	return versions;
+}
+
+/*
+ * pipeline
+ */
+pipeline::pipeline(store& s, std::map<name, const abi*> a, unsigned threads, size_t queue_limit)
+	: target(s), abis(std::move(a)), limit(std::max<size_t>(1, queue_limit)) {
+	decoders_running = std::max(1u, threads);
+	for(int i = 0; i < decoders_running; i++)
+		decoders.emplace_back([this] { decode_loop(); });
+	applier = std::thread([this] { apply_loop(); });
+}
+
+pipeline::~pipeline() {
+	try {
+		finish();
+	}
+	catch(...) {
+	}
+}
+
+void pipeline::push(uint64_t transaction, std::vector<host::table_delta> deltas) {
+	std::unique_lock lock(m);
+	jobs_space.wait(lock, [&] { return next_seq - applied_seq < limit || closing; });
+	if(closing)
+		throw std::logic_error("push to finished pipeline");
+	jobs.push_back({next_seq++, transaction, std::move(deltas)});
+	jobs_ready.notify_one();
+}
+
+void pipeline::decode_loop() {
+	std::unique_lock lock(m);
+	while(true) {
+		jobs_ready.wait(lock, [&] { return !jobs.empty() || closing; });
+		if(jobs.empty())
+			break;
+		job j = std::move(jobs.front());
+		jobs.pop_front();
+		lock.unlock();
+
+		decoded d{j.transaction, {}};
+		std::string failure;
+		try {
+			for(const auto& delta : j.deltas) {
+				if(auto r = decode(abis, delta))
+					d.rows.push_back(std::move(*r));
+				else
+					skipped_count++;
+			}
+		}
+		catch(const std::exception& e) {
+			failure = "transaction " + std::to_string(j.transaction) + ": " + e.what();
+		}
+
+		lock.lock();
+		if(!failure.empty() && error.empty())
+			error = failure;
+		ready.emplace(j.seq, std::move(d));
+		decoded_ready.notify_all();
+	}
+	decoders_running--;
+	decoded_ready.notify_all();
+}
+
+void pipeline::apply_loop() {
+	std::unique_lock lock(m);
+	while(true) {
+		decoded_ready.wait(lock, [&] { return ready.count(applied_seq) || decoders_running == 0; });
+		auto itr = ready.find(applied_seq);
+		if(itr == ready.end())
+			break;
+		decoded d = std::move(itr->second);
+		ready.erase(itr);
+		lock.unlock();
+		target.apply(d.transaction, d.rows);
+		lock.lock();
+		applied_seq++;
+		jobs_space.notify_all();
+	}
+}
+
+void pipeline::finish() {
+	{
+		std::lock_guard lock(m);
+		closing = true;
+		jobs_ready.notify_all();
+		jobs_space.notify_all();
+	}
+	for(auto& t : decoders)
+		if(t.joinable())
+			t.join();
+	if(applier.joinable())
+		applier.join();
+	if(!error.empty())
+		throw std::runtime_error(error);
+}
+
+} // namespace indexer
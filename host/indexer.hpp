@@ -0,0 +1,199 @@
+/**
+ *  indexer.hpp -- index of contract tables built from table deltas of committed transactions
+ *
+ *  Deltas are what state history plugin sends for every block: final state of every changed row
+ *  (see table_delta in chain.hpp). Rows are decoded by field types of contract ABIs, so indexer
+ *  does not link contract code and keeps every state of every row, not only the last one.
+ *  Decoding runs on worker threads, decoded rows are applied to the store by single thread in
+ *  order of transactions, queries may run concurrently with applying.
+ */
+#pragma once
+
+#include "chain.hpp"
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace indexer {
+
+using eosio::asset;
+using eosio::name;
+
+/**
+ * Table structs of contract ABI: table name => fields in order of serialization.
+ * Types are ABI type names: name, uint64, int64, asset, symbol_code, checksum256, time_point, string.
+ */
+struct abi_field {
+	std::string name;
+	std::string type;
+};
+
+using abi = std::map<name, std::vector<abi_field>>;
+
+// ABIs of contracts/bank, contracts/custodian and eosio.token (depostoken.hpp)
+const abi& bank_abi();
+const abi& custodian_abi();
+const abi& token_abi();
+
+/**
+ * Decoded field: integers and time_point (microseconds) as int64_t or uint64_t,
+ * symbol_code as its raw value, checksum256 as hex string.
+ */
+using field_value = std::variant<int64_t, uint64_t, name, asset, std::string>;
+
+struct row {
+	name      code;
+	name      scope;
+	name      table;
+	uint64_t  primary_key = 0;
+	name      payer;
+	bool      present = false;
+	std::vector<std::pair<std::string, field_value>> fields;
+
+	// throws std::out_of_range, if there is no such field
+	const field_value& operator[](const std::string& field) const;
+};
+
+struct row_key {
+	name      code;
+	name      scope;
+	name      table;
+	uint64_t  primary_key;
+
+	friend bool operator<(const row_key& a, const row_key& b) {
+		return std::tie(a.code, a.scope, a.table, a.primary_key) < std::tie(b.code, b.scope, b.table, b.primary_key);
+	}
+};
+
+struct row_version {
+	uint64_t  transaction;
+	row       state;        // state.present is false, if row was removed by this transaction
+};
+
+// decode delta by ABI of its contract, returns nothing, if contract or table are not in 'abis'
+std::optional<row> decode(const std::map<name, const abi*>& abis, const host::table_delta& delta);
+
+/**
+ * History log, offline copy of state history: records of transaction number and its deltas.
+ * read_log() returns false at the end of log, throws on truncated or damaged record.
+ */
+void append_log(std::ostream& out, uint64_t transaction, const std::vector<host::table_delta>& deltas);
+bool read_log(std::istream& in, uint64_t& transaction, std::vector<host::table_delta>& deltas);
+
+/**
+ * Rows with their history and secondary indices:
+ *   by user      'accounts' rows scoped by user and orders of user
+ *   by status    'mintorders' and 'redeemorders' rows by their status
+ *   by contract  'authfcdbonds' rows by managing contract
+ */
+class store {
+public:
+	void apply(uint64_t transaction, const std::vector<row>& rows);
+
+	// current state
+	std::optional<row> get(const row_key& key) const;
+	std::vector<asset> balances(name code, name owner) const;
+	std::optional<int64_t> variable(name code, name scope, name varname) const;
+	std::vector<row> orders(name user) const;
+	std::vector<row> orders_by_status(name code, name table, name status) const;
+	std::vector<row> dbonds(name code, name contract) const;
+
+	// all states of the row, oldest first
+	std::vector<row_version> history(const row_key& key) const;
+
+	/**
+	 * Rows changed by transactions (after, upto], each in its state after 'upto', ordered by key.
+	 * Rows removed in this range are returned with present == false, if they existed after 'after'.
+	 */
+	std::vector<row_version> changes(uint64_t after, uint64_t upto) const;
+
+	uint64_t last_transaction() const;
+	size_t rows_count() const;
+	size_t versions_count() const;
+
+private:
+	using status_key = std::tuple<name, name, name>;     // code, table, status
+
+	void index(const row_key& key, const row& r);
+	void unindex(const row_key& key, const row& r);
+	std::vector<row> current(const std::set<row_key>& keys) const;
+
+	mutable std::shared_mutex                           m;
+	std::map<row_key, std::vector<row_version>>         rows;
+	std::map<name, std::set<row_key>>                   by_user;
+	std::map<status_key, std::set<row_key>>             by_status;
+	std::map<std::pair<name, name>, std::set<row_key>>  by_contract;
+	uint64_t                                            last = 0;
+	size_t                                              versions = 0;
+};
+
+/**
+ * Pipeline feeding the store: push() queues deltas of one transaction, worker threads decode
+ * them, applier thread applies decoded transactions strictly in order of push().
+ * push() blocks, when 'queue_limit' pushed transactions are not applied yet.
+ */
+class pipeline {
+public:
+	pipeline(store& s, std::map<name, const abi*> abis, unsigned threads, size_t queue_limit = 1024);
+	~pipeline();
+
+	void push(uint64_t transaction, std::vector<host::table_delta> deltas);
+
+	// wait until everything pushed is applied and stop threads; rethrows decoding errors
+	void finish();
+
+	// deltas of contracts or tables not described by ABIs
+	uint64_t skipped() const { return skipped_count; }
+
+private:
+	struct job {
+		uint64_t                       seq;
+		uint64_t                       transaction;
+		std::vector<host::table_delta> deltas;
+	};
+
+	struct decoded {
+		uint64_t          transaction;
+		std::vector<row>  rows;
+	};
+
+	void decode_loop();
+	void apply_loop();
+
+	store&                                target;
+	std::map<name, const abi*>            abis;
+	size_t                                limit;
+
+	std::mutex                            m;
+	std::condition_variable               jobs_ready, jobs_space, decoded_ready;
+	std::deque<job>                       jobs;
+	std::map<uint64_t, decoded>           ready;
+	uint64_t                              next_seq = 0;
+	uint64_t                              applied_seq = 0;
+	bool                                  closing = false;
+	int                                   decoders_running = 0;
+	std::string                           error;
+	std::atomic<uint64_t>                 skipped_count{0};
+
+	std::vector<std::thread>              decoders;
+	std::thread                           applier;
+};
+
+} // namespace indexer
@@ -0,0 +1,332 @@
+/**
+ *  loadgen.cpp -- load generator for host builds of contracts
+ *  usage: loadgen [-u users] [-n transactions] [-j threads] [-m mix] [-c block_cpu_us] [-s slowdown] [-r seed]
+ *                 [-i indexer_threads] [-d history.log]
+ *
+ *  Boots the chain as test/boot.sh does, creates users holding DBTC and DUSD, then worker threads
+ *  build transactions of given mix and queue them to single producer, which executes them and
+ *  packs into blocks of 500 ms chain time and 'block_cpu_us' of CPU (200000 as in nodeos genesis).
+ *  Mix is comma separated list of kind=weight, kinds are mint, redeem, btc and p2p:
+ *    mint    DBTC => DUSD
+ *    redeem  DUSD => DBTC
+ *    btc     DUSD => BTC address
+ *    p2p     DUSD transfer between users
+ *  CPU is measured for native code, -s multiplies it when filling blocks to estimate wasm execution.
+ *  Accounts have no keys in host chain, so transactions are built but not signed.
+ *  Reports throughput, latency from queueing to inclusion, and rejection counts by check() message.
+ *  -i feeds table deltas of every transaction, boot included, to indexer.hpp pipeline with given
+ *  number of decoding threads, and reports how far indexer lags behind the producer.
+ *  -d writes table deltas of every transaction to history log for host/export.
+ */
+
+#include "indexer.hpp"
+#include "scenarios.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace scenarios;
+
+namespace {
+
+using clock_type = chrono::steady_clock;
+
+const uint64_t block_interval_us = 500000;
+const size_t   queue_limit = 4096;
+
+enum kind { mint, redeem, btc, p2p, kinds_count };
+const char* kind_names[] = {"mint", "redeem", "btc", "p2p"};
+
+struct pending_tx {
+	kind                     k;
+	host::packed_action      act;
+	clock_type::time_point   queued;
+};
+
+// bounded queue between transaction building threads and producer
+class tx_queue {
+public:
+	void push(pending_tx tx) {
+		unique_lock<mutex> lock(m);
+		not_full.wait(lock, [&] { return q.size() < queue_limit; });
+		tx.queued = clock_type::now();
+		q.push_back(move(tx));
+		not_empty.notify_one();
+	}
+
+	// returns false, when all producers are done and queue is empty
+	bool pop(pending_tx& tx) {
+		unique_lock<mutex> lock(m);
+		not_empty.wait(lock, [&] { return !q.empty() || writers == 0; });
+		if(q.empty())
+			return false;
+		tx = move(q.front());
+		q.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+
+	void set_writers(int n) {
+		lock_guard<mutex> lock(m);
+		writers = n;
+	}
+
+	void writer_done() {
+		lock_guard<mutex> lock(m);
+		writers--;
+		not_empty.notify_all();
+	}
+
+private:
+	mutex                m;
+	condition_variable   not_empty, not_full;
+	deque<pending_tx>    q;
+	int                  writers = 0;
+};
+
+name user_name(size_t i) {
+	string str = "loadtest";
+	for(int d = 0; d < 4; d++, i /= 26)
+		str += char('a' + i % 26);
+	return name(str);
+}
+
+vector<double> parse_mix(const string& str) {
+	vector<double> weights(kinds_count, 0);
+	istringstream in(str);
+	string item;
+	while(getline(in, item, ',')) {
+		auto eq = item.find('=');
+		string k = item.substr(0, eq);
+		auto found = find(begin(kind_names), end(kind_names), k);
+		if(found == end(kind_names) || eq == string::npos)
+			throw runtime_error("bad mix item: " + item);
+		weights[found - begin(kind_names)] = atof(item.c_str() + eq + 1);
+	}
+	return weights;
+}
+
+pending_tx make_tx(kind k, const vector<name>& users, mt19937_64& rng) {
+	name user = users[rng() % users.size()];
+	auto bank_transfer = [&](asset quantity, const string& memo) {
+		return host::make_action(BANK_ACC, name("transfer"), user, user, BANK_ACC, quantity, memo);
+	};
+	switch(k) {
+	case mint:
+		return {k, host::make_action(CUSTODIAN_ACC, name("transfer"), user, user, BANK_ACC,
+			asset(1000 + rng() % 9000, DBTC), string("Buy DUSD")), {}};
+	case redeem:
+		return {k, bank_transfer(asset(10 + rng() % 90, DUSD), "Redeem for DBTC"), {}};
+	case btc:
+		return {k, bank_transfer(asset(10 + rng() % 90, DUSD), "2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxM"), {}};
+	default: {
+		name to = users[rng() % users.size()];
+		if(to == user)
+			to = TEST_ACC;
+		return {k, host::make_action(BANK_ACC, name("transfer"), user, user, to, asset(1 + rng() % 10, DUSD), string("p2p")), {}};
+	}
+	}
+}
+
+void usage() {
+	cerr << "usage: loadgen [-u users] [-n transactions] [-j threads] [-m mix] [-c block_cpu_us] [-s slowdown] [-r seed]" << endl
+	     << "               [-i indexer_threads] [-d history.log]" << endl;
+	exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	size_t users_count = 100, total = 100000;
+	unsigned threads = max(1u, thread::hardware_concurrency());
+	string mix = "mint=1,redeem=1,btc=1,p2p=4";
+	double block_cpu_us = 200000, slowdown = 1;
+	uint64_t seed = 1;
+	unsigned indexer_threads = 0;
+	string history_file;
+
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(i + 1 >= argc)
+			usage();
+		const char* value = argv[++i];
+		if(arg == "-u")
+			users_count = max(1, atoi(value));
+		else if(arg == "-n")
+			total = max(1, atoi(value));
+		else if(arg == "-j")
+			threads = max(1, atoi(value));
+		else if(arg == "-m")
+			mix = value;
+		else if(arg == "-c")
+			block_cpu_us = atof(value);
+		else if(arg == "-s")
+			slowdown = atof(value);
+		else if(arg == "-r")
+			seed = strtoull(value, nullptr, 10);
+		else if(arg == "-i")
+			indexer_threads = max(1, atoi(value));
+		else if(arg == "-d")
+			history_file = value;
+		else
+			usage();
+	}
+
+	try {
+		auto weights = parse_mix(mix);
+
+		indexer::store index;
+		unique_ptr<indexer::pipeline> index_feed;
+		ofstream history;
+		uint64_t logged_transactions = 0;
+		auto feed_index = [&]() {
+			for(auto& deltas : host::take_deltas()) {
+				logged_transactions++;
+				if(history.is_open())
+					indexer::append_log(history, logged_transactions, deltas);
+				if(index_feed)
+					index_feed->push(logged_transactions, move(deltas));
+			}
+		};
+		if(!history_file.empty()) {
+			history.open(history_file, ios::binary | ios::trunc);
+			if(!history)
+				throw runtime_error("cannot write " + history_file);
+		}
+		host::set_deltas(indexer_threads || history.is_open());
+		if(indexer_threads) {
+			index_feed = make_unique<indexer::pipeline>(index, map<name, const indexer::abi*>{
+				{BANK_ACC, &indexer::bank_abi()},
+				{CUSTODIAN_ACC, &indexer::custodian_abi()},
+				{EOSIO_TOKEN, &indexer::token_abi()},
+			}, indexer_threads);
+		}
+
+		// users are funded with checks disabled, as it is done by test/boot.sh;
+		// orders are small comparing to bank capital of 1 BTC set by boot()
+		boot();
+		vector<name> users;
+		for(size_t i = 0; i < users_count; i++) {
+			name user = user_name(i);
+			host::create_account(user);
+			must_pass("mint DBTC for " + user.to_string(), mint_dbtc(user, 1000000));
+			must_pass("buy DUSD for " + user.to_string(), transfer_dbtc(user, BANK_ACC, asset(500000, DBTC), "Buy DUSD"));
+			users.push_back(user);
+		}
+		must_pass("settlement", setvar(name("settlement"), 0));
+		feed_index();
+
+		tx_queue queue;
+		queue.set_writers(threads);
+		vector<thread> workers;
+		for(unsigned t = 0; t < threads; t++) {
+			size_t count = total / threads + (t < total % threads ? 1 : 0);
+			workers.emplace_back([&, t, count]() {
+				mt19937_64 rng(seed + t);
+				discrete_distribution<int> pick(weights.begin(), weights.end());
+				for(size_t i = 0; i < count; i++)
+					queue.push(make_tx(kind(pick(rng)), users, rng));
+				queue.writer_done();
+			});
+		}
+
+		vector<uint64_t> latencies;
+		latencies.reserve(total);
+		map<string, uint64_t> rejections;
+		uint64_t accepted[kinds_count] = {}, rejected[kinds_count] = {};
+		uint64_t blocks = 1, block_txs = 0, max_block_txs = 0;
+		double block_cpu = 0, total_cpu = 0;
+
+		auto start = clock_type::now();
+		pending_tx tx;
+		while(queue.pop(tx)) {
+			auto begin = clock_type::now();
+			auto result = host::push_transaction({tx.act});
+			auto done = clock_type::now();
+			feed_index();
+			double cpu = chrono::duration<double, micro>(done - begin).count() * slowdown;
+			total_cpu += cpu;
+
+			if(block_cpu + cpu > block_cpu_us && block_txs > 0) {
+				max_block_txs = max(max_block_txs, block_txs);
+				host::advance_time(block_interval_us);
+				blocks++;
+				block_cpu = 0;
+				block_txs = 0;
+			}
+			block_cpu += cpu;
+			block_txs++;
+
+			latencies.push_back(chrono::duration_cast<chrono::microseconds>(done - tx.queued).count());
+			if(result.failed) {
+				rejected[tx.k]++;
+				// DEBUG builds print the reason of overdrawn balance and fail with empty message
+				rejections[result.error.empty() ? "(empty message)" : result.error]++;
+			}
+			else
+				accepted[tx.k]++;
+		}
+		double seconds = chrono::duration<double>(clock_type::now() - start).count();
+		for(auto& w : workers)
+			w.join();
+		double index_lag = 0;
+		if(index_feed) {
+			auto produced = clock_type::now();
+			index_feed->finish();
+			index_lag = chrono::duration<double>(clock_type::now() - produced).count();
+		}
+		max_block_txs = max(max_block_txs, block_txs);
+
+		sort(latencies.begin(), latencies.end());
+		auto percentile = [&](double p) {
+			return latencies.empty() ? 0 : latencies[min(latencies.size() - 1, size_t(p * latencies.size()))];
+		};
+		double avg_cpu = total_cpu / max<size_t>(1, latencies.size());
+
+		printf("transactions  %zu by %u threads, %zu users\n", latencies.size(), threads, users_count);
+		printf("throughput    %.0f tx/s wall clock\n", latencies.size() / seconds);
+		printf("cpu           %.1f us per transaction%s\n", avg_cpu, slowdown != 1 ? " (scaled)" : "");
+		printf("blocks        %llu, up to %llu transactions per block\n", (unsigned long long)blocks, (unsigned long long)max_block_txs);
+		printf("block limit   %.0f tx/s at %.0f us of cpu per block\n", block_cpu_us / avg_cpu * 1000000 / block_interval_us, block_cpu_us);
+		printf("latency us    p50 %llu, p90 %llu, p99 %llu, max %llu\n",
+			(unsigned long long)percentile(0.5), (unsigned long long)percentile(0.9),
+			(unsigned long long)percentile(0.99), (unsigned long long)(latencies.empty() ? 0 : latencies.back()));
+		if(index_feed)
+			printf("indexer       %llu transactions, %zu rows, %zu versions, %llu skipped deltas, %.3f s behind producer\n",
+				(unsigned long long)index.last_transaction(), index.rows_count(), index.versions_count(),
+				(unsigned long long)index_feed->skipped(), index_lag);
+		printf("\n%-8s %10s %10s\n", "kind", "accepted", "rejected");
+		for(int k = 0; k < kinds_count; k++)
+			if(accepted[k] + rejected[k])
+				printf("%-8s %10llu %10llu\n", kind_names[k], (unsigned long long)accepted[k], (unsigned long long)rejected[k]);
+		if(!rejections.empty()) {
+			vector<pair<uint64_t, string>> sorted;
+			for(const auto& [msg, count] : rejections)
+				sorted.emplace_back(count, msg);
+			sort(sorted.rbegin(), sorted.rend());
+			printf("\n%-10s %6s  %s\n", "rejected", "rate", "message");
+			for(const auto& [count, msg] : sorted)
+				printf("%10llu %5.1f%%  %s\n", (unsigned long long)count, 100.0 * count / latencies.size(), msg.c_str());
+		}
+	}
+	catch(const exception& e) {
+		cerr << "loadgen: " << e.what() << endl;
+		return 2;
+	}
+	return 0;
+}
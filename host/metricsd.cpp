@@ -0,0 +1,181 @@
+/**
+ *  metricsd.cpp -- Prometheus exporter of bank health metrics
+ *  usage: metricsd -f history.log [-p port] [-i interval_ms] [-n]
+ *
+ *  Follows history log (written by loadgen -d, see append_log() in indexer.hpp) like tail -f:
+ *  every 'interval_ms' (default 250) new records are applied to health monitor (see health.hpp),
+ *  and GET /metrics on 127.0.0.1:port (default 9464) returns metrics in Prometheus text format.
+ *  A scrape only formats values already kept by the monitor, it does not read tables.
+ *  History log has no block times, so metrics are computed at the latest mtime of bank variables.
+ *  A log truncated or rewritten by a new loadgen run is read again from the beginning.
+ *  -n prints metrics of the whole log once and exits.
+ */
+
+#include "health.hpp"
+#include "indexer.hpp"
+#include "scenarios.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace scenarios;
+
+namespace {
+
+// reads complete records appended to history log since the previous call
+class log_follower {
+public:
+	explicit log_follower(const string& file) : file(file) {}
+
+	// returns false, if log was truncated and monitor must be rebuilt
+	bool poll(health::monitor& monitor) {
+		ifstream in(file, ios::binary | ios::ate);
+		if(!in)
+			return true;
+		streamoff size = in.tellg();
+		if(size < pos) {
+			pos = 0;
+			return false;
+		}
+		in.seekg(pos);
+		uint64_t transaction;
+		vector<host::table_delta> deltas;
+		try {
+			while(indexer::read_log(in, transaction, deltas)) {
+				monitor.apply(deltas);
+				pos = in.tellg();
+			}
+		}
+		catch(const runtime_error&) {
+			// the last record is being written, it is read on the next poll
+		}
+		return true;
+	}
+
+private:
+	string   file;
+	streamoff pos = 0;
+};
+
+int listen_local(int port) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0)
+		throw runtime_error(string("socket: ") + strerror(errno));
+	int yes = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 16) < 0)
+		throw runtime_error("cannot listen on port " + to_string(port) + ": " + strerror(errno));
+	return fd;
+}
+
+void serve(int client, const health::monitor& monitor) {
+	// request line is all that is needed, scrapers send short requests
+	char request[4096];
+	pollfd p{client, POLLIN, 0};
+	ssize_t n = ::poll(&p, 1, 1000) > 0 ? recv(client, request, sizeof(request) - 1, 0) : 0;
+	request[max<ssize_t>(n, 0)] = 0;
+
+	string status = "200 OK", body;
+	if(strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0)
+		body = monitor.render(monitor.head_time());
+	else {
+		status = "404 Not Found";
+		body = "try /metrics\n";
+	}
+	string response = "HTTP/1.1 " + status + "\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: " + to_string(body.size()) + "\r\n"
+		"Connection: close\r\n\r\n" + body;
+	for(size_t sent = 0; sent < response.size(); ) {
+		ssize_t r = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+		if(r <= 0)
+			break;
+		sent += r;
+	}
+}
+
+void usage() {
+	cerr << "usage: metricsd -f history.log [-p port] [-i interval_ms] [-n]" << endl;
+	exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	string log_file;
+	int port = 9464, interval_ms = 250;
+	bool once = false;
+
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(arg == "-n") {
+			once = true;
+			continue;
+		}
+		if(i + 1 >= argc)
+			usage();
+		const char* value = argv[++i];
+		if(arg == "-f")
+			log_file = value;
+		else if(arg == "-p")
+			port = atoi(value);
+		else if(arg == "-i")
+			interval_ms = max(1, atoi(value));
+		else
+			usage();
+	}
+	if(log_file.empty())
+		usage();
+
+	try {
+		auto monitor = make_unique<health::monitor>(BANK_ACC, CUSTODIAN_ACC, EOSIO_TOKEN);
+		log_follower follower(log_file);
+		auto update = [&]() {
+			if(!follower.poll(*monitor)) {
+				monitor = make_unique<health::monitor>(BANK_ACC, CUSTODIAN_ACC, EOSIO_TOKEN);
+				follower.poll(*monitor);
+			}
+		};
+
+		update();
+		if(once) {
+			fputs(monitor->render(monitor->head_time()).c_str(), stdout);
+			return 0;
+		}
+
+		int server = listen_local(port);
+		cerr << "metricsd: serving http://127.0.0.1:" << port << "/metrics" << endl;
+		while(true) {
+			pollfd p{server, POLLIN, 0};
+			if(::poll(&p, 1, interval_ms) > 0) {
+				int client = accept(server, nullptr, nullptr);
+				if(client >= 0) {
+					serve(client, *monitor);
+					close(client);
+				}
+			}
+			update();
+		}
+	}
+	catch(const exception& e) {
+		cerr << "metricsd: " << e.what() << endl;
+		return 2;
+	}
+}
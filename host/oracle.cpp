@@ -0,0 +1,300 @@
+/**
+ *  oracle.cpp -- oracle feeder, see oracle.hpp
+ */
+
+#include "oracle.hpp"
+
+#include <eosio/multi_index.hpp>
+#include <eosio/system.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+
+namespace oracle {
+
+namespace {
+
+	struct variable_row {
+		name              var_name;
+		int64_t           value;
+		eosio::time_point mtime;
+
+		uint64_t primary_key() const { return var_name.value; }
+	};
+
+	using variables = eosio::multi_index<name("variables"), variable_row>;
+
+	// "btcusd 10000.00" lines, unknown names are skipped
+	bool parse(std::istream& in, quote& q) {
+		quote result;
+		std::string varname, price;
+		while(in >> varname >> price) {
+			char* end;
+			double value = strtod(price.c_str(), &end);
+			if(*end || !(value > 0))
+				return false;
+			if(varname == "btcusd")
+				result.btcusd = llround(value * 1e8);
+			else if(varname == "eosusd")
+				result.eosusd = llround(value * 1e8);
+		}
+		if(!result.btcusd && !result.eosusd)
+			return false;
+		q = result;
+		return true;
+	}
+
+	class file_reader : public source {
+	public:
+		explicit file_reader(std::string path) : path(std::move(path)) {}
+
+		std::string describe() const override { return "file:" + path; }
+
+		bool read(quote& q) override {
+			std::ifstream in(path);
+			return in && parse(in, q);
+		}
+
+	private:
+		std::string path;
+	};
+
+	class tcp_reader : public source {
+	public:
+		tcp_reader(int port, int timeout_ms) : port(port), timeout_ms(timeout_ms) {}
+
+		std::string describe() const override { return "tcp:" + std::to_string(port); }
+
+		bool read(quote& q) override {
+			int fd = socket(AF_INET, SOCK_STREAM, 0);
+			if(fd < 0)
+				return false;
+			std::string data;
+			bool complete = fetch(fd, data);
+			close(fd);
+			std::istringstream in(data);
+			return complete && parse(in, q);
+		}
+
+	private:
+		// reads until peer closes connection, whole exchange is limited by 'timeout_ms'
+		bool fetch(int fd, std::string& data) {
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+			sockaddr_in addr{};
+			addr.sin_family = AF_INET;
+			addr.sin_port = htons(port);
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			if(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS)
+				return false;
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+			char buf[4096];
+			while(true) {
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+				pollfd p{fd, POLLIN, 0};
+				if(left <= 0 || ::poll(&p, 1, int(left)) <= 0)
+					return false;
+				ssize_t n = recv(fd, buf, sizeof(buf), 0);
+				if(n == 0)
+					return true;
+				if(n < 0) {
+					if(errno == EAGAIN || errno == EINTR)
+						continue;
+					return false;
+				}
+				data.append(buf, n);
+			}
+		}
+
+		int port;
+		int timeout_ms;
+	};
+
+	limit_state read_limit(const variables& periodic, const variables& previous, name varname) {
+		limit_state result;
+		auto itr = periodic.find(varname.value);
+		if(itr == periodic.end())
+			return result;
+		result.value = itr->value;
+		result.mtime = itr->mtime.time_since_epoch().count();
+		auto prev = previous.find(varname.value);
+		if(prev != previous.end())
+			result.previous = prev->value;
+		return result;
+	}
+
+} // namespace
+
+std::unique_ptr<source> file_source(const std::string& path) {
+	return std::make_unique<file_reader>(path);
+}
+
+std::unique_ptr<source> tcp_source(int port, int timeout_ms) {
+	return std::make_unique<tcp_reader>(port, timeout_ms);
+}
+
+std::unique_ptr<source> make_source(const std::string& spec) {
+	if(spec.compare(0, 5, "file:") == 0)
+		return file_source(spec.substr(5));
+	if(spec.compare(0, 4, "tcp:") == 0)
+		return tcp_source(atoi(spec.c_str() + 4));
+	throw std::runtime_error("bad price source: " + spec);
+}
+
+int64_t median(std::vector<int64_t> values) {
+	values.erase(std::remove(values.begin(), values.end(), 0), values.end());
+	if(values.empty())
+		return 0;
+	size_t middle = values.size() / 2;
+	std::nth_element(values.begin(), values.begin() + middle, values.end());
+	if(values.size() % 2)
+		return values[middle];
+	int64_t upper = values[middle];
+	int64_t lower = *std::max_element(values.begin(), values.begin() + middle);
+	return lower + (upper - lower) / 2;
+}
+
+quote combine(const std::vector<quote>& quotes) {
+	std::vector<int64_t> btc, eos;
+	for(const auto& q : quotes) {
+		btc.push_back(q.btcusd);
+		eos.push_back(q.eosusd);
+	}
+	return {median(btc), median(eos)};
+}
+
+chain_view read_chain(name bank) {
+	variables system(bank, name("system").value);
+	variables periodic(bank, name("periodic").value);
+	variables previous(bank, name("previous").value);
+
+	chain_view result;
+	auto min_age = system.find(name("minlimitsage").value);
+	auto max_prct = system.find(name("maxlimitprct").value);
+	if(min_age == system.end() || max_prct == system.end())
+		throw std::runtime_error("minlimitsage or maxlimitprct is not defined");
+	// same scaling as token::setvar
+	result.min_age = min_age->value / 100000000;
+	result.max_k = max_prct->value * 1e-10;
+	result.low = read_limit(periodic, previous, name("btcusd.low"));
+	result.high = read_limit(periodic, previous, name("btcusd.high"));
+	auto btcusd = periodic.find(name("btcusd").value);
+	if(btcusd != periodic.end())
+		result.btcusd = btcusd->value;
+	auto eosusd = periodic.find(name("eosusd").value);
+	if(eosusd != periodic.end())
+		result.eosusd = eosusd->value;
+	return result;
+}
+
+std::optional<int64_t> plan_limit(const limit_state& limit, int64_t target, const chain_view& chain, const band_policy& policy, int64_t now) {
+	if(target <= 0)
+		return std::nullopt;
+	// a new limit is not checked by token::setvar
+	if(!limit.value)
+		return target;
+	if((now - limit.mtime) / 1000000 < chain.min_age)
+		return std::nullopt;
+	if(std::abs(target - limit.value) <= policy.deadband * target)
+		return std::nullopt;
+
+	// k is measured against the value before the previous change, so two full steps in one direction
+	// would leave no room for the third one: a step is at most sqrt(1 -+ k) of the current value,
+	// then the next step of the same size stays within k of the value before this change
+	double k = chain.max_k * policy.margin;
+	int64_t base = limit.previous ? limit.previous : limit.value;
+	int64_t lowest = int64_t(std::ceil(std::max(base * (1 - k), limit.value * std::sqrt(std::max(0.0, 1 - k)))));
+	int64_t highest = int64_t(std::floor(std::min(base * (1 + k), limit.value * std::sqrt(1 + k))));
+	lowest = std::max<int64_t>(lowest, 1);
+	if(lowest > highest)
+		return std::nullopt;
+	int64_t next = std::clamp(target, lowest, highest);
+	if(std::abs(target - next) >= std::abs(target - limit.value))
+		return std::nullopt;
+	return next;
+}
+
+tick_plan plan(const quote& median, const chain_view& chain, const band_policy& policy, int64_t now) {
+	tick_plan result;
+	if(median.btcusd) {
+		result.low = plan_limit(chain.low, llround(median.btcusd * (1 - policy.width)), chain, policy, now);
+		result.high = plan_limit(chain.high, llround(median.btcusd * (1 + policy.width)), chain, policy, now);
+		int64_t low = result.low.value_or(chain.low.value);
+		int64_t high = result.high.value_or(chain.high.value);
+		if(low >= high) {
+			result.low.reset();
+			result.high.reset();
+			low = chain.low.value;
+			high = chain.high.value;
+		}
+		if(median.btcusd >= low && median.btcusd <= high)
+			result.btcusd = median.btcusd;
+		else
+			result.held = true;
+	}
+	if(median.eosusd && median.eosusd != chain.eosusd)
+		result.eosusd = median.eosusd;
+	return result;
+}
+
+std::vector<host::packed_action> actions(const tick_plan& p, name bank, name oracle_acc) {
+	std::vector<host::packed_action> result;
+	const name periodic("periodic"), setvar("setvar");
+	auto add = [&](const char* varname, const std::optional<int64_t>& value) {
+		if(value)
+			result.push_back(host::make_action(bank, setvar, oracle_acc, periodic, name(varname), *value));
+	};
+	add("btcusd.low", p.low);
+	add("btcusd.high", p.high);
+	add("btcusd", p.btcusd);
+	add("eosusd", p.eosusd);
+	return result;
+}
+
+feeder::feeder(std::vector<std::unique_ptr<source>> s, band_policy p, name b, name o)
+	: sources(std::move(s)), policy(p), bank(b), oracle_acc(o) {}
+
+tick_report feeder::tick() {
+	auto start = std::chrono::steady_clock::now();
+	tick_report report;
+
+	std::vector<std::future<std::optional<quote>>> reads;
+	for(auto& s : sources)
+		reads.push_back(std::async(std::launch::async, [src = s.get()]() -> std::optional<quote> {
+			quote q;
+			if(src->read(q))
+				return q;
+			return std::nullopt;
+		}));
+	std::vector<quote> quotes;
+	for(auto& r : reads)
+		if(auto q = r.get())
+			quotes.push_back(*q);
+	report.sources_read = quotes.size();
+	report.median = combine(quotes);
+
+	int64_t now = eosio::current_time_point().time_since_epoch().count();
+	report.plan = plan(report.median, read_chain(bank), policy, now);
+	auto acts = actions(report.plan, bank, oracle_acc);
+	if(!acts.empty()) {
+		report.result = host::push_transaction(acts);
+		report.pushed = true;
+	}
+	report.latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+	return report;
+}
+
+} // namespace oracle
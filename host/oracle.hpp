@@ -0,0 +1,127 @@
+/**
+ *  oracle.hpp -- oracle feeder: median of price sources pushed to 'periodic' scope of the bank
+ *
+ *  token::setvar limits moves of btcusd.low and btcusd.high: a limit may change only when its
+ *  value is at least 'minlimitsage' old, and by at most 'maxlimitprct' of the value it had before
+ *  its previous change (row of 'previous' scope). btcusd itself must stay within the limits.
+ *  Planner moves every limit towards the band around the median as far as these checks allow,
+ *  so no update is rejected, and holds btcusd while the median is outside the band it can reach.
+ *  All updates of a tick are actions of one transaction: limits first, then btcusd and eosusd.
+ */
+#pragma once
+
+#include "chain.hpp"
+
+#include <eosio/name.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace oracle {
+
+using eosio::name;
+
+// prices in scale of 'periodic' variables, 1e8 per USD, 0 if source has no price
+struct quote {
+	int64_t btcusd = 0;
+	int64_t eosusd = 0;
+};
+
+class source {
+public:
+	virtual ~source() = default;
+
+	virtual std::string describe() const = 0;
+
+	// the latest prices, false if source is unavailable at this tick
+	virtual bool read(quote& q) = 0;
+};
+
+/**
+ * File with lines "btcusd 10000.00" and "eosusd 3.0000", read again at every tick,
+ * so price scrapers only rewrite it.
+ */
+std::unique_ptr<source> file_source(const std::string& path);
+
+// 127.0.0.1:port sends lines of the same format and closes connection
+std::unique_ptr<source> tcp_source(int port, int timeout_ms = 200);
+
+// "file:path" or "tcp:port"
+std::unique_ptr<source> make_source(const std::string& spec);
+
+// median of non-zero values, 0 if there are none
+int64_t median(std::vector<int64_t> values);
+
+// median of every price over given quotes
+quote combine(const std::vector<quote>& quotes);
+
+// btcusd.low or btcusd.high as token::setvar sees it
+struct limit_state {
+	int64_t value = 0;
+	int64_t mtime = 0;           // microseconds since epoch
+	int64_t previous = 0;        // value before the last change, 0 if it has not changed yet
+};
+
+// oracle data and rate limits, as stored by the bank
+struct chain_view {
+	int64_t     min_age = 0;     // minlimitsage in microseconds
+	double      max_k = 0;       // maxlimitprct as a share
+	limit_state low, high;
+	int64_t     btcusd = 0;
+	int64_t     eosusd = 0;
+};
+
+chain_view read_chain(name bank);
+
+struct band_policy {
+	double width = 0.5;          // band is median * (1 -+ width)
+	double deadband = 0.1;       // a limit stays, while it differs from its target by less than this share
+	double margin = 0.98;        // share of maxlimitprct a move may use
+};
+
+/**
+ * Next value of a limit moving to 'target', nullopt if it must stay: it is too young, is within
+ * deadband of the target, or the range allowed by maxlimitprct brings it no closer to the target.
+ */
+std::optional<int64_t> plan_limit(const limit_state& limit, int64_t target, const chain_view& chain, const band_policy& policy, int64_t now);
+
+struct tick_plan {
+	std::optional<int64_t> low, high, btcusd, eosusd;
+	bool                   held = false;     // median is outside of reachable band, btcusd is not updated
+};
+
+tick_plan plan(const quote& median, const chain_view& chain, const band_policy& policy, int64_t now);
+
+// setvar actions of the plan authorized by 'oracle_acc', in order required by token::setvar
+std::vector<host::packed_action> actions(const tick_plan& p, name bank, name oracle_acc);
+
+struct tick_report {
+	quote                      median;
+	size_t                     sources_read = 0;
+	tick_plan                  plan;
+	host::transaction_result   result;
+	bool                       pushed = false;     // false, if there was nothing to update
+	std::chrono::microseconds  latency{0};         // from tick start to execution of transaction
+};
+
+/**
+ * Reads all sources concurrently, so a slow source delays the tick by its timeout only,
+ * plans updates at current chain time and pushes them as one transaction.
+ */
+class feeder {
+public:
+	feeder(std::vector<std::unique_ptr<source>> sources, band_policy policy, name bank, name oracle_acc);
+
+	tick_report tick();
+
+private:
+	std::vector<std::unique_ptr<source>> sources;
+	band_policy                          policy;
+	name                                 bank, oracle_acc;
+};
+
+} // namespace oracle
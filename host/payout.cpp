@@ -0,0 +1,122 @@
+/**
+ *  payout.cpp -- redemption payout engine over host chain and regtest wallet stand-in
+ *  usage: payout [-n orders] [-u users] [-k min_outputs] [-m max_outputs] [-a max_age_s] [-f fee_rate] [-j journal] [-r seed]
+ *
+ *  Boots the chain as test/boot.sh does, users get DBTC and redeem random amounts to random
+ *  addresses, about one order per minute of chain time. Every minute the engine (see payouts.hpp)
+ *  pays due orders from a wallet funded with 10 BTC, journal is 'journal' (default payout.journal,
+ *  removed at start). Reports batches and fees against paying every order by its own transaction.
+ */
+
+#include "deposits.hpp"
+#include "payouts.hpp"
+#include "scenarios.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace scenarios;
+
+namespace {
+
+name user_name(size_t i) {
+	string str = "payouttest";
+	for(int d = 0; d < 2; d++, i /= 26)
+		str += char('a' + i % 26);
+	return name(str);
+}
+
+void usage() {
+	cerr << "usage: payout [-n orders] [-u users] [-k min_outputs] [-m max_outputs] [-a max_age_s] [-f fee_rate] [-j journal] [-r seed]" << endl;
+	exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	size_t orders = 1000, users = 50;
+	payouts::policy policy;
+	string journal = "payout.journal";
+	uint64_t seed = 1;
+
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(i + 1 >= argc)
+			usage();
+		const char* value = argv[++i];
+		if(arg == "-n")
+			orders = strtoull(value, nullptr, 10);
+		else if(arg == "-u")
+			users = max(1, atoi(value));
+		else if(arg == "-k")
+			policy.min_outputs = max(1, atoi(value));
+		else if(arg == "-m")
+			policy.max_outputs = max(1, atoi(value));
+		else if(arg == "-a")
+			policy.max_age = max(0, atoi(value));
+		else if(arg == "-f")
+			policy.fee_rate = max(1, atoi(value));
+		else if(arg == "-j")
+			journal = value;
+		else if(arg == "-r")
+			seed = strtoull(value, nullptr, 10);
+		else
+			usage();
+	}
+
+	try {
+		mt19937_64 rng(seed);
+		boot();
+		must_pass("settlement", setvar(name("settlement"), 0));
+		vector<name> accounts;
+		vector<string> addresses;
+		for(size_t i = 0; i < users; i++) {
+			accounts.push_back(user_name(i));
+			host::create_account(accounts.back());
+			must_pass("mint DBTC", mint_dbtc(accounts.back(), 100000000));
+			array<uint8_t, 20> hash;
+			for(auto& b : hash)
+				b = uint8_t(rng());
+			addresses.push_back(deposits::encode_address(i % 2 ? 0xc4 : 0x6f, hash));
+		}
+
+		payouts::wallet wallet("custody");
+		wallet.receive({string(64, 'f'), 0, 1000000000});
+		remove(journal.c_str());
+		payouts::engine engine(wallet, journal, policy, CUSTODIAN_ACC);
+
+		size_t batches = 0, paid = 0, created = 0;
+		int64_t fees = 0, single_fees = 0;
+		while(paid < orders) {
+			host::advance_time(60ull * 1000000);
+			if(created < orders) {
+				size_t u = rng() % users;
+				must_pass("redeem order", transfer_dbtc(accounts[u], CUSTODIAN_ACC, asset(10000 + rng() % 1000000, DBTC), addresses[rng() % users]));
+				created++;
+			}
+			auto report = engine.poll(host::current_time());
+			batches += report.batches;
+			paid += report.orders_paid;
+			fees += report.fees;
+			single_fees += report.single_fees;
+			for(const auto& e : report.errors)
+				printf("error: %s\n", e.c_str());
+			if(!report.errors.empty())
+				return 2;
+		}
+		printf("%zu orders paid by %zu transactions, %.1f orders per transaction\n", paid, batches, 1.0 * paid / max<size_t>(batches, 1));
+		printf("fees %lld satoshi, %lld if paid one by one, %.1f%% saved\n", (long long)fees, (long long)single_fees,
+			100.0 * (single_fees - fees) / max<int64_t>(single_fees, 1));
+		printf("wallet balance %lld satoshi\n", (long long)wallet.balance());
+	}
+	catch(const exception& e) {
+		cerr << "payout: " << e.what() << endl;
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,418 @@
+/**
+ *  payouts.cpp -- redemption payout engine, see payouts.hpp
+ */
+
+#include "payouts.hpp"
+#include "deposits.hpp"
+
+#include <eosio/asset.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/multi_index.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace payouts {
+
+namespace {
+
+	const int64_t dust = 546;
+
+	struct redeem_order_row {
+		uint64_t           id;
+		name               user;
+		name               status;
+		int64_t            btc_amount;
+		eosio::checksum256 btc_txid;
+		uint64_t           mtime;
+		std::string        btc_address;
+
+		uint64_t           primary_key() const { return id; }
+		uint64_t           get_secondary_1() const { return status.value; }
+		eosio::checksum256 get_secondary_2() const { return btc_txid; }
+	};
+
+	// the same indices as redeemOrders of depostoken.hpp
+	using redeem_orders = eosio::multi_index<name("redeemorders"), redeem_order_row,
+		eosio::indexed_by<name("status"), eosio::const_mem_fun<redeem_order_row, uint64_t, &redeem_order_row::get_secondary_1>>,
+		eosio::indexed_by<name("btctxid"), eosio::const_mem_fun<redeem_order_row, eosio::checksum256, &redeem_order_row::get_secondary_2>>>;
+
+	const eosio::symbol_code DBTC("DBTC");
+
+	eosio::checksum256 txid_key(const std::string& txid) {
+		auto bytes = deposits::from_hex(txid);
+		std::array<uint8_t, 32> key;
+		std::copy(bytes.begin(), bytes.end(), key.begin());
+		return eosio::checksum256(key);
+	}
+
+	void put_le(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+		for(int i = 0; i < bytes; i++, v >>= 8)
+			out.push_back(uint8_t(v & 0xff));
+	}
+
+	void put_bytes(std::vector<uint8_t>& out, const uint8_t* data, size_t size) {
+		out.push_back(uint8_t(size));
+		out.insert(out.end(), data, data + size);
+	}
+
+	struct parsed_tx {
+		std::vector<std::pair<std::string, uint32_t>> inputs;
+		btc_outputs                                   outputs;
+	};
+
+	// legacy serialization, as wallet::create() builds it
+	parsed_tx parse_tx(const std::vector<uint8_t>& raw) {
+		size_t pos = 0;
+		auto take = [&](size_t size) {
+			if(size > raw.size() - pos)
+				throw std::runtime_error("transaction is truncated");
+			const uint8_t* p = raw.data() + pos;
+			pos += size;
+			return p;
+		};
+		auto number = [&](int bytes) {
+			const uint8_t* p = take(bytes);
+			uint64_t v = 0;
+			for(int i = bytes; i--; )
+				v = v << 8 | p[i];
+			return v;
+		};
+		parsed_tx tx;
+		take(4);
+		for(uint64_t n = number(1); n; n--) {
+			hash256 prev;
+			std::copy_n(take(32), 32, prev.begin());
+			uint32_t vout = uint32_t(number(4));
+			tx.inputs.emplace_back(deposits::display_hex(prev), vout);
+			take(number(1));
+			take(4);
+		}
+		for(uint64_t n = number(1); n; n--) {
+			int64_t satoshi = int64_t(number(8));
+			size_t size = number(1);
+			const uint8_t* script = take(size);
+			tx.outputs.emplace_back(std::vector<uint8_t>(script, script + size), satoshi);
+		}
+		take(4);
+		if(pos != raw.size())
+			throw std::runtime_error("transaction has extra data");
+		return tx;
+	}
+
+} // namespace
+
+/*
+ * wallet
+ */
+wallet::wallet(std::string k) : key(std::move(k)) {
+	hash256 h = deposits::sha256d({{reinterpret_cast<const uint8_t*>(key.data()), key.size()}});
+	change_script = {0x76, 0xa9, 0x14};
+	change_script.insert(change_script.end(), h.begin(), h.begin() + 20);
+	change_script.insert(change_script.end(), {0x88, 0xac});
+}
+
+void wallet::receive(coin c) {
+	coins[{c.txid, c.vout}] = c;
+}
+
+signed_tx wallet::create(const btc_outputs& outputs, int64_t fee_rate) const {
+	int64_t total = 0;
+	for(const auto& o : outputs)
+		total += o.second;
+
+	std::vector<coin> available;
+	for(const auto& [id, c] : coins)
+		available.push_back(c);
+	std::stable_sort(available.begin(), available.end(), [](const coin& a, const coin& b) { return a.satoshi > b.satoshi; });
+
+	// signature of an input depends on the unsigned transaction, the key and input number
+	hash256 key_hash = deposits::sha256d({{reinterpret_cast<const uint8_t*>(key.data()), key.size()}});
+	auto serialize = [&](const std::vector<coin>& inputs, const btc_outputs& outs) {
+		auto build = [&](bool sign, const hash256& digest) {
+			std::vector<uint8_t> tx;
+			put_le(tx, 2, 4);
+			tx.push_back(uint8_t(inputs.size()));
+			for(size_t i = 0; i < inputs.size(); i++) {
+				auto prev = deposits::from_hex(inputs[i].txid);
+				tx.insert(tx.end(), prev.rbegin(), prev.rend());
+				put_le(tx, inputs[i].vout, 4);
+				if(sign) {
+					uint8_t n = uint8_t(i);
+					hash256 r = deposits::sha256d({{digest.data(), digest.size()}, {&n, 1}, {reinterpret_cast<const uint8_t*>(key.data()), key.size()}});
+					hash256 s = deposits::sha256d({{r.data(), r.size()}});
+					std::vector<uint8_t> sig = {0x30, 0x44, 0x02, 0x20};
+					sig.insert(sig.end(), r.begin(), r.end());
+					sig.insert(sig.end(), {0x02, 0x20});
+					sig.insert(sig.end(), s.begin(), s.end());
+					sig.push_back(0x01);
+					std::vector<uint8_t> pubkey = {0x02};
+					pubkey.insert(pubkey.end(), key_hash.begin(), key_hash.end());
+					std::vector<uint8_t> script;
+					put_bytes(script, sig.data(), sig.size());
+					put_bytes(script, pubkey.data(), pubkey.size());
+					put_bytes(tx, script.data(), script.size());
+				}
+				else
+					tx.push_back(0);
+				put_le(tx, 0xffffffff, 4);
+			}
+			tx.push_back(uint8_t(outs.size()));
+			for(const auto& [script, satoshi] : outs) {
+				put_le(tx, satoshi, 8);
+				put_bytes(tx, script.data(), script.size());
+			}
+			put_le(tx, 0, 4);
+			return tx;
+		};
+		auto unsigned_tx = build(false, {});
+		return build(true, deposits::sha256d({{unsigned_tx.data(), unsigned_tx.size()}}));
+	};
+
+	if(outputs.empty() || outputs.size() > 250)
+		throw std::runtime_error("transaction must have 1 to 250 outputs");
+	std::vector<coin> inputs;
+	int64_t in_total = 0;
+	for(const auto& c : available) {
+		if(inputs.size() == 250)
+			break;
+		inputs.push_back(c);
+		in_total += c.satoshi;
+
+		auto with_change = outputs;
+		with_change.emplace_back(change_script, 0);
+		int64_t fee = fee_rate * int64_t(serialize(inputs, with_change).size());
+		int64_t change = in_total - total - fee;
+		if(change >= dust) {
+			with_change.back().second = change;
+			signed_tx result;
+			result.raw = serialize(inputs, with_change);
+			result.fee = fee;
+			result.txid = deposits::display_hex(deposits::sha256d({{result.raw.data(), result.raw.size()}}));
+			return result;
+		}
+		// change below dust goes to fee
+		auto raw = serialize(inputs, outputs);
+		if(in_total - total >= fee_rate * int64_t(raw.size())) {
+			signed_tx result;
+			result.raw = std::move(raw);
+			result.fee = in_total - total;
+			result.txid = deposits::display_hex(deposits::sha256d({{result.raw.data(), result.raw.size()}}));
+			return result;
+		}
+	}
+	throw std::runtime_error("insufficient funds: " + std::to_string(total) + " satoshi to pay, wallet has " + std::to_string(balance()));
+}
+
+void wallet::broadcast(const signed_tx& tx) {
+	if(known(tx.txid))
+		return;
+	auto parsed = parse_tx(tx.raw);
+	for(const auto& input : parsed.inputs) {
+		auto s = spent.find(input);
+		if(s != spent.end())
+			throw std::runtime_error("txn-mempool-conflict: " + input.first + ":" + std::to_string(input.second) + " is spent by " + s->second);
+		if(!coins.count(input))
+			throw std::runtime_error("missing inputs: " + input.first + ":" + std::to_string(input.second));
+	}
+	for(const auto& input : parsed.inputs) {
+		coins.erase(input);
+		spent[input] = tx.txid;
+	}
+	for(uint32_t vout = 0; vout < parsed.outputs.size(); vout++) {
+		const auto& [script, satoshi] = parsed.outputs[vout];
+		paid[script] += satoshi;
+		if(script == change_script)
+			coins[{tx.txid, vout}] = {tx.txid, vout, satoshi};
+	}
+	broadcast_txids.insert(tx.txid);
+}
+
+int64_t wallet::balance() const {
+	int64_t result = 0;
+	for(const auto& [id, c] : coins)
+		result += c.satoshi;
+	return result;
+}
+
+int64_t wallet::paid_to(const std::vector<uint8_t>& script) const {
+	auto itr = paid.find(script);
+	return itr == paid.end() ? 0 : itr->second;
+}
+
+/*
+ * engine
+ */
+engine::engine(wallet& wl, std::string j, policy p, name c) : w(wl), journal(std::move(j)), pol(p), custodian(c) {
+	pol.max_outputs = std::clamp<size_t>(pol.max_outputs, 1, 250);
+	std::ifstream in(journal);
+	std::string line;
+	while(std::getline(in, line)) {
+		std::istringstream fields(line);
+		std::string kind, txid;
+		fields >> kind >> txid;
+		if(kind == "batch") {
+			batch b;
+			std::string ids, hex;
+			if(!(fields >> b.tx.fee >> ids >> hex))
+				throw std::runtime_error(journal + ": damaged batch " + txid);
+			b.tx.txid = txid;
+			b.tx.raw = deposits::from_hex(hex);
+			std::istringstream id_list(ids);
+			for(std::string id; std::getline(id_list, id, ','); )
+				b.orders.push_back(std::stoull(id));
+			batches[txid] = std::move(b);
+		}
+		else if(kind == "done" && batches.count(txid))
+			batches[txid].done = true;
+	}
+	if(!in.is_open())
+		append("");
+}
+
+void engine::append(const std::string& line) {
+	FILE* f = fopen(journal.c_str(), "a");
+	if(!f)
+		throw std::runtime_error("cannot write " + journal);
+	bool ok = fputs(line.c_str(), f) >= 0 && (line.empty() || fputc('\n', f) != EOF) && fflush(f) == 0 && fsync(fileno(f)) == 0;
+	fclose(f);
+	if(!ok)
+		throw std::runtime_error("cannot write " + journal);
+}
+
+bool engine::plan(int64_t now, batch& b, poll_report& report) {
+	std::set<uint64_t> busy;
+	for(const auto& [txid, other] : batches)
+		if(!other.done)
+			busy.insert(other.orders.begin(), other.orders.end());
+
+	redeem_orders orders(custodian, DBTC.raw());
+	auto by_status = orders.get_index<name("status")>();
+	std::vector<const redeem_order_row*> due;
+	for(auto itr = by_status.lower_bound(name("new").value); itr != by_status.end() && itr->status == name("new"); ++itr)
+		if(!busy.count(itr->id))
+			due.push_back(&*itr);
+	std::sort(due.begin(), due.end(), [](auto a, auto b) { return a->id < b->id; });
+	if(due.empty())
+		return false;
+	bool old = std::any_of(due.begin(), due.end(), [&](auto o) { return now - int64_t(o->mtime) >= pol.max_age * 1000000; });
+	if(due.size() < pol.min_outputs && !old)
+		return false;
+
+	// one output per address, in order of the oldest order to it
+	b = batch();
+	btc_outputs outputs;
+	std::map<std::vector<uint8_t>, size_t> output_of;
+	for(auto o : due) {
+		if(b.orders.size() == pol.max_outputs)
+			break;
+		auto script = deposits::address_script(o->btc_address);
+		if(!script) {
+			report.errors.push_back("order " + std::to_string(o->id) + ": invalid address " + o->btc_address);
+			continue;
+		}
+		auto [itr, added] = output_of.emplace(*script, outputs.size());
+		if(added)
+			outputs.emplace_back(*script, 0);
+		outputs[itr->second].second += o->btc_amount;
+		b.orders.push_back(o->id);
+	}
+	if(outputs.empty())
+		return false;
+	try {
+		b.tx = w.create(outputs, pol.fee_rate);
+	}
+	catch(const std::exception& e) {
+		report.errors.push_back(e.what());
+		return false;
+	}
+	report.batches++;
+	report.fees += b.tx.fee;
+	for(auto o : due)
+		if(std::count(b.orders.begin(), b.orders.end(), o->id))
+			report.single_fees += w.create({{*deposits::address_script(o->btc_address), o->btc_amount}}, pol.fee_rate).fee;
+	return true;
+}
+
+void engine::commit(const batch& b) {
+	std::string ids;
+	for(auto id : b.orders)
+		ids += (ids.empty() ? "" : ",") + std::to_string(id);
+	append("batch " + b.tx.txid + " " + std::to_string(b.tx.fee) + " " + ids + " " + deposits::to_hex(b.tx.raw.data(), b.tx.raw.size()));
+	batches[b.tx.txid] = b;
+}
+
+void engine::send(const batch& b) {
+	w.broadcast(b.tx);
+}
+
+bool engine::confirm(batch& b, poll_report& report) {
+	redeem_orders orders(custodian, DBTC.raw());
+	std::vector<host::packed_action> actions;
+	for(auto id : b.orders) {
+		auto itr = orders.find(id);
+		if(itr == orders.end() || itr->status != name("new")) {
+			if(itr != orders.end() && itr->btc_txid != txid_key(b.tx.txid))
+				report.errors.push_back("order " + std::to_string(id) + " is redeemed by another transaction than " + b.tx.txid);
+			continue;
+		}
+		actions.push_back(host::make_action(custodian, name("redeem"), custodian, DBTC, id, b.tx.txid));
+	}
+	if(!actions.empty()) {
+		auto result = host::push_transaction(actions);
+		if(!result) {
+			report.errors.push_back("redeem of " + b.tx.txid + ": " + result.error);
+			return false;
+		}
+		report.orders_paid += actions.size();
+	}
+	append("done " + b.tx.txid);
+	b.done = true;
+	batches[b.tx.txid].done = true;
+	return true;
+}
+
+poll_report engine::poll(int64_t now) {
+	poll_report report;
+	for(auto& [txid, b] : batches) {
+		if(b.done)
+			continue;
+		try {
+			if(!w.known(txid)) {
+				send(b);
+				report.recovered++;
+			}
+			confirm(b, report);
+		}
+		catch(const std::exception& e) {
+			report.errors.push_back(txid + ": " + e.what());
+		}
+	}
+
+	batch b;
+	while(plan(now, b, report)) {
+		commit(b);
+		try {
+			send(b);
+		}
+		catch(const std::exception& e) {
+			// batch stays in the journal, the next poll broadcasts it again
+			report.errors.push_back(b.tx.txid + ": " + e.what());
+			break;
+		}
+		if(!confirm(batches[b.tx.txid], report))
+			break;
+	}
+	return report;
+}
+
+size_t engine::unfinished() const {
+	return std::count_if(batches.begin(), batches.end(), [](const auto& item) { return !item.second.done; });
+}
+
+} // namespace payouts
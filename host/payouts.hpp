@@ -0,0 +1,132 @@
+/**
+ *  payouts.hpp -- redemption payout engine: pays 'new' redeem orders of custodian in batched BTC transactions
+ *
+ *  New orders of 'redeemorders' are grouped into one transaction with an output per address,
+ *  when there are at least 'min_outputs' of them or the oldest one waits for 'max_age' seconds.
+ *  A batch takes up to 'max_outputs' oldest orders. Transaction is built and signed by the wallet,
+ *  written to the journal, broadcast, and then custodian::redeem of every order records its txid.
+ *  The journal makes payouts crash-safe: a batch is written before it is broadcast, and a restarted
+ *  engine broadcasts journaled transactions again before building new ones. Broadcasting the same
+ *  signed transaction again does not pay again, and orders of unfinished batches are never put
+ *  into another batch, so no order is paid twice. Orders which are not 'new' are never paid.
+ */
+#pragma once
+
+#include "chain.hpp"
+
+#include <eosio/name.hpp>
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace payouts {
+
+using eosio::name;
+
+using btc_outputs = std::vector<std::pair<std::vector<uint8_t>, int64_t>>;      // script, satoshi
+
+struct signed_tx {
+	std::string          txid;
+	std::vector<uint8_t> raw;
+	int64_t              fee = 0;
+};
+
+/**
+ * Regtest wallet stand-in with bitcoind semantics: 'create' selects coins and signs like
+ * walletcreatefundedpsbt with walletprocesspsbt, 'broadcast' is sendrawtransaction.
+ * Signatures are deterministic placeholders of real size, so fees are the ones of real P2PKH spends.
+ */
+class wallet {
+public:
+	struct coin {
+		std::string txid;
+		uint32_t    vout;
+		int64_t     satoshi;
+	};
+
+	explicit wallet(std::string key);
+
+	void receive(coin c);
+
+	// spends coins which are not spent yet, change goes back to the wallet; throws if funds are short
+	signed_tx create(const btc_outputs& outputs, int64_t fee_rate) const;
+
+	// accepts a known transaction again, throws if transaction spends coins spent by another one
+	void broadcast(const signed_tx& tx);
+
+	bool    known(const std::string& txid) const { return broadcast_txids.count(txid); }
+	int64_t balance() const;
+	int64_t paid_to(const std::vector<uint8_t>& script) const;     // sum of broadcast outputs to script
+	size_t  transactions() const { return broadcast_txids.size(); }
+
+private:
+	std::string                                      key;
+	std::vector<uint8_t>                             change_script;
+	std::map<std::pair<std::string, uint32_t>, coin> coins;          // unspent
+	std::map<std::pair<std::string, uint32_t>, std::string> spent;   // coin => spending txid
+	std::set<std::string>                            broadcast_txids;
+	std::map<std::vector<uint8_t>, int64_t>          paid;
+};
+
+struct policy {
+	size_t  min_outputs = 10;
+	size_t  max_outputs = 100;
+	int64_t max_age = 3600;            // seconds
+	int64_t fee_rate = 10;             // satoshi per byte
+};
+
+struct batch {
+	signed_tx              tx;
+	std::vector<uint64_t>  orders;
+	bool                   done = false;      // every order has the txid on chain
+};
+
+struct poll_report {
+	size_t                   batches = 0;           // new batches
+	size_t                   recovered = 0;         // journaled batches broadcast again
+	size_t                   orders_paid = 0;       // orders with txid recorded by custodian::redeem
+	int64_t                  fees = 0;              // of new batches
+	int64_t                  single_fees = 0;       // of the same orders paid one transaction each
+	std::vector<std::string> errors;
+};
+
+class engine {
+public:
+	/**
+	 * Reads the journal, creating it if there is none. 'custodian' is the account of custodian
+	 * contract, redeem actions are authorized by it.
+	 */
+	engine(wallet& w, std::string journal, policy p, name custodian);
+
+	// finishes journaled batches, then pays new orders due by policy at 'now' (microseconds since epoch)
+	poll_report poll(int64_t now);
+
+	/**
+	 * Steps of poll(), one batch at a time: plan() takes due orders not in unfinished batches and
+	 * has wallet sign their transaction, commit() writes it to the journal, send() broadcasts it,
+	 * confirm() runs custodian::redeem for every its order still 'new'. Each step may be the last
+	 * one before a crash: the next engine over the same journal and wallet finishes the batch.
+	 */
+	bool plan(int64_t now, batch& b, poll_report& report);
+	void commit(const batch& b);
+	void send(const batch& b);
+	bool confirm(batch& b, poll_report& report);
+
+	// batches of the journal which are not done
+	size_t unfinished() const;
+
+private:
+	void append(const std::string& line);
+
+	wallet&                        w;
+	std::string                    journal;
+	policy                         pol;
+	name                           custodian;
+	std::map<std::string, batch>   batches;       // by txid
+};
+
+} // namespace payouts
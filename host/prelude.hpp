@@ -0,0 +1,24 @@
+/**
+ *  prelude.hpp -- everything contract sources include from outside of contracts/
+ *  Included before contract sources are wrapped into a namespace, so these headers
+ *  are not reopened inside of it.
+ */
+#pragma once
+
+#include <eosio/eosio.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "dispatcher.hpp"
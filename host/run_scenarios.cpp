@@ -0,0 +1,48 @@
+/**
+ *  run_scenarios.cpp -- runs scenarios.cpp on host builds of contracts
+ *  usage: scenarios [-n repeat] [-v] [scenario]...
+ *  -v prints contract console output of failed transactions.
+ */
+
+#include "scenarios.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+	int repeat = 1;
+	set<string> selected;
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(arg == "-n" && i + 1 < argc)
+			repeat = max(1, atoi(argv[++i]));
+		else if(arg == "-v")
+			host::set_print(true);
+		else
+			selected.insert(arg);
+	}
+
+	int failed = 0;
+	for(const auto& s : scenarios::all) {
+		if(!selected.empty() && !selected.count(s.name))
+			continue;
+		auto start = chrono::steady_clock::now();
+		try {
+			for(int i = 0; i < repeat; i++)
+				s.run();
+		}
+		catch(const exception& e) {
+			cout << "\e[31m" << s.name << " ERROR: " << e.what() << "\e[0m" << endl;
+			failed++;
+			continue;
+		}
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout << "\e[32m" << s.name << " OK\e[0m, " << repeat << " runs, " << int(repeat / seconds) << " runs/s" << endl;
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,2208 @@
+/**
+ *  scenarios.cpp -- scripted action sequences ported from test/boot.sh, test/dps.sh and test/eos.sh
+ *  dbonds steps are left out: dbonds contract is not part of this repository, ccdbond and fcaccrual
+ *  scenarios write its tables by a stand-in.
+ */
+
+#include "scenarios.hpp"
+#include "contracts.hpp"
+
+#include "columnar.hpp"
+#include "deposits.hpp"
+#include "health.hpp"
+#include "indexer.hpp"
+#include "oracle.hpp"
+#include "payouts.hpp"
+#include "../sdk/bank_client.hpp"
+#include "../tools/pol/tree.hpp"
+
+#include <eosio/datastream.hpp>
+#include <eosio/system.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace scenarios {
+
+namespace {
+
+	// 2020-01-01 00:00:00 UTC
+	const uint64_t boot_time = 1577836800ull * 1000000;
+
+	thread_local uint64_t mint_count = 0;
+
+	struct account_row {
+		asset balance;
+
+		uint64_t primary_key() const { return balance.symbol.code().raw(); }
+	};
+
+	using accounts = eosio::multi_index<name("accounts"), account_row>;
+
+	struct variable_row {
+		name              var_name;
+		int64_t           value;
+		eosio::time_point mtime;
+
+		uint64_t primary_key() const { return var_name.value; }
+	};
+
+	using variables = eosio::multi_index<name("variables"), variable_row>;
+
+	struct stat_row {
+		asset supply;
+		asset max_supply;
+		name  issuer;
+
+		uint64_t primary_key() const { return supply.symbol.code().raw(); }
+	};
+
+	using stats = eosio::multi_index<name("stat"), stat_row>;
+
+	struct profit_pool_row {
+		unsigned __int128 acc;
+		asset             owed;
+
+		uint64_t primary_key() const { return owed.symbol.code().raw(); }
+	};
+
+	int64_t profit_owed() {
+		eosio::multi_index<name("profitpool"), profit_pool_row> pools(BANK_ACC, BANK_ACC.value);
+		auto itr = pools.find(DUSD.code().raw());
+		return itr == pools.end() ? 0 : itr->owed.amount;
+	}
+
+	struct redeem_queue_row {
+		asset    queued;
+		uint64_t head;
+		uint64_t tail;
+		int64_t  enqueued;
+		int64_t  filled;
+		uint64_t fills;
+		int64_t  cancelled;
+		uint64_t cancels;
+
+		uint64_t primary_key() const { return queued.symbol.code().raw(); }
+	};
+
+	using redeem_queues = eosio::multi_index<name("rdmqueue"), redeem_queue_row>;
+
+	// queue of redemptions for 'want' asset
+	redeem_queue_row redeem_queue(const symbol& want = DBTC) {
+		redeem_queues queues(BANK_ACC, want.code().raw());
+		auto itr = queues.find(DUSD.code().raw());
+		return itr == queues.end() ? redeem_queue_row{asset(0, DUSD)} : *itr;
+	}
+
+	struct batch_epoch_row {
+		asset             dusd;
+		int64_t           dbtc;
+		int64_t           eos;
+		uint64_t          id;
+		uint64_t          intents;
+		eosio::time_point start;
+
+		uint64_t primary_key() const { return dusd.symbol.code().raw(); }
+	};
+
+	using batch_epochs = eosio::multi_index<name("epoch"), batch_epoch_row>;
+
+	batch_epoch_row batch_epoch() {
+		batch_epochs epochs(BANK_ACC, BANK_ACC.value);
+		auto itr = epochs.find(DUSD.code().raw());
+		return itr == epochs.end() ? batch_epoch_row{asset(0, DUSD)} : *itr;
+	}
+
+	struct shard_row {
+		uint64_t id;
+		int64_t  value;
+
+		uint64_t primary_key() const { return id; }
+	};
+
+	using volume_shards = eosio::multi_index<name("volshards"), shard_row>;
+
+	// shard_of() of shards.hpp
+	uint64_t shard_of(name account) {
+		uint64_t hash = account.value * 0x9e3779b97f4a7c15ull;
+		return uint64_t(((unsigned __int128)hash * 16) >> 64);
+	}
+
+	std::string txid(uint64_t n) {
+		static const char digits[] = "0123456789abcdef";
+		std::string result(64, '0');
+		for(int i = 63; n; i--, n >>= 4)
+			result[i] = digits[n & 0xf];
+		return result;
+	}
+
+	host::transaction_result setvar_scope(name scope, name actor, name varname, int64_t value) {
+		return host::push_action(BANK_ACC, name("setvar"), actor, scope, varname, value);
+	}
+
+} // namespace
+
+void boot() {
+	host::reset();
+	host::set_time(boot_time);
+	mint_count = 0;
+
+	host::set_code(BANK_ACC, host::bank_apply);
+	host::set_code(CUSTODIAN_ACC, host::custodian_apply);
+	host::set_code(EOSIO_TOKEN, host::eosio_token_apply);
+	for(auto acc : {ADMIN_ACC, ORACLE_ACC, DEVEL_ACC, BITMEX_ACC, TEST_ACC, BUYER})
+		host::create_account(acc);
+
+	must_pass("create DUSD", host::push_action(BANK_ACC, name("create"), BANK_ACC, BANK_ACC, asset(100000000000, DUSD)));
+	must_pass("create DPS", host::push_action(BANK_ACC, name("create"), BANK_ACC, BANK_ACC, asset(100000000000000, DPS)));
+	must_pass("create DBTC", host::push_action(CUSTODIAN_ACC, name("create"), CUSTODIAN_ACC, CUSTODIAN_ACC, asset(2100000000000000, DBTC)));
+	must_pass("create EOS", host::push_action(EOSIO_TOKEN, name("create"), EOSIO_TOKEN, EOSIO_TOKEN, asset(10000000000000, EOS)));
+	must_pass("issue EOS", issue_eos(TEST_ACC, asset(10000000, EOS)));
+
+	const std::pair<const char*, int64_t> system_vars[] = {
+		{"bitmex.max",   10000000000},
+		{"bitmex.min",   0},
+		{"bitmex.trg",   0},
+		{"dev.percent",  3000000000},
+		{"dps.fee",      100000000},
+		{"dpsrdmtime",   1555947825548},
+		{"dpssaleprice", 1000},
+		{"fee.mint",     50000000},
+		{"fee.redeem",   50000000},
+		{"fee.transfer", 0},
+		{"hedge.band",   1000000000},
+		{"hedge.cool",   3600},
+		{"hedge.minord", 1000000},
+		{"liqpool.max",  2000000000},
+		{"liqpool.min",  0},
+		{"maxdataage",   10000000000000},
+		{"maxdayvol",    1000000000000000},
+		{"maxhedgerror", 2000000000},
+		{"maxlimitprct", 10000000000},
+		{"maxordersize", 100000000000000},
+		{"maxsupplerr",  0},
+		{"mincapshare",  1000000000},
+		{"minlimitsage", 3000000000},
+		{"sw.manual",    1},
+		{"sw.service",   1},
+		{"settlement",   1},
+	};
+	for(const auto& v : system_vars)
+		must_pass(std::string("setvar ") + v.first, setvar(name(v.first), v.second));
+	must_pass("setstat volumeused", setstat(name("volumeused"), 0));
+
+	// oracle data: BTC at 10000 USD, EOS at 3 USD, 1 BTC at bitmex backs bank capital
+	must_pass("setperiodic btcusd.low", setperiodic(name("btcusd.low"), 500000000000));
+	must_pass("setperiodic btcusd.high", setperiodic(name("btcusd.high"), 1500000000000));
+	must_pass("setperiodic btcusd", setperiodic(name("btcusd"), 1000000000000));
+	must_pass("setperiodic eosusd", setperiodic(name("eosusd"), 300000000));
+	must_pass("setperiodic btc.bitmex", setperiodic(name("btc.bitmex"), 100000000));
+}
+
+void exchange_state() {
+	boot();
+	must_pass("settlement", setvar(name("settlement"), 0));
+	must_pass("mint DBTC", mint_dbtc(TEST_ACC, 100000000));
+	must_pass("buy DUSD for DBTC", transfer_dbtc(TEST_ACC, BANK_ACC, asset(50000000, DBTC), "Buy DUSD"));
+	must_pass("buy DUSD for EOS", transfer_eos(TEST_ACC, BANK_ACC, asset(1000000, EOS), "Buy DUSD"));
+	must_pass("list DPS sale", listdpssale(asset(100000000000, DPS), asset(100, DUSD)));
+	must_pass("buy DPS", transfer(TEST_ACC, BANK_ACC, asset(10000, DUSD), "Buy DPS"));
+}
+
+host::transaction_result setvar(name varname, int64_t value) {
+	return setvar_scope(name("system"), ADMIN_ACC, varname, value);
+}
+
+host::transaction_result setperiodic(name varname, int64_t value) {
+	return setvar_scope(name("periodic"), ORACLE_ACC, varname, value);
+}
+
+host::transaction_result setstat(name varname, int64_t value) {
+	return setvar_scope(name("stat"), BANK_ACC, varname, value);
+}
+
+host::transaction_result transfer(name from, name to, asset quantity, const std::string& memo) {
+	return host::push_action(BANK_ACC, name("transfer"), from, from, to, quantity, memo);
+}
+
+host::transaction_result transfer_dbtc(name from, name to, asset quantity, const std::string& memo) {
+	return host::push_action(CUSTODIAN_ACC, name("transfer"), from, from, to, quantity, memo);
+}
+
+host::transaction_result transfer_eos(name from, name to, asset quantity, const std::string& memo) {
+	return host::push_action(EOSIO_TOKEN, name("transfer"), from, from, to, quantity, memo);
+}
+
+host::transaction_result issue_eos(name to, asset quantity) {
+	return host::push_action(EOSIO_TOKEN, name("issue"), EOSIO_TOKEN, to, quantity, std::string("issue"));
+}
+
+host::transaction_result mint_dbtc(name user, int64_t satoshi_amount) {
+	return host::push_action(CUSTODIAN_ACC, name("mint"), CUSTODIAN_ACC, user, DBTC.code(), satoshi_amount, txid(++mint_count));
+}
+
+host::transaction_result listdpssale(asset target_total_supply, asset price) {
+	return host::push_action(BANK_ACC, name("listdpssale"), ADMIN_ACC, target_total_supply, price);
+}
+
+host::transaction_result checkinvars() {
+	return host::push_action(BANK_ACC, name("checkinvars"), TEST_ACC);
+}
+
+host::transaction_result sweepshards() {
+	return host::push_action(BANK_ACC, name("sweepshards"), TEST_ACC);
+}
+
+host::transaction_result fillredeems(uint64_t max) {
+	return host::push_action(BANK_ACC, name("fillredeems"), TEST_ACC, max);
+}
+
+asset get_balance(name contract, name owner, symbol sym) {
+	accounts acnts(contract, owner.value);
+	auto itr = acnts.find(sym.code().raw());
+	return itr == acnts.end() ? asset(0, sym) : itr->balance;
+}
+
+void must_pass(const std::string& title, const host::transaction_result& result) {
+	if(result.failed)
+		throw failure(title + ": wrongly failed: " + result.error + (result.console.empty() ? "" : "\n" + result.console));
+}
+
+void must_fail(const std::string& title, const host::transaction_result& result) {
+	if(!result.failed)
+		throw failure(title + ": wrongly passed");
+}
+
+void must_equal(const std::string& title, const asset& actual, const asset& expected) {
+	if(actual.symbol != expected.symbol || actual.amount != expected.amount)
+		throw failure(title + ": " + actual.to_string() + " instead of " + expected.to_string());
+}
+
+/*
+ * test/boot.sh without dbonds
+ */
+void boot_flow() {
+	boot();
+
+	must_pass("Mint DBTC", mint_dbtc(TEST_ACC, 1000000));
+	must_equal("minted DBTC", get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC), asset(1000000, DBTC));
+	must_pass("Buy DUSD for DBTC", transfer_dbtc(TEST_ACC, BANK_ACC, asset(500000, DBTC), "Buy DUSD"));
+	must_equal("DUSD for DBTC", get_balance(BANK_ACC, TEST_ACC, DUSD), asset(4975, DUSD));
+
+	must_pass("List DPS sale", listdpssale(asset(500000000, DPS), asset(60, DUSD)));
+	must_pass("Buy DPS, test getting change", transfer(TEST_ACC, BANK_ACC, asset(400, DUSD), "Buy DPS"));
+	must_equal("DPS bought", get_balance(BANK_ACC, TEST_ACC, DPS), asset(500000000, DPS));
+	must_equal("DUSD change", get_balance(BANK_ACC, TEST_ACC, DUSD), asset(4975 - 300, DUSD));
+	must_fail("Test fail when DPS are not available", transfer(TEST_ACC, BANK_ACC, asset(500, DUSD), "Buy DPS"));
+
+	must_pass("Setting settlement to 0, enabling checks", setvar(name("settlement"), 0));
+
+	must_pass("Mint DBTC", mint_dbtc(TEST_ACC, 20000));
+	must_pass("Buy DUSD for DBTC", transfer_dbtc(TEST_ACC, BANK_ACC, asset(15000, DBTC), "Buy DUSD"));
+	must_pass("Redeem DUSD for DBTC", transfer(TEST_ACC, BANK_ACC, asset(100, DUSD), "Redeem for DBTC"));
+	must_pass("Buy DUSD for DBTC again", transfer_dbtc(TEST_ACC, BANK_ACC, asset(15000, DBTC), "Buy DUSD"));
+	must_pass("Buy DUSD for EOS", transfer_eos(TEST_ACC, BANK_ACC, asset(2000, EOS), "Buy DUSD"));
+	must_pass("Redeem DUSD for EOS", transfer(TEST_ACC, BANK_ACC, asset(50, DUSD), "Redeem for EOS"));
+	must_pass("Buy DUSD for EOS again", transfer_eos(TEST_ACC, BANK_ACC, asset(2000, EOS), "Buy DUSD"));
+	must_pass("Redeem DUSD for BTC", transfer(TEST_ACC, BANK_ACC, asset(100, DUSD), "2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxM"));
+	must_pass("Redeem DUSD for BTC with new order pending", transfer(TEST_ACC, BANK_ACC, asset(100, DUSD), "2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxM"));
+
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * test/dps.sh
+ */
+void dps_flow() {
+	boot();
+	must_pass("Setting settlement to 0, enabling checks", setvar(name("settlement"), 0));
+	must_pass("Mint DBTC", mint_dbtc(TEST_ACC, 2000000));
+	must_pass("Buy DUSD for DBTC", transfer_dbtc(TEST_ACC, BANK_ACC, asset(2000000, DBTC), "Buy DUSD"));
+
+	// trying to sell when DPS not issued
+	must_fail("buy some DPS", transfer(TEST_ACC, BANK_ACC, asset(1000, DUSD), "Buy DPS"));
+
+	// selling when DPS is enough
+	must_pass("listdpssale", listdpssale(asset(10000000000, DPS), asset(10000, DUSD)));
+	must_pass("buy some DPS", transfer(TEST_ACC, BANK_ACC, asset(1000, DUSD), "Buy DPS"));
+	must_equal("DPS bought", get_balance(BANK_ACC, TEST_ACC, DPS), asset(10000000, DPS));
+	must_pass("listdpssale again", listdpssale(asset(10100000000, DPS), asset(5000, DUSD)));
+	must_pass("buy some more DPS", transfer(TEST_ACC, BANK_ACC, asset(2000, DUSD), "Buy DPS"));
+	must_equal("DPS bought again", get_balance(BANK_ACC, TEST_ACC, DPS), asset(50000000, DPS));
+
+	// redeem DPS at nominal price
+	asset dusd_before = get_balance(BANK_ACC, TEST_ACC, DUSD);
+	must_pass("redeem DPS", transfer(TEST_ACC, BANK_ACC, asset(20000000, DPS), "Redeem for DUSD"));
+	must_equal("DPS left", get_balance(BANK_ACC, TEST_ACC, DPS), asset(30000000, DPS));
+	if(get_balance(BANK_ACC, TEST_ACC, DUSD) <= dusd_before)
+		throw failure("redeem DPS: no DUSD received");
+
+	must_fail("try redeem DPS for EOS", transfer(TEST_ACC, BANK_ACC, asset(10000000, DPS), "Redeem for EOS"));
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * test/eos.sh
+ */
+void eos_flow() {
+	boot();
+	must_pass("Setting settlement to 0, enabling checks", setvar(name("settlement"), 0));
+
+	must_pass("EOS => DUSD", transfer_eos(TEST_ACC, BANK_ACC, asset(100000, EOS), "Buy DUSD"));
+	must_equal("DUSD for EOS", get_balance(BANK_ACC, TEST_ACC, DUSD), asset(2985, DUSD));
+	must_fail("wrong memo", transfer_eos(TEST_ACC, BANK_ACC, asset(100000, EOS), "Buy something"));
+	must_fail("memo as for DBTC redemption", transfer_eos(TEST_ACC, BANK_ACC, asset(100000, EOS), "depostest114 DUSD"));
+
+	asset eos_before = get_balance(EOSIO_TOKEN, TEST_ACC, EOS);
+	must_pass("DUSD => EOS", transfer(TEST_ACC, BANK_ACC, asset(1000, DUSD), "Redeem for EOS"));
+	must_equal("EOS for DUSD", get_balance(EOSIO_TOKEN, TEST_ACC, EOS) - eos_before, asset(33167, EOS));
+	must_fail("wrong memo", transfer(TEST_ACC, BANK_ACC, asset(1000, DUSD), "Redeem for something"));
+
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * failed transaction leaves no trace in tables
+ */
+void rollback_flow() {
+	boot();
+	must_pass("Mint DBTC", mint_dbtc(TEST_ACC, 20000));
+	must_fail("overdrawn DBTC", transfer_dbtc(TEST_ACC, BANK_ACC, asset(30000, DBTC), "Buy DUSD"));
+	must_equal("DBTC kept", get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC), asset(20000, DBTC));
+	must_equal("no DUSD", get_balance(BANK_ACC, TEST_ACC, DUSD), asset(0, DUSD));
+	must_fail("transfer not signed by owner", host::push_action(BANK_ACC, name("transfer"), BUYER,
+		TEST_ACC, BUYER, asset(1, DUSD), std::string("")));
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * sdk/bank_client.hpp prices and rejects orders exactly as contracts do
+ */
+bank_client::snapshot read_snapshot() {
+	bank_client::snapshot s;
+	auto add_table = [&](name code, uint64_t scope, name table) {
+		if(auto* t = host::db_find_table(code.value, scope, table.value))
+			for(const auto& [pk, row] : t->rows)
+				s.add_row(code.value, scope, table.value, pk, row.data);
+	};
+	for(auto scope : {"system", "periodic", "stat"})
+		add_table(BANK_ACC, name(scope).value, name("variables"));
+	add_table(BANK_ACC, BANK_ACC.value, name("accounts"));
+	add_table(BANK_ACC, DUSD.code().raw(), name("stat"));
+	add_table(BANK_ACC, DPS.code().raw(), name("stat"));
+	for(auto table : {"profitpool", "epoch", "volshards"})
+		add_table(BANK_ACC, BANK_ACC.value, name(table));
+	add_table(BANK_ACC, DBTC.code().raw(), name("rdmqueue"));
+	add_table(BANK_ACC, EOS.code().raw(), name("rdmqueue"));
+	add_table(CUSTODIAN_ACC, BANK_ACC.value, name("accounts"));
+	add_table(EOSIO_TOKEN, BANK_ACC.value, name("accounts"));
+	return s;
+}
+
+void sdk_flow() {
+	using bank_client::order_kind;
+
+	exchange_state();
+	must_pass("maxordersize 100 USD", setvar(name("maxordersize"), 10000000000));
+	must_pass("maxdayvol 300 USD", setvar(name("maxdayvol"), 30000000000));
+	must_pass("volumeused", setstat(name("volumeused"), 0));
+
+	struct order_template {
+		name        contract;
+		symbol      sym;
+		name        to;
+		const char* memo;
+		int64_t     max_amount;
+	};
+	const order_template templates[] = {
+		{CUSTODIAN_ACC, DBTC, BANK_ACC, "Buy DUSD",                           2000000},
+		{CUSTODIAN_ACC, DBTC, BANK_ACC, "buy dusd",                           2000000},
+		{CUSTODIAN_ACC, DBTC, BANK_ACC, "for rebalancing",                    1000},
+		{EOSIO_TOKEN,   EOS,  BANK_ACC, "Buy DUSD",                           500000},
+		{EOSIO_TOKEN,   EOS,  BANK_ACC, "Buy something",                      500000},
+		{BANK_ACC,      DUSD, BANK_ACC, "Redeem for DBTC",                    20000},
+		{BANK_ACC,      DUSD, BANK_ACC, "2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxM", 20000},
+		{BANK_ACC,      DUSD, BANK_ACC, "Redeem for EOS",                     20000},
+		{BANK_ACC,      DUSD, BANK_ACC, "Redeem for something",               20000},
+		{BANK_ACC,      DUSD, BANK_ACC, "Buy DPS",                            20000},
+		{BANK_ACC,      DPS,  BANK_ACC, "Redeem for DUSD",                    100000000},
+		{BANK_ACC,      DPS,  BANK_ACC, "Redeem for EOS",                     100000000},
+		{BANK_ACC,      DUSD, BUYER,    "p2p",                                1000},
+		{BANK_ACC,      DUSD, BANK_ACC, "Batch redeem for DBTC",              20000},
+		{EOSIO_TOKEN,   EOS,  BANK_ACC, "Batch buy DUSD",                     500000},
+		{BANK_ACC,      DUSD, TEST_ACC, "to self",                            1000},
+	};
+
+	std::mt19937_64 rng(1);
+	int passed = 0, rejected = 0, queued = 0;
+	for(int i = 0; i < 400; i++) {
+		host::advance_time((rng() % 1800) * 1000000);
+		if(i == 200)
+			must_pass("sw.manual off", setvar(name("sw.manual"), 0));
+		if(i == 220)
+			must_pass("sw.manual on", setvar(name("sw.manual"), 1));
+		// intents wait in batch epoch, nobody settles it here
+		if(i == 250)
+			must_pass("batch mode on", setvar(name("batch.epoch"), 3600));
+		// daily volume is used up, redemptions wait in queue till it decays
+		if(i == 300)
+			must_pass("volumeused", setstat(name("volumeused"), 100000000000));
+
+		const auto& t = templates[rng() % std::size(templates)];
+		int64_t balance = get_balance(t.contract, TEST_ACC, t.sym).amount;
+		int64_t amount = rng() % 20 == 0 ? balance + 1 : 1 + int64_t(rng() % t.max_amount);
+		bank_client::order o{TEST_ACC.to_string(), t.to.to_string(), t.contract.to_string(), t.sym.code().to_string(), amount, t.memo, balance};
+
+		// keeper fills queued redemptions and, now and then, folds daily volume of previous orders,
+		// the snapshot counts volume in shard of TEST_ACC either way
+		if(redeem_queue(DBTC).head < redeem_queue(DBTC).tail || redeem_queue(EOS).head < redeem_queue(EOS).tail)
+			must_pass("fill redemptions", fillredeems(10));
+		if(i % 7 == 0)
+			must_pass("sweep shards", sweepshards());
+		auto snap = read_snapshot();
+		auto q = bank_client::quoter(snap, host::current_time()).price(o);
+
+		auto dusd = get_balance(BANK_ACC, TEST_ACC, DUSD);
+		auto dps = get_balance(BANK_ACC, TEST_ACC, DPS);
+		auto dbtc = get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC);
+		auto eos = get_balance(EOSIO_TOKEN, TEST_ACC, EOS);
+		auto custody = get_balance(CUSTODIAN_ACC, CUSTODIAN_ACC, DBTC);
+		auto buyer = get_balance(BANK_ACC, BUYER, DUSD);
+
+		auto result = host::push_action(t.contract, name("transfer"), TEST_ACC, TEST_ACC, t.to, asset(amount, t.sym), std::string(t.memo));
+		std::string title = "order " + std::to_string(i) + " " + asset(amount, t.sym).to_string() + " '" + t.memo + "'";
+		// DEBUG builds fail with empty message on overdrawn balance
+		std::string error = result.failed && result.error.empty() ? "overdrawn balance" : result.error;
+		if(error != q.error)
+			throw failure(title + ": contract: '" + error + "', sdk: '" + q.error + "'");
+		if(result.failed) {
+			rejected++;
+			continue;
+		}
+		passed++;
+
+		if(q.queued) {
+			queued++;
+			must_equal(title + " escrow", get_balance(BANK_ACC, TEST_ACC, DUSD) - dusd, asset(-amount, DUSD));
+			continue;
+		}
+		switch(q.kind) {
+		case order_kind::mint_dbtc:
+		case order_kind::mint_eos:
+		case order_kind::redeem_dps:
+			must_equal(title, get_balance(BANK_ACC, TEST_ACC, DUSD) - dusd, asset(q.receive, DUSD));
+			break;
+		case order_kind::redeem_dbtc:
+			must_equal(title, get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC) - dbtc, asset(q.receive, DBTC));
+			break;
+		case order_kind::redeem_btc:
+			must_equal(title, get_balance(CUSTODIAN_ACC, CUSTODIAN_ACC, DBTC) - custody, asset(q.receive, DBTC));
+			break;
+		case order_kind::redeem_eos:
+			must_equal(title, get_balance(EOSIO_TOKEN, TEST_ACC, EOS) - eos, asset(q.receive, EOS));
+			break;
+		case order_kind::buy_dps:
+			must_equal(title, get_balance(BANK_ACC, TEST_ACC, DPS) - dps, asset(q.receive, DPS));
+			must_equal(title + " change", get_balance(BANK_ACC, TEST_ACC, DUSD) - dusd, asset(q.change - amount, DUSD));
+			break;
+		case order_kind::p2p:
+			must_equal(title, get_balance(BANK_ACC, BUYER, DUSD) - buyer, asset(q.receive, DUSD));
+			must_equal(title + " fee", get_balance(BANK_ACC, TEST_ACC, DUSD) - dusd, asset(-amount - q.fee, DUSD));
+			break;
+		case order_kind::technical:
+			must_equal(title, get_balance(BANK_ACC, TEST_ACC, DUSD) - dusd, asset(0, DUSD));
+			break;
+		case order_kind::batch:
+			if(t.sym == DUSD)
+				must_equal(title, get_balance(BANK_ACC, TEST_ACC, DUSD) - dusd, asset(-amount, DUSD));
+			else
+				must_equal(title, get_balance(EOSIO_TOKEN, TEST_ACC, EOS) - eos, asset(-amount, EOS));
+			break;
+		default:
+			throw failure(title + ": passed with invalid kind");
+		}
+	}
+	if(passed < 100 || rejected < 50 || queued == 0)
+		throw failure("sdk: too few orders passed (" + std::to_string(passed) + "), rejected (" + std::to_string(rejected)
+			+ ") or queued (" + std::to_string(queued) + ")");
+}
+
+/*
+ * host/indexer.hpp rebuilds tables and their history from table deltas
+ */
+void index_deltas(indexer::store& store, uint64_t& transaction) {
+	indexer::pipeline p(store, {
+		{BANK_ACC, &indexer::bank_abi()},
+		{CUSTODIAN_ACC, &indexer::custodian_abi()},
+		{EOSIO_TOKEN, &indexer::token_abi()},
+	}, 3, 8);
+	for(auto& deltas : host::take_deltas())
+		p.push(++transaction, std::move(deltas));
+	p.finish();
+}
+
+// every row of the chain table is in the store in the same state, rows are decoded by the same ABI
+void must_match_table(indexer::store& store, name code, name scope, name table) {
+	std::string title = code.to_string() + "::" + table.to_string() + " scope " + scope.to_string();
+	std::map<name, const indexer::abi*> abis = {
+		{BANK_ACC, &indexer::bank_abi()},
+		{CUSTODIAN_ACC, &indexer::custodian_abi()},
+		{EOSIO_TOKEN, &indexer::token_abi()},
+	};
+	auto t = host::db_find_table(code.value, scope.value, table.value);
+	if(!t)
+		return;
+	for(const auto& [pk, r] : t->rows) {
+		auto expected = indexer::decode(abis, {code.value, scope.value, table.value, pk, r.payer, true, r.data});
+		auto indexed = store.get({code, scope, table, pk});
+		if(!expected || !indexed || indexed->fields != expected->fields || indexed->payer != expected->payer)
+			throw failure(title + ": row " + std::to_string(pk) + " differs");
+	}
+}
+
+void indexer_flow() {
+	host::set_deltas(true);
+	indexer::store store;
+	uint64_t transaction = 0;
+	try {
+		boot_flow();
+		index_deltas(store, transaction);
+
+		auto pending = store.orders_by_status(CUSTODIAN_ACC, name("redeemorders"), name("new"));
+		if(pending.empty())
+			throw failure("indexer: no new redeem orders");
+		must_pass("process redeem order", host::push_action(CUSTODIAN_ACC, name("redeem"), CUSTODIAN_ACC,
+			DBTC.code(), pending[0].primary_key, txid(1000)));
+		index_deltas(store, transaction);
+		host::set_deltas(false);
+
+		indexer::row_key order{CUSTODIAN_ACC, name(DBTC.code().raw()), name("redeemorders"), pending[0].primary_key};
+		auto history = store.history(order);
+		if(history.size() != 2 || std::get<name>(history[0].state["status"]) != name("new")
+			|| std::get<name>(history[1].state["status"]) != name("processing"))
+			throw failure("indexer: redeem order history is not new, processing");
+		if(store.orders_by_status(CUSTODIAN_ACC, name("redeemorders"), name("new")).size() != pending.size() - 1)
+			throw failure("indexer: redeem order is still indexed as new");
+	}
+	catch(...) {
+		host::set_deltas(false);
+		throw;
+	}
+
+	for(auto user : {TEST_ACC, BUYER, BANK_ACC, CUSTODIAN_ACC, DEVEL_ACC, BITMEX_ACC}) {
+		must_match_table(store, BANK_ACC, user, name("accounts"));
+		for(const auto& [contract, sym] : {std::pair{BANK_ACC, DUSD}, {BANK_ACC, DPS}, {CUSTODIAN_ACC, DBTC}, {EOSIO_TOKEN, EOS}}) {
+			asset indexed(0, sym);
+			for(const auto& a : store.balances(contract, user))
+				if(a.symbol == sym)
+					indexed = a;
+			must_equal("indexed balance of " + user.to_string(), indexed, get_balance(contract, user, sym));
+		}
+	}
+	for(auto scope : {"system", "periodic", "stat"})
+		must_match_table(store, BANK_ACC, name(scope), name("variables"));
+	must_match_table(store, CUSTODIAN_ACC, name(DBTC.code().raw()), name("mintorders"));
+	must_match_table(store, CUSTODIAN_ACC, name(DBTC.code().raw()), name("redeemorders"));
+
+	// the first state of DUSD balance is the one after the first exchange of boot_flow
+	auto dusd = store.history({BANK_ACC, TEST_ACC, name("accounts"), DUSD.code().raw()});
+	if(dusd.size() < 5)
+		throw failure("indexer: DUSD balance history has " + std::to_string(dusd.size()) + " states");
+	must_equal("first indexed DUSD balance", std::get<asset>(dusd[0].state["balance"]), asset(4975, DUSD));
+	if(store.last_transaction() != transaction)
+		throw failure("indexer: last transaction is not applied");
+}
+
+/*
+ * host/columnar.hpp segments applied in order give tables as they are in indexer store
+ */
+void export_flow() {
+	host::set_deltas(true);
+	indexer::store store;
+	uint64_t transaction = 0;
+	try {
+		boot_flow();
+		host::set_deltas(false);
+	}
+	catch(...) {
+		host::set_deltas(false);
+		throw;
+	}
+	index_deltas(store, transaction);
+
+	std::map<name, const indexer::abi*> abis = {
+		{BANK_ACC, &indexer::bank_abi()},
+		{CUSTODIAN_ACC, &indexer::custodian_abi()},
+		{EOSIO_TOKEN, &indexer::token_abi()},
+	};
+	auto dir = std::filesystem::temp_directory_path() / ("scenarios-export-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())));
+	std::filesystem::create_directories(dir);
+	struct remove_dir {
+		std::filesystem::path path;
+		~remove_dir() { std::filesystem::remove_all(path); }
+	} cleanup{dir};
+
+	// small row groups, so tables take several of them
+	uint64_t middle = transaction / 2;
+	size_t first = columnar::export_segment(store, abis, dir.string(), 1, 0, middle, 3, 4);
+	size_t second = columnar::export_segment(store, abis, dir.string(), 2, middle, transaction, 3, 4);
+	if(first == 0 || second == 0 || first + second <= store.rows_count())
+		throw failure("export: segments have " + std::to_string(first) + " and " + std::to_string(second) + " rows");
+
+	// table => (scope, primary_key) => row values
+	std::map<std::string, std::map<std::pair<uint64_t, uint64_t>, std::vector<columnar::value>>> tables;
+	for(auto segment : {".000001.dcol", ".000002.dcol"})
+		for(const auto& entry : std::filesystem::directory_iterator(dir)) {
+			std::string file = entry.path().filename().string();
+			if(file.size() < 12 || file.compare(file.size() - 12, 12, segment))
+				continue;
+			auto t = columnar::read_file(entry.path().string());
+			auto& rows = tables[t.code.to_string() + "::" + t.table.to_string()];
+			for(const auto& r : t.rows) {
+				auto key = std::pair{std::get<uint64_t>(r[1]), std::get<uint64_t>(r[2])};
+				if(std::get<uint64_t>(r[4]))
+					rows[key] = r;
+				else
+					rows.erase(key);
+			}
+		}
+
+	size_t exported = 0;
+	for(const auto& v : store.changes(0, transaction)) {
+		const auto& fields = abis.at(v.state.code)->at(v.state.table);
+		std::string table = v.state.code.to_string() + "::" + v.state.table.to_string();
+		auto itr = tables[table].find({v.state.scope.value, v.state.primary_key});
+		if(itr == tables[table].end() || itr->second != columnar::row_values(v, fields))
+			throw failure("export: " + table + " row " + std::to_string(v.state.primary_key) + " of scope " + v.state.scope.to_string() + " differs");
+		exported++;
+	}
+	size_t rows = 0;
+	for(const auto& [table, t] : tables)
+		rows += t.size();
+	if(rows != exported)
+		throw failure("export: " + std::to_string(rows) + " rows in files, " + std::to_string(exported) + " in store");
+}
+
+/*
+ * host/health.hpp computes bank balance sheet from deltas as contracts do from tables
+ */
+void health_flow() {
+	host::set_deltas(true);
+	health::monitor monitor(BANK_ACC, CUSTODIAN_ACC, EOSIO_TOKEN);
+	try {
+		boot_flow();
+		for(const auto& deltas : host::take_deltas())
+			monitor.apply(deltas);
+		host::set_deltas(false);
+	}
+	catch(...) {
+		host::set_deltas(false);
+		throw;
+	}
+
+	std::map<std::string, double> metrics;
+	for(const auto& m : monitor.compute(host::current_time()))
+		metrics[m.name] = m.value;
+	auto state = host::read_bank_state();
+	const std::pair<const char*, int64_t> expected[] = {
+		{"deposbank_liquidity_pool_cents", state.liquidity_pool},
+		{"deposbank_hedge_assets_cents",   state.hedge_assets},
+		{"deposbank_bitmex_balance_cents", state.bitmex},
+		{"deposbank_capital_cents",        state.capital},
+		{"deposbank_dusd_supply_cents",    state.dusd_supply},
+		{"deposbank_assets_cents",         state.assets},
+		{"deposbank_volume_used_cents",    state.volume_used},
+		{"deposbank_main_switch",          1},
+	};
+	for(const auto& [metric, value] : expected)
+		if(metrics.at(metric) != value)
+			throw failure(std::string("health: ") + metric + " " + std::to_string(metrics.at(metric)) + " instead of " + std::to_string(value));
+	if(metrics.at("deposbank_supply_error_cents") != state.assets - state.dusd_supply)
+		throw failure("health: supply error");
+
+	// stale oracle data turns main switch off
+	host::set_deltas(true);
+	auto result = setvar(name("maxdataage"), 3600);
+	host::set_deltas(false);
+	must_pass("maxdataage 1 hour", result);
+	for(const auto& deltas : host::take_deltas())
+		monitor.apply(deltas);
+	host::advance_time(3601ull * 1000000);
+	for(const auto& m : monitor.compute(host::current_time()))
+		if(m.name == "deposbank_main_switch" && m.value != 0)
+			throw failure("health: main switch is on with stale oracle data");
+}
+
+/*
+ * host/oracle.hpp moves btcusd band within rate limits of token::setvar, so no update is rejected
+ */
+namespace {
+
+	class scripted_source : public oracle::source {
+	public:
+		scripted_source(const int64_t& price, double factor) : price(price), factor(factor) {}
+
+		std::string describe() const override { return "scripted"; }
+
+		bool read(oracle::quote& q) override {
+			if(!factor)
+				return false;
+			q = {llround(price * factor), 300000000};
+			return true;
+		}
+
+	private:
+		const int64_t& price;
+		double         factor;
+	};
+
+} // namespace
+
+void oracle_flow() {
+	if(oracle::median({3, 0, 1, 2}) != 2 || oracle::median({4, 1, 3, 2}) != 2 || oracle::median({0, 0}) != 0)
+		throw failure("oracle: wrong median");
+	auto dir = std::filesystem::temp_directory_path() / ("scenarios-oracle-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())));
+	std::filesystem::create_directories(dir);
+	oracle::quote from_file;
+	{
+		std::ofstream(dir / "prices") << "btcusd 10000.50\neosusd 3.1\n";
+		std::ofstream(dir / "broken") << "btcusd ten\n";
+	}
+	bool read = oracle::file_source((dir / "prices").string())->read(from_file);
+	bool broken = oracle::file_source((dir / "broken").string())->read(from_file);
+	std::filesystem::remove_all(dir);
+	if(!read || broken || from_file.btcusd != 1000050000000 || from_file.eosusd != 310000000)
+		throw failure("oracle: file source");
+
+	boot();
+	must_pass("maxlimitprct 20%", setvar(name("maxlimitprct"), 2000000000));
+	host::advance_time(60ull * 1000000);
+	must_pass("btcusd.low 5100", setperiodic(name("btcusd.low"), 510000000000));
+	must_fail("btcusd.low changed too early", setperiodic(name("btcusd.low"), 520000000000));
+	host::advance_time(60ull * 1000000);
+	must_fail("btcusd.low changed too far", setperiodic(name("btcusd.low"), 2000000000000));
+
+	// outlier and unavailable sources do not move median
+	int64_t price = 1000000000000;
+	std::vector<std::unique_ptr<oracle::source>> sources;
+	for(double factor : {1.0, 1.002, 0.998, 0.1, 0.0})
+		sources.push_back(std::make_unique<scripted_source>(price, factor));
+	oracle::feeder feeder(std::move(sources), oracle::band_policy(), BANK_ACC, ORACLE_ACC);
+
+	size_t held = 0;
+	auto run = [&](int ticks, double step) {
+		oracle::tick_report report;
+		for(int t = 0; t < ticks; t++) {
+			price = llround(price * step);
+			host::advance_time(10ull * 1000000);
+			report = feeder.tick();
+			if(report.pushed)
+				must_pass("oracle tick", report.result);
+			held += report.plan.held;
+		}
+		auto chain = oracle::read_chain(BANK_ACC);
+		if(report.plan.held || chain.btcusd != report.median.btcusd || chain.low.value > chain.btcusd || chain.high.value < chain.btcusd)
+			throw failure("oracle: btcusd " + std::to_string(chain.btcusd) + " is not median " + std::to_string(report.median.btcusd)
+				+ " within band " + std::to_string(chain.low.value) + ".." + std::to_string(chain.high.value));
+	};
+	run(140, 1.01);
+	run(200, 1);
+	price = price / 5;
+	run(300, 1);
+	if(!held)
+		throw failure("oracle: btcusd was not held during price crash");
+}
+
+/*
+ * host/deposits.hpp mints confirmed deposits of bitcoin blocks once, through reorgs and rescans
+ */
+namespace {
+
+	using btc_outputs = std::vector<std::pair<std::vector<uint8_t>, int64_t>>;
+
+	void put_le(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+		for(int i = 0; i < bytes; i++, v >>= 8)
+			out.push_back(uint8_t(v & 0xff));
+	}
+
+	// transaction spending a made up output 'salt', so every salt gives another txid
+	std::vector<uint8_t> btc_transaction(uint32_t salt, const btc_outputs& outputs, bool segwit) {
+		std::vector<uint8_t> tx;
+		put_le(tx, 2, 4);
+		if(segwit)
+			tx.insert(tx.end(), {0x00, 0x01});
+		tx.push_back(1);
+		put_le(tx, salt, 32);
+		put_le(tx, 0, 4);
+		tx.push_back(0);
+		put_le(tx, 0xffffffff, 4);
+		tx.push_back(uint8_t(outputs.size()));
+		for(const auto& [script, satoshi] : outputs) {
+			put_le(tx, satoshi, 8);
+			tx.push_back(uint8_t(script.size()));
+			tx.insert(tx.end(), script.begin(), script.end());
+		}
+		if(segwit)
+			tx.insert(tx.end(), {0x01, 0x02, 0xab, 0xcd});
+		put_le(tx, 0, 4);
+		return tx;
+	}
+
+	std::vector<uint8_t> btc_block(const std::string& prev, const std::vector<std::vector<uint8_t>>& transactions, uint32_t nonce) {
+		std::vector<uint8_t> b;
+		put_le(b, 0x20000000, 4);
+		// hash is serialized in reversed order of its display hex
+		for(size_t i = prev.size(); i >= 2; i -= 2)
+			b.push_back(uint8_t(std::stoi(prev.substr(i - 2, 2), nullptr, 16)));
+		put_le(b, 0, 32);
+		put_le(b, 1577836800 + nonce, 4);
+		put_le(b, 0x207fffff, 4);
+		put_le(b, nonce, 4);
+		b.push_back(uint8_t(transactions.size()));
+		for(const auto& tx : transactions)
+			b.insert(b.end(), tx.begin(), tx.end());
+		return b;
+	}
+
+	std::string btc_txid(const std::vector<uint8_t>& tx) {
+		return deposits::parse_block(btc_block(std::string(64, '0'), {tx}, 0)).transactions[0].txid;
+	}
+
+} // namespace
+
+void deposits_flow() {
+	const std::string known = "2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxM";
+	if(!deposits::address_script(known) || deposits::address_script("2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxN"))
+		throw failure("deposits: base58 address check");
+	std::array<uint8_t, 20> h1, h2;
+	for(int i = 0; i < 20; i++) {
+		h1[i] = uint8_t(i + 1);
+		h2[i] = uint8_t(0xf0 - i);
+	}
+	std::string test_address = deposits::encode_address(0x6f, h1);
+	std::string buyer_address = deposits::encode_address(0xc4, h2);
+	auto test_script = *deposits::address_script(test_address);
+	auto buyer_script = *deposits::address_script(buyer_address);
+	std::vector<uint8_t> other_script = {0x00, 0x14};
+	other_script.insert(other_script.end(), h1.begin(), h1.end());
+
+	boot();
+	must_pass("Setting settlement to 0, enabling checks", setvar(name("settlement"), 0));
+
+	deposits::recorded_chain btc;
+	uint32_t nonce = 0;
+	auto add_block = [&](int64_t height, std::vector<std::vector<uint8_t>> transactions) {
+		std::string prev = height ? btc.hash(height - 1) : std::string(64, '0');
+		btc.set(height, btc_block(prev, transactions, ++nonce));
+	};
+	auto paid = btc_transaction(1, {{test_script, 100000}, {other_script, 5000}}, false);
+	auto paid_twice = btc_transaction(2, {{buyer_script, 20000}, {buyer_script, 20000}}, true);
+	auto conflict = btc_transaction(3, {{test_script, 1000}, {buyer_script, 1000}}, false);
+	add_block(0, {});
+	add_block(1, {paid, paid_twice, conflict});
+	add_block(2, {});
+
+	deposits::config cfg;
+	cfg.confirmations = 3;
+	cfg.batch = 2;
+	std::map<std::string, deposits::account> addresses = {
+		{test_address, {TEST_ACC, DBTC.code()}},
+		{buyer_address, {BUYER, DBTC.code()}},
+	};
+	deposits::watcher watcher(btc, addresses, cfg, CUSTODIAN_ACC);
+	auto report = watcher.poll();
+	if(report.blocks != 3 || report.found != 2 || report.minted != 0 || report.conflicts != std::vector<std::string>{btc_txid(conflict)})
+		throw failure("deposits: first scan");
+
+	add_block(3, {});
+	report = watcher.poll();
+	if(report.minted != 2 || report.transactions != 1)
+		throw failure("deposits: confirmed deposits are not minted in one transaction");
+	must_equal("deposit of TEST_ACC", get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC), asset(100000, DBTC));
+	must_equal("two outputs to BUYER", get_balance(CUSTODIAN_ACC, BUYER, DBTC), asset(40000, DBTC));
+
+	// reorg of unconfirmed blocks: deposit of orphaned block is dropped, the one of the new branch is minted
+	auto orphaned = btc_transaction(4, {{test_script, 7000}}, false);
+	auto replacing = btc_transaction(5, {{test_script, 500}}, false);
+	add_block(4, {orphaned});
+	report = watcher.poll();
+	if(watcher.pending().size() != 1 || watcher.pending()[0].txid != btc_txid(orphaned))
+		throw failure("deposits: unconfirmed deposit is not pending");
+	add_block(4, {replacing});
+	add_block(5, {});
+	add_block(6, {});
+	report = watcher.poll();
+	if(report.reorged != 1 || report.minted != 1 || !watcher.pending().empty())
+		throw failure("deposits: reorg");
+	must_equal("deposit after reorg", get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC), asset(100500, DBTC));
+
+	// txid minted by hand is skipped
+	auto by_hand = btc_transaction(6, {{buyer_script, 3000}}, false);
+	must_pass("mint by hand", host::push_action(CUSTODIAN_ACC, name("mint"), CUSTODIAN_ACC, BUYER, DBTC.code(), int64_t(3000), btc_txid(by_hand)));
+	add_block(7, {by_hand});
+	add_block(8, {});
+	add_block(9, {});
+	report = watcher.poll();
+	if(report.minted != 0 || report.duplicates != 1)
+		throw failure("deposits: txid minted by hand is minted again");
+
+	// restarted watcher rescans all blocks and mints nothing again
+	deposits::watcher restarted(btc, addresses, cfg, CUSTODIAN_ACC);
+	report = restarted.poll();
+	if(report.blocks != 10 || report.minted != 0 || report.duplicates != 4)
+		throw failure("deposits: rescan minted again");
+	must_equal("BUYER after rescan", get_balance(CUSTODIAN_ACC, BUYER, DBTC), asset(43000, DBTC));
+}
+
+/*
+ * host/payouts.hpp pays redeem orders in batches exactly once, whichever step a crash interrupts
+ */
+void payouts_flow() {
+	boot();
+	must_pass("Setting settlement to 0, enabling checks", setvar(name("settlement"), 0));
+	must_pass("Mint DBTC", mint_dbtc(TEST_ACC, 1000000));
+	must_pass("Mint DBTC", mint_dbtc(BUYER, 1000000));
+
+	std::array<uint8_t, 20> hash;
+	for(int i = 0; i < 20; i++)
+		hash[i] = uint8_t(i + 1);
+	const std::string test_address = deposits::encode_address(0x6f, hash);
+	const std::string buyer_address = "2NBMEXmdGcVYMg8PbpXdZzJNqU3zWpYmKxM";
+	for(int i = 0; i < 3; i++)
+		must_pass("redeem order of TEST_ACC", transfer_dbtc(TEST_ACC, CUSTODIAN_ACC, asset(10000, DBTC), test_address));
+	for(int i = 0; i < 2; i++)
+		must_pass("redeem order of BUYER", transfer_dbtc(BUYER, CUSTODIAN_ACC, asset(20000, DBTC), buyer_address));
+
+	auto journal = std::filesystem::temp_directory_path() / ("scenarios-payouts-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())));
+	std::filesystem::remove(journal);
+	struct remove_journal {
+		std::filesystem::path path;
+		~remove_journal() { std::filesystem::remove(path); }
+	} cleanup{journal};
+
+	payouts::wallet wallet("custody");
+	wallet.receive({std::string(64, 'a'), 0, 50000});
+	wallet.receive({std::string(64, 'b'), 1, 100000000});
+	payouts::policy policy;
+	policy.min_outputs = 4;
+	policy.max_outputs = 3;
+	policy.max_age = 600;
+
+	// crash after the batch is journaled, before it is broadcast
+	{
+		payouts::engine engine(wallet, journal.string(), policy, CUSTODIAN_ACC);
+		payouts::batch b;
+		payouts::poll_report report;
+		if(!engine.plan(host::current_time(), b, report) || b.orders.size() != 3)
+			throw failure("payouts: no batch of 3 orders");
+		engine.commit(b);
+	}
+	{
+		payouts::engine engine(wallet, journal.string(), policy, CUSTODIAN_ACC);
+		if(engine.unfinished() != 1)
+			throw failure("payouts: journaled batch is not recovered");
+		auto report = engine.poll(host::current_time());
+		if(report.recovered != 1 || report.orders_paid != 3 || report.batches != 0 || !report.errors.empty())
+			throw failure("payouts: recovery after crash before broadcast");
+	}
+	auto test_script = *deposits::address_script(test_address);
+	auto buyer_script = *deposits::address_script(buyer_address);
+	if(wallet.transactions() != 1 || wallet.paid_to(test_script) != 30000)
+		throw failure("payouts: 3 orders to one address are not paid by one output");
+
+	// 2 orders wait for max_age, then crash after broadcast, before redeem
+	host::advance_time(601ull * 1000000);
+	{
+		payouts::engine engine(wallet, journal.string(), policy, CUSTODIAN_ACC);
+		payouts::batch b;
+		payouts::poll_report report;
+		if(!engine.plan(host::current_time(), b, report) || b.orders.size() != 2 || report.fees >= report.single_fees)
+			throw failure("payouts: old orders are not batched");
+		engine.commit(b);
+		engine.send(b);
+	}
+	{
+		payouts::engine engine(wallet, journal.string(), policy, CUSTODIAN_ACC);
+		auto report = engine.poll(host::current_time());
+		if(report.recovered != 0 || report.orders_paid != 2 || engine.unfinished() != 0 || !report.errors.empty())
+			throw failure("payouts: recovery after crash before redeem");
+		report = engine.poll(host::current_time());
+		if(report.batches || report.orders_paid)
+			throw failure("payouts: paid orders are paid again");
+	}
+	if(wallet.transactions() != 2 || wallet.paid_to(buyer_script) != 40000 || wallet.paid_to(test_script) != 30000)
+		throw failure("payouts: orders are not paid exactly once");
+	must_equal("DBTC retired", get_balance(CUSTODIAN_ACC, CUSTODIAN_ACC, DBTC), asset(0, DBTC));
+}
+
+/*
+ * rebalance action keeps bitmex share of hedge assets around bitmex.trg, netting orders in flight
+ */
+namespace {
+
+	// mintorders and redeemorders of depostoken.hpp, read by primary key only
+	struct mint_order_row {
+		uint64_t           id;
+		name               user;
+		name               status;
+		int64_t            btc_amount;
+		eosio::checksum256 btc_txid;
+		uint64_t           mtime;
+
+		uint64_t primary_key() const { return id; }
+	};
+
+	struct redeem_order_row {
+		uint64_t           id;
+		name               user;
+		name               status;
+		int64_t            btc_amount;
+		eosio::checksum256 btc_txid;
+		uint64_t           mtime;
+		std::string        btc_address;
+
+		uint64_t primary_key() const { return id; }
+	};
+
+	template<uint64_t Table, typename Row>
+	std::vector<Row> bank_orders() {
+		eosio::multi_index<name(Table), Row> orders(CUSTODIAN_ACC, DBTC.code().raw());
+		std::vector<Row> result;
+		for(const auto& o : orders)
+			if(o.user == BANK_ACC)
+				result.push_back(o);
+		return result;
+	}
+
+	int64_t stat_variable(const char* varname) {
+		variables vars(BANK_ACC, name("stat").value);
+		auto itr = vars.find(name(varname).value);
+		return itr == vars.end() ? 0 : itr->value;
+	}
+
+	host::transaction_result rebalance() {
+		return host::push_action(BANK_ACC, name("rebalance"), TEST_ACC);
+	}
+
+	void must_have_orders(const std::string& title, size_t withdrawals, size_t topups) {
+		if(bank_orders<name("mintorders").value, mint_order_row>().size() != withdrawals
+			|| bank_orders<name("redeemorders").value, redeem_order_row>().size() != topups)
+			throw failure("hedge: " + title);
+	}
+
+} // namespace
+
+void hedge_flow() {
+	// bank holds 0.5 BTC of DBTC and 100 EOS, 1 BTC at bitmex, capital is about 10000 USD
+	exchange_state();
+	must_pass("bitmex.trg 60%", setvar(name("bitmex.trg"), 6000000000));
+	must_pass("hedge.band 5%", setvar(name("hedge.band"), 500000000));
+	must_pass("hedge.minord 0.001 BTC", setvar(name("hedge.minord"), 100000));
+	must_pass("hedge.cool 1 hour", setvar(name("hedge.cool"), 3600));
+
+	// 60% of 1.53 BTC is 0.918 BTC, 0.082 BTC is withdrawn from bitmex
+	must_pass("rebalance", rebalance());
+	must_have_orders("no withdrawal order", 1, 0);
+	auto withdrawal = bank_orders<name("mintorders").value, mint_order_row>()[0];
+	if(withdrawal.btc_amount != 8200000 || stat_variable("hedge.wdraw") != 8200000 || stat_variable("hedge.last") != -8200000)
+		throw failure("hedge: withdrawal order is " + std::to_string(withdrawal.btc_amount));
+
+	// cool-down holds the next order, then the order in flight is netted
+	must_pass("bitmex.trg 50%", setvar(name("bitmex.trg"), 5000000000));
+	must_pass("rebalance in cool-down", rebalance());
+	must_have_orders("order placed in cool-down", 1, 0);
+	must_pass("bitmex.trg 60%", setvar(name("bitmex.trg"), 6000000000));
+	host::advance_time(3601ull * 1000000);
+	must_pass("rebalance with withdrawal in flight", rebalance());
+	must_have_orders("withdrawal in flight is not netted", 1, 0);
+
+	// bitmex pays the withdrawal out before custodian fills the order: it is in transfer to bank,
+	// neither netted twice by rebalancing nor missed by bank assets
+	auto assets = host::read_bank_state().assets;
+	must_pass("btc.bitmex 0.918", setperiodic(name("btc.bitmex"), 91800000));
+	if(stat_variable("hedge.wdraw") != 0 || stat_variable("hedge.xfer") != 8200000)
+		throw failure("hedge: paid out withdrawal is not in transfer");
+	must_equal("assets with withdrawal in transfer", asset(host::read_bank_state().assets, DUSD), asset(assets, DUSD));
+	must_pass("rebalance with withdrawal paid out", rebalance());
+	must_have_orders("paid out withdrawal is netted twice", 1, 0);
+
+	// custodian fills the order, BTC deposit to bank does not settle it
+	must_pass("BTC deposit to bank", mint_dbtc(BANK_ACC, 100000));
+	if(stat_variable("hedge.xfer") != 8200000)
+		throw failure("hedge: BTC deposit settles withdrawal");
+	must_pass("fill hedge order", host::push_action(CUSTODIAN_ACC, name("fillhedge"), CUSTODIAN_ACC, withdrawal.id, txid(3001)));
+	if(stat_variable("hedge.xfer") != 0)
+		throw failure("hedge: withdrawal is not settled");
+	must_fail("fill hedge order twice", host::push_action(CUSTODIAN_ACC, name("fillhedge"), CUSTODIAN_ACC, withdrawal.id, txid(3002)));
+	must_equal("bank DBTC", get_balance(CUSTODIAN_ACC, BANK_ACC, DBTC), asset(58300000, DBTC));
+	must_have_orders("minted DBTC is not recorded", 2, 0);
+
+	// 75% of 1.531 BTC is 1.14825 BTC, 0.23025 BTC of DBTC is sent for bitmex top-up
+	must_pass("bitmex.trg 75%", setvar(name("bitmex.trg"), 7500000000));
+	must_pass("rebalance", rebalance());
+	must_have_orders("no top-up order", 2, 1);
+	auto topup = bank_orders<name("redeemorders").value, redeem_order_row>()[0];
+	if(topup.btc_amount != 23025000 || topup.status != name("new") || stat_variable("hedge.topup") != 23025000)
+		throw failure("hedge: top-up order is " + std::to_string(topup.btc_amount));
+	must_pass("Check solvency invariants", checkinvars());
+
+	// custodian pays the top-up out, it is bank's BTC till bitmex balance shows it
+	assets = host::read_bank_state().assets;
+	must_pass("custodian pays top-up", host::push_action(CUSTODIAN_ACC, name("redeem"), CUSTODIAN_ACC, DBTC.code(), topup.id, txid(2000)));
+	if(stat_variable("hedge.topup") != 23025000)
+		throw failure("hedge: top-up is settled by custodian payout");
+	must_equal("assets with top-up paid out", asset(host::read_bank_state().assets, DUSD), asset(assets, DUSD));
+	must_pass("btc.bitmex 1.14825", setperiodic(name("btc.bitmex"), 114825000));
+	if(stat_variable("hedge.topup") != 0)
+		throw failure("hedge: top-up is not settled");
+	must_equal("assets with top-up credited", asset(host::read_bank_state().assets, DUSD), asset(assets, DUSD));
+
+	// bitmex balance moves within the band
+	must_pass("btc.bitmex 1.1", setperiodic(name("btc.bitmex"), 110000000));
+	host::advance_time(3601ull * 1000000);
+	must_pass("rebalance within band", rebalance());
+	must_have_orders("order placed within band", 2, 1);
+
+	// out of band, but less than minimum order
+	must_pass("hedge.band 1%", setvar(name("hedge.band"), 100000000));
+	must_pass("hedge.minord 0.1 BTC", setvar(name("hedge.minord"), 10000000));
+	must_pass("rebalance with small order", rebalance());
+	must_have_orders("order less than minimum is placed", 2, 1);
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * transfer fees, daily volume, ledger totals and action metrics are accrued in shard rows of accounts
+ * and folded by sweepshards
+ */
+namespace {
+
+	struct ledger_row {
+		asset users_held;
+		asset issuer_held;
+
+		uint64_t primary_key() const { return users_held.symbol.code().raw(); }
+	};
+
+	struct metric_row {
+		uint64_t slot;
+		int64_t  hour;
+		uint64_t calls;
+		int64_t  volume;
+
+		uint64_t primary_key() const { return slot; }
+	};
+
+	using fee_shards = eosio::multi_index<name("feeshards"), shard_row>;
+	using ledger_shards = eosio::multi_index<name("ledgshards"), shard_row>;
+	using ledgers = eosio::multi_index<name("ledger"), ledger_row>;
+	using metrics = eosio::multi_index<name("metrics"), metric_row>;
+
+	template<typename Shards = fee_shards>
+	int64_t shard_value(uint64_t scope, name account, name code = BANK_ACC) {
+		Shards shards(code, scope);
+		auto itr = shards.find(shard_of(account));
+		return itr == shards.end() ? 0 : itr->value;
+	}
+
+	int64_t users_held(name code, const symbol& sym) {
+		ledgers ldg(code, code.value);
+		auto itr = ldg.find(sym.code().raw());
+		return itr == ldg.end() ? 0 : itr->users_held.amount;
+	}
+
+	int64_t ledger_shards_total(name code, const symbol& sym) {
+		int64_t total = 0;
+		for(const auto& s : ledger_shards(code, sym.code().raw()))
+			total += s.value;
+		return total;
+	}
+
+	metric_row current_metric(name metric_name) {
+		int64_t hour = host::current_time() / 1000000 / 3600;
+		metrics mtr(BANK_ACC, metric_name.value);
+		auto itr = mtr.find(hour % 24);
+		return itr == mtr.end() || itr->hour != hour ? metric_row{uint64_t(hour % 24), hour, 0, 0} : *itr;
+	}
+
+} // namespace
+
+void shards_flow() {
+	exchange_state();
+	must_pass("fee.transfer 1%", setvar(name("fee.transfer"), 100000000));
+	must_pass("Mint DBTC", mint_dbtc(BUYER, 3000000));
+	must_pass("sweep shards", sweepshards());
+	metric_row mint = current_metric(name("mint.dbtc"));
+	must_pass("BUYER buys DUSD", transfer_dbtc(BUYER, BANK_ACC, asset(3000000, DBTC), "Buy DUSD"));
+	if(current_metric(name("mint.dbtc")).calls != mint.calls)
+		throw failure("shards: mint metric is written by exchange");
+	must_pass("sweep shards", sweepshards());
+	if(current_metric(name("mint.dbtc")).calls != mint.calls + 1)
+		throw failure("shards: mint metric is not recorded by sweep");
+
+	// fees wait in shards of payers, bank balance is not written by transfers
+	auto bank_dusd = get_balance(BANK_ACC, BANK_ACC, DUSD);
+	int64_t dusd_users_held = users_held(BANK_ACC, DUSD);
+	metric_row p2p = current_metric(name("p2p"));
+	must_pass("p2p TEST_ACC => BUYER", transfer(TEST_ACC, BUYER, asset(1000, DUSD), "p2p"));
+	must_pass("p2p TEST_ACC => BUYER", transfer(TEST_ACC, BUYER, asset(2000, DUSD), "p2p"));
+	must_pass("p2p BUYER => TEST_ACC", transfer(BUYER, TEST_ACC, asset(5000, DUSD), "p2p"));
+	must_equal("bank DUSD before sweep", get_balance(BANK_ACC, BANK_ACC, DUSD), bank_dusd);
+	if(shard_value(DUSD.code().raw(), TEST_ACC) != 30 || shard_value(DUSD.code().raw(), BUYER) != 50)
+		throw failure("shards: transfer fees are not in shards of payers");
+
+	// ledger totals and p2p metric are not written by transfers between users either
+	if(users_held(BANK_ACC, DUSD) != dusd_users_held || current_metric(name("p2p")).calls != p2p.calls)
+		throw failure("shards: ledger totals or p2p metric are written by transfers");
+	if(shard_value<ledger_shards>(DUSD.code().raw(), TEST_ACC) + shard_value<ledger_shards>(DUSD.code().raw(), BUYER) == 0)
+		throw failure("shards: ledger deltas are not in shards of accounts");
+	must_pass("Check solvency invariants", checkinvars());
+	must_pass("sweep shards", sweepshards());
+	must_equal("bank DUSD after sweep", get_balance(BANK_ACC, BANK_ACC, DUSD), bank_dusd + asset(80, DUSD));
+	if(shard_value(DUSD.code().raw(), TEST_ACC) != 0 || shard_value(DUSD.code().raw(), BUYER) != 0)
+		throw failure("shards: fee shards are not folded");
+	if(shard_value<ledger_shards>(DUSD.code().raw(), TEST_ACC) != 0 || shard_value<ledger_shards>(DUSD.code().raw(), BUYER) != 0)
+		throw failure("shards: ledger shards are not folded");
+	if(users_held(BANK_ACC, DUSD) != dusd_users_held - 80)
+		throw failure("shards: ledger shards are folded into " + std::to_string(users_held(BANK_ACC, DUSD)));
+	metric_row p2p_swept = current_metric(name("p2p"));
+	if(p2p_swept.calls != p2p.calls + 3 || p2p_swept.volume != p2p.volume + 8000)
+		throw failure("shards: p2p metric is not recorded by sweep");
+	must_pass("Check solvency invariants", checkinvars());
+
+	// DBTC ledger shards are folded by custodian
+	must_pass("sweep custodian shards", host::push_action(CUSTODIAN_ACC, name("sweepshards"), TEST_ACC));
+	if(shard_value<ledger_shards>(DBTC.code().raw(), BUYER, CUSTODIAN_ACC) != 0)
+		throw failure("shards: DBTC ledger shards are not folded");
+	must_pass("Check solvency invariants", checkinvars());
+
+	// daily volume: orders are checked against the aggregate and the shard of their account, which
+	// takes orders while its volume not folded yet is within 'maxdayvol' / 16, 18.75 USD here
+	must_pass("maxdayvol 300 USD", setvar(name("maxdayvol"), 30000000000));
+	must_pass("volumeused", setstat(name("volumeused"), 0));
+	if(shard_of(TEST_ACC) == shard_of(BUYER))
+		throw failure("shards: TEST_ACC and BUYER share a shard");
+	must_pass("redeem 100 USD", transfer(TEST_ACC, BANK_ACC, asset(10000, DUSD), "Redeem for DBTC"));
+	must_pass("redeem 100 USD", transfer(BUYER, BANK_ACC, asset(10000, DUSD), "Redeem for DBTC"));
+	auto test_dbtc = get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC);
+	must_pass("redeem 1 USD, shard over allowance", transfer(TEST_ACC, BANK_ACC, asset(100, DUSD), "Redeem for DBTC"));
+	must_equal("redeem 1 USD, shard over allowance, is queued", get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC), test_dbtc);
+	must_pass("redeem 60 USD behind it", transfer(TEST_ACC, BANK_ACC, asset(6000, DUSD), "Redeem for DBTC"));
+	must_pass("mint 50 USD", transfer_dbtc(TEST_ACC, BANK_ACC, asset(500000, DBTC), "Buy DUSD"));
+	must_pass("sweep shards", sweepshards());
+	must_pass("fill queued redemption", fillredeems(10));
+	must_pass("redeem 20 USD, after mint", transfer(TEST_ACC, BANK_ACC, asset(2000, DUSD), "Redeem for DBTC"));
+	must_pass("Check solvency invariants", checkinvars());
+
+	// seeded totals are the running totals, shards not folded included
+	must_pass("p2p TEST_ACC => BUYER", transfer(TEST_ACC, BUYER, asset(1000, DUSD), "p2p"));
+	int64_t dusd_held = users_held(BANK_ACC, DUSD) + ledger_shards_total(BANK_ACC, DUSD);
+	int64_t dbtc_held = users_held(CUSTODIAN_ACC, DBTC) + ledger_shards_total(CUSTODIAN_ACC, DBTC);
+	must_fail("seedledger by user", host::push_action(BANK_ACC, name("seedledger"), TEST_ACC, DUSD.code()));
+	must_pass("seed DUSD ledger", host::push_action(BANK_ACC, name("seedledger"), ADMIN_ACC, DUSD.code()));
+	must_pass("seed DBTC ledger", host::push_action(CUSTODIAN_ACC, name("seedledger"), ADMIN_ACC, DBTC.code()));
+	if(users_held(BANK_ACC, DUSD) != dusd_held || ledger_shards_total(BANK_ACC, DUSD) != 0)
+		throw failure("shards: seeded DUSD users_held " + std::to_string(users_held(BANK_ACC, DUSD)) + " instead of " + std::to_string(dusd_held));
+	if(users_held(CUSTODIAN_ACC, DBTC) != dbtc_held || ledger_shards_total(CUSTODIAN_ACC, DBTC) != 0)
+		throw failure("shards: seeded DBTC users_held " + std::to_string(users_held(CUSTODIAN_ACC, DBTC)) + " instead of " + std::to_string(dbtc_held));
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * conversions of utility.hpp specialized for DUSD and DEUR policies read their own rate variables and
+ * give the same results as DUSD formulas at the same rates
+ */
+void stablecoin_flow() {
+	const symbol DEUR("DEUR", 2);
+	boot();
+	must_pass("setperiodic btceur", setperiodic(name("btceur"), 900000000000));
+	must_pass("setperiodic eoseur", setperiodic(name("eoseur"), 270000000));
+
+	// 1 BTC, 100 EOS; 0.5% fee at mint and redemption
+	auto usd = host::read_coin_quote(DUSD.code(), 100000000, 1000000);
+	auto eur = host::read_coin_quote(DEUR.code(), 100000000, 1000000);
+	if(usd.btc_price != 1000000 || usd.btc_value != 1000000 || usd.eos_value != 30000 || usd.mint_btc != 995000
+			|| usd.redeem_btc != 99004975 || usd.mint_eos != 29850 || usd.redeem_eos != 990050)
+		throw failure("stablecoin: DUSD quote changed, " + std::to_string(usd.mint_btc) + " for 1 BTC");
+	if(eur.btc_price != 900000 || eur.btc_value != 900000 || eur.eos_value != 27000 || eur.mint_btc != 895500
+			|| eur.redeem_btc != usd.redeem_btc || eur.mint_eos != 26865 || eur.redeem_eos != usd.redeem_eos)
+		throw failure("stablecoin: DEUR quote is " + std::to_string(eur.mint_btc) + " for 1 BTC");
+
+	// each policy reads only its own rates
+	must_pass("setperiodic btceur", setperiodic(name("btceur"), 450000000000));
+	if(host::read_coin_quote(DUSD.code(), 100000000, 0).mint_btc != 995000
+			|| host::read_coin_quote(DEUR.code(), 100000000, 0).mint_btc != 447750)
+		throw failure("stablecoin: quotes depend on rates of other policy");
+}
+
+/*
+ * cc_dbonds held by bank get no value, while layout of 'ccdbond' rows of dbonds contract is not
+ * published; dbonds contract is a stand-in writing rows of some layout the bank must not read
+ */
+namespace {
+
+	using eosio::extended_asset;
+	using eosio::symbol_code;
+	using eosio::time_point;
+
+	const name DBONDS_ACC("depccdbonds1");
+	const name DBOND_EMITENT("depccissuer1");
+
+	struct cc_dbond_fields {
+		symbol_code    dbond_id;
+		name           emitent;
+		asset          quantity_to_issue;
+		time_point     maturity_time;
+		time_point     retire_time;
+		extended_asset payoff_price;
+		bool           fungible;
+		std::string    additional_info;
+		extended_asset crypto_collateral;
+		int            early_payoff_policy;
+		asset          max_supply;
+		extended_asset issue_price;
+	};
+
+	struct cc_dbond_row {
+		cc_dbond_fields dbond;
+		time_point      initial_time;
+		int             cc_state;
+
+		uint64_t primary_key() const { return dbond.dbond_id.raw(); }
+	};
+
+	struct dbond_stats_row {
+		asset supply;
+		asset max_supply;
+		name  issuer;
+
+		uint64_t primary_key() const { return supply.symbol.code().raw(); }
+	};
+
+	struct dbond_account_row {
+		asset balance;
+
+		uint64_t primary_key() const { return balance.symbol.code().raw(); }
+	};
+
+	// fc_dbond serialized as dbond fields, then fc_dbond fields
+	struct dbond_fields {
+		symbol_code    dbond_id;
+		name           emitent;
+		asset          quantity_to_issue;
+		time_point     maturity_time;
+		time_point     retire_time;
+		extended_asset payoff_price;
+		bool           fungible;
+		std::string    additional_info;
+	};
+
+	struct fiat_bond_fields {
+		std::string ISIN;
+		std::string name;
+		std::string issuer;
+		std::string currency;
+		time_point  maturity_time;
+		std::string bond_description_webpage;
+	};
+
+	struct fc_dbond_fields {
+		dbond_fields      base;
+		fiat_bond_fields  collateral_bond;
+		name              verifier;
+		name              counterparty;
+		name              liquidation_agent;
+		std::string       escrow_contract_link;
+		int64_t           apr;
+		std::vector<name> holders_list;
+	};
+
+	struct fc_dbond_row {
+		fc_dbond_fields dbond;
+		time_point      initial_time;
+		extended_asset  initial_price;
+		extended_asset  current_price;
+		int             fc_state;
+		int             confirmed_by_counterparty;
+
+		uint64_t primary_key() const { return dbond.base.dbond_id.raw(); }
+	};
+
+	template<typename Row>
+	void emplace_dbond(name receiver, const Row& row, name emitent, asset supply) {
+		eosio::multi_index<name("stat"), dbond_stats_row> stats(receiver, row.primary_key());
+		eosio::multi_index<name("accounts"), dbond_account_row> accounts(receiver, BANK_ACC.value);
+		stats.emplace(receiver, [&](auto& r) { r = {supply, supply, emitent}; });
+		accounts.emplace(receiver, [&](auto& r) { r.balance = supply; });
+	}
+
+	// 'setccdbond' and 'setfcdbond' actions: dbond info with its supply, all of it is held by bank;
+	// 'setfcstate' sets fc_state of fc_dbond; 'confirmfcdb' sent by 'authdbond' of bank is accepted
+	void dbonds_apply(name receiver, name code, name action, const std::vector<char>& data) {
+		if(code != receiver || action == name("confirmfcdb"))
+			return;
+		eosio::datastream<const char*> ds(data.data(), data.size());
+		asset supply;
+		if(action == name("setccdbond")) {
+			cc_dbond_row row;
+			ds >> row >> supply;
+			eosio::multi_index<name("ccdbond"), cc_dbond_row> info(receiver, row.dbond.emitent.value);
+			info.emplace(receiver, [&](auto& r) { r = row; });
+			emplace_dbond(receiver, row, row.dbond.emitent, supply);
+		}
+		else if(action == name("setfcstate")) {
+			symbol_code id;
+			int state;
+			ds >> id >> state;
+			eosio::multi_index<name("fcdbond"), fc_dbond_row> info(receiver, DBOND_EMITENT.value);
+			info.modify(info.get(id.raw()), receiver, [&](auto& r) { r.fc_state = state; });
+		}
+		else if(action == name("setfcdbond")) {
+			fc_dbond_row row;
+			ds >> row >> supply;
+			eosio::multi_index<name("fcdbond"), fc_dbond_row> info(receiver, row.dbond.base.emitent.value);
+			info.emplace(receiver, [&](auto& r) { r = row; });
+			emplace_dbond(receiver, row, row.dbond.base.emitent, supply);
+		}
+		else
+			eosio::check(false, "unknown action");
+	}
+
+	host::transaction_result setccdbond(const char* id, extended_asset collateral, int64_t issue_price, int64_t supply) {
+		cc_dbond_row row{};
+		row.dbond.dbond_id = symbol_code(id);
+		row.dbond.emitent = DBOND_EMITENT;
+		row.dbond.max_supply = asset(supply, symbol(id, 0));
+		row.dbond.crypto_collateral = collateral;
+		row.dbond.issue_price = extended_asset(asset(issue_price, DUSD), BANK_ACC);
+		return host::push_action(DBONDS_ACC, name("setccdbond"), DBONDS_ACC, row, asset(supply, symbol(id, 0)));
+	}
+
+	int64_t dbonds_value(name contract) {
+		variables vars(BANK_ACC, name("dbonds").value);
+		return vars.get(contract.value, "dbonds contract is not registered").value;
+	}
+
+} // namespace
+
+void ccdbond_flow() {
+	exchange_state();
+	host::create_account(DBONDS_ACC);
+	host::set_code(DBONDS_ACC, dbonds_apply);
+	must_pass("register dbonds contract", setvar_scope(name("dbonds"), BANK_ACC, DBONDS_ACC, 0));
+
+	// 100 bonds of 150 USD on 2 BTC, 100 bonds of 100 USD on 3000 EOS, 50 bonds of 200 USD on 1 BTC
+	extended_asset btc2(asset(200000000, DBTC), CUSTODIAN_ACC), btc1(asset(100000000, DBTC), CUSTODIAN_ACC);
+	must_pass("cc_dbond on BTC", setccdbond("CCBTCA", btc2, 15000, 100));
+	must_pass("cc_dbond on EOS", setccdbond("CCEOS", extended_asset(asset(30000000, EOS), EOSIO_TOKEN), 10000, 100));
+	must_pass("cc_dbond on BTC", setccdbond("CCBTCB", btc1, 20000, 50));
+
+	must_pass("balance supply", host::push_action(BANK_ACC, name("blncsppl"), BANK_ACC));
+	if(dbonds_value(DBONDS_ACC) != 0)
+		throw failure("ccdbond: value is " + std::to_string(dbonds_value(DBONDS_ACC)));
+
+	// neither price of collateral nor its kind is looked at
+	must_pass("setperiodic btcusd", setperiodic(name("btcusd"), 600000000000));
+	must_pass("cc_dbond on DPS", setccdbond("CCDPS", extended_asset(asset(100000000, DPS), BANK_ACC), 100, 1));
+	must_pass("balance supply", host::push_action(BANK_ACC, name("blncsppl"), BANK_ACC));
+	if(dbonds_value(DBONDS_ACC) != 0)
+		throw failure("ccdbond: value at BTC crash is " + std::to_string(dbonds_value(DBONDS_ACC)));
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * fc_dbonds authorized by bank accrue interest from parameters cached by 'authdbond',
+ * without price pushes by dbonds contract
+ */
+namespace {
+
+	host::transaction_result setfcdbond(const char* id, int64_t initial_price, int64_t current_price, int64_t apr,
+			uint64_t maturity_us, int64_t supply, uint64_t retire_us = 0, int64_t payoff_price = 0) {
+		fc_dbond_row row{};
+		row.dbond.base.dbond_id = symbol_code(id);
+		row.dbond.base.emitent = DBOND_EMITENT;
+		row.dbond.base.maturity_time = time_point(eosio::microseconds(maturity_us));
+		row.dbond.base.retire_time = time_point(eosio::microseconds(retire_us));
+		row.dbond.base.payoff_price = extended_asset(asset(payoff_price, DUSD), BANK_ACC);
+		row.fc_state = 2; // CIRCULATING
+		row.dbond.apr = apr;
+		row.initial_time = time_point(eosio::microseconds(host::current_time()));
+		row.initial_price = extended_asset(asset(initial_price, DUSD), BANK_ACC);
+		row.current_price = extended_asset(asset(current_price, DUSD), BANK_ACC);
+		return host::push_action(DBONDS_ACC, name("setfcdbond"), DBONDS_ACC, row, asset(supply, symbol(id, 0)));
+	}
+
+} // namespace
+
+void fcaccrual_flow() {
+	const uint64_t year = 365ull * 24 * 3600 * 1000000;
+	exchange_state();
+	host::create_account(DBONDS_ACC);
+	host::set_code(DBONDS_ACC, dbonds_apply);
+	must_pass("register dbonds contract", setvar_scope(name("dbonds"), BANK_ACC, DBONDS_ACC, 0));
+
+	// 100 bonds of 100 USD at 10% for 2 years, authorized; 10 bonds at pushed price of 50 USD, not authorized
+	must_pass("fc_dbond at 10%", setfcdbond("FCACCR", 10000, 10000, 1000, host::current_time() + 2 * year, 100));
+	must_pass("fc_dbond priced by push", setfcdbond("FCPUSH", 5000, 5000, 1000, host::current_time() + 2 * year, 10));
+	must_fail("authdbond without admin", host::push_action(BANK_ACC, name("authdbond"), TEST_ACC, DBONDS_ACC, symbol_code("FCACCR")));
+	must_pass("authdbond", host::push_action(BANK_ACC, name("authdbond"), ADMIN_ACC, DBONDS_ACC, symbol_code("FCACCR")));
+
+	// a year later: 100 * 110 USD + 10 * 50 USD
+	host::advance_time(year);
+	must_pass("balance supply", host::push_action(BANK_ACC, name("blncsppl"), BANK_ACC));
+	if(dbonds_value(DBONDS_ACC) != 1150000)
+		throw failure("fcaccrual: value after a year is " + std::to_string(dbonds_value(DBONDS_ACC)));
+	must_pass("Check solvency invariants", checkinvars());
+
+	// a second before maturity: 100 * 119.99 USD + 10 * 50 USD
+	host::advance_time(year - 1000000);
+	must_pass("balance supply", host::push_action(BANK_ACC, name("blncsppl"), BANK_ACC));
+	if(dbonds_value(DBONDS_ACC) != 1249900)
+		throw failure("fcaccrual: value before maturity is " + std::to_string(dbonds_value(DBONDS_ACC)));
+
+	// dbonds held past maturity are unpaid, authorized or not
+	host::advance_time(year);
+	must_pass("balance supply", host::push_action(BANK_ACC, name("blncsppl"), BANK_ACC));
+	if(dbonds_value(DBONDS_ACC) != 0)
+		throw failure("fcaccrual: value after maturity is " + std::to_string(dbonds_value(DBONDS_ACC)));
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * sweep action walks only authorized dbonds due by maturity or retire time
+ */
+namespace {
+
+	struct authorized_dbond_row {
+		symbol_code dbond;
+		name        contract;
+
+		uint64_t primary_key() const { return dbond.raw(); }
+	};
+
+	struct dbond_due_row {
+		symbol_code dbond;
+		time_point  maturity_time;
+		time_point  retire_time;
+		bool        matured;
+
+		uint64_t primary_key() const { return dbond.raw(); }
+	};
+
+	host::transaction_result sweep(uint64_t max) {
+		return host::push_action(BANK_ACC, name("sweep"), TEST_ACC, max);
+	}
+
+	void must_sweep(const std::string& title, uint64_t max, uint64_t expected) {
+		host::set_print(true);
+		auto result = sweep(max);
+		host::set_print(false);
+		must_pass(title, result);
+		// inline supply balancing prints after the count
+		auto pos = result.console.find("swept ");
+		if(pos == std::string::npos || std::stoull(result.console.substr(pos + 6)) != expected)
+			throw failure(title + ": " + result.console + ", expected swept " + std::to_string(expected));
+	}
+
+} // namespace
+
+void sweep_flow() {
+	const uint64_t year = 365ull * 24 * 3600 * 1000000;
+	exchange_state();
+	host::create_account(DBONDS_ACC);
+	host::set_code(DBONDS_ACC, dbonds_apply);
+	must_pass("register dbonds contract", setvar_scope(name("dbonds"), BANK_ACC, DBONDS_ACC, 0));
+
+	// 10 bonds of 100 USD each, paid off at 110 USD: two mature in a year and retire in two, one matures in five
+	uint64_t now = host::current_time();
+	for(const char* id : {"FCPAID", "FCDFLT"})
+		must_pass(std::string("fc_dbond ") + id, setfcdbond(id, 10000, 10000, 0, now + year, 10, now + 2 * year, 11000));
+	must_pass("fc_dbond FCLATER", setfcdbond("FCLATER", 10000, 10000, 0, now + 5 * year, 10, now + 6 * year, 11000));
+	for(const char* id : {"FCPAID", "FCDFLT", "FCLATER"})
+		must_pass(std::string("authdbond ") + id, host::push_action(BANK_ACC, name("authdbond"), ADMIN_ACC, DBONDS_ACC, symbol_code(id)));
+	must_fail("authdbond twice", host::push_action(BANK_ACC, name("authdbond"), ADMIN_ACC, DBONDS_ACC, symbol_code("FCLATER")));
+	must_sweep("nothing due", 10, 0);
+
+	// matured dbonds held by bank are unpaid, technically defaulted one too, and are not valued at payoff price;
+	// sweep takes not more than 'max' of them
+	must_pass("FCDFLT technical default", host::push_action(DBONDS_ACC, name("setfcstate"), DBONDS_ACC, symbol_code("FCDFLT"), 4));
+	host::advance_time(year);
+	must_sweep("sweep one matured", 1, 1);
+	must_sweep("sweep the other", 10, 1);
+	must_sweep("nothing due", 10, 0);
+	if(dbonds_value(DBONDS_ACC) != 100000)
+		throw failure("sweep: value of matured dbonds is " + std::to_string(dbonds_value(DBONDS_ACC)));
+
+	// at retire time paid off dbond is unauthorized, the other is written down;
+	// stand-in does not burn paid off dbond, past maturity it has no value
+	must_pass("FCPAID paid off", host::push_action(DBONDS_ACC, name("setfcstate"), DBONDS_ACC, symbol_code("FCPAID"), 3));
+	host::advance_time(year);
+	must_sweep("sweep retired", 10, 2);
+	if(dbonds_value(DBONDS_ACC) != 100000)
+		throw failure("sweep: value after retire time is " + std::to_string(dbonds_value(DBONDS_ACC)));
+	eosio::multi_index<name("authfcdbonds"), authorized_dbond_row> authorized(BANK_ACC, BANK_ACC.value);
+	if(std::distance(authorized.begin(), authorized.end()) != 1 || authorized.begin()->dbond != symbol_code("FCLATER"))
+		throw failure("sweep: retired dbonds are still authorized");
+	eosio::multi_index<name("dbonddue"), dbond_due_row> dues(BANK_ACC, BANK_ACC.value);
+	if(std::distance(dues.begin(), dues.end()) != 1 || dues.begin()->dbond != symbol_code("FCLATER") || dues.begin()->matured)
+		throw failure("sweep: due times of retired dbonds are kept");
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * DPS balances and supply at snapshots are checkpointed by their first change after the snapshot
+ */
+namespace {
+
+	struct checkpoint_row {
+		uint64_t id;
+		asset    balance;
+
+		uint64_t primary_key() const { return id; }
+	};
+
+	size_t balance_checkpoints(name owner) {
+		eosio::multi_index<name("balchkpts"), checkpoint_row> checkpoints(BANK_ACC, owner.value);
+		return std::distance(checkpoints.begin(), checkpoints.end());
+	}
+
+	host::transaction_result snapshot() {
+		return host::push_action(BANK_ACC, name("snapshot"), ADMIN_ACC);
+	}
+
+	void must_print(const std::string& title, const host::transaction_result& result, const asset& expected) {
+		must_pass(title, result);
+		if(result.console != expected.to_string())
+			throw failure(title + ": printed " + result.console + ", expected " + expected.to_string());
+	}
+
+} // namespace
+
+void snapshots_flow() {
+	exchange_state();
+	must_fail("balance before any snapshot", host::push_action(BANK_ACC, name("balanceat"), TEST_ACC, TEST_ACC, uint64_t(1)));
+	auto test_dps = get_balance(BANK_ACC, TEST_ACC, DPS);
+	auto supply = stats(BANK_ACC, DPS.code().raw()).get(DPS.code().raw()).supply;
+	must_fail("snapshot without admin", host::push_action(BANK_ACC, name("snapshot"), TEST_ACC));
+
+	// snapshot 1: two transfers write one checkpoint of each account
+	must_pass("snapshot 1", snapshot());
+	must_pass("DPS to BUYER", transfer(TEST_ACC, BUYER, asset(100000000, DPS), "p2p"));
+	must_pass("DPS to BUYER", transfer(TEST_ACC, BUYER, asset(200000000, DPS), "p2p"));
+	if(balance_checkpoints(TEST_ACC) != 1 || balance_checkpoints(BUYER) != 1)
+		throw failure("snapshots: transfers within snapshot period wrote more than one checkpoint");
+	must_pass("list DPS sale", listdpssale(supply + asset(10000000000, DPS), asset(100, DUSD)));
+
+	// snapshot 2 and 3 without changes between them, then DPS goes back
+	must_pass("snapshot 2", snapshot());
+	must_pass("snapshot 3", snapshot());
+	must_pass("DPS to TEST_ACC", transfer(BUYER, TEST_ACC, asset(50000000, DPS), "p2p"));
+
+	host::set_print(true);
+	auto balanceat = [](name owner, uint64_t id) {
+		return host::push_action(BANK_ACC, name("balanceat"), TEST_ACC, owner, id);
+	};
+	auto supplyat = [](uint64_t id) {
+		return host::push_action(BANK_ACC, name("supplyat"), TEST_ACC, id);
+	};
+	must_print("TEST_ACC at 1", balanceat(TEST_ACC, 1), test_dps);
+	must_print("TEST_ACC at 2", balanceat(TEST_ACC, 2), test_dps - asset(300000000, DPS));
+	must_print("TEST_ACC at 3", balanceat(TEST_ACC, 3), test_dps - asset(300000000, DPS));
+	must_print("BUYER at 1", balanceat(BUYER, 1), asset(0, DPS));
+	must_print("BUYER at 3", balanceat(BUYER, 3), asset(300000000, DPS));
+	must_print("supply at 1", supplyat(1), supply);
+	must_print("supply at 3", supplyat(3), supply + asset(10000000000, DPS));
+	host::set_print(false);
+	must_fail("balance at future snapshot", balanceat(TEST_ACC, 4));
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * profit distributed to DPS holders is accrued by their balance changes and claimed by each holder
+ */
+namespace {
+
+	// profit of 'balance' for accumulator growth by 'profit' per 'circulation', as accrue_profit() computes it
+	int64_t profit_share(int64_t balance, int64_t profit, int64_t circulation) {
+		const unsigned __int128 scale = 1000000000000000000ull;
+		return int64_t(balance * (profit * scale / circulation) / scale);
+	}
+
+	host::transaction_result distribute(asset profit) {
+		return host::push_action(BANK_ACC, name("distribute"), ADMIN_ACC, profit);
+	}
+
+	host::transaction_result claim(name owner) {
+		return host::push_action(BANK_ACC, name("claim"), TEST_ACC, owner);
+	}
+
+} // namespace
+
+void profit_flow() {
+	exchange_state();
+	must_fail("distribute without admin", host::push_action(BANK_ACC, name("distribute"), TEST_ACC, asset(1000, DUSD)));
+	must_pass("DPS to BUYER", transfer(TEST_ACC, BUYER, asset(2000000000, DPS), "p2p"));
+	int64_t test_dps = get_balance(BANK_ACC, TEST_ACC, DPS).amount;
+	int64_t develop_dps = get_balance(BANK_ACC, DEVEL_ACC, DPS).amount;
+	int64_t circulation = test_dps + develop_dps + 2000000000;
+	must_fail("distribute more than capital", distribute(asset(host::read_bank_state().capital + 1, DUSD)));
+
+	// 300 USD to holders as they are, then TEST_ACC moves DPS to BUYER and 100 USD more are distributed
+	int64_t capital = host::read_bank_state().capital;
+	must_pass("distribute 300 USD", distribute(asset(30000, DUSD)));
+	if(host::read_bank_state().capital != capital - 30000)
+		throw failure("profit: distributed profit is counted in capital");
+	must_pass("DPS to BUYER", transfer(TEST_ACC, BUYER, asset(1000000000, DPS), "p2p"));
+	must_pass("distribute 100 USD", distribute(asset(10000, DUSD)));
+
+	auto test_dusd = get_balance(BANK_ACC, TEST_ACC, DUSD);
+	auto buyer_dusd = get_balance(BANK_ACC, BUYER, DUSD);
+	must_pass("TEST_ACC claims", claim(TEST_ACC));
+	must_pass("BUYER claims", claim(BUYER));
+	must_fail("BUYER claims again", claim(BUYER));
+	int64_t test_profit = profit_share(test_dps, 30000, circulation) + profit_share(test_dps - 1000000000, 10000, circulation);
+	int64_t buyer_profit = profit_share(2000000000, 30000, circulation) + profit_share(3000000000, 10000, circulation);
+	must_equal("TEST_ACC profit", get_balance(BANK_ACC, TEST_ACC, DUSD), test_dusd + asset(test_profit, DUSD));
+	must_equal("BUYER profit", get_balance(BANK_ACC, BUYER, DUSD), buyer_dusd + asset(buyer_profit, DUSD));
+
+	// claims pay out of profit owed, not capital
+	if(host::read_bank_state().capital != capital - 40000 || profit_owed() != 40000 - test_profit - buyer_profit)
+		throw failure("profit: claims changed capital or owed profit is wrong");
+	must_pass("DEVEL_ACC claims", claim(DEVEL_ACC));
+	// rounding leaves less than a cent for every holder at every distribution
+	if(profit_owed() >= 3 * 2)
+		throw failure("profit: " + std::to_string(profit_owed()) + " cents left after all claims");
+
+	// DPS transfer fees waiting in shards are the bank's, they get no share
+	must_pass("fee.transfer 10%", setvar(name("fee.transfer"), 1000000000));
+	must_pass("DPS to TEST_ACC", transfer(BUYER, TEST_ACC, asset(2000000000, DPS), "p2p"));
+	must_pass("fee.transfer 0", setvar(name("fee.transfer"), 0));
+	int64_t owed = profit_owed();
+	must_pass("distribute 100 USD", distribute(asset(10000, DUSD)));
+	for(auto holder : {TEST_ACC, BUYER, DEVEL_ACC})
+		must_pass("claim", claim(holder));
+	if(profit_owed() - owed >= 3)
+		throw failure("profit: " + std::to_string(profit_owed() - owed) + " cents of distribution left after all claims");
+	must_pass("sweep shards", sweepshards());
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * savings vault: deposits buy shares at the current share price, accrual raises it for all savers at once,
+ * not faster than fc_dbonds held by bank earn
+ */
+namespace {
+
+	host::transaction_result withdraw(name owner, int64_t shares) {
+		return host::push_action(BANK_ACC, name("withdraw"), owner, owner, shares);
+	}
+
+	host::transaction_result accrue() {
+		return host::push_action(BANK_ACC, name("accrue"), TEST_ACC);
+	}
+
+} // namespace
+
+void savings_flow() {
+	const uint64_t half_year = 365ull * 12 * 3600 * 1000000;
+	host::set_deltas(true);
+	health::monitor monitor(BANK_ACC, CUSTODIAN_ACC, EOSIO_TOKEN);
+	auto apply_deltas = [&]() {
+		for(const auto& deltas : host::take_deltas())
+			monitor.apply(deltas);
+	};
+	try {
+		exchange_state();
+		must_pass("DUSD to BUYER", transfer(TEST_ACC, BUYER, asset(60000, DUSD), "p2p"));
+		must_pass("savings APR 20%", setvar(name("save.apr"), 2000));
+
+		// without dbonds savings do not grow, 10 bonds at 10% cap savings APR at 10%
+		host::create_account(DBONDS_ACC);
+		host::set_code(DBONDS_ACC, dbonds_apply);
+		must_pass("register dbonds contract", setvar_scope(name("dbonds"), BANK_ACC, DBONDS_ACC, 0));
+		must_pass("fc_dbond at 10%", setfcdbond("FCSAVE", 10000, 10000, 1000, host::current_time() + 20 * half_year, 10));
+		must_pass("authdbond", host::push_action(BANK_ACC, name("authdbond"), ADMIN_ACC, DBONDS_ACC, symbol_code("FCSAVE")));
+		must_pass("balance supply", host::push_action(BANK_ACC, name("blncsppl"), BANK_ACC));
+		must_equal("savings APR cap", asset(stat_variable("dbonds.apr"), DUSD), asset(1000, DUSD));
+
+		// deposit is retired and taken off bank assets, so supply stays balanced
+		auto before = host::read_bank_state();
+		must_pass("TEST_ACC deposits 1000 USD", transfer(TEST_ACC, BANK_ACC, asset(100000, DUSD), "Deposit to savings"));
+		auto after = host::read_bank_state();
+		if(after.dusd_supply != before.dusd_supply - 100000 || after.assets != before.assets - 100000)
+			throw failure("savings: deposit changed supply by " + std::to_string(after.dusd_supply - before.dusd_supply)
+				+ " and assets by " + std::to_string(after.assets - before.assets));
+
+		// half a year at 10% makes share price 1.05 cents, BUYER gets 50000 shares for 525 USD;
+		// health monitor takes dbonds at value saved by supply balancing
+		host::advance_time(half_year);
+		must_pass("balance supply", host::push_action(BANK_ACC, name("blncsppl"), BANK_ACC));
+		apply_deltas();
+		host::set_deltas(false);
+		std::map<std::string, double> metrics;
+		for(const auto& m : monitor.compute(host::current_time()))
+			metrics[m.name] = m.value;
+		if(metrics.at("deposbank_savings_cents") != 105000 || metrics.at("deposbank_assets_cents") != host::read_bank_state().assets)
+			throw failure("savings: health monitor values vault at " + std::to_string(metrics.at("deposbank_savings_cents")));
+	}
+	catch(...) {
+		host::set_deltas(false);
+		throw;
+	}
+	must_pass("BUYER deposits 525 USD", transfer(BUYER, BANK_ACC, asset(52500, DUSD), "Deposit to savings"));
+	must_fail("withdraw without owner", host::push_action(BANK_ACC, name("withdraw"), TEST_ACC, BUYER, int64_t(1)));
+	must_fail("withdraw more than owned", withdraw(BUYER, 50001));
+
+	auto test_dusd = get_balance(BANK_ACC, TEST_ACC, DUSD);
+	must_pass("TEST_ACC withdraws", withdraw(TEST_ACC, 100000));
+	must_equal("TEST_ACC savings", get_balance(BANK_ACC, TEST_ACC, DUSD), test_dusd + asset(105000, DUSD));
+	must_fail("TEST_ACC withdraws again", withdraw(TEST_ACC, 1));
+
+	// accrual is one write for any number of savers and balances supply
+	host::advance_time(half_year);
+	must_fail("Supply is behind accrued savings", checkinvars());
+	must_pass("accrue", accrue());
+	must_pass("Check solvency invariants", checkinvars());
+	auto buyer_dusd = get_balance(BANK_ACC, BUYER, DUSD);
+	must_pass("maxdataage 1 hour", setvar(name("maxdataage"), 3600));
+	host::advance_time(3601ull * 1000000);
+	must_fail("withdraw with stale oracle data", withdraw(BUYER, 50000));
+	must_pass("maxdataage back", setvar(name("maxdataage"), 10000000000000));
+	must_pass("BUYER withdraws", withdraw(BUYER, 50000));
+	must_equal("BUYER savings", get_balance(BANK_ACC, BUYER, DUSD), buyer_dusd + asset(55125, DUSD));
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * redemption queue: redemptions over daily volume wait in FIFO order, escrowed DUSD is not bank capital
+ */
+namespace {
+
+	void must_print_position(const char* title, const symbol& want, uint64_t order_id, const std::string& expected) {
+		host::set_print(true);
+		auto result = host::push_action(BANK_ACC, name("rdmposition"), TEST_ACC, want.code(), order_id);
+		host::set_print(false);
+		must_pass(title, result);
+		// get_used_volume() prints its decay before
+		if(result.console.find(expected) == std::string::npos)
+			throw failure(std::string(title) + ": '" + result.console + "' instead of '" + expected + "'");
+	}
+
+} // namespace
+
+void redeemqueue_flow() {
+	const uint64_t hour = 3600ull * 1000000;
+	exchange_state();
+	must_pass("DUSD to BUYER", transfer(TEST_ACC, BUYER, asset(10000, DUSD), "p2p"));
+	must_pass("maxordersize 100 USD", setvar(name("maxordersize"), 10000000000));
+	must_pass("maxdayvol 300 USD", setvar(name("maxdayvol"), 30000000000));
+	must_pass("sweep shards", sweepshards());
+	must_pass("volumeused 290 USD", setstat(name("volumeused"), 29000000000));
+
+	// DUSD leaves redeemer at once and waits in bank balance, capital is not changed by escrow
+	auto before = host::read_bank_state();
+	auto test_dusd = get_balance(BANK_ACC, TEST_ACC, DUSD);
+	auto test_dbtc = get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC);
+	must_pass("TEST_ACC redeems 50 USD", transfer(TEST_ACC, BANK_ACC, asset(5000, DUSD), "Redeem for DBTC"));
+	must_equal("TEST_ACC DUSD escrowed", get_balance(BANK_ACC, TEST_ACC, DUSD), test_dusd - asset(5000, DUSD));
+	must_equal("TEST_ACC DBTC not sent", get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC), test_dbtc);
+	// small order fits into volume, but waits behind the queue
+	must_pass("BUYER redeems 5 USD", transfer(BUYER, BANK_ACC, asset(500, DUSD), "Redeem for DBTC"));
+	must_fail("Order above maxordersize is not queued", transfer(TEST_ACC, BANK_ACC, asset(15000, DUSD), "Redeem for DBTC"));
+	auto after = host::read_bank_state();
+	if(after.capital != before.capital || after.dusd_supply != before.dusd_supply)
+		throw failure("redeemqueue: escrow changed capital by " + std::to_string(after.capital - before.capital));
+	must_pass("Check solvency invariants", checkinvars());
+
+	// 290 + 50 ahead + 2 * 5 is 50 USD over 300, volume decays by 15 USD per hour
+	must_print_position("position of BUYER", DBTC, 1, "position 1 ahead 50.00 DUSD wait 14400");
+	must_fail("position of unknown order", host::push_action(BANK_ACC, name("rdmposition"), TEST_ACC, DBTC.code(), uint64_t(2)));
+
+	// head of queue does not fit, nothing is filled and nothing behind it jumps the queue
+	must_pass("fill before volume decays", fillredeems(10));
+	if(redeem_queue().tail - redeem_queue().head != 2)
+		throw failure("redeemqueue: order filled before volume decayed");
+
+	// 6 hours decay volume to 200 USD, batch is bounded by 'max'
+	host::advance_time(6 * hour);
+	must_pass("fill one", fillredeems(1));
+	if(get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC) <= test_dbtc)
+		throw failure("redeemqueue: TEST_ACC got no DBTC");
+	must_equal("TEST_ACC DUSD after fill", get_balance(BANK_ACC, TEST_ACC, DUSD), test_dusd - asset(5000, DUSD));
+	must_equal("BUYER order is queued after fill", redeem_queue().queued, asset(500, DUSD));
+	must_print_position("position of BUYER after fill", DBTC, 1, "position 0 ahead 0.00 DUSD wait 0");
+	must_fail("position of filled order", host::push_action(BANK_ACC, name("rdmposition"), TEST_ACC, DBTC.code(), uint64_t(0)));
+
+	must_pass("sweep shards", sweepshards());
+	auto buyer_dbtc = get_balance(CUSTODIAN_ACC, BUYER, DBTC);
+	must_pass("fill rest", fillredeems(10));
+	if(get_balance(CUSTODIAN_ACC, BUYER, DBTC) <= buyer_dbtc)
+		throw failure("redeemqueue: BUYER got no DBTC");
+	must_fail("queue is empty", fillredeems(10));
+	must_equal("nothing is queued", redeem_queue().queued, asset(0, DUSD));
+	must_pass("Check solvency invariants", checkinvars());
+
+	// empty queue does not hold redemptions, which fit
+	must_pass("BUYER redeems 5 USD at once", transfer(BUYER, BANK_ACC, asset(500, DUSD), "Redeem for DBTC"));
+	if(redeem_queue().tail != redeem_queue().head)
+		throw failure("redeemqueue: redemption queued behind empty queue");
+
+	// 400 USD is more than 100 EOS of bank, EOS queue does not hold redemptions for DBTC
+	must_pass("maxordersize 500 USD", setvar(name("maxordersize"), 50000000000));
+	must_pass("maxdayvol 10000 USD", setvar(name("maxdayvol"), 1000000000000));
+	must_pass("TEST_ACC redeems 400 USD for EOS", transfer(TEST_ACC, BANK_ACC, asset(40000, DUSD), "Redeem for EOS"));
+	must_pass("BUYER redeems 5 USD for EOS", transfer(BUYER, BANK_ACC, asset(500, DUSD), "Redeem for EOS"));
+	must_pass("TEST_ACC redeems 10 USD for EOS", transfer(TEST_ACC, BANK_ACC, asset(1000, DUSD), "Redeem for EOS"));
+	must_equal("EOS redemptions are queued", redeem_queue(EOS).queued, asset(41500, DUSD));
+	must_pass("BUYER redeems 5 USD for DBTC", transfer(BUYER, BANK_ACC, asset(500, DUSD), "Redeem for DBTC"));
+	if(redeem_queue(DBTC).tail != redeem_queue(DBTC).head)
+		throw failure("redeemqueue: redemption for DBTC queued behind EOS queue");
+	must_pass("fill with EOS short", fillredeems(10));
+	must_equal("EOS redemptions wait", redeem_queue(EOS).queued, asset(41500, DUSD));
+
+	// owner takes escrow back, fill and position skip the gap
+	must_fail("cancel by another account", host::push_action(BANK_ACC, name("rdmcancel"), TEST_ACC, TEST_ACC, EOS.code(), uint64_t(1)));
+	auto buyer_dusd = get_balance(BANK_ACC, BUYER, DUSD);
+	must_pass("BUYER cancels", host::push_action(BANK_ACC, name("rdmcancel"), BUYER, BUYER, EOS.code(), uint64_t(1)));
+	must_equal("BUYER DUSD refunded", get_balance(BANK_ACC, BUYER, DUSD), buyer_dusd + asset(500, DUSD));
+	// position is a difference of running totals: cancel ahead of a queued order is not subtracted
+	// from its position, cancel before an order is queued is
+	must_print_position("position after cancel", EOS, 2, "position 2 ahead 405.00 DUSD wait 0");
+	must_pass("BUYER redeems 20 USD for EOS", transfer(BUYER, BANK_ACC, asset(2000, DUSD), "Redeem for EOS"));
+	must_print_position("position behind cancel", EOS, 3, "position 2 ahead 410.00 DUSD wait 0");
+	must_pass("TEST_ACC cancels head", host::push_action(BANK_ACC, name("rdmcancel"), TEST_ACC, TEST_ACC, EOS.code(), uint64_t(0)));
+	auto test_eos = get_balance(EOSIO_TOKEN, TEST_ACC, EOS);
+	auto buyer_eos = get_balance(EOSIO_TOKEN, BUYER, EOS);
+	must_pass("fill after cancel", fillredeems(10));
+	if(get_balance(EOSIO_TOKEN, TEST_ACC, EOS) <= test_eos || get_balance(EOSIO_TOKEN, BUYER, EOS) <= buyer_eos
+		|| redeem_queue(EOS).queued.amount != 0 || redeem_queue(EOS).head != redeem_queue(EOS).tail)
+		throw failure("redeemqueue: orders behind cancelled ones are not filled");
+
+	// gaps count against 'max' of fill, an order behind two gaps takes the second fill of 2
+	must_pass("TEST_ACC redeems 400 USD for EOS", transfer(TEST_ACC, BANK_ACC, asset(40000, DUSD), "Redeem for EOS"));
+	must_pass("BUYER redeems 5 USD for EOS", transfer(BUYER, BANK_ACC, asset(500, DUSD), "Redeem for EOS"));
+	must_pass("BUYER redeems 5 USD more", transfer(BUYER, BANK_ACC, asset(500, DUSD), "Redeem for EOS"));
+	must_pass("BUYER cancels", host::push_action(BANK_ACC, name("rdmcancel"), BUYER, BUYER, EOS.code(), uint64_t(5)));
+	must_pass("TEST_ACC cancels", host::push_action(BANK_ACC, name("rdmcancel"), TEST_ACC, TEST_ACC, EOS.code(), uint64_t(4)));
+	must_equal("redemption behind gaps is queued", redeem_queue(EOS).queued, asset(500, DUSD));
+	must_pass("fill of 2 skips gaps", fillredeems(2));
+	if(redeem_queue(EOS).head != 6 || redeem_queue(EOS).queued.amount != 500)
+		throw failure("redeemqueue: fill of 2 read more than 2 orders");
+	must_pass("fill behind gaps", fillredeems(2));
+	must_equal("nothing is queued for EOS", redeem_queue(EOS).queued, asset(0, DUSD));
+	must_pass("Check solvency invariants", checkinvars());
+}
+
+/*
+ * batch epochs: intents wait without valuation, settlement prices the epoch at one snapshot and nets supply
+ */
+namespace {
+
+	host::transaction_result settleepoch() {
+		return host::push_action(BANK_ACC, name("settleepoch"), TEST_ACC);
+	}
+
+} // namespace
+
+void batch_flow() {
+	const uint64_t hour = 3600ull * 1000000;
+	exchange_state();
+	must_pass("DUSD to BUYER", transfer(TEST_ACC, BUYER, asset(10000, DUSD), "p2p"));
+	must_fail("Batch mode is off", transfer(TEST_ACC, BANK_ACC, asset(5000, DUSD), "Batch redeem for DBTC"));
+	must_pass("batch epoch 1 hour", setvar(name("batch.epoch"), 3600));
+	must_fail("Settle empty epoch", settleepoch());
+
+	// payments are not bank's till settlement, so intents move neither assets, nor capital, nor supply
+	auto before = host::read_bank_state();
+	must_pass("TEST_ACC mint intent", transfer_dbtc(TEST_ACC, BANK_ACC, asset(1000000, DBTC), "Batch buy DUSD"));
+	must_pass("TEST_ACC redemption intent", transfer(TEST_ACC, BANK_ACC, asset(5000, DUSD), "Batch redeem for DBTC"));
+	must_pass("BUYER redemption intent", transfer(BUYER, BANK_ACC, asset(2000, DUSD), "Batch redeem for EOS"));
+	auto after = host::read_bank_state();
+	if(after.assets != before.assets || after.capital != before.capital || after.dusd_supply != before.dusd_supply)
+		throw failure("batch: intents changed assets by " + std::to_string(after.assets - before.assets)
+			+ ", capital by " + std::to_string(after.capital - before.capital));
+	must_pass("Check solvency invariants", checkinvars());
+	must_fail("Settle before epoch is over", settleepoch());
+
+	// every intent gets what a single order would get at the rates of settlement
+	host::advance_time(hour);
+	bank_client::quoter quoter(read_snapshot(), host::current_time());
+	auto receive = [&](name owner, name contract, const char* sym, int64_t amount, const char* memo) {
+		return quoter.price({owner.to_string(), BANK_ACC.to_string(), contract.to_string(), sym, amount, memo}).receive;
+	};
+	auto test_dusd = get_balance(BANK_ACC, TEST_ACC, DUSD);
+	auto test_dbtc = get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC);
+	auto buyer_eos = get_balance(EOSIO_TOKEN, BUYER, EOS);
+	must_pass("Settle epoch", settleepoch());
+	must_equal("TEST_ACC minted", get_balance(BANK_ACC, TEST_ACC, DUSD) - test_dusd,
+		asset(receive(TEST_ACC, CUSTODIAN_ACC, "DBTC", 1000000, "Buy DUSD"), DUSD));
+	must_equal("TEST_ACC redeemed", get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC) - test_dbtc,
+		asset(receive(TEST_ACC, BANK_ACC, "DUSD", 5000, "Redeem for DBTC"), DBTC));
+	must_equal("BUYER redeemed", get_balance(EOSIO_TOKEN, BUYER, EOS) - buyer_eos,
+		asset(receive(BUYER, BANK_ACC, "DUSD", 2000, "Redeem for EOS"), EOS));
+	if(batch_epoch().intents != 0 || batch_epoch().id != 1 || batch_epoch().dusd.amount != 0)
+		throw failure("batch: epoch is not reset by settlement");
+	// one supply balancing takes supply to assets for the net of the epoch
+	must_pass("Check solvency invariants", checkinvars());
+
+	// the next epoch starts at settlement
+	must_pass("BUYER redemption intent", transfer(BUYER, BANK_ACC, asset(1000, DUSD), "Batch redeem for DBTC"));
+	must_fail("Settle before next epoch is over", settleepoch());
+	host::advance_time(hour);
+	must_pass("Settle next epoch", settleepoch());
+	must_pass("Check solvency invariants", checkinvars());
+
+	// intents are checked as single orders at submission
+	must_pass("maxordersize 500 USD", setvar(name("maxordersize"), 50000000000));
+	must_fail("Intent above maxordersize", transfer(TEST_ACC, BANK_ACC, asset(60000, DUSD), "Batch redeem for EOS"));
+	must_fail("Intent below batch.minord", transfer(TEST_ACC, BANK_ACC, asset(50, DUSD), "Batch redeem for DBTC"));
+	must_fail("Mint intent below batch.minord", transfer_dbtc(TEST_ACC, BANK_ACC, asset(5000, DBTC), "Batch buy DUSD"));
+
+	// 400 USD is more than 100 EOS of bank, the intent is refunded and the rest of the epoch settles
+	test_dusd = get_balance(BANK_ACC, TEST_ACC, DUSD);
+	buyer_eos = get_balance(EOSIO_TOKEN, BUYER, EOS);
+	must_pass("TEST_ACC redeems 400 USD for EOS", transfer(TEST_ACC, BANK_ACC, asset(40000, DUSD), "Batch redeem for EOS"));
+	must_pass("BUYER redeems 10 USD for EOS", transfer(BUYER, BANK_ACC, asset(1000, DUSD), "Batch redeem for EOS"));
+	host::advance_time(hour);
+	must_pass("Settle epoch short of EOS", settleepoch());
+	must_equal("TEST_ACC DUSD refunded", get_balance(BANK_ACC, TEST_ACC, DUSD), test_dusd);
+	if(get_balance(EOSIO_TOKEN, BUYER, EOS) <= buyer_eos)
+		throw failure("batch: BUYER got no EOS");
+	must_pass("Check solvency invariants", checkinvars());
+
+	// EOS of open mint intent is not paid out: 300 USD is more than EOS of bank, but less than with the intent
+	must_pass("issue EOS", issue_eos(TEST_ACC, asset(1000000, EOS)));
+	must_pass("TEST_ACC mints for 100 EOS", transfer_eos(TEST_ACC, BANK_ACC, asset(1000000, EOS), "Batch buy DUSD"));
+	auto bank_eos = get_balance(EOSIO_TOKEN, BANK_ACC, EOS);
+	must_pass("TEST_ACC redeems 300 USD for EOS", transfer(TEST_ACC, BANK_ACC, asset(30000, DUSD), "Redeem for EOS"));
+	must_equal("redemption is queued", redeem_queue(EOS).queued, asset(30000, DUSD));
+	must_pass("fill with intent open", fillredeems(10));
+	must_equal("bank EOS of intent", get_balance(EOSIO_TOKEN, BANK_ACC, EOS), bank_eos);
+	host::advance_time(hour);
+	must_pass("Settle epoch with queued redemption", settleepoch());
+	must_pass("fill after settlement", fillredeems(10));
+	must_equal("redemption is filled", redeem_queue(EOS).queued, asset(0, DUSD));
+	must_pass("Check solvency invariants", checkinvars());
+
+	// 12000 USD is more than DUSD balance of bank, minters are paid from issue, not from bank capital
+	must_pass("maxordersize 20000 USD", setvar(name("maxordersize"), 2000000000000));
+	must_pass("mint DBTC", mint_dbtc(TEST_ACC, 120000000));
+	test_dusd = get_balance(BANK_ACC, TEST_ACC, DUSD);
+	if(get_balance(BANK_ACC, BANK_ACC, DUSD).amount >= 1200000)
+		throw failure("batch: bank holds DUSD for mint");
+	must_pass("TEST_ACC mints 12000 USD", transfer_dbtc(TEST_ACC, BANK_ACC, asset(120000000, DBTC), "Batch buy DUSD"));
+	host::advance_time(hour);
+	must_pass("Settle epoch over bank DUSD", settleepoch());
+	if(get_balance(BANK_ACC, TEST_ACC, DUSD).amount <= test_dusd.amount + 1190000)
+		throw failure("batch: TEST_ACC got no DUSD");
+	must_pass("Check solvency invariants", checkinvars());
+
+	// mint, which takes volume below -300 USD, is refunded, redemption behind it is not held
+	must_pass("maxdayvol 300 USD", setvar(name("maxdayvol"), 30000000000));
+	must_pass("sweep shards", sweepshards());
+	must_pass("volumeused -290 USD", setstat(name("volumeused"), -29000000000));
+	test_dbtc = get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC);
+	auto buyer_dbtc = get_balance(CUSTODIAN_ACC, BUYER, DBTC);
+	must_pass("TEST_ACC mints 100 USD", transfer_dbtc(TEST_ACC, BANK_ACC, asset(1000000, DBTC), "Batch buy DUSD"));
+	must_pass("BUYER redeems 20 USD for DBTC", transfer(BUYER, BANK_ACC, asset(2000, DUSD), "Batch redeem for DBTC"));
+	host::advance_time(hour);
+	must_pass("Settle epoch over daily volume", settleepoch());
+	must_equal("TEST_ACC DBTC refunded", get_balance(CUSTODIAN_ACC, TEST_ACC, DBTC), test_dbtc);
+	if(get_balance(CUSTODIAN_ACC, BUYER, DBTC) <= buyer_dbtc)
+		throw failure("batch: BUYER got no DBTC");
+	must_pass("Check solvency invariants", checkinvars());
+
+}
+
+/*
+ * proof of liabilities: tree built by tools/pol from a snapshot as cleos prints it, checked by 'verifypol'
+ */
+namespace {
+
+	struct pol_proof_row {
+		eosio::checksum256 hash;
+		int64_t            sum;
+		bool               is_left;
+	};
+
+	host::transaction_result verifypol(name owner, const asset& balance, const std::vector<pol::proof_node>& path) {
+		std::vector<pol_proof_row> rows;
+		for(const auto& p : path)
+			rows.push_back({eosio::checksum256(p.hash), p.sum, p.is_left});
+		return host::push_action(BANK_ACC, name("verifypol"), TEST_ACC, owner, balance, rows);
+	}
+
+} // namespace
+
+void pol_flow() {
+	exchange_state();
+	must_fail("verify before commit", verifypol(TEST_ACC, asset(0, DUSD), {}));
+
+	// odd number of leaves, the last one goes up without a pair
+	std::vector<name> owners = {TEST_ACC, BUYER, ADMIN_ACC};
+	std::vector<pol::node> leaves;
+	int64_t total = 0;
+	for(auto owner : owners) {
+		std::string printed = get_balance(BANK_ACC, owner, DUSD).to_string();
+		int64_t amount = pol::parse_amount(printed.substr(0, printed.find(' ')), DUSD.precision());
+		leaves.push_back(pol::leaf(owner.value, amount));
+		total += amount;
+	}
+	auto levels = pol::build_levels(leaves, 2);
+	if(levels.back()[0].sum != total)
+		throw failure("pol: root sum " + std::to_string(levels.back()[0].sum) + " instead of " + std::to_string(total));
+
+	must_fail("commit without admin", host::push_action(BANK_ACC, name("commitpol"), TEST_ACC,
+		eosio::checksum256(levels.back()[0].hash), asset(total, DUSD), time_point()));
+	must_pass("commit root", host::push_action(BANK_ACC, name("commitpol"), ADMIN_ACC,
+		eosio::checksum256(levels.back()[0].hash), asset(total, DUSD), time_point()));
+	for(size_t i = 0; i < owners.size(); i++)
+		must_pass("verify " + owners[i].to_string(), verifypol(owners[i], asset(leaves[i].sum, DUSD), pol::proof_path(levels, i)));
+	must_fail("verify wrong balance", verifypol(BUYER, asset(leaves[1].sum + 1, DUSD), pol::proof_path(levels, 1)));
+	must_fail("verify path of another leaf", verifypol(BUYER, asset(leaves[1].sum, DUSD), pol::proof_path(levels, 0)));
+
+	// amount of snapshot must have exact precision of the token, integer is in minimal units
+	if(pol::parse_amount("12.34", 2) != 1234 || pol::parse_amount("1234", 2) != 1234)
+		throw failure("pol: amounts are misread");
+	for(const char* bad : {"1.5", "1.500", ".50", "-1.00", "1.2.3"}) {
+		bool thrown = false;
+		try {
+			pol::parse_amount(bad, 2);
+		}
+		catch(const std::runtime_error&) {
+			thrown = true;
+		}
+		if(!thrown)
+			throw failure(std::string("pol: amount ") + bad + " is accepted");
+	}
+}
+
+const std::vector<scenario> all = {
+	{"boot",     boot_flow},
+	{"dps",      dps_flow},
+	{"eos",      eos_flow},
+	{"rollback", rollback_flow},
+	{"sdk",      sdk_flow},
+	{"indexer",  indexer_flow},
+	{"export",   export_flow},
+	{"health",   health_flow},
+	{"oracle",   oracle_flow},
+	{"deposits", deposits_flow},
+	{"payouts",  payouts_flow},
+	{"hedge",    hedge_flow},
+	{"shards",   shards_flow},
+	{"stablecoin", stablecoin_flow},
+	{"ccdbond",  ccdbond_flow},
+	{"fcaccrual", fcaccrual_flow},
+	{"sweep",    sweep_flow},
+	{"snapshots", snapshots_flow},
+	{"profit",   profit_flow},
+	{"savings",  savings_flow},
+	{"redeemqueue", redeemqueue_flow},
+	{"batch",    batch_flow},
+	{"pol",      pol_flow},
+};
+
+} // namespace scenarios
@@ -0,0 +1,84 @@
+/**
+ *  scenarios.hpp -- scripted action sequences over host builds of contracts
+ *  Helpers follow shell wrappings of test/common.sh, accounts are the ones of test/env.sh.
+ */
+#pragma once
+
+#include "chain.hpp"
+
+#include <eosio/asset.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace scenarios {
+
+using eosio::asset;
+using eosio::name;
+using eosio::symbol;
+
+const name BANK_ACC("thedeposbank");
+const name CUSTODIAN_ACC("deposcustody");
+const name ADMIN_ACC("deposadmin11");
+const name ORACLE_ACC("deposoracle1");
+const name DEVEL_ACC("deposdevelop");
+const name BITMEX_ACC("bitmex");
+const name EOSIO_TOKEN("eosio.token");
+const name TEST_ACC("depostest114");
+const name BUYER("depostest115");
+
+const symbol DUSD("DUSD", 2);
+const symbol DPS("DPS", 8);
+const symbol DBTC("DBTC", 8);
+const symbol EOS("EOS", 4);
+
+struct failure : std::runtime_error {
+	using std::runtime_error::runtime_error;
+};
+
+/**
+ * Fresh chain with bank, custodian and eosio.token deployed, tokens created and variables set
+ * as test/boot.sh does, oracle data set. Checks are disabled by "settlement" variable.
+ */
+void boot();
+
+/**
+ * boot() with checks enabled, TEST_ACC holding DBTC, EOS, DUSD and DPS and DPS listed for sale,
+ * every exchange path can be executed from this state. Used by benchmarks and cost reports.
+ */
+void exchange_state();
+
+// parameters are in units of the same scale as in variables table
+host::transaction_result setvar(name varname, int64_t value);
+host::transaction_result setperiodic(name varname, int64_t value);
+host::transaction_result setstat(name varname, int64_t value);
+
+host::transaction_result transfer(name from, name to, asset quantity, const std::string& memo);
+host::transaction_result transfer_dbtc(name from, name to, asset quantity, const std::string& memo);
+host::transaction_result transfer_eos(name from, name to, asset quantity, const std::string& memo);
+host::transaction_result issue_eos(name to, asset quantity);
+host::transaction_result mint_dbtc(name user, int64_t satoshi_amount);
+host::transaction_result listdpssale(asset target_total_supply, asset price);
+host::transaction_result checkinvars();
+host::transaction_result sweepshards();
+host::transaction_result fillredeems(uint64_t max);
+
+asset get_balance(name contract, name owner, symbol sym);
+
+// throw failure, if transaction result is not as expected
+void must_pass(const std::string& title, const host::transaction_result& result);
+void must_fail(const std::string& title, const host::transaction_result& result);
+void must_equal(const std::string& title, const asset& actual, const asset& expected);
+
+struct scenario {
+	const char* name;
+	void (*run)();
+};
+
+extern const std::vector<scenario> all;
+
+} // namespace scenarios
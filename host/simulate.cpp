@@ -0,0 +1,321 @@
+/**
+ *  simulate.cpp -- Monte Carlo simulator of bank balance sheet for tuning limit and hedge variables
+ *  usage: simulate [-N runs] [-j threads] [-d days] [-o orders_per_hour] [-s order_usd] [-v volatility]
+ *                  [-f prices.csv] [-u users] [-r seed] [-p varname=value[,value]...]...
+ *
+ *  Every run boots the chain (see scenarios.hpp), sets 'system' variables given by -p and replays
+ *  hourly BTC price path and random order flow through unchanged bank and custodian contracts, so
+ *  limits, fees and supply balancing are exactly those of limitations.hpp and utility.hpp.
+ *  Price path is geometric Brownian motion with given annual volatility, or hourly prices in USD
+ *  from CSV file (last field of each line, lines without a number are skipped).
+ *  Orders are mints (DBTC => DUSD) and redemptions (DUSD => DBTC) of equal probability, Poisson
+ *  number per hour, log-normal USD value. Oracle sets btcusd.low/high at +-50% around the price.
+ *
+ *  -p with several comma separated values sweeps all combinations, values are integers in the
+ *  scale of variables table, e.g. -p maxdayvol=100000000000000,500000000000000 -p mincapshare=1000000000
+ *  Runs are spread over threads, each thread has its own chain. For each combination reports:
+ *    rejected   share of order volume rejected, mean and 95th percentile over runs
+ *    capratio   minimal bank capital / DUSD supply during run, mean and 5th percentile
+ *    liqsoft    hours when liquidity pool is out of [capital/4, capital*3/4], as check_liquidity() sees it
+ *    liqhard    hours when liquidity pool exceeds capital
+ *    churn      DUSD issued and retired by supply balancing, in USD
+ *  and rejection reasons with their share of rejected volume.
+ */
+
+#include "scenarios.hpp"
+#include "contracts.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace scenarios;
+
+namespace {
+
+const uint64_t hour_us = 3600ull * 1000000;
+const double   initial_price = 10000;     // boot() sets btcusd to 10000 USD
+
+struct options {
+	size_t          runs = 100;
+	unsigned        threads = max(1u, thread::hardware_concurrency());
+	size_t          hours = 30 * 24;
+	double          orders_per_hour = 20;
+	double          order_usd = 100;
+	double          volatility = 0.8;
+	size_t          users = 20;
+	uint64_t        seed = 1;
+	vector<double>  prices;               // from CSV, empty for synthetic path
+};
+
+using parameters = vector<pair<name, int64_t>>;
+
+struct run_result {
+	double              volume = 0;
+	double              rejected = 0;
+	double              min_capital_ratio = 1e9;
+	int                 soft_liquidity_hours = 0;
+	int                 hard_liquidity_hours = 0;
+	double              churn = 0;
+	map<string, double> reasons;          // rejected USD by check() message
+};
+
+vector<double> read_prices(const string& file) {
+	ifstream in(file);
+	if(!in)
+		throw runtime_error("cannot read " + file);
+	vector<double> result;
+	string line;
+	while(getline(in, line)) {
+		auto comma = line.find_last_of(",;\t ");
+		string field = comma == string::npos ? line : line.substr(comma + 1);
+		char* end = nullptr;
+		double price = strtod(field.c_str(), &end);
+		if(end != field.c_str() && price > 0)
+			result.push_back(price);
+	}
+	if(result.size() < 2)
+		throw runtime_error("no prices in " + file);
+	return result;
+}
+
+name user_name(size_t i) {
+	string str = "simuser";
+	for(int d = 0; d < 5; d++, i /= 26)
+		str += char('a' + i % 26);
+	return name(str);
+}
+
+string failure_reason(const host::transaction_result& result) {
+	// DEBUG builds fail with empty message on overdrawn balance
+	return result.error.empty() ? "(empty message)" : result.error;
+}
+
+host::transaction_result set_oracle_price(double usd) {
+	auto value = int64_t(usd * 1e8);
+	auto setperiodic = [](const char* varname, int64_t v) {
+		return host::make_action(BANK_ACC, name("setvar"), ORACLE_ACC, name("periodic"), name(varname), v);
+	};
+	return host::push_transaction({
+		setperiodic("btcusd.low", value / 2),
+		setperiodic("btcusd.high", value / 2 * 3),
+		setperiodic("btcusd", value),
+	});
+}
+
+run_result simulate(const options& opt, const parameters& params, uint64_t seed) {
+	mt19937_64 rng(seed);
+	normal_distribution<double> gauss;
+	poisson_distribution<int> orders(opt.orders_per_hour);
+	// log-normal with mean order_usd
+	lognormal_distribution<double> order_size(log(opt.order_usd) - 0.5, 1.0);
+
+	// users are funded with checks disabled, as it is done by test/boot.sh
+	boot();
+	vector<name> users;
+	for(size_t i = 0; i < opt.users; i++) {
+		users.push_back(user_name(i));
+		host::create_account(users.back());
+		must_pass("fund " + users.back().to_string(), mint_dbtc(users.back(), 100000000));
+	}
+	for(const auto& [varname, value] : params)
+		must_pass("setvar " + varname.to_string(), setvar(varname, value));
+	must_pass("settlement", setvar(name("settlement"), 0));
+
+	run_result r;
+	double price = initial_price;
+	double dt = 1.0 / (365 * 24);
+	size_t hours = opt.prices.empty() ? opt.hours : opt.prices.size();
+
+	for(size_t h = 0; h < hours; h++) {
+		host::advance_time(hour_us);
+
+		price = opt.prices.empty()
+			? price * exp(opt.volatility * sqrt(dt) * gauss(rng) - 0.5 * opt.volatility * opt.volatility * dt)
+			: opt.prices[h];
+		int64_t supply_before = host::read_bank_state().dusd_supply;
+		auto oracle = set_oracle_price(price);
+		if(oracle.failed)
+			r.reasons["oracle: " + failure_reason(oracle)] += 0;
+		r.churn += abs(host::read_bank_state().dusd_supply - supply_before) / 100.0;
+
+		for(int n = orders(rng); n > 0; n--) {
+			name user = users[rng() % users.size()];
+			double usd = order_size(rng);
+			int64_t dusd = get_balance(BANK_ACC, user, DUSD).amount;
+			bool redeem = (rng() & 1) && dusd > 0;
+			host::transaction_result result;
+			if(redeem) {
+				int64_t cents = min(dusd, max<int64_t>(1, int64_t(usd * 100)));
+				usd = cents / 100.0;
+				result = transfer(user, BANK_ACC, asset(cents, DUSD), "Redeem for DBTC");
+			}
+			else {
+				int64_t satoshi = max<int64_t>(1, int64_t(usd / price * 1e8));
+				result = transfer_dbtc(user, BANK_ACC, asset(satoshi, DBTC), "Buy DUSD");
+			}
+			r.volume += usd;
+			if(result.failed) {
+				r.rejected += usd;
+				r.reasons[failure_reason(result)] += usd;
+			}
+		}
+
+		auto bank = host::read_bank_state();
+		if(bank.dusd_supply > 0)
+			r.min_capital_ratio = min(r.min_capital_ratio, 1.0 * bank.capital / bank.dusd_supply);
+		if(bank.liquidity_pool < bank.capital / 4 || bank.liquidity_pool > bank.capital * 3 / 4)
+			r.soft_liquidity_hours++;
+		if(bank.liquidity_pool > bank.capital)
+			r.hard_liquidity_hours++;
+	}
+	return r;
+}
+
+vector<parameters> combinations(const vector<pair<name, vector<int64_t>>>& sweep) {
+	vector<parameters> result(1);
+	for(const auto& [varname, values] : sweep) {
+		vector<parameters> next;
+		for(const auto& p : result)
+			for(auto v : values) {
+				next.push_back(p);
+				next.back().emplace_back(varname, v);
+			}
+		result = move(next);
+	}
+	return result;
+}
+
+double percentile(vector<double> v, double p) {
+	if(v.empty())
+		return 0;
+	sort(v.begin(), v.end());
+	return v[min(v.size() - 1, size_t(p * v.size()))];
+}
+
+double mean(const vector<double>& v) {
+	double sum = 0;
+	for(auto x : v)
+		sum += x;
+	return v.empty() ? 0 : sum / v.size();
+}
+
+void report(const parameters& params, const vector<run_result>& results) {
+	vector<double> rejected, capratio, soft, hard, churn;
+	map<string, double> reasons;
+	double rejected_total = 0;
+	for(const auto& r : results) {
+		rejected.push_back(r.volume > 0 ? r.rejected / r.volume : 0);
+		capratio.push_back(r.min_capital_ratio);
+		soft.push_back(r.soft_liquidity_hours);
+		hard.push_back(r.hard_liquidity_hours);
+		churn.push_back(r.churn);
+		for(const auto& [msg, usd] : r.reasons)
+			reasons[msg] += usd;
+		rejected_total += r.rejected;
+	}
+
+	string title;
+	for(const auto& [varname, value] : params)
+		title += (title.empty() ? "" : " ") + varname.to_string() + "=" + to_string(value);
+	printf("%s\n", title.empty() ? "(boot variables)" : title.c_str());
+	printf("  rejected  %7.3f%% mean, %7.3f%% p95\n", 100 * mean(rejected), 100 * percentile(rejected, 0.95));
+	printf("  capratio  %7.3f mean, %7.3f p5\n", mean(capratio), percentile(capratio, 0.05));
+	printf("  liqsoft   %7.1f hours mean, %7.1f p95\n", mean(soft), percentile(soft, 0.95));
+	printf("  liqhard   %7.1f hours mean, %7.1f p95\n", mean(hard), percentile(hard, 0.95));
+	printf("  churn     %7.0f USD mean, %7.0f p95\n", mean(churn), percentile(churn, 0.95));
+	for(const auto& [msg, usd] : reasons)
+		printf("  %6.2f%%  %s\n", rejected_total > 0 ? 100 * usd / rejected_total : 0, msg.c_str());
+}
+
+void usage() {
+	cerr << "usage: simulate [-N runs] [-j threads] [-d days] [-o orders_per_hour] [-s order_usd] [-v volatility]" << endl
+	     << "                [-f prices.csv] [-u users] [-r seed] [-p varname=value[,value]...]..." << endl;
+	exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	options opt;
+	vector<pair<name, vector<int64_t>>> sweep;
+
+	try {
+		for(int i = 1; i < argc; i++) {
+			string arg = argv[i];
+			if(i + 1 >= argc)
+				usage();
+			string value = argv[++i];
+			if(arg == "-N")
+				opt.runs = max(1, atoi(value.c_str()));
+			else if(arg == "-j")
+				opt.threads = max(1, atoi(value.c_str()));
+			else if(arg == "-d")
+				opt.hours = max(1, atoi(value.c_str())) * 24;
+			else if(arg == "-o")
+				opt.orders_per_hour = atof(value.c_str());
+			else if(arg == "-s")
+				opt.order_usd = atof(value.c_str());
+			else if(arg == "-v")
+				opt.volatility = atof(value.c_str());
+			else if(arg == "-f")
+				opt.prices = read_prices(value);
+			else if(arg == "-u")
+				opt.users = max(1, atoi(value.c_str()));
+			else if(arg == "-r")
+				opt.seed = strtoull(value.c_str(), nullptr, 10);
+			else if(arg == "-p") {
+				auto eq = value.find('=');
+				if(eq == string::npos)
+					usage();
+				vector<int64_t> values;
+				istringstream in(value.substr(eq + 1));
+				string v;
+				while(getline(in, v, ','))
+					values.push_back(llround(stod(v)));
+				sweep.emplace_back(name(value.substr(0, eq)), values);
+			}
+			else
+				usage();
+		}
+
+		for(const auto& params : combinations(sweep)) {
+			vector<run_result> results(opt.runs);
+			atomic<size_t> next{0};
+			vector<thread> workers;
+			string error;
+			for(unsigned t = 0; t < min<size_t>(opt.threads, opt.runs); t++)
+				workers.emplace_back([&]() {
+					try {
+						for(size_t run; (run = next++) < opt.runs; )
+							results[run] = simulate(opt, params, opt.seed + run);
+					}
+					catch(const exception& e) {
+						error = e.what();
+						next = opt.runs;
+					}
+				});
+			for(auto& w : workers)
+				w.join();
+			if(!error.empty())
+				throw runtime_error(error);
+			report(params, results);
+		}
+	}
+	catch(const exception& e) {
+		cerr << "simulate: " << e.what() << endl;
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,51 @@
+/**
+ *  token_contract.cpp -- eosio.token stand-in for host builds, see contracts.hpp
+ */
+
+#include "prelude.hpp"
+#include "contracts.hpp"
+
+namespace host_eosio_token {
+
+using std::pow;
+
+#include <depostoken.hpp>
+
+class eosio_token : public token {
+public:
+	using token::token;
+
+	void create(name issuer, asset maximum_supply) {
+		token::create(issuer, maximum_supply);
+	}
+
+	void issue(name to, asset quantity, string memo) {
+		token::issue(to, quantity, memo);
+	}
+
+	void transfer(name from, name to, asset quantity, string memo) {
+		check_transfer(from, to, quantity, memo);
+		sub_balance(from, quantity);
+		add_balance(to, quantity, from);
+	}
+
+	void open(name owner, const symbol& symbol, name ram_payer) {
+		token::open(owner, symbol, ram_payer);
+	}
+};
+
+} // namespace host_eosio_token
+
+void host::eosio_token_apply(eosio::name receiver, eosio::name code, eosio::name action, const std::vector<char>& data) {
+	using host_eosio_token::eosio_token;
+
+	if(code != receiver)
+		return;
+	switch(action.value) {
+		HOST_DISPATCH_ACTION(eosio_token, create)
+		HOST_DISPATCH_ACTION(eosio_token, issue)
+		HOST_DISPATCH_ACTION(eosio_token, transfer)
+		HOST_DISPATCH_ACTION(eosio_token, open)
+	}
+	eosio::check(false, "unknown action");
+}
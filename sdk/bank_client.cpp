@@ -0,0 +1,222 @@
+/**
+ *  bank_client.cpp -- quoter of bank_client.hpp, built like host/bank_contract.cpp: contract sources
+ *  are compiled in a namespace of their own against host build of eosio, see host/prelude.hpp
+ */
+
+#include "prelude.hpp"
+#include "chain.hpp"
+#include "bank_client.hpp"
+
+#include <functional>
+#include <optional>
+
+namespace bank_client_contract {
+
+using std::pow;
+
+#include <depostoken.hpp>
+#include <limitations.hpp>
+
+#include "dbond_serialization.hpp"
+
+} // namespace bank_client_contract
+
+namespace bank_client {
+
+using namespace bank_client_contract;
+
+struct quoter::impl {
+	host::private_chain               chain;
+	std::optional<conversion_rates<>> rates;
+	std::string                       main_switch;    // error of check_main_switch(), empty if conversions are on
+
+	// runs contract code as an action of thedeposbank, its writes are reverted; returns error of check()
+	static std::string run(const std::function<void()>& body) {
+		return host::push_code(BANKACCOUNT, body, false).error;
+	}
+
+	static asset to_asset(const order& o) {
+		for(auto sym : {DUSD, DPS, DBTC, EOS})
+			if(sym.code().to_string() == o.symbol)
+				return {o.amount, sym};
+		return {o.amount, symbol(symbol_code(o.symbol), 0)};
+	}
+
+	order_kind classify(const order& o, std::string& error) const {
+		name from(o.from), to(o.to), contract(o.contract);
+		asset quantity = to_asset(o);
+		error.clear();
+		if(contract == BANKACCOUNT) {
+			// bank::transfer
+			if((from != BANKACCOUNT && to != BANKACCOUNT) || o.memo == "deny")
+				return p2p;
+			if(from == BANKACCOUNT)
+				return p2p;
+			if(quantity.symbol == DUSD) {
+				if(match_memo(o.memo, "Batch redeem for EOS") || match_memo(o.memo, "Batch redeem for DBTC"))
+					return batch;
+				if(match_memo(o.memo, "Buy DPS"))
+					return buy_dps;
+				if(is_dusd_redeem(from, to, extended_asset(quantity, contract), o.memo))
+					return match_memo(o.memo, "Redeem for DBTC") ? redeem_dbtc : match_memo(o.memo, "Redeem for EOS") ? redeem_eos : redeem_btc;
+				error = "transfer not allowed 3";
+				return invalid;
+			}
+			if(quantity.symbol == DPS) {
+				if(match_memo(o.memo, "Redeem for DUSD"))
+					return redeem_dps;
+				error = "transfer not allowed 4";
+				return invalid;
+			}
+			error = "transfer not allowed 5";
+			return invalid;
+		}
+		if(to != BANKACCOUNT)
+			return p2p;
+		// bank::ontransfer
+		extended_asset payment(quantity, contract);
+		if(!is_approved_liquid_asset(payment)) {
+			error = "transfer not allowed 6";
+			return invalid;
+		}
+		if(match_memo(o.memo, "Batch buy DUSD"))
+			return batch;
+		if(is_dusd_mint(from, to, payment, o.memo))
+			return quantity.symbol == DBTC ? mint_dbtc : mint_eos;
+		if(is_technical_transfer(contract, from, quantity, o.memo))
+			return technical;
+		error = "transfer not allowed 9";
+		return invalid;
+	}
+
+	int64_t convert(order_kind kind, asset quantity) const {
+		switch(kind) {
+		case mint_dbtc:   return rates->satoshi2coin(quantity.amount).amount;
+		case mint_eos:    return rates->eos2coin(quantity.amount).amount;
+		case redeem_dbtc:
+		case redeem_btc:  return rates->coin2satoshi(quantity);
+		case redeem_eos:  return rates->coin2eos(quantity);
+		case p2p:         return quantity.amount;
+		default:          return 0;
+		}
+	}
+
+	// checks in the order contracts execute them
+	void validate(const order& o, quote& q) const {
+		auto fail = [&](const std::string& msg) {
+			if(q.error.empty())
+				q.error = msg;
+		};
+		name from(o.from), to(o.to), contract(o.contract);
+		asset quantity = to_asset(o);
+		extended_asset payment(quantity, contract);
+		bool bank_token = contract == BANKACCOUNT;
+		std::string memo_error = std::move(q.error);
+		q.error.clear();
+
+		if(contract == CUSTODIAN)
+			fail(main_switch);
+		if(from == to)
+			fail("cannot transfer to self");
+		if(o.amount <= 0)
+			fail("must transfer positive quantity");
+		if(o.memo.size() > 256)
+			fail("memo has more than 256 bytes");
+		if(bank_token)
+			fail(main_switch);
+
+		if(q.kind == p2p) {
+			// only thedeposbank charges transfer fee, see bank::process_regular_transfer()
+			if(bank_token)
+				fail(run([&] { q.fee = get_transfer_fee(quantity); }));
+			if(o.balance >= 0 && o.amount + q.fee > o.balance)
+				fail("overdrawn balance");
+			return;
+		}
+		// tokens leave sender before notification of thedeposbank
+		if(!bank_token && o.balance >= 0 && o.amount > o.balance)
+			fail("overdrawn balance");
+		// bank::process_batch_intent()
+		if(q.kind == batch) {
+			symbol_code want = !bank_token ? DUSD.code() : match_memo(o.memo, "Batch redeem for EOS") ? EOS.code() : DBTC.code();
+			fail(run([&] {
+				add_batch_intent(from, quantity, want);
+				check_batch_intent(payment, want);
+			}));
+			if(bank_token && o.balance >= 0 && o.amount > o.balance)
+				fail("overdrawn balance");
+			return;
+		}
+		// queued redemption skips check_on_transfer(), escrow checks balance only
+		bool redeem = q.kind == redeem_dbtc || q.kind == redeem_btc || q.kind == redeem_eos;
+		if(redeem && q.error.empty()) {
+			fail(run([&] { q.queued = must_queue_redeem(from, quantity, o.memo); }));
+			if(q.queued) {
+				if(o.balance >= 0 && o.amount > o.balance)
+					fail("overdrawn balance");
+				return;
+			}
+		}
+		if(q.kind >= mint_dbtc && q.kind <= redeem_eos) {
+			fail(run([&] {
+				q.usd_value = get_usd_value(payment);
+				check_on_transfer(from, to, payment, o.memo);
+			}));
+		}
+		fail(memo_error);
+
+		if(q.kind == buy_dps) {
+			asset change;
+			fail(run([&] {
+				q.receive = get_dps_for_sale(quantity, change).amount;
+				q.change = change.amount;
+				check(q.receive > 0, "there is no DPS for sale at the moment");
+			}));
+		}
+		if(q.kind == redeem_dps)
+			fail(run([&] { q.receive = dps2dusd(quantity, true).amount; }));
+		if(bank_token && o.balance >= 0 && o.amount > o.balance)
+			fail("overdrawn balance");
+		if(contract == EOSIOTOKEN)
+			fail(main_switch);
+	}
+};
+
+quoter::quoter(const snapshot& s, int64_t now) {
+	auto own = std::make_unique<impl>();
+	own->chain.use([&] {
+		host::set_time(now);
+		for(const auto& row : s.rows)
+			host::load_row(name(row.code), row.scope, name(row.table), row.primary_key, row.data);
+		own->rates.emplace();
+		own->main_switch = impl::run([] { check_main_switch(); });
+	});
+	this->own = std::move(own);
+}
+
+quoter::~quoter() = default;
+
+order_kind quoter::classify(const order& o, std::string& error) const {
+	return own->chain.use([&] { return own->classify(o, error); });
+}
+
+void quoter::price_batch(const order* orders, size_t n, quote* out) const {
+	own->chain.use([&] {
+		for(size_t i = 0; i < n; i++) {
+			out[i] = {};
+			out[i].kind = own->classify(orders[i], out[i].error);
+		}
+		for(size_t i = 0; i < n; i++)
+			out[i].receive = own->convert(out[i].kind, impl::to_asset(orders[i]));
+		for(size_t i = 0; i < n; i++)
+			own->validate(orders[i], out[i]);
+	});
+}
+
+quote quoter::price(const order& o) const {
+	quote result;
+	price_batch(&o, 1, &result);
+	return result;
+}
+
+} // namespace bank_client
@@ -0,0 +1,127 @@
+/**
+ *  bank_client.hpp -- client library for pricing and pre-validation of orders to thedeposbank
+ *
+ *  bank_client.cpp is built from contract sources: conversions, limits and memo matching are those
+ *  of contracts/utility.hpp, contracts/limitations.hpp and contracts/stablecoin.hpp, run by host
+ *  build of eosio (see host/chain.hpp) over a private chain, which holds rows of the snapshot only.
+ *  So a change of any contract function is a change of quotes, nothing is copied here. Only the
+ *  order of checks of bank::transfer and bank::ontransfer, which are actions, is repeated by the
+ *  quoter; the 'sdk' scenario of host/scenarios.cpp executes random orders on host build of
+ *  contracts and checks that results and error messages are the same.
+ *
+ *  Checks of bank balance sheet done by check_on_system_change() after an exchange (liquidity,
+ *  leverage, capital) are not pre-validated: they depend on all bank assets and dbonds.
+ *  DUSD redemption, which must_queue_redeem() of limitations.hpp sends to redemption queue, is
+ *  quoted with 'queued' set and 'receive' at prices of the snapshot, it is filled at prices of fill time.
+ *  Intents of batch mode (see contracts/batch.hpp) are validated only, they are priced by settlement.
+ *  Every order is validated against the snapshot as if it were the only one.
+ *
+ *  Snapshot holds binary rows, as get_table_rows returns them with "json": false, of tables:
+ *    thedeposbank: 'variables' of scopes system, periodic and stat; 'accounts' of scope thedeposbank;
+ *                  'stat' of scopes DUSD and DPS; 'profitpool', 'epoch', 'volshards' of scope
+ *                  thedeposbank; 'rdmqueue' of scopes DBTC and EOS;
+ *    deposcustody and eosio.token: 'accounts' of scope thedeposbank.
+ *  A table missing from the snapshot is read as empty. A variable missing from it fails orders,
+ *  which need it, with the message of the contract; quoter throws std::runtime_error, if variables
+ *  of conversion rates are missing.
+ *
+ *  Usage:
+ *    bank_client::snapshot s;
+ *    s.add_row(code, scope, table, primary_key, data);      // every row of tables above
+ *    bank_client::quoter q(s, now_us);
+ *    q.price_batch(orders.data(), orders.size(), quotes.data());
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bank_client {
+
+// names and scopes are raw uint64_t values of eosio names and symbol codes
+struct table_row {
+	uint64_t          code;
+	uint64_t          scope;
+	uint64_t          table;
+	uint64_t          primary_key;
+	std::vector<char> data;
+};
+
+/**
+ * State of the bank the orders are validated against, see the list of tables above.
+ */
+struct snapshot {
+	std::vector<table_row> rows;
+
+	void add_row(uint64_t code, uint64_t scope, uint64_t table, uint64_t primary_key, std::vector<char> data) {
+		rows.push_back({code, scope, table, primary_key, std::move(data)});
+	}
+};
+
+struct order {
+	std::string from;
+	std::string to;
+	std::string contract;       // token contract: thedeposbank, deposcustody or eosio.token
+	std::string symbol;         // DUSD, DPS, DBTC or EOS
+	int64_t     amount = 0;     // in minimal units of the token
+	std::string memo;
+	int64_t     balance = -1;   // balance of 'from' in the same token, if known, to check overdraft
+};
+
+enum order_kind : int {
+	invalid,
+	mint_dbtc,      // DBTC => DUSD
+	mint_eos,       // EOS => DUSD
+	redeem_dbtc,    // DUSD => DBTC
+	redeem_btc,     // DUSD => BTC address in memo, DBTC goes to custodian redeem order
+	redeem_eos,     // DUSD => EOS
+	buy_dps,        // DUSD => DPS at sale price
+	redeem_dps,     // DPS => DUSD at nominal price
+	p2p,            // transfer without exchange
+	technical,      // DBTC to thedeposbank without "Buy DUSD" memo: accepted, nothing is returned
+	batch,          // intent of batch epoch: DBTC, EOS or DUSD waits for 'settleepoch'
+	order_kinds
+};
+
+struct quote {
+	order_kind  kind = invalid;
+	int64_t     receive = 0;        // minimal units of the token received: DUSD, DBTC, EOS or DPS
+	int64_t     change = 0;         // DUSD returned from DPS purchase
+	int64_t     fee = 0;            // transfer fee of p2p transfer, charged above amount
+	int64_t     usd_value = 0;      // cents counted by check_limits(), 0 if order is not a user exchange
+	bool        queued = false;     // redemption goes to redemption queue, DUSD is escrowed till 'fillredeems'
+	std::string error;              // empty, if order passes, otherwise message of failing check()
+};
+
+/**
+ * Prices and validates orders against one snapshot. Conversion rates and the main switch are
+ * read once by constructor, each order runs contract checks of its kind on the private chain.
+ * Bitcoin network of BTC addresses is that of the build, -DBITCOIN_TESTNET as for contracts.
+ */
+class quoter {
+public:
+	quoter(const snapshot& s, int64_t now);
+	~quoter();
+	quoter(const quoter&) = delete;
+	quoter& operator=(const quoter&) = delete;
+
+	// kind of order by memo dispatch of bank::transfer and bank::ontransfer, 'error' is set for invalid
+	order_kind classify(const order& o, std::string& error) const;
+
+	/**
+	 * Prices and validates 'n' orders into 'out'. Memos are classified first, then amounts are
+	 * converted at the rates read by constructor, then contract checks are run.
+	 */
+	void price_batch(const order* orders, size_t n, quote* out) const;
+
+	quote price(const order& o) const;
+
+private:
+	struct impl;
+	std::unique_ptr<impl> own;
+};
+
+} // namespace bank_client
@@ -43,6 +43,9 @@ setvar dpssaleprice                1000
 setvar fee.mint              ,5000,0000
 setvar fee.redeem            ,5000,0000
 setvar fee.transfer                   0
+setvar hedge.band          10,0000,0000
+setvar hedge.cool                  3600
+setvar hedge.minord          100,0000
 setvar liqpool.max         20,0000,0000
 setvar liqpool.min                    0
 setvar maxdataage    10,000,000,000,000
@@ -173,3 +176,6 @@ transfer $TEST_ACC $DBONDS "10.00 DUSD" "retire $bond_name"
 pause
 
 evaluate_assets
+
+title "Check solvency invariants"
+must_pass "Check solvency invariants" checkinvars
@@ -108,3 +108,73 @@ function mint_dbtc() {
 	cleos -u $API_URL push action "$CUSTODIAN_ACC" mint "[\"$user\", \"DBTC\", $amount, \"$txid\"]" -p $CUSTODIAN_ACC@active
 }
 
+function fill_hedge() {
+	order_id=$1
+	txid=$2
+	cleos -u $API_URL push action "$CUSTODIAN_ACC" fillhedge "[$order_id, \"$txid\"]" -p $CUSTODIAN_ACC@active
+}
+
+
+function checkinvars() {
+	cleos -u $API_URL push action $BANK_ACC checkinvars "[]" -p $TEST_ACC@active
+}
+
+function rebalance() {
+	cleos -u $API_URL push action $BANK_ACC rebalance "[]" -p $TEST_ACC@active
+}
+
+function sweepshards() {
+	cleos -u $API_URL push action $BANK_ACC sweepshards "[]" -p $TEST_ACC@active
+	cleos -u $API_URL push action $CUSTODIAN_ACC sweepshards "[]" -p $TEST_ACC@active
+}
+
+# parameters: <token symbol: DUSD, DPS or DBTC>
+function seedledger() {
+	if [ "$1" == "DBTC" ]; then
+		cleos -u $API_URL push action $CUSTODIAN_ACC seedledger "[\"$1\"]" -p $ADMIN_ACC@active
+	else
+		cleos -u $API_URL push action $BANK_ACC seedledger "[\"$1\"]" -p $ADMIN_ACC@active
+	fi
+}
+
+function snapshot() {
+	cleos -u $API_URL push action $BANK_ACC snapshot "[]" -p $ADMIN_ACC@active
+}
+
+function balanceat() {
+	cleos -u $API_URL push action $BANK_ACC balanceat "[\"$1\", $2]" -p $TEST_ACC@active
+}
+
+function distribute() {
+	cleos -u $API_URL push action $BANK_ACC distribute "[\"$1\"]" -p $ADMIN_ACC@active
+}
+
+function claim() {
+	cleos -u $API_URL push action $BANK_ACC claim "[\"$1\"]" -p $TEST_ACC@active
+}
+
+function withdraw() {
+	cleos -u $API_URL push action $BANK_ACC withdraw "[\"$1\", $2]" -p $1@active
+}
+
+function accrue() {
+	cleos -u $API_URL push action $BANK_ACC accrue "[]" -p $TEST_ACC@active
+}
+
+function fillredeems() {
+	cleos -u $API_URL push action $BANK_ACC fillredeems "[$1]" -p $TEST_ACC@active
+}
+
+# parameters: <requested asset: DBTC or EOS> <order id>
+function rdmposition() {
+	cleos -u $API_URL push action $BANK_ACC rdmposition "[\"$1\", $2]" -p $TEST_ACC@active
+}
+
+# parameters: <owner> <requested asset: DBTC or EOS> <order id>
+function rdmcancel() {
+	cleos -u $API_URL push action $BANK_ACC rdmcancel "[\"$1\", \"$2\", $3]" -p $1@active
+}
+
+function settleepoch() {
+	cleos -u $API_URL push action $BANK_ACC settleepoch "[]" -p $TEST_ACC@active
+}
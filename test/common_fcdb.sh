@@ -139,3 +139,8 @@ function transfer_to_sell {
 	bond_id=${4:-$bond_name}
 	cleos -u $API_URL push action $DBONDS transfer '["'$from'", "'$to'", "'"$qtty"'", "sell '$bond_id' to '$counterparty'"]' -p $from@active
 }
+
+function sweep {
+	max=${1:-10}
+	cleos -u $API_URL push action $BANK_ACC sweep '['$max']' -p $TEST_ACC@active
+}
@@ -147,3 +147,9 @@ function pause {
 		fi
 	fi
 }
+
+# print hourly buckets of given bank metric, ex. "mint.dbtc" or "lim.liq"
+function get_metric() {
+	metric=$1
+	cleos -u $API_URL get table -l 100 $BANK_ACC $metric metrics | jq -r '.rows[] | "\(.hour) \(.calls) \(.volume)"' | sort -n
+}
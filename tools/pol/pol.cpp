@@ -0,0 +1,135 @@
+/**
+ *  pol.cpp -- builds Merkle sum tree for proof of liabilities, see contracts/pol.hpp
+ *
+ *  Reads snapshot of balances from stdin, one "<account> <amount>" per line, where amount is
+ *  either integer in token's minimal units or decimal as printed by cleos ("12.34 DUSD") with
+ *  exactly the token's precision, given by -d (2 for DUSD by default).
+ *  Prints root and total to commit by 'commitpol' action. With -p <account> also prints proof path
+ *  for 'verifypol' action.
+ *
+ *  Leaves are hashed by worker threads while the snapshot is still being read, each level of the
+ *  tree is then hashed in parallel.
+ */
+
+#include "tree.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace pol;
+
+const size_t batch_size = 1 << 16;
+
+void usage() {
+	cerr << "usage: pol [-j threads] [-d decimals] [-x account]... [-p account] < snapshot" << endl;
+	exit(1);
+}
+
+int main(int argc, char** argv) {
+	unsigned threads = max(1u, thread::hardware_concurrency());
+	set<uint64_t> excluded;
+	string prove_for;
+	int precision = 2;
+
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if(i + 1 >= argc)
+			usage();
+		if(arg == "-j")
+			threads = max(1, atoi(argv[++i]));
+		else if(arg == "-d")
+			precision = max(0, atoi(argv[++i]));
+		else if(arg == "-x")
+			excluded.insert(name_value(argv[++i]));
+		else if(arg == "-p")
+			prove_for = argv[++i];
+		else
+			usage();
+	}
+
+	try {
+		uint64_t prove_owner = prove_for.empty() ? 0 : name_value(prove_for);
+		size_t prove_index = SIZE_MAX;
+		int64_t prove_amount = 0;
+
+		// read snapshot and hash leaves in batches, not waiting for the whole input
+		vector<future<vector<node>>> batches;
+		vector<pair<uint64_t, int64_t>> rows;
+		size_t count = 0;
+		string line;
+		while(getline(cin, line)) {
+			size_t a_begin = line.find_first_not_of(" \t");
+			size_t a_end = line.find_first_of(" \t", a_begin);
+			size_t v_begin = line.find_first_not_of(" \t", a_end);
+			if(v_begin == string::npos)
+				continue;
+			size_t v_end = line.find_first_of(" \t", v_begin);
+			string account = line.substr(a_begin, a_end - a_begin);
+			string amount = line.substr(v_begin, v_end == string::npos ? string::npos : v_end - v_begin);
+			uint64_t owner = name_value(account);
+			if(excluded.count(owner))
+				continue;
+			int64_t value = parse_amount(amount, precision);
+			if(owner == prove_owner && !prove_for.empty()) {
+				prove_index = count;
+				prove_amount = value;
+			}
+			rows.emplace_back(owner, value);
+			count++;
+			if(rows.size() == batch_size) {
+				batches.push_back(async(launch::async, hash_batch, move(rows)));
+				rows = {};
+			}
+			// keep number of batches in flight bounded by number of threads
+			if(batches.size() >= threads && batches[batches.size() - threads].valid())
+				batches[batches.size() - threads].wait();
+		}
+		if(!rows.empty())
+			batches.push_back(async(launch::async, hash_batch, move(rows)));
+
+		if(count == 0)
+			throw runtime_error("empty snapshot");
+		if(!prove_for.empty() && prove_index == SIZE_MAX)
+			throw runtime_error("account not found in snapshot: " + prove_for);
+
+		vector<node> leaves;
+		leaves.reserve(count);
+		for(auto& b : batches) {
+			auto nodes = b.get();
+			leaves.insert(leaves.end(), nodes.begin(), nodes.end());
+		}
+		auto levels = build_levels(move(leaves), threads);
+
+		const node& root = levels.back()[0];
+		cout << "root " << to_hex(root.hash) << endl;
+		cout << "total " << root.sum << endl;
+		cout << "count " << count << endl;
+
+		if(!prove_for.empty()) {
+			cout << "balance " << prove_amount << endl;
+			cout << "path [";
+			bool first = true;
+			for(const auto& sibling : proof_path(levels, prove_index)) {
+				cout << (first ? "" : ",") << "{\"hash\":\"" << to_hex(sibling.hash)
+				     << "\",\"sum\":" << sibling.sum
+				     << ",\"is_left\":" << (sibling.is_left ? "true" : "false") << "}";
+				first = false;
+			}
+			cout << "]" << endl;
+		}
+	}
+	catch(const exception& e) {
+		cerr << "pol: " << e.what() << endl;
+		return 2;
+	}
+	return 0;
+}
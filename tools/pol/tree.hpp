@@ -0,0 +1,165 @@
+/**
+ *  tree.hpp -- Merkle sum tree of tools/pol, byte layout as in contracts/pol.hpp
+ *
+ *  Shared by pol tool and host scenarios, which check its proofs against 'verifypol' action.
+ */
+#pragma once
+
+#include "../../host/sha256.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace pol {
+
+struct node {
+	hash256 hash;
+	int64_t sum;
+};
+
+// sibling of proof path, as 'pol_proof_node' of verifypol
+struct proof_node {
+	hash256 hash;
+	int64_t sum;
+	bool    is_left;
+};
+
+inline uint64_t char_to_value(char c) {
+	if(c == '.')
+		return 0;
+	if(c >= '1' && c <= '5')
+		return (c - '1') + 1;
+	if(c >= 'a' && c <= 'z')
+		return (c - 'a') + 6;
+	throw std::runtime_error(std::string("character is not in allowed character set for names: ") + c);
+}
+
+// same encoding as eosio::name
+inline uint64_t name_value(const std::string& str) {
+	if(str.size() > 13)
+		throw std::runtime_error("string is too long to be a valid name: " + str);
+	uint64_t value = 0;
+	size_t n = std::min(str.size(), size_t(12));
+	for(size_t i = 0; i < n; i++) {
+		value <<= 5;
+		value |= char_to_value(str[i]);
+	}
+	value <<= (4 + 5 * (12 - n));
+	if(str.size() == 13) {
+		uint64_t v = char_to_value(str[12]);
+		if(v > 0x0F)
+			throw std::runtime_error("thirteenth character in name cannot be a letter that comes after j");
+		value |= v;
+	}
+	return value;
+}
+
+// integer is taken in minimal units, decimal must have exactly 'precision' digits after the point,
+// as cleos prints it, so that "1.5" of a token with precision 2 is not read as 15 minimal units
+inline int64_t parse_amount(const std::string& str, int precision) {
+	size_t point = str.find('.');
+	std::string digits = str;
+	if(point != std::string::npos) {
+		if(point == 0 || str.size() - point - 1 != size_t(precision))
+			throw std::runtime_error("bad amount: " + str + ", expected " + std::to_string(precision) + " decimals");
+		digits.erase(point, 1);
+	}
+	if(digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos)
+		throw std::runtime_error("bad amount: " + str);
+	size_t pos = 0;
+	int64_t amount = std::stoll(digits, &pos);
+	if(pos != digits.size())
+		throw std::runtime_error("bad amount: " + str);
+	return amount;
+}
+
+inline void put_int64(uint8_t*& pos, uint64_t value) {
+	for(int i = 0; i < 8; i++)
+		*pos++ = uint8_t((value >> (8 * i)) & 0xff);
+}
+
+inline node leaf(uint64_t owner, int64_t amount) {
+	uint8_t buf[17];
+	uint8_t* pos = buf;
+	*pos++ = 0;
+	put_int64(pos, owner);
+	put_int64(pos, uint64_t(amount));
+	return {sha256(buf, sizeof(buf)), amount};
+}
+
+inline node parent(const node& left, const node& right) {
+	uint8_t buf[81];
+	uint8_t* pos = buf;
+	*pos++ = 1;
+	pos = std::copy(left.hash.begin(), left.hash.end(), pos);
+	put_int64(pos, uint64_t(left.sum));
+	pos = std::copy(right.hash.begin(), right.hash.end(), pos);
+	put_int64(pos, uint64_t(right.sum));
+	return {sha256(buf, sizeof(buf)), left.sum + right.sum};
+}
+
+inline std::string to_hex(const hash256& h) {
+	static const char digits[] = "0123456789abcdef";
+	std::string result;
+	for(auto b : h) {
+		result += digits[b >> 4];
+		result += digits[b & 0xf];
+	}
+	return result;
+}
+
+inline std::vector<node> hash_batch(std::vector<std::pair<uint64_t, int64_t>> rows) {
+	std::vector<node> result;
+	result.reserve(rows.size());
+	for(const auto& r : rows)
+		result.push_back(leaf(r.first, r.second));
+	return result;
+}
+
+// hash one level of the tree into the next one, using 'threads' workers
+inline std::vector<node> next_level(const std::vector<node>& level, unsigned threads) {
+	size_t pairs = level.size() / 2;
+	std::vector<node> result((level.size() + 1) / 2);
+	size_t chunk = (pairs + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	for(size_t begin = 0; begin < pairs; begin += chunk) {
+		size_t end = std::min(pairs, begin + chunk);
+		workers.emplace_back([&, begin, end]() {
+			for(size_t i = begin; i < end; i++)
+				result[i] = parent(level[2 * i], level[2 * i + 1]);
+		});
+	}
+	for(auto& w : workers)
+		w.join();
+	// node without a pair goes to the next level unchanged
+	if(level.size() % 2)
+		result.back() = level.back();
+	return result;
+}
+
+// levels of the tree from 'leaves' up to the root
+inline std::vector<std::vector<node>> build_levels(std::vector<node> leaves, unsigned threads) {
+	std::vector<std::vector<node>> levels;
+	levels.push_back(std::move(leaves));
+	while(levels.back().size() > 1)
+		levels.push_back(next_level(levels.back(), threads));
+	return levels;
+}
+
+// siblings of leaf 'index' from leaf level up to the root, node without a pair has no sibling
+inline std::vector<proof_node> proof_path(const std::vector<std::vector<node>>& levels, size_t index) {
+	std::vector<proof_node> path;
+	for(size_t l = 0; l + 1 < levels.size(); l++) {
+		size_t sibling = index ^ 1;
+		if(sibling < levels[l].size())
+			path.push_back({levels[l][sibling].hash, levels[l][sibling].sum, sibling < index});
+		index /= 2;
+	}
+	return path;
+}
+
+} // namespace pol